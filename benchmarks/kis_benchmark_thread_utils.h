@@ -0,0 +1,98 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_BENCHMARK_THREAD_UTILS_H
+#define __KIS_BENCHMARK_THREAD_UTILS_H
+
+#include <QTest>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+
+namespace KisBenchmarkThreadUtils {
+
+/**
+ * Adds the "numThreads" column to the data of a benchmark and the rows
+ * for 1, 2, 4, ... threads up to QThread::idealThreadCount()
+ */
+inline void addThreadCountRows()
+{
+    QTest::addColumn<int>("numThreads");
+
+    const int maxThreads = qMax(1, QThread::idealThreadCount());
+
+    int numThreads = 1;
+    for (; numThreads < maxThreads; numThreads *= 2) {
+        QTest::newRow(QString("%1 threads").arg(numThreads).toLatin1()) << numThreads;
+    }
+    QTest::newRow(QString("%1 threads").arg(maxThreads).toLatin1()) << maxThreads;
+}
+
+/**
+ * Limits the number of threads of the global thread pool, which is
+ * used by QtConcurrent, for the lifetime of the object
+ */
+class GlobalThreadCountLimiter
+{
+public:
+    GlobalThreadCountLimiter(int numThreads)
+        : m_oldMaxThreadCount(QThreadPool::globalInstance()->maxThreadCount())
+    {
+        QThreadPool::globalInstance()->setMaxThreadCount(numThreads);
+    }
+
+    ~GlobalThreadCountLimiter() {
+        QThreadPool::globalInstance()->setMaxThreadCount(m_oldMaxThreadCount);
+    }
+
+private:
+    Q_DISABLE_COPY(GlobalThreadCountLimiter)
+
+    int m_oldMaxThreadCount;
+};
+
+template <typename Func>
+class FunctionRunnable : public QRunnable
+{
+public:
+    FunctionRunnable(Func func, int index) : m_func(func), m_index(index) {}
+
+    void run() override {
+        m_func(m_index);
+    }
+
+private:
+    Func m_func;
+    int m_index;
+};
+
+/**
+ * Runs \p func(index) for every index in [0, \p numJobs) on the
+ * threads of \p pool and waits until all of them are finished
+ */
+template <typename Func>
+void runConcurrently(QThreadPool &pool, int numJobs, Func func)
+{
+    for (int i = 0; i < numJobs; i++) {
+        pool.start(new FunctionRunnable<Func>(func, i));
+    }
+    pool.waitForDone();
+}
+
+}
+
+#endif /* __KIS_BENCHMARK_THREAD_UTILS_H */
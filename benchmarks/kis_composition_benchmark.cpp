@@ -47,6 +47,9 @@
 #include <KoColorSpaceTraits.h>
 #include <KoCompositeOpAlphaDarken.h>
 #include <KoCompositeOpOver.h>
+#include <KoCompositeOpGeneric.h>
+#include <KoCompositeOpFunctions.h>
+#include <KoCompositeOpRegistry.h>
 #include "KoOptimizedCompositeOpFactory.h"
 
 // for posix_memalign()
@@ -127,6 +130,27 @@ struct RandomGenerator<quint8>
     boost::mt11213b m_rnd;
 };
 
+template <>
+struct RandomGenerator<quint16>
+{
+    RandomGenerator(int seed)
+        : m_smallint(0,65535),
+          m_rnd(seed)
+    {
+    }
+
+    quint16 operator() () {
+        return m_smallint(m_rnd);
+    }
+
+    quint16 unit() {
+        return KoColorSpaceMathsTraits<quint16>::unitValue;
+    }
+
+    boost::uniform_smallint<int> m_smallint;
+    boost::mt11213b m_rnd;
+};
+
 template <>
 struct RandomGenerator<float>
 {
@@ -255,6 +279,8 @@ QVector<Tile> generateTiles(int size,
 
         if (pixelSize == 4) {
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+        } else if (pixelSize == 8) {
+            generateDataLine<quint16>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else if (pixelSize == 16) {
             generateDataLine<float>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else {
@@ -281,6 +307,16 @@ inline bool fuzzyCompare(channel_type a, channel_type b, channel_type prec) {
     return qAbs(a - b) <= prec;
 }
 
+/**
+ * Some blending modes (e.g. Color Dodge) have no upper limit for
+ * floating point channels, so the values above the unit are compared
+ * relatively.
+ */
+template <>
+inline bool fuzzyCompare(float a, float b, float prec) {
+    return qAbs(a - b) <= prec * qMax(1.0f, qAbs(b));
+}
+
 template <typename channel_type>
 inline bool comparePixels(channel_type *p1, channel_type *p2, channel_type prec) {
     return (p1[3] == p2[3] && p1[3] == 0) ||
@@ -322,7 +358,19 @@ bool compareTwoOpsPixels(QVector<Tile> &tiles, channel_type prec) {
     return true;
 }
 
-bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2)
+/**
+ * The tolerance of the comparison of the vectorized ops against
+ * the scalar ones:
+ *
+ * U8:  10 levels, inherited from the Alpha Darken and Over ops,
+ *      the integer ops round every intermediate multiplication
+ * U16: 10 * 257 levels, the same relative error
+ * F32: 2e-7 by default, the blending functions are compared with
+ *      a custom precision, because the scalar versions calculate
+ *      some of their intermediate values in double precision
+ */
+bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp *op2,
+                   const QBitArray &channelFlags = QBitArray(), float floatPrecision = 2e-7)
 {
     Q_ASSERT(op1->colorSpace()->pixelSize() == op2->colorSpace()->pixelSize());
     const quint32 pixelSize = op1->colorSpace()->pixelSize();
@@ -330,15 +378,15 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     QVector<Tile> tiles = generateTiles(2, alignment, alignment, ALPHA_RANDOM, ALPHA_RANDOM, op1->colorSpace()->pixelSize());
 
     KoCompositeOp::ParameterInfo params;
-    params.dstRowStride  = 4 * rowStride;
-    params.srcRowStride  = 4 * rowStride;
+    params.dstRowStride  = pixelSize * rowStride;
+    params.srcRowStride  = pixelSize * rowStride;
     params.maskRowStride = rowStride;
     params.rows          = processRect.height();
     params.cols          = processRect.width();
     // This is a hack as in the old version we get a rounding of opacity to this value
     params.opacity       = float(Arithmetic::scale<quint8>(0.5*1.0f))/255.0;
     params.flow          = 0.3*1.0f;
-    params.channelFlags  = QBitArray();
+    params.channelFlags  = channelFlags;
 
     params.dstRowStart   = tiles[0].dst;
     params.srcRowStart   = tiles[0].src;
@@ -354,8 +402,11 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     if (pixelSize == 4) {
         compareResult = compareTwoOpsPixels<quint8>(tiles, 10);
     }
+    else if (pixelSize == 8) {
+        compareResult = compareTwoOpsPixels<quint16>(tiles, 2570);
+    }
     else if (pixelSize == 16) {
-        compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
+        compareResult = compareTwoOpsPixels<float>(tiles, floatPrecision);
     }
     else {
         qFatal("Pixel size %i is not implemented", pixelSize);
@@ -710,6 +761,187 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+/**
+ * Creates the scalar version of a generic blending mode, the same
+ * way as KoCompositeOps.h does
+ */
+template <class Traits>
+KoCompositeOp* createGenericOpReference(const KoColorSpace *cs, const QString &id)
+{
+    typedef typename Traits::channels_type T;
+
+#define REFERENCE_OP(func) new KoCompositeOpGenericSC<Traits, &func<T> >(cs, id, QString(), QString())
+#define REFERENCE_HSX_OP(func, HSXType) new KoCompositeOpGenericHSL<Traits, &func<HSXType, float> >(cs, id, QString(), QString())
+
+    if (id == COMPOSITE_OVERLAY)                 return REFERENCE_OP(cfOverlay);
+    if (id == COMPOSITE_GRAIN_MERGE)             return REFERENCE_OP(cfGrainMerge);
+    if (id == COMPOSITE_GRAIN_EXTRACT)           return REFERENCE_OP(cfGrainExtract);
+    if (id == COMPOSITE_HARD_MIX)                return REFERENCE_OP(cfHardMix);
+    if (id == COMPOSITE_GEOMETRIC_MEAN)          return REFERENCE_OP(cfGeometricMean);
+    if (id == COMPOSITE_PARALLEL)                return REFERENCE_OP(cfParallel);
+    if (id == COMPOSITE_ALLANON)                 return REFERENCE_OP(cfAllanon);
+    if (id == COMPOSITE_SCREEN)                  return REFERENCE_OP(cfScreen);
+    if (id == COMPOSITE_DODGE)                   return REFERENCE_OP(cfColorDodge);
+    if (id == COMPOSITE_LINEAR_DODGE)            return REFERENCE_OP(cfAddition);
+    if (id == COMPOSITE_LIGHTEN)                 return REFERENCE_OP(cfLightenOnly);
+    if (id == COMPOSITE_HARD_LIGHT)              return REFERENCE_OP(cfHardLight);
+    if (id == COMPOSITE_SOFT_LIGHT_SVG)          return REFERENCE_OP(cfSoftLightSvg);
+    if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP)    return REFERENCE_OP(cfSoftLight);
+    if (id == COMPOSITE_PIN_LIGHT)               return REFERENCE_OP(cfPinLight);
+    if (id == COMPOSITE_LINEAR_LIGHT)            return REFERENCE_OP(cfLinearLight);
+    if (id == COMPOSITE_BURN)                    return REFERENCE_OP(cfColorBurn);
+    if (id == COMPOSITE_LINEAR_BURN)             return REFERENCE_OP(cfLinearBurn);
+    if (id == COMPOSITE_DARKEN)                  return REFERENCE_OP(cfDarkenOnly);
+    if (id == COMPOSITE_ADD)                     return REFERENCE_OP(cfAddition);
+    if (id == COMPOSITE_SUBTRACT)                return REFERENCE_OP(cfSubtract);
+    if (id == COMPOSITE_INVERSE_SUBTRACT)        return REFERENCE_OP(cfInverseSubtract);
+    if (id == COMPOSITE_MULT)                    return REFERENCE_OP(cfMultiply);
+    if (id == COMPOSITE_DIVIDE)                  return REFERENCE_OP(cfDivide);
+    if (id == COMPOSITE_DIFF)                    return REFERENCE_OP(cfDifference);
+    if (id == COMPOSITE_EXCLUSION)               return REFERENCE_OP(cfExclusion);
+    if (id == COMPOSITE_EQUIVALENCE)             return REFERENCE_OP(cfEquivalence);
+    if (id == COMPOSITE_ADDITIVE_SUBTRACTIVE)    return REFERENCE_OP(cfAdditiveSubtractive);
+
+    if (id == COMPOSITE_COLOR)                   return REFERENCE_HSX_OP(cfColor, HSYType);
+    if (id == COMPOSITE_HUE)                     return REFERENCE_HSX_OP(cfHue, HSYType);
+    if (id == COMPOSITE_SATURATION)              return REFERENCE_HSX_OP(cfSaturation, HSYType);
+    if (id == COMPOSITE_INC_SATURATION)          return REFERENCE_HSX_OP(cfIncreaseSaturation, HSYType);
+    if (id == COMPOSITE_DEC_SATURATION)          return REFERENCE_HSX_OP(cfDecreaseSaturation, HSYType);
+    if (id == COMPOSITE_LUMINIZE)                return REFERENCE_HSX_OP(cfLightness, HSYType);
+    if (id == COMPOSITE_INC_LUMINOSITY)          return REFERENCE_HSX_OP(cfIncreaseLightness, HSYType);
+    if (id == COMPOSITE_DEC_LUMINOSITY)          return REFERENCE_HSX_OP(cfDecreaseLightness, HSYType);
+    if (id == COMPOSITE_DARKER_COLOR)            return REFERENCE_HSX_OP(cfDarkerColor, HSYType);
+    if (id == COMPOSITE_LIGHTER_COLOR)           return REFERENCE_HSX_OP(cfLighterColor, HSYType);
+    if (id == COMPOSITE_COLOR_HSI)               return REFERENCE_HSX_OP(cfColor, HSIType);
+    if (id == COMPOSITE_HUE_HSI)                 return REFERENCE_HSX_OP(cfHue, HSIType);
+    if (id == COMPOSITE_SATURATION_HSI)          return REFERENCE_HSX_OP(cfSaturation, HSIType);
+    if (id == COMPOSITE_INC_SATURATION_HSI)      return REFERENCE_HSX_OP(cfIncreaseSaturation, HSIType);
+    if (id == COMPOSITE_DEC_SATURATION_HSI)      return REFERENCE_HSX_OP(cfDecreaseSaturation, HSIType);
+    if (id == COMPOSITE_INTENSITY)               return REFERENCE_HSX_OP(cfLightness, HSIType);
+    if (id == COMPOSITE_INC_INTENSITY)           return REFERENCE_HSX_OP(cfIncreaseLightness, HSIType);
+    if (id == COMPOSITE_DEC_INTENSITY)           return REFERENCE_HSX_OP(cfDecreaseLightness, HSIType);
+    if (id == COMPOSITE_COLOR_HSL)               return REFERENCE_HSX_OP(cfColor, HSLType);
+    if (id == COMPOSITE_HUE_HSL)                 return REFERENCE_HSX_OP(cfHue, HSLType);
+    if (id == COMPOSITE_SATURATION_HSL)          return REFERENCE_HSX_OP(cfSaturation, HSLType);
+    if (id == COMPOSITE_INC_SATURATION_HSL)      return REFERENCE_HSX_OP(cfIncreaseSaturation, HSLType);
+    if (id == COMPOSITE_DEC_SATURATION_HSL)      return REFERENCE_HSX_OP(cfDecreaseSaturation, HSLType);
+    if (id == COMPOSITE_LIGHTNESS)               return REFERENCE_HSX_OP(cfLightness, HSLType);
+    if (id == COMPOSITE_INC_LIGHTNESS)           return REFERENCE_HSX_OP(cfIncreaseLightness, HSLType);
+    if (id == COMPOSITE_DEC_LIGHTNESS)           return REFERENCE_HSX_OP(cfDecreaseLightness, HSLType);
+    if (id == COMPOSITE_COLOR_HSV)               return REFERENCE_HSX_OP(cfColor, HSVType);
+    if (id == COMPOSITE_HUE_HSV)                 return REFERENCE_HSX_OP(cfHue, HSVType);
+    if (id == COMPOSITE_SATURATION_HSV)          return REFERENCE_HSX_OP(cfSaturation, HSVType);
+    if (id == COMPOSITE_INC_SATURATION_HSV)      return REFERENCE_HSX_OP(cfIncreaseSaturation, HSVType);
+    if (id == COMPOSITE_DEC_SATURATION_HSV)      return REFERENCE_HSX_OP(cfDecreaseSaturation, HSVType);
+    if (id == COMPOSITE_VALUE)                   return REFERENCE_HSX_OP(cfLightness, HSVType);
+    if (id == COMPOSITE_INC_VALUE)               return REFERENCE_HSX_OP(cfIncreaseLightness, HSVType);
+    if (id == COMPOSITE_DEC_VALUE)               return REFERENCE_HSX_OP(cfDecreaseLightness, HSVType);
+
+#undef REFERENCE_HSX_OP
+#undef REFERENCE_OP
+
+    return 0;
+}
+
+typedef KoCompositeOp* (*GenericOpFactoryMethod)(const KoColorSpace*, const QString&, const QString&, const QString&);
+
+template <class Traits>
+void compareGenericOps(const KoColorSpace *cs, GenericOpFactoryMethod createOptimizedOp,
+                       const QStringList &ids, float floatPrecision)
+{
+    QBitArray alphaLocked(4, true);
+    alphaLocked.clearBit(alpha_pos);
+
+    Q_FOREACH (const QString &id, ids) {
+        QScopedPointer<KoCompositeOp> opAct(createOptimizedOp(cs, id, QString(), QString()));
+        QScopedPointer<KoCompositeOp> opExp(createGenericOpReference<Traits>(cs, id));
+
+        if (!opAct) {
+            QSKIP("The vectorized composite ops are not available");
+        }
+
+        QVERIFY(opExp);
+
+        QVERIFY2(compareTwoOps(true, opAct.data(), opExp.data(), QBitArray(), floatPrecision), qPrintable(id));
+        QVERIFY2(compareTwoOps(false, opAct.data(), opExp.data(), QBitArray(), floatPrecision), qPrintable(id));
+        QVERIFY2(compareTwoOps(true, opAct.data(), opExp.data(), alphaLocked, floatPrecision), qPrintable(id));
+    }
+}
+
+QStringList separableOpIds()
+{
+    return QStringList()
+        << COMPOSITE_OVERLAY << COMPOSITE_GRAIN_MERGE << COMPOSITE_GRAIN_EXTRACT
+        << COMPOSITE_HARD_MIX << COMPOSITE_GEOMETRIC_MEAN << COMPOSITE_PARALLEL
+        << COMPOSITE_ALLANON << COMPOSITE_SCREEN << COMPOSITE_DODGE
+        << COMPOSITE_LINEAR_DODGE << COMPOSITE_LIGHTEN << COMPOSITE_HARD_LIGHT
+        << COMPOSITE_SOFT_LIGHT_SVG << COMPOSITE_SOFT_LIGHT_PHOTOSHOP << COMPOSITE_PIN_LIGHT
+        << COMPOSITE_LINEAR_LIGHT << COMPOSITE_BURN << COMPOSITE_LINEAR_BURN
+        << COMPOSITE_DARKEN << COMPOSITE_ADD << COMPOSITE_SUBTRACT
+        << COMPOSITE_INVERSE_SUBTRACT << COMPOSITE_MULT << COMPOSITE_DIVIDE
+        << COMPOSITE_DIFF << COMPOSITE_EXCLUSION << COMPOSITE_EQUIVALENCE
+        << COMPOSITE_ADDITIVE_SUBTRACTIVE;
+}
+
+QStringList hsxOpIds()
+{
+    return QStringList()
+        << COMPOSITE_COLOR << COMPOSITE_HUE << COMPOSITE_SATURATION
+        << COMPOSITE_INC_SATURATION << COMPOSITE_DEC_SATURATION << COMPOSITE_LUMINIZE
+        << COMPOSITE_INC_LUMINOSITY << COMPOSITE_DEC_LUMINOSITY
+        << COMPOSITE_DARKER_COLOR << COMPOSITE_LIGHTER_COLOR
+        << COMPOSITE_COLOR_HSI << COMPOSITE_HUE_HSI << COMPOSITE_SATURATION_HSI
+        << COMPOSITE_INC_SATURATION_HSI << COMPOSITE_DEC_SATURATION_HSI << COMPOSITE_INTENSITY
+        << COMPOSITE_INC_INTENSITY << COMPOSITE_DEC_INTENSITY
+        << COMPOSITE_COLOR_HSL << COMPOSITE_HUE_HSL << COMPOSITE_SATURATION_HSL
+        << COMPOSITE_INC_SATURATION_HSL << COMPOSITE_DEC_SATURATION_HSL << COMPOSITE_LIGHTNESS
+        << COMPOSITE_INC_LIGHTNESS << COMPOSITE_DEC_LIGHTNESS
+        << COMPOSITE_COLOR_HSV << COMPOSITE_HUE_HSV << COMPOSITE_SATURATION_HSV
+        << COMPOSITE_INC_SATURATION_HSV << COMPOSITE_DEC_SATURATION_HSV << COMPOSITE_VALUE
+        << COMPOSITE_INC_VALUE << COMPOSITE_DEC_VALUE;
+}
+
+void KisCompositionBenchmark::compareRgb8GenericSCOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    compareGenericOps<KoBgrU8Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp32, separableOpIds(), 0);
+}
+
+void KisCompositionBenchmark::compareRgb16GenericSCOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    compareGenericOps<KoBgrU16Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp64, separableOpIds(), 0);
+}
+
+void KisCompositionBenchmark::compareRgbF32GenericSCOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    compareGenericOps<KoRgbF32Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp128, separableOpIds(), 1e-5);
+}
+
+/**
+ * The HSX functions divide by the chroma and the lightness
+ * differences, which amplifies the rounding errors, so F32 gets a
+ * looser precision than in the separable modes.
+ */
+void KisCompositionBenchmark::compareRgb8GenericHSLOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    compareGenericOps<KoBgrU8Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp32, hsxOpIds(), 0);
+}
+
+void KisCompositionBenchmark::compareRgb16GenericHSLOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    compareGenericOps<KoBgrU16Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp64, hsxOpIds(), 0);
+}
+
+void KisCompositionBenchmark::compareRgbF32GenericHSLOps()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F32", "");
+    compareGenericOps<KoRgbF32Traits>(cs, &KoOptimizedCompositeOpFactory::createGenericOp128, hsxOpIds(), 1e-4);
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -947,4 +1179,3 @@ void KisCompositionBenchmark::benchmarkFloatIntUint()
 }
 
 QTEST_MAIN(KisCompositionBenchmark)
-
@@ -46,6 +46,13 @@ private Q_SLOTS:
     void compareOverOpsNoMask();
     void compareRgbF32OverOps();
 
+    void compareRgb8GenericSCOps();
+    void compareRgb16GenericSCOps();
+    void compareRgbF32GenericSCOps();
+    void compareRgb8GenericHSLOps();
+    void compareRgb16GenericHSLOps();
+    void compareRgbF32GenericHSLOps();
+
     void testRgb8CompositeAlphaDarkenLegacy();
     void testRgb8CompositeAlphaDarkenOptimized();
 
@@ -18,9 +18,12 @@
 
 #include "kis_datamanager_benchmark.h"
 #include "kis_benchmark_values.h"
+#include "kis_benchmark_thread_utils.h"
 
 #include <QTest>
+#include <QElapsedTimer>
 #include <kis_datamanager.h>
+#include <kis_paint_device_writer.h>
 
 // RGBA
 #define PIXEL_SIZE 4
@@ -198,5 +201,66 @@ void KisDatamanagerBenchmark::benchmarkMemCpy()
     delete[] dst;
 }
 
+class KisCountingPaintDeviceWriter : public KisPaintDeviceWriter
+{
+public:
+    KisCountingPaintDeviceWriter() : m_bytesWritten(0) {}
+
+    bool write(const QByteArray &data) override {
+        m_bytesWritten += data.size();
+        return true;
+    }
+
+    bool write(const char* data, qint64 length) override {
+        Q_UNUSED(data);
+        m_bytesWritten += length;
+        return true;
+    }
+
+    qint64 m_bytesWritten;
+};
+
+void KisDatamanagerBenchmark::benchmarkWrite_data()
+{
+    KisBenchmarkThreadUtils::addThreadCountRows();
+}
+
+void KisDatamanagerBenchmark::benchmarkWrite()
+{
+    QFETCH(int, numThreads);
+
+    quint8 defaultPixel[PIXEL_SIZE];
+    memset(defaultPixel, 0, PIXEL_SIZE);
+    KisDataManager dm(PIXEL_SIZE, defaultPixel);
+
+    const int dataSize = PIXEL_SIZE * TEST_IMAGE_WIDTH * TEST_IMAGE_HEIGHT;
+    quint8 *bytes = new quint8[dataSize];
+
+    // a noisy gradient, so that the compressor has some work to do
+    for (int i = 0; i < dataSize; i++) {
+        bytes[i] = ((i / PIXEL_SIZE) % 256) ^ (qrand() & 0x7);
+    }
+    dm.writeBytes(bytes, 0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+    delete[] bytes;
+
+    KisCountingPaintDeviceWriter writer;
+    qint64 elapsed = 0;
+
+    {
+        KisBenchmarkThreadUtils::GlobalThreadCountLimiter limiter(numThreads);
+
+        QElapsedTimer timer;
+        timer.start();
+        dm.write(writer);
+        elapsed = qMax(qint64(1), timer.nsecsElapsed());
+    }
+
+    const qreal bytesPerSecond = qreal(dataSize) * 1e9 / elapsed;
+    qDebug() << numThreads << "threads:"
+             << bytesPerSecond / (1024 * 1024) << "MiB/s"
+             << "compressed to" << writer.m_bytesWritten << "bytes";
+
+    QTest::setBenchmarkResult(bytesPerSecond, QTest::BytesPerSecond);
+}
 
 QTEST_MAIN(KisDatamanagerBenchmark)
@@ -0,0 +1,581 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * A headless end-to-end benchmark. It loads a document, replays a
+ * script of strokes and filter actions through the strokes queue of
+ * the image and reports the latencies, throughput and the peak memory
+ * consumption as JSON.
+ *
+ * Usage:
+ *
+ *   KisReplayBenchmarkRunner [document.kra] [script.json]
+ *                            [--output results.json] [--repeat N]
+ *                            [--warmup N] [--trace trace.json]
+ *
+ * Without arguments it replays data/replay_benchmark.json against
+ * data/load_test.kra. The script has the following format (the
+ * relative paths are resolved against the folder of the script):
+ *
+ *   {
+ *     "repeat": 5,
+ *     "actions": [
+ *       { "type": "stroke", "layer": "Layer 6", "preset": "softbrush_30px.kpp",
+ *         "points": [[x, y, pressure], ...] },
+ *       { "type": "filter", "layer": "Background", "filter": "blur",
+ *         "config": "blur.cfg", "rect": [x, y, w, h] },
+ *       { "type": "refresh" }
+ *     ]
+ *   }
+ *
+ * The latency of an action is the time from the start of its stroke
+ * until the projection of the image is fully updated. The time is
+ * measured in milliseconds.
+ *
+ * All the actions of a pass are undone before the next pass (the undo
+ * is not measured), so every pass, including the warm-up ones, replays
+ * the script on the same document.
+ */
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QThread>
+#include <QtMath>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include <KoCanvasResourceManager.h>
+#include <KoCompositeOpRegistry.h>
+#include <KoColor.h>
+
+#include <KisDocument.h>
+#include <KisPart.h>
+#include <kundo2stack.h>
+#include <kis_image.h>
+#include <kis_layer_utils.h>
+#include <kis_memory_statistics_server.h>
+#include <kis_update_time_monitor.h>
+#include <kis_canvas_resource_provider.h>
+#include <kis_resources_snapshot.h>
+#include <krita_utils.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paint_information.h>
+#include <filter/kis_filter.h>
+#include <filter/kis_filter_registry.h>
+#include <filter/kis_filter_configuration.h>
+#include <strokes/freehand_stroke.h>
+#include <strokes/kis_filter_stroke_strategy.h>
+
+
+namespace {
+
+struct ReplayAction
+{
+    enum Type {
+        STROKE,
+        FILTER,
+        REFRESH
+    };
+
+    Type type;
+    QString label;
+
+    KisNodeSP node;
+
+    KisPaintOpPresetSP preset;
+    QVector<KisPaintInformation> points;
+
+    KisFilterSP filter;
+    KisFilterConfigurationSP filterConfig;
+    QRect rect;
+
+    QVector<qreal> latencies;
+};
+
+void printError(const QString &message)
+{
+    QTextStream(stderr) << "ERROR: " << message << endl;
+}
+
+QString resolvePath(const QString &path, const QDir &baseDir)
+{
+    return QFileInfo(path).isAbsolute() ? path : baseDir.absoluteFilePath(path);
+}
+
+KisNodeSP findLayer(KisImageSP image, const QString &name)
+{
+    return KisLayerUtils::recursiveFindNode(image->root(),
+        [name] (KisNodeSP node) {
+            return node->name() == name;
+        });
+}
+
+bool parseAction(const QJsonObject &object, KisImageSP image, const QDir &baseDir, ReplayAction *action)
+{
+    const QString type = object.value("type").toString();
+
+    if (type == "refresh") {
+        action->type = ReplayAction::REFRESH;
+        action->label = object.value("label").toString("refresh");
+        return true;
+    }
+
+    action->node = findLayer(image, object.value("layer").toString());
+    if (!action->node || !action->node->paintDevice()) {
+        printError(QString("cannot find a paintable layer \"%1\"").arg(object.value("layer").toString()));
+        return false;
+    }
+
+    if (type == "stroke") {
+        action->type = ReplayAction::STROKE;
+
+        const QString presetFileName = resolvePath(object.value("preset").toString(), baseDir);
+        action->preset = new KisPaintOpPreset(presetFileName);
+        if (!action->preset->load()) {
+            printError(QString("cannot load the preset \"%1\"").arg(presetFileName));
+            return false;
+        }
+
+        Q_FOREACH (const QJsonValue &value, object.value("points").toArray()) {
+            const QJsonArray point = value.toArray();
+            const qreal pressure = point.size() > 2 ? point[2].toDouble() : 1.0;
+
+            action->points << KisPaintInformation(QPointF(point[0].toDouble(), point[1].toDouble()),
+                                                  pressure);
+        }
+
+        if (action->points.size() < 2) {
+            printError("a stroke should have at least two points");
+            return false;
+        }
+
+        action->label = object.value("label").toString(QString("stroke: %1").arg(action->preset->name()));
+
+    } else if (type == "filter") {
+        action->type = ReplayAction::FILTER;
+
+        action->filter = KisFilterRegistry::instance()->value(object.value("filter").toString());
+        if (!action->filter) {
+            printError(QString("unknown filter \"%1\"").arg(object.value("filter").toString()));
+            return false;
+        }
+
+        action->filterConfig = action->filter->defaultConfiguration();
+
+        if (object.contains("config")) {
+            QFile file(resolvePath(object.value("config").toString(), baseDir));
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                printError(QString("cannot open the filter config \"%1\"").arg(file.fileName()));
+                return false;
+            }
+
+            QTextStream in(&file);
+            in.setCodec("UTF-8");
+            action->filterConfig->fromXML(in.readAll());
+        }
+
+        const QJsonArray rect = object.value("rect").toArray();
+        action->rect = rect.size() == 4 ?
+            QRect(rect[0].toInt(), rect[1].toInt(), rect[2].toInt(), rect[3].toInt()) :
+            image->bounds();
+
+        action->label = object.value("label").toString(QString("filter: %1").arg(action->filter->id()));
+
+    } else {
+        printError(QString("unknown action type \"%1\"").arg(type));
+        return false;
+    }
+
+    return true;
+}
+
+KisResourcesSnapshotSP createResources(KisImageSP image, const ReplayAction &action,
+                                       KoCanvasResourceManager *manager)
+{
+    QVariant i;
+
+    i.setValue(KoColor(Qt::black, image->colorSpace()));
+    manager->setResource(KoCanvasResourceManager::ForegroundColor, i);
+
+    i.setValue(KoColor(Qt::white, image->colorSpace()));
+    manager->setResource(KoCanvasResourceManager::BackgroundColor, i);
+
+    i.setValue(static_cast<void*>(0));
+    manager->setResource(KisCanvasResourceProvider::CurrentPattern, i);
+    manager->setResource(KisCanvasResourceProvider::CurrentGradient, i);
+    manager->setResource(KisCanvasResourceProvider::CurrentGeneratorConfiguration, i);
+
+    i.setValue(action.node);
+    manager->setResource(KisCanvasResourceProvider::CurrentKritaNode, i);
+
+    if (action.preset) {
+        i.setValue(action.preset);
+        manager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, i);
+    }
+
+    i.setValue(COMPOSITE_OVER);
+    manager->setResource(KisCanvasResourceProvider::CurrentCompositeOp, i);
+
+    i.setValue(1.0);
+    manager->setResource(KisCanvasResourceProvider::Opacity, i);
+
+    return new KisResourcesSnapshot(image, action.node, manager);
+}
+
+void replayStroke(KisImageSP image, const ReplayAction &action)
+{
+    KoCanvasResourceManager manager;
+    KisResourcesSnapshotSP resources = createResources(image, action, &manager);
+
+    FreehandStrokeStrategy *strategy =
+        new FreehandStrokeStrategy(resources->needsIndirectPainting(),
+                                   resources->indirectPaintingCompositeOp(),
+                                   resources,
+                                   new FreehandStrokeStrategy::PainterInfo(),
+                                   kundo2_noi18n("Replayed Stroke"));
+
+    KisStrokeId strokeId = image->startStroke(strategy);
+
+    for (int i = 1; i < action.points.size(); i++) {
+        image->addJob(strokeId,
+                      new FreehandStrokeStrategy::Data(action.node, 0,
+                                                       action.points[i - 1],
+                                                       action.points[i]));
+    }
+
+    image->endStroke(strokeId);
+}
+
+void replayFilter(KisImageSP image, const ReplayAction &action)
+{
+    KoCanvasResourceManager manager;
+    KisResourcesSnapshotSP resources = createResources(image, action, &manager);
+
+    KisStrokeId strokeId =
+        image->startStroke(new KisFilterStrokeStrategy(action.filter,
+                                                       action.filterConfig,
+                                                       resources));
+
+    Q_FOREACH (const QRect &rc, KritaUtils::splitRectIntoPatches(action.rect, KritaUtils::optimalPatchSize())) {
+        image->addJob(strokeId, new KisFilterStrokeStrategy::Data(rc, true));
+    }
+
+    image->endStroke(strokeId);
+}
+
+qreal replayAction(KisImageSP image, const ReplayAction &action)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    switch (action.type) {
+    case ReplayAction::STROKE:
+        replayStroke(image, action);
+        break;
+    case ReplayAction::FILTER:
+        replayFilter(image, action);
+        break;
+    case ReplayAction::REFRESH:
+        image->refreshGraphAsync();
+        break;
+    }
+
+    image->waitForDone();
+
+    return timer.nsecsElapsed() / 1e6;
+}
+
+/**
+ * Undoes all the actions replayed after the undo stack of the document
+ * had \p index commands and waits until the image is updated
+ */
+void undoReplayedActions(KisDocument *doc, KisImageSP image, int index)
+{
+    doc->undoStack()->setIndex(index);
+    image->waitForDone();
+}
+
+qint64 peakResidentMemory()
+{
+#if defined Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+#elif defined Q_OS_UNIX
+    struct rusage usage;
+    if (!getrusage(RUSAGE_SELF, &usage)) {
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss;
+#else
+        return qint64(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return -1;
+}
+
+QJsonObject latencyStatistics(QVector<qreal> samples)
+{
+    QJsonObject result;
+    if (samples.isEmpty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+
+    // nearest-rank percentiles
+    auto percentile = [&samples] (qreal p) {
+        const int rank = qCeil(p * samples.size());
+        return samples[qBound(0, rank - 1, samples.size() - 1)];
+    };
+
+    qreal sum = 0.0;
+    Q_FOREACH (qreal value, samples) {
+        sum += value;
+    }
+
+    result["samples"] = samples.size();
+    result["min"] = samples.first();
+    result["mean"] = sum / samples.size();
+    result["p50"] = percentile(0.50);
+    result["p90"] = percentile(0.90);
+    result["p99"] = percentile(0.99);
+    result["max"] = samples.last();
+
+    return result;
+}
+
+QJsonObject throughput(const ReplayAction &action)
+{
+    QJsonObject result;
+
+    qreal totalTime = 0.0;
+    Q_FOREACH (qreal value, action.latencies) {
+        totalTime += value;
+    }
+
+    if (totalTime <= 0.0) return result;
+
+    const qreal seconds = totalTime / 1000.0;
+    const int runs = action.latencies.size();
+
+    if (action.type == ReplayAction::STROKE) {
+        result["value"] = runs * (action.points.size() - 1) / seconds;
+        result["unit"] = QString("segments/s");
+    } else if (action.type == ReplayAction::FILTER) {
+        result["value"] = runs * qreal(action.rect.width()) * action.rect.height() / 1e6 / seconds;
+        result["unit"] = QString("Mpx/s");
+    } else {
+        result["value"] = runs / seconds;
+        result["unit"] = QString("refreshes/s");
+    }
+
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    // the runner never shows any windows
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    app.setApplicationName("KisReplayBenchmarkRunner");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays strokes and filters on a document and reports their performance");
+    parser.addHelpOption();
+    parser.addPositionalArgument("document", "The .kra document to load");
+    parser.addPositionalArgument("script", "The JSON script of actions to replay");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the results into <file> instead of stdout", "file");
+    QCommandLineOption repeatOption(QStringList() << "r" << "repeat", "Replay every action <n> times", "n");
+    QCommandLineOption warmupOption("warmup", "Replay the script <n> times before measuring", "n", "1");
+    QCommandLineOption traceOption("trace", "Write the trace of the update pipeline into <file>", "file");
+
+    parser.addOption(outputOption);
+    parser.addOption(repeatOption);
+    parser.addOption(warmupOption);
+    parser.addOption(traceOption);
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+
+    const QString documentFileName = args.size() > 0 ?
+        args[0] : QString(FILES_DATA_DIR) + QDir::separator() + "load_test.kra";
+    const QString scriptFileName = args.size() > 1 ?
+        args[1] : QString(FILES_DATA_DIR) + QDir::separator() + "replay_benchmark.json";
+
+    QFile scriptFile(scriptFileName);
+    if (!scriptFile.open(QIODevice::ReadOnly)) {
+        printError(QString("cannot open the script \"%1\"").arg(scriptFileName));
+        return 1;
+    }
+
+    QJsonParseError parseError;
+    const QJsonObject script = QJsonDocument::fromJson(scriptFile.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        printError(QString("cannot parse the script: %1").arg(parseError.errorString()));
+        return 1;
+    }
+
+    QScopedPointer<KisDocument> doc(KisPart::instance()->createDocument());
+
+    QElapsedTimer loadingTimer;
+    loadingTimer.start();
+
+    if (!doc->loadNativeFormat(documentFileName) || !doc->image()) {
+        printError(QString("cannot load the document \"%1\"").arg(documentFileName));
+        return 1;
+    }
+
+    KisImageSP image = doc->image();
+    app.processEvents();
+    image->waitForDone();
+
+    const qreal loadingTime = loadingTimer.nsecsElapsed() / 1e6;
+
+    /**
+     * Every pass is undone before the next one, so the undo limit must
+     * not drop any of the commands of the pass
+     */
+    doc->undoStack()->clear();
+    doc->undoStack()->setUndoLimit(0);
+    const int initialUndoIndex = doc->undoStack()->index();
+
+    QVector<ReplayAction> actions;
+    const QDir baseDir = QFileInfo(scriptFileName).absoluteDir();
+
+    Q_FOREACH (const QJsonValue &value, script.value("actions").toArray()) {
+        ReplayAction action;
+        if (!parseAction(value.toObject(), image, baseDir, &action)) {
+            return 1;
+        }
+        actions << action;
+    }
+
+    const int numRepeats = qMax(1, parser.isSet(repeatOption) ?
+                                parser.value(repeatOption).toInt() :
+                                script.value("repeat").toInt(1));
+    const int numWarmups = qMax(0, parser.value(warmupOption).toInt());
+
+    for (int i = 0; i < numWarmups; i++) {
+        Q_FOREACH (const ReplayAction &action, actions) {
+            replayAction(image, action);
+        }
+        undoReplayedActions(doc.data(), image, initialUndoIndex);
+    }
+
+    if (parser.isSet(traceOption)) {
+        KisUpdateTimeMonitor::instance()->startTracing();
+    }
+
+    qint64 peakTileMemory = 0;
+    QVector<qreal> allLatencies;
+
+    qreal totalTime = 0.0;
+
+    for (int i = 0; i < numRepeats; i++) {
+        QElapsedTimer passTimer;
+        passTimer.start();
+
+        for (auto it = actions.begin(); it != actions.end(); ++it) {
+            const qreal latency = replayAction(image, *it);
+            it->latencies << latency;
+            allLatencies << latency;
+
+            // sampled between the actions only, the strokes are running otherwise
+            peakTileMemory = qMax(peakTileMemory,
+                KisMemoryStatisticsServer::instance()->fetchMemoryStatistics(image).totalMemorySize);
+        }
+
+        totalTime += passTimer.nsecsElapsed() / 1e6;
+
+        undoReplayedActions(doc.data(), image, initialUndoIndex);
+    }
+
+    if (parser.isSet(traceOption)) {
+        KisUpdateTimeMonitor::instance()->stopTracing(parser.value(traceOption));
+    }
+
+    QJsonArray actionResults;
+    for (int i = 0; i < actions.size(); i++) {
+        QJsonObject result;
+        result["index"] = i;
+        result["label"] = actions[i].label;
+        result["latency"] = latencyStatistics(actions[i].latencies);
+        result["throughput"] = throughput(actions[i]);
+        actionResults.append(result);
+    }
+
+    QJsonObject total;
+    total["time"] = totalTime;
+    total["latency"] = latencyStatistics(allLatencies);
+    total["throughput"] = allLatencies.size() / (totalTime / 1000.0);
+
+    QJsonObject memory;
+    memory["peakResidentBytes"] = peakResidentMemory();
+    memory["peakTileMemoryBytes"] = peakTileMemory;
+
+    QJsonObject results;
+    results["document"] = QFileInfo(documentFileName).absoluteFilePath();
+    results["script"] = QFileInfo(scriptFileName).absoluteFilePath();
+    results["imageSize"] = QJsonArray() << image->width() << image->height();
+    results["threads"] = QThread::idealThreadCount();
+    results["repeat"] = numRepeats;
+    results["warmup"] = numWarmups;
+    results["loadingTime"] = loadingTime;
+    results["actions"] = actionResults;
+    results["total"] = total;
+    results["memory"] = memory;
+
+    const QByteArray output = QJsonDocument(results).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            printError(QString("cannot write the results into \"%1\"").arg(file.fileName()));
+            return 1;
+        }
+        file.write(output);
+    } else {
+        QTextStream(stdout) << output;
+    }
+
+    image->waitForDone();
+    doc.reset();
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_hash_table_benchmark.h"
+#include "kis_benchmark_values.h"
+#include "kis_benchmark_thread_utils.h"
+
+#include <QTest>
+#include <QThreadPool>
+
+#include <kis_datamanager.h>
+
+// RGBA
+#define PIXEL_SIZE 4
+#define NUM_CYCLES 10
+
+
+/**
+ * Emulates a KisUpdateJobItem walking through its own part of
+ * a big layer: every tile of the assigned rows is fetched from
+ * the data manager's hash table and locked, but not processed
+ */
+static void accessTiles(KisTiledDataManager &dm, const QRect &tilesRect, bool writable)
+{
+    for (int i = 0; i < NUM_CYCLES; i++) {
+        for (int row = tilesRect.top(); row <= tilesRect.bottom(); row++) {
+            for (int col = tilesRect.left(); col <= tilesRect.right(); col++) {
+                KisTileSP tile = dm.getTile(col, row, writable);
+
+                if (writable) {
+                    tile->lockForWrite();
+                    tile->unlockForWrite();
+                } else {
+                    tile->lockForRead();
+                    tile->unlock();
+                }
+            }
+        }
+    }
+}
+
+void KisTileHashTableBenchmark::runConcurrentAccess(bool writable)
+{
+    QFETCH(int, numThreads);
+
+    quint8 defaultPixel[PIXEL_SIZE];
+    memset(defaultPixel, 0, PIXEL_SIZE);
+    KisTiledDataManager dm(PIXEL_SIZE, defaultPixel);
+
+    quint8 fillPixel[PIXEL_SIZE];
+    memset(fillPixel, 128, PIXEL_SIZE);
+    dm.clear(QRect(0, 0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT), fillPixel);
+
+    const int numCols = TEST_IMAGE_WIDTH / KisTileData::WIDTH;
+    const int numRows = TEST_IMAGE_HEIGHT / KisTileData::HEIGHT;
+    const int rowsPerThread = qMax(1, numRows / numThreads);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+
+    const int numJobs = (numRows + rowsPerThread - 1) / rowsPerThread;
+
+    QBENCHMARK {
+        KisBenchmarkThreadUtils::runConcurrently(pool, numJobs,
+            [&dm, numCols, numRows, rowsPerThread, writable] (int index) {
+                const int row = index * rowsPerThread;
+                const int height = qMin(rowsPerThread, numRows - row);
+
+                accessTiles(dm, QRect(0, row, numCols, height), writable);
+            });
+    }
+}
+
+void KisTileHashTableBenchmark::benchmarkConcurrentReadAccess_data()
+{
+    KisBenchmarkThreadUtils::addThreadCountRows();
+}
+
+void KisTileHashTableBenchmark::benchmarkConcurrentReadAccess()
+{
+    runConcurrentAccess(false);
+}
+
+void KisTileHashTableBenchmark::benchmarkConcurrentWriteAccess_data()
+{
+    KisBenchmarkThreadUtils::addThreadCountRows();
+}
+
+void KisTileHashTableBenchmark::benchmarkConcurrentWriteAccess()
+{
+    runConcurrentAccess(true);
+}
+
+QTEST_MAIN(KisTileHashTableBenchmark)
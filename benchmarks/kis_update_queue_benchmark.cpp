@@ -0,0 +1,143 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_update_queue_benchmark.h"
+#include "kis_benchmark_values.h"
+
+#include <QTest>
+#include <QtMath>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_simple_update_queue.h>
+#include <kis_updater_context.h>
+
+#define DAB_SIZE 40
+#define NUM_DABS 20000
+#define DAB_SPACING 0.1
+#define NUM_THREADS 4
+
+
+/**
+ * Reproduces the update pattern of a long freehand brush stroke: the
+ * dabs are placed along a spiral with the spacing of 0.1 of the dab
+ * size, and every dab sends an update of its own bounds, so the
+ * queue gets a dense stream of small heavily overlapping rects.
+ */
+static QVector<QRect> recordStrokeRects(const QRect &imageRect)
+{
+    QVector<QRect> rects;
+
+    const QPointF center = QRectF(imageRect).center();
+    const qreal maxRadius = 0.45 * qMin(imageRect.width(), imageRect.height());
+    const qreal step = DAB_SPACING * DAB_SIZE;
+
+    qreal angle = 0.0;
+
+    for (int i = 0; i < NUM_DABS; i++) {
+        const qreal radius = maxRadius * (i + 1) / NUM_DABS;
+        const QPointF pt = center + radius * QPointF(qCos(angle), qSin(angle));
+
+        rects << QRect(pt.toPoint() - QPoint(DAB_SIZE / 2, DAB_SIZE / 2),
+                       QSize(DAB_SIZE, DAB_SIZE));
+
+        angle += step / qMax(radius, qreal(DAB_SIZE));
+    }
+
+    return rects;
+}
+
+void KisUpdateQueueBenchmark::initTestCase()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    m_image = new KisImage(0, TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT, cs, "benchmark");
+    m_layer = new KisPaintLayer(m_image, "layer", OPACITY_OPAQUE_U8);
+
+    m_image->lock();
+    m_image->addNode(m_layer);
+    m_image->unlock();
+
+    m_strokeRects = recordStrokeRects(m_image->bounds());
+}
+
+void KisUpdateQueueBenchmark::cleanupTestCase()
+{
+    m_layer = 0;
+    m_image = 0;
+}
+
+void KisUpdateQueueBenchmark::benchmarkReplayStroke_data()
+{
+    QTest::addColumn<int>("dabsPerPass");
+
+    QTest::newRow("1 dab per pass") << 1;
+    QTest::newRow("16 dabs per pass") << 16;
+    QTest::newRow("256 dabs per pass") << 256;
+    QTest::newRow("whole stroke in one pass") << NUM_DABS;
+}
+
+/**
+ * The scheduler passes are emulated with a testable updater context,
+ * so only the cost of queueing, joining and dispatching the walkers
+ * is measured, not the merge itself
+ */
+void KisUpdateQueueBenchmark::benchmarkReplayStroke()
+{
+    QFETCH(int, dabsPerPass);
+
+    const QRect imageRect = m_image->bounds();
+    int numJobs = 0;
+
+    auto runPass = [&numJobs] (KisSimpleUpdateQueue &queue,
+                               KisTestableUpdaterContext &context) {
+        queue.processQueue(context);
+
+        qint32 numMergeJobs = 0;
+        qint32 numStrokeJobs = 0;
+        context.getJobsSnapshot(numMergeJobs, numStrokeJobs);
+        numJobs += numMergeJobs;
+
+        context.clear();
+    };
+
+    QBENCHMARK {
+        KisSimpleUpdateQueue queue;
+        KisTestableUpdaterContext context(NUM_THREADS);
+
+        numJobs = 0;
+
+        for (int i = 0; i < m_strokeRects.size(); i++) {
+            queue.addUpdateJob(m_layer, m_strokeRects[i], imageRect, 0);
+
+            if ((i + 1) % dabsPerPass == 0) {
+                queue.optimize();
+                runPass(queue, context);
+            }
+        }
+
+        while (!queue.isEmpty()) {
+            runPass(queue, context);
+        }
+    }
+
+    qDebug() << "Replayed" << m_strokeRects.size() << "dabs,"
+             << "merge jobs dispatched:" << numJobs;
+}
+
+QTEST_MAIN(KisUpdateQueueBenchmark)
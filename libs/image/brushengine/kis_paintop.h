@@ -106,6 +106,19 @@ public:
         return true;
     }
 
+    /**
+     * Whether the paintop writes to the device with
+     * KisPainter::bltFixed() only and never reads the pixels of the
+     * device back. For such paintops the blending of the dabs may be
+     * offloaded to a KisDabBlendingPipeline, so the next dab can be
+     * generated while the previous one is being blended.
+     *
+     * Default is false
+     */
+    virtual bool supportsDabPipelining() const {
+        return false;
+    }
+
     /**
      * Split the coordinate into whole + fraction, where fraction is always >= 0.
      */
@@ -172,3 +172,35 @@ bool KisFilter::needsTransparentPixels(const KisFilterConfigurationSP config, co
 
     return false;
 }
+
+bool KisFilter::supportsSeparablePasses(const KisFilterConfigurationSP config, int lod) const
+{
+    Q_UNUSED(config);
+    Q_UNUSED(lod);
+
+    return false;
+}
+
+void KisFilter::processSeparablePass(SeparablePass pass,
+                                     const KisPaintDeviceSP src,
+                                     KisPaintDeviceSP dst,
+                                     const QRect &rect,
+                                     const KisFilterConfigurationSP config,
+                                     int lod) const
+{
+    Q_UNUSED(pass);
+    Q_UNUSED(src);
+    Q_UNUSED(dst);
+    Q_UNUSED(rect);
+    Q_UNUSED(config);
+    Q_UNUSED(lod);
+
+    KIS_ASSERT_RECOVER_NOOP(0 && "the filter is not separable");
+}
+
+QRect KisFilter::separablePassNeededRect(SeparablePass pass, const QRect &rect, const KisFilterConfigurationSP config, int lod) const
+{
+    Q_UNUSED(pass);
+
+    return neededRect(rect, config, lod);
+}
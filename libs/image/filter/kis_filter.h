@@ -127,6 +127,39 @@ public:
 
     virtual bool needsTransparentPixels(const KisFilterConfigurationSP config, const KoColorSpace *cs) const;
 
+    enum SeparablePass {
+        HorizontalPass,
+        VerticalPass
+    };
+
+    /**
+     * Returns true if the filter is separable, that is, applying
+     * processSeparablePass() with HorizontalPass and then with
+     * VerticalPass gives the same result as processImpl(). Then the
+     * result of the horizontal pass can be cached and reused between
+     * the updates of the filter (\see KisFilterUpdateCache)
+     */
+    virtual bool supportsSeparablePasses(const KisFilterConfigurationSP config, int lod) const;
+
+    /**
+     * Applies one pass of a separable filter. The pass reads \p src
+     * in the rect returned by separablePassNeededRect() and writes
+     * the result into \p dst in \p rect. \p src and \p dst must be
+     * different devices. One of them is usually a temporary buffer
+     * without the level of detail set, so \p lod is passed explicitly.
+     */
+    virtual void processSeparablePass(SeparablePass pass,
+                                      const KisPaintDeviceSP src,
+                                      KisPaintDeviceSP dst,
+                                      const QRect &rect,
+                                      const KisFilterConfigurationSP config,
+                                      int lod) const;
+
+    /**
+     * The rect a pass of a separable filter reads to produce \p rect
+     */
+    virtual QRect separablePassNeededRect(SeparablePass pass, const QRect &rect, const KisFilterConfigurationSP config, int lod) const;
+
 protected:
 
     QString configEntryGroup() const;
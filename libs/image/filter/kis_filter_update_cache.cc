@@ -0,0 +1,418 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_filter_update_cache.h"
+
+#include <QBitArray>
+#include <QMap>
+#include <QMutex>
+#include <QRegion>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include "kis_filter.h"
+#include "kis_filter_configuration.h"
+#include "kis_paint_device.h"
+#include "kis_default_bounds_base.h"
+#include "kis_datamanager.h"
+#include "kis_work_stealing_task_pool.h"
+
+
+namespace {
+
+/**
+ * Everything the output of the filter depends on, except the pixels
+ * of the source
+ */
+struct Signature
+{
+    Signature() : srcColorSpace(0), dstColorSpace(0) {}
+
+    Signature(const QString &_filterXml,
+              const KisFilterConfigurationSP config,
+              const KisPaintDeviceSP src,
+              const KisPaintDeviceSP dst)
+        : filterXml(_filterXml),
+          channelFlags(config->channelFlags()),
+          srcColorSpace(src->colorSpace()),
+          dstColorSpace(dst->colorSpace()),
+          offset(src->x(), src->y())
+    {
+        const KoColor pixel = src->defaultPixel();
+        defaultPixel = QByteArray(reinterpret_cast<const char*>(pixel.data()),
+                                  srcColorSpace->pixelSize());
+    }
+
+    bool operator==(const Signature &rhs) const {
+        return srcColorSpace && rhs.srcColorSpace &&
+            *srcColorSpace == *rhs.srcColorSpace &&
+            *dstColorSpace == *rhs.dstColorSpace &&
+            offset == rhs.offset &&
+            channelFlags == rhs.channelFlags &&
+            defaultPixel == rhs.defaultPixel &&
+            filterXml == rhs.filterXml;
+    }
+
+    QString filterXml;
+    QBitArray channelFlags;
+    const KoColorSpace *srcColorSpace;
+    const KoColorSpace *dstColorSpace;
+    QPoint offset;
+    QByteArray defaultPixel;
+};
+
+struct LodState
+{
+    LodState() : dst(0) {}
+
+    KisDataManager::TileContents srcContents;
+
+    KisPaintDeviceSP horizontalPass;
+    QRegion horizontalPassValid;
+
+    /**
+     * The area of the horizontal pass used by the updates finished
+     * since the pass was cropped last time
+     */
+    QRect horizontalPassUsedRect;
+
+    /**
+     * Used for the identity check only. If the device is deleted and
+     * another one takes its address, the versions of the tiles still
+     * differ, so the stale output is not reused.
+     */
+    const KisPaintDevice *dst;
+    KisDataManager::TileVersions dstVersions;
+    QRegion outputValid;
+};
+
+/**
+ * An update whose filter is running outside the lock. If the data
+ * it has read is invalidated in the meantime, its results are not
+ * added to the cache when it finishes.
+ */
+struct RunningUpdate
+{
+    RunningUpdate(int _lod, const QRect &_outputRect)
+        : lod(_lod), outputRect(_outputRect),
+          outputValid(true), horizontalPassValid(true) {}
+
+    int lod;
+    QRect outputRect;
+    QRegion horizontalPassRegion;
+    bool outputValid;
+    bool horizontalPassValid;
+};
+
+void runTiled(const QRegion &region, bool threaded,
+              const KisWorkStealingTaskPool::RectTask &func)
+{
+    Q_FOREACH (const QRect &rc, region.rects()) {
+        if (threaded) {
+            KisWorkStealingTaskPool::runTiledInCurrentPool(rc, func);
+        } else {
+            func(rc);
+        }
+    }
+}
+
+}
+
+struct KisFilterUpdateCache::Private
+{
+    QMutex mutex;
+    Signature signature;
+    QMap<int, LodState> states;
+    QList<RunningUpdate*> runningUpdates;
+
+    /**
+     * The serialized configuration, cached per configuration
+     * object. KisAdjustmentLayer::setFilter() calls clear().
+     */
+    KisFilterConfigurationSP xmlConfig;
+    QString xmlCache;
+
+    const QString& configXml(const KisFilterConfigurationSP config);
+
+    void invalidateOutput(int lod, const QRegion &region);
+    void invalidateHorizontalPass(int lod, const QRegion &region);
+    void invalidateAll(int lod);
+    void reset();
+
+    bool hasRunningUpdates(int lod) const;
+};
+
+const QString& KisFilterUpdateCache::Private::configXml(const KisFilterConfigurationSP config)
+{
+    if (xmlConfig != config) {
+        xmlConfig = config;
+        xmlCache = config->toXML();
+    }
+    return xmlCache;
+}
+
+void KisFilterUpdateCache::Private::invalidateOutput(int lod, const QRegion &region)
+{
+    states[lod].outputValid -= region;
+
+    Q_FOREACH (RunningUpdate *update, runningUpdates) {
+        if (update->lod == lod && region.intersects(update->outputRect)) {
+            update->outputValid = false;
+        }
+    }
+}
+
+void KisFilterUpdateCache::Private::invalidateHorizontalPass(int lod, const QRegion &region)
+{
+    states[lod].horizontalPassValid -= region;
+
+    Q_FOREACH (RunningUpdate *update, runningUpdates) {
+        if (update->lod == lod && region.intersects(update->horizontalPassRegion)) {
+            update->horizontalPassValid = false;
+        }
+    }
+}
+
+void KisFilterUpdateCache::Private::invalidateAll(int lod)
+{
+    Q_FOREACH (RunningUpdate *update, runningUpdates) {
+        if (update->lod == lod) {
+            update->outputValid = false;
+            update->horizontalPassValid = false;
+        }
+    }
+}
+
+bool KisFilterUpdateCache::Private::hasRunningUpdates(int lod) const
+{
+    Q_FOREACH (RunningUpdate *update, runningUpdates) {
+        if (update->lod == lod) return true;
+    }
+    return false;
+}
+
+void KisFilterUpdateCache::Private::reset()
+{
+    signature = Signature();
+    states.clear();
+
+    Q_FOREACH (RunningUpdate *update, runningUpdates) {
+        update->outputValid = false;
+        update->horizontalPassValid = false;
+    }
+}
+
+
+KisFilterUpdateCache::KisFilterUpdateCache()
+    : m_d(new Private)
+{
+}
+
+KisFilterUpdateCache::~KisFilterUpdateCache()
+{
+}
+
+void KisFilterUpdateCache::clear()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    m_d->reset();
+    m_d->xmlConfig = 0;
+    m_d->xmlCache.clear();
+}
+
+void KisFilterUpdateCache::process(KisFilterSP filter,
+                                   KisFilterConfigurationSP config,
+                                   KisPaintDeviceSP src,
+                                   KisPaintDeviceSP dst,
+                                   const QRect &updateRect,
+                                   const QRect &applyRect,
+                                   bool reuseOutput)
+{
+    KIS_SAFE_ASSERT_RECOVER_NOOP((applyRect & updateRect) == applyRect);
+
+    const int lod = src->defaultBounds()->currentLevelOfDetail();
+    const QPoint srcOffset(src->x(), src->y());
+    const QPoint dstOffset(dst->x(), dst->y());
+
+    /**
+     * The separable passes write into the destination directly, so
+     * they cannot convert the color space the way KisFilter::process()
+     * does with its temporary device
+     */
+    const bool separable =
+        filter->supportsSeparablePasses(config, lod) &&
+        *src->colorSpace() == *dst->colorSpace() &&
+        *dst->colorSpace() == *dst->compositionSourceColorSpace();
+
+    RunningUpdate update(lod, updateRect);
+    QRegion dirtyRegion;
+    QRegion dirtyApplyRegion;
+    QRegion horizontalPassDirtyRegion;
+    KisPaintDeviceSP horizontalPass;
+
+    /**
+     * The lock guards the bookkeeping only. The filter itself runs
+     * unlocked, so that the merge jobs updating different parts of
+     * the layer can run in parallel.
+     */
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        const Signature signature(m_d->configXml(config), config, src, dst);
+        if (!(signature == m_d->signature)) {
+            m_d->reset();
+            m_d->signature = signature;
+        }
+
+        LodState &state = m_d->states[lod];
+
+        if (!reuseOutput || state.dst != dst.data()) {
+            state.dst = reuseOutput ? dst.data() : 0;
+            state.dstVersions.clear();
+            state.outputValid = QRegion();
+            m_d->invalidateAll(lod);
+        }
+
+        if (!separable) {
+            state.horizontalPass = 0;
+            state.horizontalPassValid = QRegion();
+            state.horizontalPassUsedRect = QRect();
+        }
+
+        /**
+         * Invalidate the dependency cones of the changed source tiles.
+         * The kernels of the separable filters are symmetric, so the
+         * rect the horizontal pass needs is also the rect it changes.
+         */
+        const QRect srcRect = filter->neededRect(updateRect, config, lod);
+
+        const QRegion srcChanged =
+            src->dataManager()->changedContentRegion(srcRect.translated(-srcOffset),
+                                                     &state.srcContents).translated(srcOffset);
+
+        Q_FOREACH (const QRect &rc, srcChanged.rects()) {
+            m_d->invalidateOutput(lod, filter->changedRect(rc, config, lod));
+
+            if (separable) {
+                m_d->invalidateHorizontalPass(lod,
+                    filter->separablePassNeededRect(KisFilter::HorizontalPass, rc, config, lod));
+            }
+        }
+
+        /**
+         * Someone else could have written into the destination. Only
+         * the tiles of the update rect are checked, the rest of them
+         * is checked when it gets updated itself.
+         */
+        if (reuseOutput && !state.outputValid.isEmpty()) {
+            const QRegion dstChanged =
+                dst->dataManager()->changedRegion(updateRect.translated(-dstOffset),
+                                                  &state.dstVersions);
+
+            m_d->invalidateOutput(lod, dstChanged.translated(dstOffset));
+        }
+
+        dirtyRegion = QRegion(updateRect) - (state.outputValid & updateRect);
+        dirtyApplyRegion = dirtyRegion & applyRect;
+
+        if (separable) {
+            Q_FOREACH (const QRect &rc, dirtyApplyRegion.rects()) {
+                update.horizontalPassRegion +=
+                    filter->separablePassNeededRect(KisFilter::VerticalPass, rc, config, lod);
+            }
+
+            if (!state.horizontalPass) {
+                state.horizontalPass = new KisPaintDevice(src->colorSpace());
+            }
+
+            horizontalPass = state.horizontalPass;
+            horizontalPassDirtyRegion = update.horizontalPassRegion - state.horizontalPassValid;
+        }
+
+        m_d->runningUpdates.append(&update);
+    }
+
+    Q_FOREACH (const QRect &rc, dirtyRegion.rects()) {
+        dst->clear(rc);
+    }
+
+    const bool threaded = filter->supportsThreading();
+
+    if (separable) {
+        runTiled(horizontalPassDirtyRegion, threaded,
+            [&] (const QRect &rc) {
+                filter->processSeparablePass(KisFilter::HorizontalPass,
+                                             src, horizontalPass, rc, config, lod);
+            });
+
+        runTiled(dirtyApplyRegion, threaded,
+            [&] (const QRect &rc) {
+                filter->processSeparablePass(KisFilter::VerticalPass,
+                                             horizontalPass, dst, rc, config, lod);
+            });
+    } else {
+        runTiled(dirtyApplyRegion, threaded,
+            [&] (const QRect &rc) {
+                filter->process(src, dst, 0, rc, config.data(), 0);
+            });
+    }
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        m_d->runningUpdates.removeOne(&update);
+
+        auto it = m_d->states.find(lod);
+        if (it == m_d->states.end()) return;
+
+        LodState &state = *it;
+
+        if (separable && state.horizontalPass == horizontalPass) {
+            if (update.horizontalPassValid) {
+                state.horizontalPassValid += update.horizontalPassRegion;
+            }
+
+            state.horizontalPassUsedRect |= update.horizontalPassRegion.boundingRect();
+
+            /**
+             * Keep only the part of the pass used by the latest update,
+             * otherwise the pass would grow to the whole filtered area.
+             * The overlapping rows needed by the next chunk of the same
+             * update are inside this part. Nobody else uses the pass
+             * while no update of this level of detail is running.
+             */
+            if (!m_d->hasRunningUpdates(lod)) {
+                horizontalPass->crop(state.horizontalPassUsedRect);
+                state.horizontalPassValid &= state.horizontalPassUsedRect;
+                state.horizontalPassUsedRect = QRect();
+
+                if (state.horizontalPassValid.isEmpty()) {
+                    state.horizontalPass = 0;
+                }
+            }
+        }
+
+        if (reuseOutput && update.outputValid && state.dst == dst.data()) {
+            state.outputValid += updateRect;
+
+            // our own writes should not invalidate the output next time
+            dst->dataManager()->changedRegion(updateRect.translated(-dstOffset),
+                                              &state.dstVersions);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_FILTER_UPDATE_CACHE_H
+#define __KIS_FILTER_UPDATE_CACHE_H
+
+#include <QScopedPointer>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+class QRect;
+
+
+/**
+ * Keeps the intermediate and the final results of a filter applied to
+ * a device between the updates, so that an update recomputes only the
+ * pixels which actually depend on the changed part of the source.
+ *
+ * The source is tracked with the versions and the content hashes of
+ * its tiles (\see KisTiledDataManager::changedContentRegion()), so a
+ * tile rewritten with the same pixels (which is usual for the
+ * projection below an adjustment layer during a stroke) does not
+ * cause any recalculation.
+ * A changed tile invalidates only its dependency cone, that is the
+ * changedRect() of the filter. Everything else is reused:
+ *
+ * - the output of the filter, if the destination device has not been
+ *   touched by anyone else since the previous update
+ *
+ * - the result of the horizontal pass of separable filters (\see
+ *   KisFilter::supportsSeparablePasses()). The pass is also shared
+ *   between the tiled chunks of one update, which otherwise recompute
+ *   the overlapping rows of their needed rects each
+ *
+ * The cache is reset when the configuration of the filter, the color
+ * space, the offset or the default pixel of the source change. Every
+ * level of detail has a separate state.
+ *
+ * NOTE: the cache keeps the intermediate buffer of the separable
+ *       filters in memory, but only the part of it used by the
+ *       latest update. The rest is dropped as soon as no update
+ *       is running.
+ */
+class KRITAIMAGE_EXPORT KisFilterUpdateCache
+{
+public:
+    KisFilterUpdateCache();
+    ~KisFilterUpdateCache();
+
+    /**
+     * Filters \p src into \p dst inside \p applyRect and clears the
+     * rest of \p updateRect in \p dst. \p applyRect must be a part of
+     * \p updateRect.
+     *
+     * If \p reuseOutput is true, the pixels of \p dst in \p updateRect
+     * which are still valid are not recalculated. It should be set
+     * only when \p dst is the same device on every call, otherwise
+     * only the horizontal pass of the filter is reused.
+     *
+     * The filter is run in the work-stealing pool of the current
+     * update job, if it supports threading. The cache is locked only
+     * while its state is being checked and updated, so the updates of
+     * different rects can be processed concurrently.
+     *
+     * The configuration is serialized once per configuration object,
+     * so clear() must be called when \p config is changed in place.
+     */
+    void process(KisFilterSP filter,
+                 KisFilterConfigurationSP config,
+                 KisPaintDeviceSP src,
+                 KisPaintDeviceSP dst,
+                 const QRect &updateRect,
+                 const QRect &applyRect,
+                 bool reuseOutput);
+
+    /**
+     * Drops all the cached data
+     */
+    void clear();
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_FILTER_UPDATE_CACHE_H */
@@ -32,6 +32,7 @@
 #include "kis_processing_visitor.h"
 #include "kis_thread_safe_signal_compressor.h"
 #include "kis_recalculate_generator_layer_job.h"
+#include "kis_work_stealing_task_pool.h"
 
 
 #define UPDATE_DELAY 100 /*ms */
@@ -109,11 +110,26 @@ void KisGeneratorLayer::update()
 
     KisPaintDeviceSP originalDevice = original();
 
-    KisProcessingInformation dstCfg(originalDevice,
-                                    processRect.topLeft(),
-                                    KisSelectionSP());
-
-    f->generate(dstCfg, processRect.size(), filterConfig.data());
+    if (f->supportsThreading()) {
+        /**
+         * When executed by the updater context, the generation is
+         * split into chunks which are shared with the idle threads
+         */
+        KisWorkStealingTaskPool::runTiledInCurrentPool(processRect,
+            [originalDevice, f, filterConfig] (const QRect &rc) {
+                KisProcessingInformation chunkCfg(originalDevice,
+                                                  rc.topLeft(),
+                                                  KisSelectionSP());
+
+                f->generate(chunkCfg, rc.size(), filterConfig.data());
+            });
+    } else {
+        KisProcessingInformation dstCfg(originalDevice,
+                                        processRect.topLeft(),
+                                        KisSelectionSP());
+
+        f->generate(dstCfg, processRect.size(), filterConfig.data());
+    }
 
 
     // hack alert!
@@ -31,6 +31,7 @@
 #include "filter/kis_filter_configuration.h"
 #include "filter/kis_filter_registry.h"
 #include "filter/kis_filter.h"
+#include "filter/kis_filter_update_cache.h"
 #include "kis_node_visitor.h"
 #include "kis_processing_visitor.h"
 
@@ -39,7 +40,8 @@ KisAdjustmentLayer::KisAdjustmentLayer(KisImageWSP image,
                                        const QString &name,
                                        KisFilterConfigurationSP kfc,
                                        KisSelectionSP selection)
-    : KisSelectionBasedLayer(image.data(), name, selection, kfc)
+    : KisSelectionBasedLayer(image.data(), name, selection, kfc),
+      m_filterUpdateCache(new KisFilterUpdateCache())
 {
     // by default Adjustment Layers have a copy composition,
     // which is more natural for users
@@ -51,7 +53,8 @@ KisAdjustmentLayer::KisAdjustmentLayer(KisImageWSP image,
 }
 
 KisAdjustmentLayer::KisAdjustmentLayer(const KisAdjustmentLayer& rhs)
-        : KisSelectionBasedLayer(rhs)
+        : KisSelectionBasedLayer(rhs),
+          m_filterUpdateCache(new KisFilterUpdateCache())
 {
 }
 
@@ -64,6 +67,12 @@ void KisAdjustmentLayer::setFilter(KisFilterConfigurationSP filterConfig)
 {
     filterConfig->setChannelFlags(channelFlags());
     KisSelectionBasedLayer::setFilter(filterConfig);
+    m_filterUpdateCache->clear();
+}
+
+KisFilterUpdateCache* KisAdjustmentLayer::filterUpdateCache() const
+{
+    return m_filterUpdateCache.data();
 }
 
 QRect KisAdjustmentLayer::incomingChangeRect(const QRect &rect) const
@@ -32,11 +32,13 @@
 #define KIS_ADJUSTMENT_LAYER_H_
 
 #include <QObject>
+#include <QScopedPointer>
 #include <kritaimage_export.h>
 #include "kis_selection_based_layer.h"
 
 
 class KisFilterConfiguration;
+class KisFilterUpdateCache;
 
 /**
  * @class KisAdjustmentLayer Contains a KisFilter and a KisSelection.
@@ -102,6 +104,12 @@ public:
 
     void setChannelFlags(const QBitArray & channelFlags) override;
 
+    /**
+     * The cache used by the merger to reuse the unchanged results
+     * of the filter between the updates of the layer
+     */
+    KisFilterUpdateCache* filterUpdateCache() const;
+
 protected:
     // override from KisLayer
     QRect incomingChangeRect(const QRect &rect) const override;
@@ -117,6 +125,9 @@ public Q_SLOTS:
     KisLayer* layer() {
         return this;
     }
+
+private:
+    QScopedPointer<KisFilterUpdateCache> m_filterUpdateCache;
 };
 
 #endif // KIS_ADJUSTMENT_LAYER_H_
@@ -36,10 +36,13 @@
 #include "filter/kis_filter.h"
 #include "filter/kis_filter_configuration.h"
 #include "filter/kis_filter_registry.h"
+#include "filter/kis_filter_update_cache.h"
 #include "kis_selection.h"
 #include "kis_clone_layer.h"
 #include "kis_processing_information.h"
 #include "kis_busy_progress_indicator.h"
+#include "kis_work_stealing_task_pool.h"
+#include "kis_update_time_monitor.h"
 
 
 #include "kis_merge_walker.h"
@@ -85,13 +88,15 @@ public:
         }
 
         KisPaintDeviceSP originalDevice = layer->original();
-        originalDevice->clear(m_updateRect);
 
         const QRect applyRect = m_updateRect & m_projection->extent();
 
         // If the intersection of the updaterect and the projection extent is
         //      null, we are finish here.
-        if(applyRect.isNull()) return true;
+        if(applyRect.isNull()) {
+            originalDevice->clear(m_updateRect);
+            return true;
+        }
 
         KisFilterConfigurationSP filterConfig = layer->filter();
         if (!filterConfig) {
@@ -100,6 +105,7 @@ public:
              * filter inside. Then the layer has work as a pass-through
              * node. Just copy the merged data to the layer's original.
              */
+            originalDevice->clear(m_updateRect);
             KisPainter::copyAreaOptimized(applyRect.topLeft(), m_projection, originalDevice, applyRect);
             return true;
         }
@@ -108,11 +114,15 @@ public:
         const QRect filterRect = selection ? applyRect & selection->selectedRect() : applyRect;
 
         KisFilterSP filter = KisFilterRegistry::instance()->value(filterConfig->name());
-        if (!filter) return false;
+        if (!filter) {
+            originalDevice->clear(m_updateRect);
+            return false;
+        }
 
         KisPaintDeviceSP dstDevice = originalDevice;
 
         if (selection) {
+            originalDevice->clear(m_updateRect);
             dstDevice = new KisPaintDevice(originalDevice->colorSpace());
         }
 
@@ -120,8 +130,18 @@ public:
             KIS_ASSERT_RECOVER_NOOP(layer->busyProgressIndicator());
             layer->busyProgressIndicator()->update();
 
-            // We do not create a transaction here, as srcDevice != dstDevice
-            filter->process(m_projection, dstDevice, 0, filterRect, filterConfig.data(), 0);
+            /**
+             * We do not create a transaction here, as srcDevice != dstDevice
+             *
+             * Without a selection the filter writes right into the
+             * original of the layer, so the cache can also reuse the
+             * pixels it has filtered during the previous updates.
+             * Otherwise the original is cleared above anyway.
+             */
+            layer->filterUpdateCache()->process(filter, filterConfig,
+                                                m_projection, dstDevice,
+                                                selection ? filterRect : m_updateRect,
+                                                filterRect, !selection);
         }
 
         if (selection) {
@@ -223,6 +243,12 @@ void KisAsyncMerger::startMerge(KisBaseRectsWalker &walker, bool notifyClones) {
 
         QRect applyRect = item.m_applyRect;
 
+        /**
+         * The composition and the writing of the projection are
+         * recorded as separate events nested into this one
+         */
+        KisUpdateTraceScope trace("merger", "Merge leaf", applyRect, currentLeaf);
+
         if(item.m_position & KisMergeWalker::N_EXTRA) {
             // The type of layers that will not go to projection.
 
@@ -336,7 +362,15 @@ void KisAsyncMerger::writeProjection(KisProjectionLeafSP topmostLeaf, bool useTe
     if (!m_currentProjection) return;
 
     if(m_currentProjection != m_finalProjection) {
-        KisPainter::copyAreaOptimized(rect.topLeft(), m_currentProjection, m_finalProjection, rect);
+        KisUpdateTraceScope trace("merger", "Write projection", rect);
+
+        KisPaintDeviceSP src = m_currentProjection;
+        KisPaintDeviceSP dst = m_finalProjection;
+
+        KisWorkStealingTaskPool::runTiledInCurrentPool(rect,
+            [src, dst] (const QRect &rc) {
+                KisPainter::copyAreaOptimized(rc.topLeft(), src, dst, rc);
+            });
     }
     DEBUG_NODE_ACTION("Writing projection", "", topmostLeaf->parent(), rect);
 }
@@ -346,8 +380,23 @@ bool KisAsyncMerger::compositeWithProjection(KisProjectionLeafSP leaf, const QRe
     if (!m_currentProjection) return true;
     if (!leaf->visible()) return true;
 
-    KisPainter gc(m_currentProjection);
-    leaf->projectionPlane()->apply(&gc, rect);
+    KisUpdateTraceScope trace("merger", "Composite", rect);
+
+    KisPaintDeviceSP dst = m_currentProjection;
+    KisAbstractProjectionPlaneSP plane = leaf->projectionPlane();
+
+    /**
+     * The leaves are still merged one by one, but the composition of
+     * every leaf is split into tile-aligned chunks, which are shared
+     * with the idle threads of the updater context. The call returns
+     * when all the chunks are ready, so the next leaf and
+     * writeProjection() always see the fully composed rect.
+     */
+    KisWorkStealingTaskPool::runTiledInCurrentPool(rect,
+        [dst, plane] (const QRect &rc) {
+            KisPainter gc(dst);
+            plane->apply(&gc, rc);
+        });
 
     DEBUG_NODE_ACTION("Compositing projection", "", leaf, rect);
     return true;
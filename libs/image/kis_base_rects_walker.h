@@ -114,7 +114,8 @@ public:
 
 public:
     KisBaseRectsWalker()
-        : m_levelOfDetail(0)
+        : m_recordedTrip(0),
+          m_levelOfDetail(0)
     {
     }
 
@@ -133,7 +134,27 @@ public:
         m_requestedRect = requestedRect;
         m_startNode = node;
         m_levelOfDetail = getNodeLevelOfDetail(startLeaf);
+
+        /**
+         * The nodes visited by the trip and their positions depend
+         * on the structure of the graph only, so they are cached in
+         * the start leaf and the repeated updates of the same node
+         * do only the rects arithmetic.
+         */
+        const int tripType = tripCacheId();
+        const bool useTripCache = tripType >= 0 && m_graphChecksum >= 0;
+
+        if (useTripCache && replayCachedTrip(startLeaf, tripType)) return;
+
+        KisProjectionLeaf::WalkerTrip trip;
+        m_recordedTrip = useTripCache ? &trip : 0;
+
         startTrip(startLeaf);
+
+        if (m_recordedTrip) {
+            m_recordedTrip = 0;
+            startLeaf->setCachedWalkerTrip(tripType, m_graphChecksum, trip);
+        }
     }
 
     inline void recalculate(const QRect& requestedRect) {
@@ -210,7 +231,7 @@ public:
         return m_changeRectVaries;
     }
 
-    inline KisNodeSP startNode() const {
+    inline const KisNodeSP& startNode() const {
         return m_startNode;
     }
 
@@ -232,8 +253,87 @@ protected:
      */
     virtual void startTrip(KisProjectionLeafSP startWith) = 0;
 
+    /**
+     * The walkers whose trip depends on the structure of the graph only
+     * (and not on the rects collected on the way) may return a
+     * non-negative id here to let the trip be cached in the start leaf.
+     * The id must be unique for every kind of the trip.
+     *
+     * \see KisProjectionLeaf::cachedWalkerTrip()
+     */
+    virtual int tripCacheId() const {
+        return -1;
+    }
+
 protected:
 
+    enum TripAction {
+        TRIP_CHANGE_RECT,
+        TRIP_NEED_RECT,
+        TRIP_MASKS_CHANGE_RECT
+    };
+
+    inline void recordTripStep(TripAction action, KisProjectionLeafSP leaf, NodePosition position) {
+        if (!m_recordedTrip) return;
+
+        KisProjectionLeaf::WalkerTripStep step = {action, position, leaf.toWeakRef()};
+        m_recordedTrip->append(step);
+    }
+
+    /**
+     * The walkers supporting trip caching should visit the nodes
+     * with these methods instead of calling register*() directly
+     */
+    inline void visitChangeRect(KisProjectionLeafSP leaf, NodePosition position) {
+        recordTripStep(TRIP_CHANGE_RECT, leaf, position);
+        registerChangeRect(leaf, position);
+    }
+
+    inline void visitNeedRect(KisProjectionLeafSP leaf, NodePosition position) {
+        recordTripStep(TRIP_NEED_RECT, leaf, position);
+        registerNeedRect(leaf, position);
+    }
+
+    inline void visitMasksChangeRect(KisProjectionLeafSP firstMask) {
+        recordTripStep(TRIP_MASKS_CHANGE_RECT, firstMask, N_NORMAL);
+        adjustMasksChangeRect(firstMask);
+    }
+
+    bool replayCachedTrip(KisProjectionLeafSP startLeaf, int tripType) {
+        KisProjectionLeaf::WalkerTrip trip;
+        if (!startLeaf->cachedWalkerTrip(tripType, m_graphChecksum, &trip)) {
+            return false;
+        }
+
+        QVector<KisProjectionLeafSP> leaves;
+        leaves.reserve(trip.size());
+
+        Q_FOREACH (const KisProjectionLeaf::WalkerTripStep &step, trip) {
+            KisProjectionLeafSP leaf = step.leaf.toStrongRef();
+            if (!leaf) return false;
+
+            leaves.append(leaf);
+        }
+
+        for (int i = 0; i < trip.size(); i++) {
+            const KisProjectionLeaf::WalkerTripStep &step = trip[i];
+
+            switch (step.action) {
+            case TRIP_CHANGE_RECT:
+                registerChangeRect(leaves[i], step.position);
+                break;
+            case TRIP_NEED_RECT:
+                registerNeedRect(leaves[i], step.position);
+                break;
+            case TRIP_MASKS_CHANGE_RECT:
+                adjustMasksChangeRect(leaves[i]);
+                break;
+            }
+        }
+
+        return true;
+    }
+
     static inline qint32 getGraphPosition(qint32 position) {
         return position & GRAPH_POSITION_MASK;
     }
@@ -477,6 +577,11 @@ private:
      */
     qint32 m_graphChecksum;
 
+    /**
+     * The trip being recorded by collectRects() or null
+     */
+    KisProjectionLeaf::WalkerTrip *m_recordedTrip;
+
     /**
      * Temporary variables
      */
@@ -0,0 +1,428 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_dab_blending_pipeline.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+
+#include <KoColorSpace.h>
+
+#include "kis_assert.h"
+#include "kis_fixed_paint_device.h"
+#include "kis_paint_device.h"
+#include "kis_selection.h"
+#include "kis_work_stealing_task_pool.h"
+
+
+namespace {
+
+/**
+ * The size of a tile of KisPaintDevice. The dabs are split into
+ * pieces of this size, so two pieces blended concurrently never
+ * touch the same tile.
+ */
+const int TILE_SIZE = 64;
+
+struct DabRequest
+{
+    QPoint dstPos;
+    KisFixedPaintDeviceSP dab;
+    QRect srcRect;
+    const KoCompositeOp *compositeOp;
+    KoCompositeOp::ParameterInfo params;
+    KisSelectionSP selection;
+    KoColorConversionTransformation::Intent renderingIntent;
+    KoColorConversionTransformation::ConversionFlags conversionFlags;
+
+    QRect dstRect() const {
+        return QRect(dstPos, srcRect.size());
+    }
+};
+
+struct DabPiece
+{
+    const DabRequest *request;
+    QRect rect;
+};
+
+inline int divideFloor(int value, int step) {
+    return value >= 0 ? value / step : -((-value + step - 1) / step);
+}
+
+inline quint64 tileKey(const QPoint &pt) {
+    return (quint64(quint32(divideFloor(pt.x(), TILE_SIZE))) << 32) |
+        quint32(divideFloor(pt.y(), TILE_SIZE));
+}
+
+}
+
+struct KisDabBlendingPipeline::Private
+{
+    Private(KisDabBlendingPipeline *_q)
+        : q(_q),
+          pool(0),
+          head(0),
+          count(0),
+          isBlending(false),
+          isBlendingJobRunning(false)
+    {
+    }
+
+    KisDabBlendingPipeline *q;
+
+    KisPaintDeviceSP device;
+    DirtyCallback callback;
+    KisWorkStealingTaskPool *pool;
+
+    /**
+     * The ring buffer of the pending dabs. The producer writes to
+     * (head + count) % capacity, the blending job reads from head.
+     */
+    QVector<DabRequest> ring;
+    int head;
+    int count;
+
+    /**
+     * Set while a batch is being blended. The batches are blended
+     * one after another, otherwise the dabs of a later batch could
+     * overtake the ones of an earlier batch.
+     */
+    bool isBlending;
+
+    /**
+     * Set while a blending job is started in the pool
+     */
+    bool isBlendingJobRunning;
+
+    QVector<QRect> addedRects;
+
+    QMutex mutex;
+    QWaitCondition notFull;
+    QWaitCondition idle;
+
+    void tryStartBlendingJob();
+    void blendingJob();
+
+    QVector<DabRequest> takeBatch();
+    void blendTakenBatch(QMutexLocker *locker, QVector<DabRequest> &batch);
+
+    QVector<QRect> blendBatch(const QVector<DabRequest> &batch);
+    void blendPiece(const DabRequest &request, const QRect &rc);
+};
+
+/**
+ * Should be called with the mutex held
+ */
+void KisDabBlendingPipeline::Private::tryStartBlendingJob()
+{
+    if (isBlendingJobRunning || !pool) return;
+
+    isBlendingJobRunning = pool->tryStartTask([this] () { blendingJob(); });
+}
+
+/**
+ * Blends the pending dabs in a thread of the updater context. The
+ * job doesn't wait for new dabs: it gives the thread back as soon as
+ * the buffer is empty and the next added dab starts a new job. It
+ * also gives the thread back when the context reserves it for one
+ * of its own jobs (e.g. a merge job of the stroke). The remaining
+ * dabs are then blended by the producer (\see addDab() and flush())
+ * or by the next job started by addDab().
+ */
+void KisDabBlendingPipeline::Private::blendingJob()
+{
+    QMutexLocker l(&mutex);
+
+    while (count) {
+        while (isBlending) {
+            idle.wait(&mutex);
+        }
+
+        if (!count || pool->hasThreadReservations()) break;
+
+        QVector<DabRequest> batch = takeBatch();
+        blendTakenBatch(&l, batch);
+    }
+
+    isBlendingJobRunning = false;
+    idle.wakeAll();
+
+    /**
+     * The producer may be waiting for the buffer to get free space,
+     * now it should blend the dabs itself
+     */
+    notFull.wakeAll();
+}
+
+/**
+ * Should be called with the mutex held and no batch being blended
+ */
+QVector<DabRequest> KisDabBlendingPipeline::Private::takeBatch()
+{
+    QVector<DabRequest> batch;
+    batch.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        const int index = (head + i) % ring.size();
+        batch.append(ring[index]);
+        ring[index] = DabRequest();
+    }
+
+    head = (head + count) % ring.size();
+    count = 0;
+    isBlending = true;
+
+    notFull.wakeAll();
+
+    return batch;
+}
+
+/**
+ * Blends the \p batch taken with takeBatch() with the mutex unlocked
+ */
+void KisDabBlendingPipeline::Private::blendTakenBatch(QMutexLocker *locker, QVector<DabRequest> &batch)
+{
+    locker->unlock();
+
+    const QVector<QRect> dirtyRects = blendBatch(batch);
+    batch.clear();
+
+    if (callback) {
+        callback(dirtyRects);
+    }
+
+    locker->relock();
+
+    isBlending = false;
+    idle.wakeAll();
+}
+
+QVector<QRect> KisDabBlendingPipeline::Private::blendBatch(const QVector<DabRequest> &batch)
+{
+    QVector<QRect> dirtyRects;
+    dirtyRects.reserve(batch.size());
+
+    /**
+     * The pieces are grouped by tiles. Every group keeps the order
+     * of the dabs, so the overlapping dabs are blended in the same
+     * order as they were painted.
+     */
+    QHash<quint64, int> groupIndex;
+    QVector<QVector<DabPiece>> groups;
+
+    Q_FOREACH (const DabRequest &request, batch) {
+        const QRect dstRect = request.dstRect();
+        dirtyRects.append(dstRect);
+
+        Q_FOREACH (const QRect &rc, KisWorkStealingTaskPool::splitRect(dstRect, TILE_SIZE)) {
+            const quint64 key = tileKey(rc.topLeft());
+
+            auto it = groupIndex.find(key);
+            if (it == groupIndex.end()) {
+                it = groupIndex.insert(key, groups.size());
+                groups.append(QVector<DabPiece>());
+            }
+
+            DabPiece piece = {&request, rc};
+            groups[*it].append(piece);
+        }
+    }
+
+    QVector<KisWorkStealingTaskPool::Task> tasks;
+    tasks.reserve(groups.size());
+
+    for (int i = 0; i < groups.size(); i++) {
+        const QVector<DabPiece> &group = groups[i];
+
+        tasks.append([this, &group] () {
+            Q_FOREACH (const DabPiece &piece, group) {
+                blendPiece(*piece.request, piece.rect);
+            }
+        });
+    }
+
+    KisWorkStealingTaskPool::runInCurrentPool(tasks);
+
+    return dirtyRects;
+}
+
+void KisDabBlendingPipeline::Private::blendPiece(const DabRequest &request, const QRect &rc)
+{
+    const KoColorSpace *colorSpace = device->colorSpace();
+    const KisFixedPaintDevice *dab = request.dab.data();
+    const QRect srcBounds = dab->bounds();
+
+    const int srcX = request.srcRect.x() + rc.x() - request.dstPos.x();
+    const int srcY = request.srcRect.y() + rc.y() - request.dstPos.y();
+
+    QVector<quint8> dstBytes(rc.width() * rc.height() * device->pixelSize());
+    device->readBytes(dstBytes.data(), rc);
+
+    KoCompositeOp::ParameterInfo params(request.params);
+
+    params.dstRowStart   = dstBytes.data();
+    params.dstRowStride  = rc.width() * device->pixelSize();
+    params.srcRowStart   = dab->data() +
+        (srcBounds.width() * (srcY - srcBounds.top()) + (srcX - srcBounds.left())) * dab->pixelSize();
+    params.srcRowStride  = srcBounds.width() * dab->pixelSize();
+    params.maskRowStart  = 0;
+    params.maskRowStride = 0;
+    params.rows          = rc.height();
+    params.cols          = rc.width();
+
+    QVector<quint8> selBytes;
+
+    if (request.selection) {
+        KisPaintDeviceSP selectionProjection(request.selection->projection());
+
+        selBytes.resize(rc.width() * rc.height() * selectionProjection->pixelSize());
+        selectionProjection->readBytes(selBytes.data(), rc);
+
+        params.maskRowStart = selBytes.constData();
+        params.maskRowStride = rc.width() * selectionProjection->pixelSize();
+    }
+
+    colorSpace->bitBlt(dab->colorSpace(), params, request.compositeOp,
+                       request.renderingIntent, request.conversionFlags);
+
+    device->writeBytes(dstBytes.constData(), rc);
+}
+
+KisDabBlendingPipeline::KisDabBlendingPipeline(KisPaintDeviceSP device,
+                                               const DirtyCallback &callback,
+                                               KisWorkStealingTaskPool *pool,
+                                               int capacity)
+    : m_d(new Private(this))
+{
+    KIS_SAFE_ASSERT_RECOVER(capacity > 0) {
+        capacity = 1;
+    }
+
+    m_d->device = device;
+    m_d->callback = callback;
+    m_d->pool = pool;
+    m_d->ring.resize(capacity);
+}
+
+KisDabBlendingPipeline::~KisDabBlendingPipeline()
+{
+    waitForDone();
+}
+
+void KisDabBlendingPipeline::addDab(qint32 dstX, qint32 dstY,
+                                    KisFixedPaintDeviceSP srcDev,
+                                    const QRect &srcRect,
+                                    const KoCompositeOp *compositeOp,
+                                    const KoCompositeOp::ParameterInfo &params,
+                                    KisSelectionSP selection,
+                                    KoColorConversionTransformation::Intent renderingIntent,
+                                    KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    DabRequest request;
+    request.dstPos = QPoint(dstX, dstY);
+
+    /**
+     * The paintops reuse (and even mirror) their dabs after passing
+     * them to the painter, so we should keep our own copy of the
+     * blended area
+     */
+    request.dab = new KisFixedPaintDevice(srcDev->colorSpace());
+    request.dab->setRect(srcRect);
+    request.dab->initialize();
+    srcDev->readBytes(request.dab->data(),
+                      srcRect.x(), srcRect.y(),
+                      srcRect.width(), srcRect.height());
+
+    request.srcRect = srcRect;
+    request.compositeOp = compositeOp;
+    request.params = params;
+    request.selection = selection;
+    request.renderingIntent = renderingIntent;
+    request.conversionFlags = conversionFlags;
+
+    QMutexLocker l(&m_d->mutex);
+
+    /**
+     * If the buffer is full and the context has no thread for the
+     * blending job, the producer blends the dabs itself
+     */
+    while (m_d->count == m_d->ring.size()) {
+        m_d->tryStartBlendingJob();
+
+        if (!m_d->isBlendingJobRunning && !m_d->isBlending) {
+            QVector<DabRequest> batch = m_d->takeBatch();
+            m_d->blendTakenBatch(&l, batch);
+        } else {
+            m_d->notFull.wait(&m_d->mutex);
+        }
+    }
+
+    m_d->ring[(m_d->head + m_d->count) % m_d->ring.size()] = request;
+    m_d->count++;
+    m_d->addedRects.append(request.dstRect());
+
+    m_d->tryStartBlendingJob();
+}
+
+void KisDabBlendingPipeline::waitForDone()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    while (m_d->count || m_d->isBlending || m_d->isBlendingJobRunning) {
+        if (m_d->count && !m_d->isBlending && !m_d->isBlendingJobRunning) {
+            QVector<DabRequest> batch = m_d->takeBatch();
+            m_d->blendTakenBatch(&l, batch);
+        } else {
+            m_d->idle.wait(&m_d->mutex);
+        }
+    }
+}
+
+void KisDabBlendingPipeline::flush()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    if (!m_d->count) return;
+
+    m_d->tryStartBlendingJob();
+
+    if (!m_d->isBlendingJobRunning && !m_d->isBlending) {
+        QVector<DabRequest> batch = m_d->takeBatch();
+        m_d->blendTakenBatch(&l, batch);
+    }
+}
+
+QVector<QRect> KisDabBlendingPipeline::takeAddedRects()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    QVector<QRect> rects;
+    rects.swap(m_d->addedRects);
+    return rects;
+}
+
+int KisDabBlendingPipeline::capacity() const
+{
+    return m_d->ring.size();
+}
+
+KisPaintDeviceSP KisDabBlendingPipeline::device() const
+{
+    return m_d->device;
+}
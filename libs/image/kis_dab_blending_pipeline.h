@@ -0,0 +1,135 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_DAB_BLENDING_PIPELINE_H
+#define __KIS_DAB_BLENDING_PIPELINE_H
+
+#include <functional>
+
+#include <QRect>
+#include <QScopedPointer>
+#include <QVector>
+
+#include <KoColorConversionTransformation.h>
+#include <KoCompositeOp.h>
+
+#include "kis_types.h"
+#include "kritaimage_export.h"
+
+class KisWorkStealingTaskPool;
+
+
+/**
+ * The second stage of a pipelined painting stroke.
+ *
+ * Normally a paintop generates a dab and blends it onto the device in
+ * the same thread, so the two operations wait for each other. When a
+ * pipeline is attached to a painter (\see KisPainter::setDabBlendingPipeline()),
+ * KisPainter::bltFixed() only puts the dab into a bounded ring buffer
+ * and returns, so the paintop can go on generating the next dab. The
+ * pipeline starts a blending job on a free thread of the updater
+ * context (\see KisWorkStealingTaskPool::tryStartTask()) that takes
+ * the dabs out of the buffer, splits them into tile-sized pieces and
+ * blends the pieces tile by tile. The job ends as soon as the buffer
+ * is empty or the context reserves a thread for its own job, so the
+ * pipeline never uses more threads than the context has and never
+ * delays the other jobs of the stroke. Within a tile the dabs are blended in the order they were
+ * added, so the result is exactly the same as with the sequential
+ * blending. Different tiles may be blended concurrently by the
+ * threads of the work-stealing pool of the updater context.
+ *
+ * The dirty rects of the blended dabs are passed to the callback
+ * after the pixels have landed on the device, not by the painter.
+ *
+ * The producer blocks when the buffer is full, so the memory used by
+ * the pending dabs is limited. If the context has no free thread for
+ * the blending job, the producer blends the full buffer itself. The
+ * producer should call flush() when it stops adding dabs for a while
+ * (e.g. at the end of a stroke job), otherwise the dabs added while no
+ * job could be started would wait for the next dab.
+ */
+class KRITAIMAGE_EXPORT KisDabBlendingPipeline
+{
+public:
+    typedef std::function<void (const QVector<QRect>&)> DirtyCallback;
+
+public:
+    /**
+     * \p device is the device the dabs are blended onto, \p callback
+     * is called from the thread blending the dabs with the rects
+     * changed by every blended batch of dabs. The blending jobs are
+     * started in \p pool. If it is null, the dabs are blended by the
+     * producer when the buffer gets full or in waitForDone().
+     */
+    KisDabBlendingPipeline(KisPaintDeviceSP device,
+                           const DirtyCallback &callback,
+                           KisWorkStealingTaskPool *pool = 0,
+                           int capacity = 128);
+
+    /**
+     * Blends all the pending dabs and waits for the blending job
+     */
+    ~KisDabBlendingPipeline();
+
+    /**
+     * Puts a copy of the \p srcRect part of \p srcDev into the
+     * buffer. The dab will be blended to \p dstX, \p dstY with the
+     * passed composite op and parameters. Blocks if the buffer is
+     * full. The arguments are the same as the ones used by
+     * KisPainter::bltFixed().
+     */
+    void addDab(qint32 dstX, qint32 dstY,
+                KisFixedPaintDeviceSP srcDev,
+                const QRect &srcRect,
+                const KoCompositeOp *compositeOp,
+                const KoCompositeOp::ParameterInfo &params,
+                KisSelectionSP selection,
+                KoColorConversionTransformation::Intent renderingIntent,
+                KoColorConversionTransformation::ConversionFlags conversionFlags);
+
+    /**
+     * Makes sure the pending dabs get blended without waiting for the
+     * next added dab: starts a blending job for them or, if the
+     * context has no thread for it, blends them in the calling
+     * thread. Doesn't wait for an already running job.
+     */
+    void flush();
+
+    /**
+     * Blocks until all the added dabs are blended and reported
+     */
+    void waitForDone();
+
+    /**
+     * Returns the rects of the dabs added since the previous call.
+     * They get dirty later, when the dabs are blended. Used for
+     * measuring the response time of the strokes.
+     */
+    QVector<QRect> takeAddedRects();
+
+    /**
+     * The maximum number of dabs that can be pending in the buffer
+     */
+    int capacity() const;
+
+    KisPaintDeviceSP device() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_DAB_BLENDING_PIPELINE_H */
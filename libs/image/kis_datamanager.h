@@ -167,6 +167,14 @@ public:
         return ACTUAL_DATAMGR::region();
     }
 
+    /**
+     * Asks the tiles covering \p rect to be loaded from swap in a
+     * background thread. Used as a hint only.
+     */
+    inline void prefetchTiles(const QRect &rect) {
+        ACTUAL_DATAMGR::prefetchTiles(rect);
+    }
+
 public:
 
     /**
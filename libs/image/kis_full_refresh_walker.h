@@ -58,6 +58,11 @@ public:
         }
     }
 
+    int tripCacheId() const override {
+        // the trip depends on m_currentUpdateType, so it cannot be replayed
+        return -1;
+    }
+
     void registerChangeRect(KisProjectionLeafSP leaf, NodePosition position) override {
         if(m_currentUpdateType == FULL_REFRESH) {
             KisRefreshSubtreeWalker::registerChangeRect(leaf, position);
@@ -37,6 +37,7 @@
 #include "kis_selection_mask.h"
 #include "kis_psd_layer_style.h"
 #include "kis_layer_properties_icons.h"
+#include "kis_node_graph_listener.h"
 
 
 struct Q_DECL_HIDDEN KisGroupLayer::Private
@@ -292,11 +293,24 @@ bool KisGroupLayer::passThroughMode() const
 }
 
 void KisGroupLayer::setPassThroughMode(bool value)
+{
+    setPassThroughModeImpl(value, true);
+}
+
+void KisGroupLayer::setPassThroughModeImpl(bool value, bool invalidateGraph)
 {
     if (m_d->passThroughMode == value) return;
 
     m_d->passThroughMode = value;
 
+    /**
+     * Pass-through groups change the shape of the projection graph,
+     * so all the cached walker trips become outdated
+     */
+    if (invalidateGraph && graphListener()) {
+        graphListener()->invalidateGraphSequenceNumber();
+    }
+
     baseNodeChangedCallback();
     baseNodeInvalidateAllFramesCallback();
 }
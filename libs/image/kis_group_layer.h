@@ -115,6 +115,14 @@ private:
     bool checkCloneLayer(KisCloneLayerSP clone) const;
     bool checkNodeRecursively(KisNodeSP node) const;
 
+    friend class KisProjectionLeaf;
+    /**
+     * Sets the pass-through mode, but bumps the graph sequence number
+     * only if \p invalidateGraph is true. Used by the projection leaf
+     * to switch the mode temporarily.
+     */
+    void setPassThroughModeImpl(bool value, bool invalidateGraph);
+
 private:
     struct Private;
     Private * const m_d;
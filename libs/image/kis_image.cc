@@ -1648,6 +1648,11 @@ void KisImage::setDesiredLevelOfDetail(int lod)
     m_d->scheduler.setDesiredLevelOfDetail(lod);
 }
 
+void KisImage::setUpdatesPriorityRect(const QRect &rc)
+{
+    m_d->scheduler.setUpdatesPriorityRect(rc);
+}
+
 int KisImage::currentLevelOfDetail() const
 {
     if (m_d->blockLevelOfDetail) {
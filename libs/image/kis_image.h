@@ -548,6 +548,14 @@ public:
      */
     void setDesiredLevelOfDetail(int lod);
 
+    /**
+     * Notify KisImage which part of the image is currently visible
+     * to the user. The updates of this area will be processed first,
+     * the rest of the image is updated in the background. Pass an
+     * empty rect to reset the priority.
+     */
+    void setUpdatesPriorityRect(const QRect &rc);
+
     /**
      * Relative position of the mirror axis center
      *     0,0 - topleft corner of the image
@@ -79,6 +79,17 @@ void KisImageConfig::setEnablePerfLog(bool value)
     m_config.writeEntry("enablePerfLog", value);
 }
 
+QString KisImageConfig::updateTraceFile(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("updateTraceFile", QString()) : QString();
+}
+
+void KisImageConfig::setUpdateTraceFile(const QString &value)
+{
+    m_config.writeEntry("updateTraceFile", value);
+}
+
 qreal KisImageConfig::transformMaskOffBoundsReadArea() const
 {
     return m_config.readEntry("transformMaskOffBoundsReadArea", 0.5);
@@ -163,6 +174,43 @@ void KisImageConfig::setSwapWindowSize(int value)
     m_config.writeEntry("swapWindowSize", value);
 }
 
+QString KisImageConfig::swapCompression(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("swapCompression", "LZF") : "LZF";
+}
+
+void KisImageConfig::setSwapCompression(const QString &value)
+{
+    m_config.writeEntry("swapCompression", value);
+}
+
+QString KisImageConfig::saveCompression(bool requestDefault) const
+{
+    /**
+     * LZF is the default, because the files written with other codecs
+     * cannot be opened by the older versions of Krita
+     */
+    return !requestDefault ?
+        m_config.readEntry("saveCompression", "LZF") : "LZF";
+}
+
+void KisImageConfig::setSaveCompression(const QString &value)
+{
+    m_config.writeEntry("saveCompression", value);
+}
+
+bool KisImageConfig::tileDataFirstTouch(bool requestDefault) const
+{
+    return !requestDefault ?
+        m_config.readEntry("tileDataFirstTouch", false) : false;
+}
+
+void KisImageConfig::setTileDataFirstTouch(bool value)
+{
+    m_config.writeEntry("tileDataFirstTouch", value);
+}
+
 int KisImageConfig::tilesHardLimit() const
 {
     qreal hp = qreal(memoryHardLimitPercent()) / 100.0;
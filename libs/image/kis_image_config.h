@@ -36,6 +36,9 @@ public:
     bool enablePerfLog(bool requestDefault = false) const;
     void setEnablePerfLog(bool value);
 
+    QString updateTraceFile(bool requestDefault = false) const;
+    void setUpdateTraceFile(const QString &value);
+
     qreal transformMaskOffBoundsReadArea() const;
 
     int updatePatchHeight() const;
@@ -58,6 +61,25 @@ public:
     int swapWindowSize() const;
     void setSwapWindowSize(int value);
 
+    /**
+     * Names of the codecs used for compressing the tiles (see
+     * KisCompressionFactory). The swap is latency-bound, so it
+     * should use a fast codec, while the saved files are size-bound.
+     */
+    QString swapCompression(bool requestDefault = false) const;
+    void setSwapCompression(const QString &value);
+
+    QString saveCompression(bool requestDefault = false) const;
+    void setSaveCompression(const QString &value);
+
+    /**
+     * If enabled, the memory arenas for the tiles are faulted in by
+     * the thread that allocates them, so on NUMA systems they are
+     * placed on the node of the thread that is going to use them.
+     */
+    bool tileDataFirstTouch(bool requestDefault = false) const;
+    void setTileDataFirstTouch(bool value);
+
     int tilesHardLimit() const; // MiB
     int tilesSoftLimit() const; // MiB
     int poolLimit() const; // MiB
@@ -113,9 +113,18 @@ KisMemoryStatisticsServer::fetchMemoryStatistics(KisImageSP image) const
     stats.realMemorySize = tileStats.realMemorySize;
     stats.historicalMemorySize = tileStats.historicalMemorySize;
     stats.poolSize = tileStats.poolSize;
+    stats.poolBudget = tileStats.poolBudget;
+    stats.poolCloneHits = tileStats.poolCloneHits;
+    stats.poolCloneMisses = tileStats.poolCloneMisses;
+    stats.poolClonesWasted = tileStats.poolClonesWasted;
 
     stats.swapSize = tileStats.swapSize;
 
+    stats.uniformSavedSize = tileStats.uniformSavedSize;
+
+    stats.arenasReservedSize = tileStats.arenasReservedSize;
+    stats.arenasUsedSize = tileStats.arenasUsedSize;
+
     KisImageConfig cfg;
 
     stats.tilesHardLimit = cfg.tilesHardLimit() * MiB;
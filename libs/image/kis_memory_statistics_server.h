@@ -40,9 +40,18 @@ public:
               realMemorySize(0),
               historicalMemorySize(0),
               poolSize(0),
+              poolBudget(0),
+              poolCloneHits(0),
+              poolCloneMisses(0),
+              poolClonesWasted(0),
 
               swapSize(0),
 
+              uniformSavedSize(0),
+
+              arenasReservedSize(0),
+              arenasUsedSize(0),
+
               totalMemoryLimit(0),
               tilesHardLimit(0),
               tilesSoftLimit(0),
@@ -57,8 +66,26 @@ public:
         qint64 historicalMemorySize;
         qint64 poolSize;
 
+        /**
+         * The memory the tiles pooler allows itself to use at the
+         * moment and the efficiency of the pre-made clones
+         */
+        qint64 poolBudget;
+        qint64 poolCloneHits;
+        qint64 poolCloneMisses;
+        qint64 poolClonesWasted;
+
         qint64 swapSize;
 
+        qint64 uniformSavedSize;
+
+        /**
+         * (arenasReservedSize - arenasUsedSize) is the memory lost
+         * to fragmentation of the tile allocator
+         */
+        qint64 arenasReservedSize;
+        qint64 arenasUsedSize;
+
         qint64 totalMemoryLimit;
         qint64 tilesHardLimit;
         qint64 tilesSoftLimit;
@@ -36,6 +36,11 @@ KisBaseRectsWalker::UpdateType KisMergeWalker::type() const
     return m_flags == DEFAULT ? KisBaseRectsWalker::UPDATE : KisBaseRectsWalker::UPDATE_NO_FILTHY;
 }
 
+int KisMergeWalker::tripCacheId() const
+{
+    return m_flags;
+}
+
 void KisMergeWalker::startTrip(KisProjectionLeafSP startLeaf)
 {
     if(startLeaf->isMask()) {
@@ -69,7 +74,7 @@ void KisMergeWalker::startTripWithMask(KisProjectionLeafSP filthyMask)
         return;
     }
 
-    adjustMasksChangeRect(filthyMask);
+    visitMasksChangeRect(filthyMask);
 
     KisProjectionLeafSP nextLeaf = parentLayer->nextSibling();
     KisProjectionLeafSP prevLeaf = parentLayer->prevSibling();
@@ -82,7 +87,7 @@ void KisMergeWalker::startTripWithMask(KisProjectionLeafSP filthyMask)
     NodePosition positionToFilthy =
         (m_flags == DEFAULT ? N_FILTHY_PROJECTION : N_ABOVE_FILTHY) |
         calculateNodePosition(parentLayer);
-    registerNeedRect(parentLayer, positionToFilthy);
+    visitNeedRect(parentLayer, positionToFilthy);
 
     if(prevLeaf)
         visitLowerNode(prevLeaf);
@@ -92,7 +97,7 @@ void KisMergeWalker::visitHigherNode(KisProjectionLeafSP leaf, NodePosition posi
 {
     positionToFilthy |= calculateNodePosition(leaf);
 
-    registerChangeRect(leaf, positionToFilthy);
+    visitChangeRect(leaf, positionToFilthy);
 
     KisProjectionLeafSP nextLeaf = leaf->nextSibling();
     if (nextLeaf)
@@ -100,14 +105,14 @@ void KisMergeWalker::visitHigherNode(KisProjectionLeafSP leaf, NodePosition posi
     else if (leaf->parent())
         startTrip(leaf->parent());
 
-    registerNeedRect(leaf, positionToFilthy);
+    visitNeedRect(leaf, positionToFilthy);
 }
 
 void KisMergeWalker::visitLowerNode(KisProjectionLeafSP leaf)
 {
     NodePosition position =
         N_BELOW_FILTHY | calculateNodePosition(leaf);
-    registerNeedRect(leaf, position);
+    visitNeedRect(leaf, position);
 
     KisProjectionLeafSP prevLeaf = leaf->prevSibling();
     if (prevLeaf)
@@ -62,6 +62,8 @@ protected:
 
     using KisBaseRectsWalker::startTrip;
 
+    int tripCacheId() const override;
+
     void startTripWithMask(KisProjectionLeafSP filthyMask);
 
 private:
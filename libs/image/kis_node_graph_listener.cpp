@@ -74,6 +74,11 @@ int KisNodeGraphListener::graphSequenceNumber() const
     return m_d->sequenceNumber;
 }
 
+void KisNodeGraphListener::invalidateGraphSequenceNumber()
+{
+    m_d->sequenceNumber++;
+}
+
 void KisNodeGraphListener::nodeChanged(KisNode * /*node*/)
 {
 }
@@ -115,6 +115,14 @@ public:
      */
      int graphSequenceNumber() const;
 
+    /**
+     * Increments the sequence number of the graph without changing
+     * the hierarchy of the nodes. Should be called when the way the
+     * walkers traverse the graph changes, e.g. when a group changes
+     * its pass-through mode.
+     */
+    void invalidateGraphSequenceNumber();
+
 private:
     struct Private;
     QScopedPointer<Private> m_d;
@@ -24,6 +24,8 @@
 #include <QImage>
 #include <QList>
 #include <QHash>
+#include <QMap>
+#include <QMutex>
 #include <QIODevice>
 #include <qmath.h>
 
@@ -399,6 +401,7 @@ public:
     void uploadFrame(int dstFrameId, KisPaintDeviceSP srcDevice);
     void uploadFrameData(DataSP srcData, DataSP dstData);
 
+    struct LodLevel;
     struct LodDataStructImpl;
     LodDataStruct* createLodDataStruct(int lod);
     void updateLodDataStruct(LodDataStruct *dst, const QRect &srcRect);
@@ -410,6 +413,7 @@ public:
 private:
 
     QRegion syncWholeDevice(Data *srcData);
+    void downscaleLodRect(Data *lodData, const QRect &originalRect);
 
     inline DataSP currentFrameData() const
     {
@@ -528,6 +532,15 @@ private:
     mutable QScopedPointer<Data> m_externalFrameData;
     mutable QMutex m_dataSwitchLock;
 
+    /**
+     * The levels of detail generated by the previous synchronizations,
+     * indexed by the level. They are kept resident, so switching to a
+     * level the device has already been synchronized with costs only
+     * the downsampling of the tiles changed in between.
+     */
+    QMap<int, LodLevel*> m_lodPyramid;
+    mutable QMutex m_lodPyramidLock;
+
     FramesHash m_frames;
     int m_nextFreeFrameId;
 };
@@ -548,6 +561,7 @@ KisPaintDevice::Private::Private(KisPaintDevice *paintDevice)
 KisPaintDevice::Private::~Private()
 {
     m_frames.clear();
+    qDeleteAll(m_lodPyramid);
 }
 
 KisPaintDevice::Private::KisPaintDeviceStrategy* KisPaintDevice::Private::currentStrategy()
@@ -596,23 +610,66 @@ struct KisPaintDevice::Private::StrategyPolicy {
     int m_offsetY;
 };
 
+/**
+ * A level of the persistent LoD pyramid. It remembers the versions of
+ * the source tiles it has been synchronized with, so the next
+ * synchronization downsamples the changed tiles only.
+ */
+struct KisPaintDevice::Private::LodLevel {
+    LodLevel(Data *srcData) : data(new Data(srcData, false)) {}
+    QScopedPointer<Data> data;
+    KisDataManager::TileVersions syncedVersions;
+};
+
 struct KisPaintDevice::Private::LodDataStructImpl : public KisPaintDevice::LodDataStruct {
-    LodDataStructImpl(Data *_lodData) : lodData(_lodData) {}
-    QScopedPointer<Data> lodData;
+    LodDataStructImpl(LodLevel *_level) : level(_level) {}
+
+    /**
+     * The level is owned by the device. The new versions are
+     * committed into the level in uploadLodDataStruct() only, so
+     * a cancelled synchronization is redone next time.
+     */
+    LodLevel *level;
+    QRegion dirtyRegion;
+    KisDataManager::TileVersions versions;
 };
 
 QRegion KisPaintDevice::Private::regionForLodSyncing() const
 {
     Data *srcData = currentNonLodData();
-    return srcData->dataManager()->region().translated(srcData->x(), srcData->y());
+    QRegion region = srcData->dataManager()->region().translated(srcData->x(), srcData->y());
+
+    /**
+     * The tiles removed from the source since the previous
+     * synchronization should be reset in the levels as well
+     */
+    QMutexLocker l(&m_lodPyramidLock);
+
+    Q_FOREACH (LodLevel *level, m_lodPyramid) {
+        Data *lodData = level->data.data();
+        const QRect lodExtent =
+            lodData->dataManager()->extent().translated(lodData->x(), lodData->y());
+
+        if (!lodExtent.isEmpty()) {
+            region += KisLodTransform::upscaledRect(lodExtent, lodData->levelOfDetail());
+        }
+    }
+
+    return region;
 }
 
 KisPaintDevice::LodDataStruct* KisPaintDevice::Private::createLodDataStruct(int newLod)
 {
     Data *srcData = currentNonLodData();
 
-    Data *lodData = new Data(srcData, false);
-    LodDataStruct *lodStruct = new LodDataStructImpl(lodData);
+    QMutexLocker l(&m_lodPyramidLock);
+
+    LodLevel *&level = m_lodPyramid[newLod];
+    if (!level) {
+        level = new LodLevel(srcData);
+    }
+
+    Data *lodData = level->data.data();
 
     int expectedX = KisLodTransform::coordToLodCoord(srcData->x(), newLod);
     int expectedY = KisLodTransform::coordToLodCoord(srcData->y(), newLod);
@@ -620,11 +677,18 @@ KisPaintDevice::LodDataStruct* KisPaintDevice::Private::createLodDataStruct(int
     /**
      * We compare color spaces as pure pointers, because they must be
      * exactly the same, since they come from the common source.
+     *
+     * The versions of the tiles say nothing about the default pixel,
+     * so its change also means the level should be regenerated.
      */
     if (lodData->levelOfDetail() != newLod ||
         lodData->colorSpace() != srcData->colorSpace() ||
         lodData->x() != expectedX ||
-        lodData->y() != expectedY) {
+        lodData->y() != expectedY ||
+        lodData->dataManager()->pixelSize() != srcData->dataManager()->pixelSize() ||
+        memcmp(lodData->dataManager()->defaultPixel(),
+               srcData->dataManager()->defaultPixel(),
+               srcData->dataManager()->pixelSize()) != 0) {
 
 
         lodData->prepareClone(srcData);
@@ -633,10 +697,14 @@ KisPaintDevice::LodDataStruct* KisPaintDevice::Private::createLodDataStruct(int
         lodData->setX(expectedX);
         lodData->setY(expectedY);
 
-        // FIXME: different kind of synchronization
+        level->syncedVersions.clear();
     }
 
-    //QRegion dirtyRegion = syncWholeDevice(srcData);
+    LodDataStructImpl *lodStruct = new LodDataStructImpl(level);
+    lodStruct->dirtyRegion =
+        srcData->dataManager()->changedRegion(level->syncedVersions, &lodStruct->versions)
+            .translated(srcData->x(), srcData->y());
+
     lodData->cache()->invalidate();
 
     return lodStruct;
@@ -647,7 +715,19 @@ void KisPaintDevice::Private::updateLodDataStruct(LodDataStruct *_dst, const QRe
     LodDataStructImpl *dst = dynamic_cast<LodDataStructImpl*>(_dst);
     KIS_SAFE_ASSERT_RECOVER_RETURN(dst);
 
-    Data *lodData = dst->lodData.data();
+    /**
+     * The jobs cover the whole device, but only the tiles changed
+     * since the previous synchronization should be downsampled
+     */
+    const QRegion dirtyRegion = dst->dirtyRegion & originalRect;
+
+    Q_FOREACH (const QRect &rc, dirtyRegion.rects()) {
+        downscaleLodRect(dst->level->data.data(), rc);
+    }
+}
+
+void KisPaintDevice::Private::downscaleLodRect(Data *lodData, const QRect &originalRect)
+{
     Data *srcData = currentNonLodData();
 
     const int lod = lodData->levelOfDetail();
@@ -743,13 +823,19 @@ void KisPaintDevice::Private::uploadLodDataStruct(LodDataStruct *_dst)
     LodDataStructImpl *dst = dynamic_cast<LodDataStructImpl*>(_dst);
     KIS_SAFE_ASSERT_RECOVER_RETURN(dst);
 
+    Data *lodData = dst->level->data.data();
+
     KIS_SAFE_ASSERT_RECOVER_RETURN(
-        dst->lodData->levelOfDetail() == defaultBounds->currentLevelOfDetail());
+        lodData->levelOfDetail() == defaultBounds->currentLevelOfDetail());
 
     ensureLodDataPresent();
 
-    m_lodData->prepareClone(dst->lodData.data());
-    m_lodData->dataManager()->bitBltRough(dst->lodData->dataManager(), dst->lodData->dataManager()->extent());
+    // the tiles are shared with the level, so no pixels are copied here
+    m_lodData->prepareClone(lodData);
+    m_lodData->dataManager()->bitBltRough(lodData->dataManager(), lodData->dataManager()->extent());
+
+    QMutexLocker l(&m_lodPyramidLock);
+    dst->level->syncedVersions = dst->versions;
 }
 
 void KisPaintDevice::Private::transferFromData(Data *data, KisPaintDeviceSP targetDevice)
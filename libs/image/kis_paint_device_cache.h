@@ -21,6 +21,7 @@
 
 #include "kis_lock_free_cache.h"
 #include <QElapsedTimer>
+#include <KoColor.h>
 
 
 class KisPaintDeviceCache
@@ -31,6 +32,7 @@ public:
           m_exactBoundsCache(paintDevice),
           m_nonDefaultPixelAreaCache(paintDevice),
           m_regionCache(paintDevice),
+          m_thumbnailsColorSpace(0),
           m_sequenceNumber(0)
     {
     }
@@ -40,6 +42,7 @@ public:
           m_exactBoundsCache(rhs.m_paintDevice),
           m_nonDefaultPixelAreaCache(rhs.m_paintDevice),
           m_regionCache(rhs.m_paintDevice),
+          m_thumbnailsColorSpace(0),
           m_sequenceNumber(0)
     {
     }
@@ -92,14 +95,41 @@ public:
             return thumbnail;
         }
 
-        if (m_thumbnailsValid) {
-            thumbnail = findThumbnail(w, h, oversample);
-        }
-        else {
-            m_thumbnails.clear();
+        if (!m_thumbnailsValid) {
+            /**
+             * The device might have been marked as changed without
+             * any actual change of the pixels, e.g. when the whole
+             * image is refreshed. Comparing the versions of the tiles
+             * doesn't read any pixels, so it is much cheaper than
+             * regenerating the thumbnails. Unlike a content hash, the
+             * versions never match for different content.
+             */
+            KisDataManager::TileVersions versions;
+            const bool tilesChanged =
+                !m_paintDevice->dataManager()->changedRegion(m_thumbnailsVersions, &versions).isEmpty();
+
+            const QRect bounds = m_paintDevice->extent();
+            const KoColorSpace *colorSpace = m_paintDevice->colorSpace();
+            const KoColor defaultPixel = m_paintDevice->defaultPixel();
+
+            if (tilesChanged ||
+                bounds != m_thumbnailsBounds ||
+                colorSpace != m_thumbnailsColorSpace ||
+                !(defaultPixel == m_thumbnailsDefaultPixel)) {
+
+                m_thumbnails.clear();
+                m_thumbnailsBounds = bounds;
+                m_thumbnailsColorSpace = colorSpace;
+                m_thumbnailsDefaultPixel = defaultPixel;
+            }
+
+            m_thumbnailsVersions.swap(versions);
+
             m_thumbnailsValid = true;
         }
 
+        thumbnail = findThumbnail(w, h, oversample);
+
         if (thumbnail.isNull()) {
             thumbnail = m_paintDevice->createThumbnail(w, h, QRect(), oversample, renderingIntent, conversionFlags);
             cacheThumbnail(w, h, oversample, thumbnail);
@@ -163,6 +193,10 @@ private:
     RegionCache m_regionCache;
 
     bool m_thumbnailsValid;
+    KisDataManager::TileVersions m_thumbnailsVersions;
+    QRect m_thumbnailsBounds;
+    const KoColorSpace *m_thumbnailsColorSpace;
+    KoColor m_thumbnailsDefaultPixel;
     QMap<int, QMap<int, QMap<qreal,QImage> > > m_thumbnails;
     QAtomicInt m_sequenceNumber;
 };
@@ -21,6 +21,7 @@
 
 #include "KoAlwaysInline.h"
 #include "kundo2command.h"
+#include "kis_work_stealing_task_pool.h"
 
 
 struct DirectDataAccessPolicy {
@@ -140,9 +141,6 @@ public:
     }
 
     void convertDataColorSpace(const KoColorSpace *dstColorSpace, KoColorConversionTransformation::Intent renderingIntent, KoColorConversionTransformation::ConversionFlags conversionFlags, KUndo2Command *parentCommand) {
-        typedef KisSequentialIteratorBase<ReadOnlyIteratorPolicy<DirectDataAccessPolicy>, DirectDataAccessPolicy> InternalSequentialConstIterator;
-        typedef KisSequentialIteratorBase<WritableIteratorPolicy<DirectDataAccessPolicy>, DirectDataAccessPolicy> InternalSequentialIterator;
-
         if (m_colorSpace == dstColorSpace || *m_colorSpace == *dstColorSpace) {
             return;
         }
@@ -156,29 +154,25 @@ public:
 
         KisDataManagerSP dstDataManager = new KisDataManager(dstPixelSize, dstDefaultPixel.data());
 
-
-        if (!rc.isEmpty()) {
-            InternalSequentialConstIterator srcIt(DirectDataAccessPolicy(m_dataManager.data(), cacheInvalidator()), rc);
-            InternalSequentialIterator dstIt(DirectDataAccessPolicy(dstDataManager.data(), cacheInvalidator()), rc);
-
-            int nConseqPixels = 0;
-
-            do {
-                nConseqPixels = srcIt.nConseqPixels();
-
-                const quint8 *srcData = srcIt.rawDataConst();
-                quint8 *dstData = dstIt.rawData();
-
-                m_colorSpace->convertPixelsTo(srcData, dstData,
-                                              dstColorSpace,
-                                              nConseqPixels,
-                                              renderingIntent, conversionFlags);
-
-
-            } while(srcIt.nextPixels(nConseqPixels) &&
-                    dstIt.nextPixels(nConseqPixels));
+        /**
+         * The conversion is done tile by tile: a single call to
+         * convertPixelsTo() converts the whole tile, so the cost of
+         * the call into LCMS is paid once per 4096 pixels instead of
+         * once per scanline. The tiles are independent, so we spread
+         * them over all the available cores. Every thread fetches its
+         * own transformation from KoColorConversionCache, so the
+         * LCMS transforms are never shared between the threads.
+         */
+        QVector<KisWorkStealingTaskPool::Task> tasks;
+
+        Q_FOREACH (const QRect &tileRect, KisWorkStealingTaskPool::splitRect(rc, KisTileData::WIDTH)) {
+            tasks.append([=] () {
+                convertTile(tileRect, dstDataManager.data(), dstColorSpace, renderingIntent, conversionFlags);
+            });
         }
 
+        KisWorkStealingTaskPool::runInCurrentOrGlobalPool(tasks);
+
         // becomes owned by the parent
         ChangeColorSpaceCommand *cmd =
             new ChangeColorSpaceCommand(this,
@@ -258,6 +252,43 @@ public:
     }
 
 
+private:
+    /**
+     * Converts the pixels of \p rc into \p dstDataManager. The rect
+     * must not cross the tile boundaries.
+     */
+    void convertTile(const QRect &rc, KisDataManager *dstDataManager,
+                     const KoColorSpace *dstColorSpace,
+                     KoColorConversionTransformation::Intent renderingIntent,
+                     KoColorConversionTransformation::ConversionFlags conversionFlags) {
+
+        KisRandomConstAccessorSP srcIt = new KisRandomAccessor2(m_dataManager.data(), rc.x(), rc.y(), 0, 0, false, cacheInvalidator());
+        KisRandomAccessorSP dstIt = new KisRandomAccessor2(dstDataManager, rc.x(), rc.y(), 0, 0, true, cacheInvalidator());
+
+        const int srcRowStride = srcIt->rowStride(rc.x(), rc.y());
+        const int dstRowStride = dstIt->rowStride(rc.x(), rc.y());
+
+        const quint8 *srcData = srcIt->rawDataConst();
+        quint8 *dstData = dstIt->rawData();
+
+        if (srcRowStride == rc.width() * m_colorSpace->pixelSize() &&
+            dstRowStride == rc.width() * dstColorSpace->pixelSize()) {
+
+            m_colorSpace->convertPixelsTo(srcData, dstData, dstColorSpace,
+                                          rc.width() * rc.height(),
+                                          renderingIntent, conversionFlags);
+        } else {
+            for (int row = 0; row < rc.height(); row++) {
+                m_colorSpace->convertPixelsTo(srcData, dstData, dstColorSpace,
+                                              rc.width(),
+                                              renderingIntent, conversionFlags);
+
+                srcData += srcRowStride;
+                dstData += dstRowStride;
+            }
+        }
+    }
+
 private:
     struct CacheInvalidator : public KisIteratorCompleteListener {
         CacheInvalidator(KisPaintDeviceData *_q) : q(_q) {}
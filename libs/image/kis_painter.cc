@@ -68,6 +68,7 @@
 #include <KoColorSpaceMaths.h>
 #include "kis_lod_transform.h"
 #include "kis_algebra_2d.h"
+#include "kis_dab_blending_pipeline.h"
 
 
 
@@ -122,6 +123,7 @@ struct Q_DECL_HIDDEN KisPainter::Private {
     KoCompositeOp::ParameterInfo paramInfo;
     KoColorConversionTransformation::Intent renderingIntent;
     KoColorConversionTransformation::ConversionFlags conversionFlags;
+    KisDabBlendingPipeline     *dabBlendingPipeline;
 
     bool tryReduceSourceRect(const KisPaintDevice *srcDev,
                              QRect *srcRect,
@@ -180,6 +182,7 @@ void KisPainter::init()
     d->paramInfo = KoCompositeOp::ParameterInfo();
     d->renderingIntent = KoColorConversionTransformation::internalRenderingIntent();
     d->conversionFlags = KoColorConversionTransformation::internalConversionFlags();
+    d->dabBlendingPipeline = 0;
 }
 
 KisPainter::~KisPainter()
@@ -932,7 +935,15 @@ void KisPainter::bltFixed(qint32 dstX, qint32 dstY,
     /* Trying to read outside a KisFixedPaintDevice is inherently wrong and shouldn't be done,
     so crash if someone attempts to do this. Don't resize as it would obfuscate the mistake. */
     Q_ASSERT(srcBounds.contains(srcRect));
-    Q_UNUSED(srcRect); // only used in above assertion
+
+    if (d->dabBlendingPipeline) {
+        KIS_SAFE_ASSERT_RECOVER_NOOP(d->dabBlendingPipeline->device() == d->device);
+
+        d->dabBlendingPipeline->addDab(dstX, dstY, srcDev, srcRect,
+                                       d->compositeOp, d->paramInfo, d->selection,
+                                       d->renderingIntent, d->conversionFlags);
+        return;
+    }
 
     /* Create an intermediate byte array to hold information before it is written
     to the current paint device (aka: d->device) */
@@ -2680,6 +2691,16 @@ KisPaintOp* KisPainter::paintOp() const
     return d->paintOp;
 }
 
+void KisPainter::setDabBlendingPipeline(KisDabBlendingPipeline *pipeline)
+{
+    d->dabBlendingPipeline = pipeline;
+}
+
+KisDabBlendingPipeline* KisPainter::dabBlendingPipeline() const
+{
+    return d->dabBlendingPipeline;
+}
+
 void KisPainter::setMirrorInformation(const QPointF& axesCenter, bool mirrorHorizontally, bool mirrorVertically)
 {
     d->axesCenter = axesCenter;
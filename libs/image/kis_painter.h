@@ -53,6 +53,7 @@ class KoPattern;
 class KisPaintInformation;
 class KisPaintOp;
 class KisDistanceInformation;
+class KisDabBlendingPipeline;
 
 /**
  * KisPainter contains the graphics primitives necessary to draw on a
@@ -617,6 +618,23 @@ public:
      */
     KisPaintOp* paintOp() const;
 
+    /**
+     * Makes bltFixed() pass the dabs to \p pipeline instead of
+     * blending them directly. The dirty rects of such dabs are
+     * reported by the pipeline, not by takeDirtyRegion(). The
+     * painter doesn't take the ownership of the pipeline.
+     *
+     * Pass null to switch back to the direct blending.
+     *
+     * \see KisDabBlendingPipeline
+     */
+    void setDabBlendingPipeline(KisDabBlendingPipeline *pipeline);
+
+    /**
+     * \see setDabBlendingPipeline()
+     */
+    KisDabBlendingPipeline* dabBlendingPipeline() const;
+
     void setMirrorInformation(const QPointF &axesCenter, bool mirrorHorizontally, bool mirrorVertically);
 
     /**
@@ -18,6 +18,9 @@
 
 #include "kis_projection_leaf.h"
 
+#include <QHash>
+#include <QMutex>
+
 #include <KoColorSpace.h>
 
 #include "kis_layer.h"
@@ -37,6 +40,14 @@ struct Q_DECL_HIDDEN KisProjectionLeaf::Private
 
     KisNode* node;
 
+    struct CachedTrip {
+        int graphSequenceNumber;
+        WalkerTrip trip;
+    };
+
+    mutable QMutex tripCacheLock;
+    QHash<int, CachedTrip> tripCache;
+
     static bool checkPassThrough(const KisNode *node) {
         const KisGroupLayer *group = qobject_cast<const KisGroupLayer*>(node);
         return group && group->passThroughMode();
@@ -50,11 +61,11 @@ struct Q_DECL_HIDDEN KisProjectionLeaf::Private
         return checkPassThrough(node);
     }
 
-    void temporarySetPassThrough(bool value) {
+    void temporarySetPassThrough(bool value, bool invalidateGraph) {
         KisGroupLayer *group = qobject_cast<KisGroupLayer*>(node);
         if (!group) return;
 
-        group->setPassThroughMode(value);
+        group->setPassThroughModeImpl(value, invalidateGraph);
     }
 };
 
@@ -267,7 +278,13 @@ void KisProjectionLeaf::explicitlyRegeneratePassThroughProjection()
 {
     if (!m_d->checkThisPassThrough()) return;
 
-    m_d->temporarySetPassThrough(false);
+    /**
+     * The graph is the same after the regeneration, so the sequence
+     * number is bumped only once, when the mode is restored. That
+     * still drops the trips that the concurrent walkers might have
+     * cached while the mode was switched off.
+     */
+    m_d->temporarySetPassThrough(false, false);
 
     const QRect updateRect = projection()->defaultBounds()->bounds();
 
@@ -277,5 +294,29 @@ void KisProjectionLeaf::explicitlyRegeneratePassThroughProjection()
     KisAsyncMerger merger;
     merger.startMerge(walker);
 
-    m_d->temporarySetPassThrough(true);
+    m_d->temporarySetPassThrough(true, true);
+}
+
+bool KisProjectionLeaf::cachedWalkerTrip(int tripType, int graphSequenceNumber, WalkerTrip *trip) const
+{
+    QMutexLocker l(&m_d->tripCacheLock);
+
+    auto it = m_d->tripCache.constFind(tripType);
+    if (it == m_d->tripCache.constEnd() ||
+        it->graphSequenceNumber != graphSequenceNumber) {
+
+        return false;
+    }
+
+    *trip = it->trip;
+    return true;
+}
+
+void KisProjectionLeaf::setCachedWalkerTrip(int tripType, int graphSequenceNumber, const WalkerTrip &trip)
+{
+    QMutexLocker l(&m_d->tripCacheLock);
+
+    Private::CachedTrip &cachedTrip = m_d->tripCache[tripType];
+    cachedTrip.graphSequenceNumber = graphSequenceNumber;
+    cachedTrip.trip = trip;
 }
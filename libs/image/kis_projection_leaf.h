@@ -20,6 +20,7 @@
 #define __KIS_PROJECTION_LEAF_H
 
 #include <QScopedPointer>
+#include <QVector>
 
 #include "kis_types.h"
 #include "kritaimage_export.h"
@@ -71,6 +72,34 @@ public:
      */
     void explicitlyRegeneratePassThroughProjection();
 
+    /**
+     * A step of a rects walker's trip through the graph: the
+     * register-method called (the meaning of \p action is defined by
+     * KisBaseRectsWalker), the position of the leaf and the leaf itself
+     */
+    struct WalkerTripStep {
+        int action;
+        qint32 position;
+        KisProjectionLeafWSP leaf;
+    };
+    typedef QVector<WalkerTripStep> WalkerTrip;
+
+    /**
+     * The sequence of leaves a walker visits depends on the structure
+     * of the graph only, so the walkers starting from this leaf cache
+     * it here. Every kind of the trip is stored under its own \p tripType.
+     * The trip is valid while the graph sequence number of the node is
+     * the same as the one it has been recorded with.
+     *
+     * \return false if there is no valid trip in the cache
+     */
+    bool cachedWalkerTrip(int tripType, int graphSequenceNumber, WalkerTrip *trip) const;
+
+    /**
+     * \see cachedWalkerTrip()
+     */
+    void setCachedWalkerTrip(int tripType, int graphSequenceNumber, const WalkerTrip &trip);
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -20,9 +20,16 @@
 
 #include <QMutexLocker>
 
+#include <algorithm>
+
 #include "kis_image_config.h"
 #include "kis_full_refresh_walker.h"
 #include "kis_spontaneous_job.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "kis_lod_transform.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "kis_update_time_monitor.h"
 
 
 //#define ENABLE_DEBUG_JOIN
@@ -39,6 +46,14 @@
 #endif /* ENABLE_DEBUG_JOIN */
 
 
+namespace {
+
+inline int divideFloor(int value, int step) {
+    return value >= 0 ? value / step : -((-value + step - 1) / step);
+}
+
+}
+
 #ifdef ENABLE_ACCUMULATOR
     #define DECLARE_ACCUMULATOR() static qreal _baseAmount=0, _newAmount=0
     #define ACCUMULATOR_ADD(baseAmount, newAmount) \
@@ -53,7 +68,8 @@
 
 
 KisSimpleUpdateQueue::KisSimpleUpdateQueue()
-    : m_overrideLevelOfDetail(-1)
+    : m_nextSeqNo(0),
+      m_overrideLevelOfDetail(-1)
 {
     updateSettings();
 }
@@ -77,6 +93,16 @@ void KisSimpleUpdateQueue::updateSettings()
     m_maxCollectAlpha = config.maxCollectAlpha();
     m_maxMergeAlpha = config.maxMergeAlpha();
     m_maxMergeCollectAlpha = config.maxMergeCollectAlpha();
+
+    /**
+     * The index depends on the patch size, so rebuild it
+     */
+    QMutexLocker locker(&m_lock);
+
+    m_updatesIndex.clear();
+    Q_FOREACH (KisBaseRectsWalkerSP walker, m_updatesList) {
+        indexWalker(walker);
+    }
 }
 
 int KisSimpleUpdateQueue::overrideLevelOfDetail() const
@@ -94,10 +120,63 @@ void KisSimpleUpdateQueue::processQueue(KisUpdaterContext &updaterContext)
     updaterContext.unlock();
 }
 
+void KisSimpleUpdateQueue::setPriorityRect(const QRect &rc)
+{
+    QMutexLocker locker(&m_lock);
+    m_priorityRect = rc;
+}
+
+QRect KisSimpleUpdateQueue::priorityRect(int levelOfDetail) const
+{
+    return levelOfDetail > 0 ?
+        KisLodTransform::scaledRect(KisLodTransform::alignedRect(m_priorityRect, levelOfDetail), levelOfDetail) :
+        m_priorityRect;
+}
+
 bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
 {
     QMutexLocker locker(&m_lock);
 
+    /**
+     * The walkers touching the visible area go first, the rest
+     * is processed in the order of arrival. The big updates are
+     * already split into patches, so the visible part of a full
+     * refresh is shown to the user before the rest of the image
+     * is ready.
+     */
+    bool jobAdded =
+        (!m_priorityRect.isEmpty() && tryAddMergeJob(updaterContext, true)) ||
+        tryAddMergeJob(updaterContext, false);
+
+    if (jobAdded) return true;
+
+    if (!m_spontaneousJobsList.isEmpty()) {
+        /**
+         * WARNING: Please note that this still doesn't guarantee that
+         * the spontaneous jobs are exclusive, since updates and/or
+         * strokes can be added after them. The only thing it
+         * guarantees that two spontaneous jobs will not be executed
+         * in parallel.
+         *
+         * Right now it works as it is. Probably will need to be fixed
+         * in the future.
+         */
+        qint32 numMergeJobs;
+        qint32 numStrokeJobs;
+        updaterContext.getJobsSnapshot(numMergeJobs, numStrokeJobs);
+
+        if (!numMergeJobs && !numStrokeJobs) {
+            KisSpontaneousJob *job = m_spontaneousJobsList.takeFirst();
+            updaterContext.addSpontaneousJob(job);
+            jobAdded = true;
+        }
+    }
+
+    return jobAdded;
+}
+
+bool KisSimpleUpdateQueue::tryAddMergeJob(KisUpdaterContext &updaterContext, bool priorityOnly)
+{
     KisBaseRectsWalkerSP item;
     KisMutableWalkersListIterator iter(m_updatesList);
     bool jobAdded = false;
@@ -107,6 +186,12 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
     while(iter.hasNext()) {
         item = iter.next();
 
+        if (priorityOnly &&
+            !item->requestedRect().intersects(priorityRect(item->levelOfDetail()))) {
+
+            continue;
+        }
+
         if ((currentLevelOfDetail < 0 || currentLevelOfDetail == item->levelOfDetail()) &&
             !item->checksumValid()) {
 
@@ -119,36 +204,13 @@ bool KisSimpleUpdateQueue::processOneJob(KisUpdaterContext &updaterContext)
             updaterContext.isJobAllowed(item)) {
 
             updaterContext.addMergeJob(item);
+            unindexWalker(item);
             iter.remove();
             jobAdded = true;
             break;
         }
     }
 
-    if (jobAdded) return true;
-
-    if (!m_spontaneousJobsList.isEmpty()) {
-        /**
-         * WARNING: Please note that this still doesn't guarantee that
-         * the spontaneous jobs are exclusive, since updates and/or
-         * strokes can be added after them. The only thing it
-         * guarantees that two spontaneous jobs will not be executed
-         * in parallel.
-         *
-         * Right now it works as it is. Probably will need to be fixed
-         * in the future.
-         */
-        qint32 numMergeJobs;
-        qint32 numStrokeJobs;
-        updaterContext.getJobsSnapshot(numMergeJobs, numStrokeJobs);
-
-        if (!numMergeJobs && !numStrokeJobs) {
-            KisSpontaneousJob *job = m_spontaneousJobsList.takeFirst();
-            updaterContext.addSpontaneousJob(job);
-            jobAdded = true;
-        }
-    }
-
     return jobAdded;
 }
 
@@ -188,13 +250,47 @@ void KisSimpleUpdateQueue::addJob(KisNodeSP node, const QRect& rc,
     }
     /* else if(type == KisBaseRectsWalker::UNSUPPORTED) fatalKrita; */
 
-    walker->collectRects(node, rc);
+    {
+        KisUpdateTraceScope trace("walkers", "Collect rects", rc, node);
+        walker->collectRects(node, rc);
+    }
+
+    prefetchTiles(walker);
 
     m_lock.lock();
     m_updatesList.append(walker);
+    indexWalker(walker);
     m_lock.unlock();
 }
 
+void KisSimpleUpdateQueue::prefetchTiles(KisBaseRectsWalkerSP walker)
+{
+    /**
+     * The walker already knows which areas of which devices will
+     * be read by the merger, so ask the swapped out tiles of these
+     * areas to be loaded in the background while the job is
+     * waiting in the queue. LoD planes are small and are
+     * regenerated on demand, so they are not worth prefetching.
+     */
+    if (walker->levelOfDetail() > 0 ||
+        !KisTileDataStore::instance()->hasSwappedTiles()) {
+
+        return;
+    }
+
+    Q_FOREACH (const KisBaseRectsWalker::JobItem &item, walker->leafStack()) {
+        KisPaintDeviceSP original = item.m_leaf->original();
+        if (original) {
+            original->dataManager()->prefetchTiles(item.m_applyRect);
+        }
+
+        KisPaintDeviceSP projection = item.m_leaf->projection();
+        if (projection && projection != original) {
+            projection->dataManager()->prefetchTiles(item.m_applyRect);
+        }
+    }
+}
+
 void KisSimpleUpdateQueue::addSpontaneousJob(KisSpontaneousJob *spontaneousJob)
 {
     QMutexLocker locker(&m_lock);
@@ -265,24 +361,26 @@ bool KisSimpleUpdateQueue::tryMergeJob(KisNodeSP node, const QRect& rc,
     QRect baseRect = rc;
 
     KisBaseRectsWalkerSP goodCandidate;
-    KisBaseRectsWalkerSP item;
-    KisWalkersListIterator iter(m_updatesList);
 
     /**
      * We add new jobs to the tail of the list,
-     * so it's more probable to find a good candidate here.
+     * so it's more probable to find a good candidate
+     * among the most recent ones.
      */
 
-    iter.toBack();
-
-    while(iter.hasPrevious()) {
-        item = iter.previous();
-
+    Q_FOREACH (KisBaseRectsWalkerSP item, fetchJoinCandidates(rc, true)) {
         if(item->startNode() != node) continue;
         if(item->type() != type) continue;
         if(item->cropRect() != cropRect) continue;
         if(item->levelOfDetail() != levelOfDetail) continue;
 
+        /**
+         * The rect is already pending, nothing to add
+         */
+        if(item->requestedRect().contains(rc)) {
+            return true;
+        }
+
         if(joinRects(baseRect, item->requestedRect(), m_maxMergeAlpha)) {
             goodCandidate = item;
             break;
@@ -311,12 +409,12 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
                                        QRect baseRect,
                                        const qreal maxAlpha)
 {
-    KisBaseRectsWalkerSP item;
-    KisMutableWalkersListIterator iter(m_updatesList);
-
-    while(iter.hasNext()) {
-        item = iter.next();
-
+    /**
+     * The base rect may grow while collecting, but the union never
+     * exceeds one patch, so all the rects that can ever be joined
+     * start in the neighbourhood of the original rect
+     */
+    Q_FOREACH (KisBaseRectsWalkerSP item, fetchJoinCandidates(baseRect, false)) {
         if(item == baseWalker) continue;
         if(item->type() != baseWalker->type()) continue;
         if(item->startNode() != baseWalker->startNode()) continue;
@@ -324,13 +422,106 @@ void KisSimpleUpdateQueue::collectJobs(KisBaseRectsWalkerSP &baseWalker,
         if(item->levelOfDetail() != baseWalker->levelOfDetail()) continue;
 
         if(joinRects(baseRect, item->requestedRect(), maxAlpha)) {
-            iter.remove();
+            removeWalker(item);
         }
     }
 
     if(baseWalker->requestedRect() != baseRect) {
+        const qint64 seqNo = unindexWalker(baseWalker);
         baseWalker->collectRects(baseWalker->startNode(), baseRect);
+        indexWalker(baseWalker, seqNo);
+    }
+}
+
+quint64 KisSimpleUpdateQueue::cellKey(int col, int row) const
+{
+    return (quint64(quint32(row)) << 32) | quint32(col);
+}
+
+void KisSimpleUpdateQueue::indexWalker(KisBaseRectsWalkerSP walker, qint64 seqNo)
+{
+    const QRect rc = walker->requestedRect();
+    if (rc.width() > m_patchWidth || rc.height() > m_patchHeight) return;
+
+    const int col = divideFloor(rc.x(), m_patchWidth);
+    const int row = divideFloor(rc.y(), m_patchHeight);
+
+    IndexEntry entry;
+    entry.walker = walker;
+    entry.seqNo = seqNo >= 0 ? quint64(seqNo) : m_nextSeqNo++;
+
+    m_updatesIndex[cellKey(col, row)].append(entry);
+}
+
+qint64 KisSimpleUpdateQueue::unindexWalker(KisBaseRectsWalkerSP walker)
+{
+    const QRect rc = walker->requestedRect();
+    if (rc.width() > m_patchWidth || rc.height() > m_patchHeight) return -1;
+
+    const int col = divideFloor(rc.x(), m_patchWidth);
+    const int row = divideFloor(rc.y(), m_patchHeight);
+
+    auto cellIt = m_updatesIndex.find(cellKey(col, row));
+    if (cellIt == m_updatesIndex.end()) return -1;
+
+    QVector<IndexEntry> &entries = *cellIt;
+    qint64 seqNo = -1;
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->walker == walker) {
+            seqNo = it->seqNo;
+            entries.erase(it);
+            break;
+        }
+    }
+
+    if (entries.isEmpty()) {
+        m_updatesIndex.erase(cellIt);
     }
+
+    return seqNo;
+}
+
+void KisSimpleUpdateQueue::removeWalker(KisBaseRectsWalkerSP walker)
+{
+    unindexWalker(walker);
+    m_updatesList.removeOne(walker);
+}
+
+QVector<KisBaseRectsWalkerSP>
+KisSimpleUpdateQueue::fetchJoinCandidates(const QRect &rc, bool mostRecentFirst) const
+{
+    QVector<IndexEntry> entries;
+
+    const int col = divideFloor(rc.x(), m_patchWidth);
+    const int row = divideFloor(rc.y(), m_patchHeight);
+
+    for (int i = row - 1; i <= row + 1; i++) {
+        for (int j = col - 1; j <= col + 1; j++) {
+            auto it = m_updatesIndex.constFind(cellKey(j, i));
+            if (it != m_updatesIndex.constEnd()) {
+                entries += *it;
+            }
+        }
+    }
+
+    /**
+     * Keep the order the walkers were added to the queue in,
+     * so the result of joining doesn't depend on the index
+     */
+    std::sort(entries.begin(), entries.end(),
+              [mostRecentFirst] (const IndexEntry &lhs, const IndexEntry &rhs) {
+                  return mostRecentFirst ? lhs.seqNo > rhs.seqNo : lhs.seqNo < rhs.seqNo;
+              });
+
+    QVector<KisBaseRectsWalkerSP> candidates;
+    candidates.reserve(entries.size());
+
+    Q_FOREACH (const IndexEntry &entry, entries) {
+        candidates.append(entry.walker);
+    }
+
+    return candidates;
 }
 
 bool KisSimpleUpdateQueue::joinRects(QRect& baseRect,
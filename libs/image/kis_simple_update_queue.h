@@ -20,6 +20,7 @@
 #define __KIS_SIMPLE_UPDATE_QUEUE_H
 
 #include <QMutex>
+#include <QHash>
 #include "kis_updater_context.h"
 
 typedef QList<KisBaseRectsWalkerSP> KisWalkersList;
@@ -54,24 +55,60 @@ public:
 
     int overrideLevelOfDetail() const;
 
+    /**
+     * Sets the area of the image that is currently visible to the
+     * user (in image coordinates of LoD 0). The walkers touching
+     * this area are dispatched before the other ones. An empty rect
+     * resets the priority and the jobs are processed in the order
+     * of arrival.
+     */
+    void setPriorityRect(const QRect &rc);
+
 protected:
     void addJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
 
     bool processOneJob(KisUpdaterContext &updaterContext);
+    bool tryAddMergeJob(KisUpdaterContext &updaterContext, bool priorityOnly);
+    QRect priorityRect(int levelOfDetail) const;
 
     bool trySplitJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
     bool tryMergeJob(KisNodeSP node, const QRect& rc, const QRect& cropRect, int levelOfDetail, KisBaseRectsWalker::UpdateType type);
 
     void collectJobs(KisBaseRectsWalkerSP &baseWalker, QRect baseRect,
                      const qreal maxAlpha);
+
+    void prefetchTiles(KisBaseRectsWalkerSP walker);
     bool joinRects(QRect& baseRect, const QRect& newRect, qreal maxAlpha);
 
+    void indexWalker(KisBaseRectsWalkerSP walker, qint64 seqNo = -1);
+    qint64 unindexWalker(KisBaseRectsWalkerSP walker);
+    void removeWalker(KisBaseRectsWalkerSP walker);
+    QVector<KisBaseRectsWalkerSP> fetchJoinCandidates(const QRect &rc, bool mostRecentFirst) const;
+    inline quint64 cellKey(int col, int row) const;
+
 protected:
 
     mutable QMutex m_lock;
     KisWalkersList m_updatesList;
     KisSpontaneousJobsList m_spontaneousJobsList;
 
+    struct IndexEntry {
+        KisBaseRectsWalkerSP walker;
+        quint64 seqNo;
+    };
+
+    /**
+     * A spatial index of the pending walkers. Two rects can be
+     * joined only when their union fits into one patch, so every
+     * walker is registered in the patch-sized cell containing the
+     * top-left corner of its requested rect, and the candidates for
+     * a join are looked up in the 3x3 neighbourhood of a cell
+     * instead of scanning the whole list. The walkers that are bigger
+     * than a patch cannot be joined and are not indexed.
+     */
+    QHash<quint64, QVector<IndexEntry>> m_updatesIndex;
+    quint64 m_nextSeqNo;
+
     /**
      * Parameters of optimization
      * (loaded from a configuration file)
@@ -102,6 +139,11 @@ protected:
     qreal m_maxMergeCollectAlpha;
 
     int m_overrideLevelOfDetail;
+
+    /**
+     * \see setPriorityRect()
+     */
+    QRect m_priorityRect;
 };
 
 class KRITAIMAGE_EXPORT KisTestableSimpleUpdateQueue : public KisSimpleUpdateQueue
@@ -26,6 +26,8 @@
 #include "kis_spontaneous_job.h"
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
+#include "kis_work_stealing_task_pool.h"
+#include "kis_update_time_monitor.h"
 
 
 class KisUpdateJobItem :  public QObject, public QRunnable
@@ -40,8 +42,10 @@ public:
     };
 
 public:
-    KisUpdateJobItem(QReadWriteLock *exclusiveJobLock)
+    KisUpdateJobItem(QReadWriteLock *exclusiveJobLock,
+                     KisWorkStealingTaskPool *taskPool)
         : m_exclusiveJobLock(exclusiveJobLock),
+          m_taskPool(taskPool),
           m_type(EMPTY),
           m_runnableJob(0)
     {
@@ -53,6 +57,9 @@ public:
     }
 
     void run() override {
+        m_taskPool->releaseThreadReservation();
+        KisWorkStealingTaskPool::setCurrentPool(m_taskPool);
+
         if(m_exclusive) {
             m_exclusiveJobLock->lockForWrite();
         } else {
@@ -63,6 +70,8 @@ public:
             runMergeJob();
         } else {
             Q_ASSERT(m_type == STROKE || m_type == SPONTANEOUS);
+
+            KisUpdateTraceScope trace("jobs", m_type == STROKE ? "Stroke job" : "Spontaneous job");
             m_runnableJob->run();
             delete m_runnableJob;
             m_runnableJob = 0;
@@ -74,13 +83,19 @@ public:
         emit sigJobFinished();
 
         m_exclusiveJobLock->unlock();
+
+        KisWorkStealingTaskPool::setCurrentPool(0);
     }
 
     inline void runMergeJob() {
         Q_ASSERT(m_type == MERGE);
         // dbgKrita << "Executing merge job" << m_walker->changeRect()
         //          << "on thread" << QThread::currentThreadId();
-        m_merger.startMerge(*m_walker);
+        {
+            KisUpdateTraceScope trace("jobs", "Merge job", m_changeRect,
+                                      m_walker->startNode());
+            m_merger.startMerge(*m_walker);
+        }
 
         QRect changeRect = m_walker->changeRect();
         emit sigContinueUpdate(changeRect);
@@ -175,6 +190,14 @@ private:
      */
     QReadWriteLock *m_exclusiveJobLock;
 
+    /**
+     * The job may split its work into smaller tasks and
+     * share them with the idle threads of the context
+     *
+     * \see KisUpdaterContext::m_taskPool
+     */
+    KisWorkStealingTaskPool *m_taskPool;
+
     bool m_exclusive;
 
     volatile Type m_type;
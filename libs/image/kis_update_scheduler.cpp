@@ -238,6 +238,11 @@ void KisUpdateScheduler::explicitRegenerateLevelOfDetail()
     processQueues();
 }
 
+void KisUpdateScheduler::setUpdatesPriorityRect(const QRect &rc)
+{
+    m_d->updatesQueue.setPriorityRect(rc);
+}
+
 int KisUpdateScheduler::currentLevelOfDetail() const
 {
     int levelOfDetail = -1;
@@ -157,6 +157,14 @@ public:
      */
     void explicitRegenerateLevelOfDetail();
 
+    /**
+     * Sets the area of the image visible to the user. The updates
+     * touching this area are processed before the other ones.
+     *
+     * \see KisSimpleUpdateQueue::setPriorityRect()
+     */
+    void setUpdatesPriorityRect(const QRect &rc);
+
     /**
      * Install a factory of a stroke strategy, that will be started
      * every time when the scheduler needs to synchronize LOD caches
@@ -21,6 +21,7 @@
 #include <QGlobalStatic>
 #include <QHash>
 #include <QSet>
+#include <QStringList>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QPointF>
@@ -30,12 +31,17 @@
 #include <QDir>
 
 #include <QElapsedTimer>
+#include <QThread>
+#include <QCoreApplication>
+#include <QTextStream>
 
 #include <QFileInfo>
 
 #include "kis_debug.h"
 #include "kis_global.h"
 #include "kis_image_config.h"
+#include "kis_node.h"
+#include "kis_projection_leaf.h"
 
 
 #include <brushengine/kis_paintop_preset.h>
@@ -77,6 +83,23 @@ private:
     qint64 m_updateTime;
 };
 
+struct TraceEvent
+{
+    const char *category;
+    const char *name;
+    qint64 startTime;
+    qint64 endTime;
+    int threadId;
+    QRect rect;
+    QString detail;
+};
+
+/**
+ * The events are kept in memory until the trace is written, so
+ * limit their number for the case someone forgets to stop it
+ */
+static const int maxTraceEvents = 1 << 22;
+
 struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
 {
     Private()
@@ -85,9 +108,12 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
           numTickets(0),
           numUpdates(0),
           mousePath(0.0),
-          loggingEnabled(false)
+          loggingEnabled(false),
+          numDroppedTraceEvents(0)
     {
-        loggingEnabled = KisImageConfig().enablePerfLog();
+        KisImageConfig cfg;
+        loggingEnabled = cfg.enablePerfLog();
+        traceFileName = cfg.updateTraceFile();
     }
 
     QHash<void*, StrokeTicket*> preliminaryTickets;
@@ -105,6 +131,18 @@ struct Q_DECL_HIDDEN KisUpdateTimeMonitor::Private
     KisPaintOpPresetSP preset;
 
     bool loggingEnabled;
+
+    QAtomicInt tracingActive;
+    QString traceFileName;
+    QElapsedTimer traceTimer;
+    QMutex traceMutex;
+    QVector<TraceEvent> traceEvents;
+    QHash<QThread*, int> traceThreadIds;
+    QStringList traceThreadNames;
+    int numDroppedTraceEvents;
+
+    int traceThreadId(QThread *thread);
+    void writeTrace(QTextStream &stream);
 };
 
 KisUpdateTimeMonitor::KisUpdateTimeMonitor()
@@ -117,6 +155,10 @@ KisUpdateTimeMonitor::KisUpdateTimeMonitor()
         }
         dir.mkdir("log");
     }
+
+    if (!m_d->traceFileName.isEmpty()) {
+        startTracing();
+    }
 }
 
 KisUpdateTimeMonitor::~KisUpdateTimeMonitor()
@@ -256,3 +298,243 @@ void KisUpdateTimeMonitor::reportUpdateFinished(const QRect &rect)
     }
     m_d->numUpdates++;
 }
+
+void KisUpdateTimeMonitor::startTracing()
+{
+    QMutexLocker locker(&m_d->traceMutex);
+
+    m_d->traceEvents.clear();
+    m_d->traceThreadIds.clear();
+    m_d->traceThreadNames.clear();
+    m_d->numDroppedTraceEvents = 0;
+    m_d->traceTimer.start();
+
+    m_d->tracingActive.storeRelease(1);
+}
+
+bool KisUpdateTimeMonitor::stopTracing(const QString &fileName)
+{
+    QMutexLocker locker(&m_d->traceMutex);
+
+    if (!m_d->tracingActive.loadAcquire()) return false;
+    m_d->tracingActive.storeRelease(0);
+
+    if (m_d->numDroppedTraceEvents) {
+        warnKrita << "KisUpdateTimeMonitor: dropped" << m_d->numDroppedTraceEvents
+                  << "trace events, the trace is too long";
+    }
+
+    bool result = false;
+
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QTextStream stream(&file);
+        stream.setCodec("UTF-8");
+        m_d->writeTrace(stream);
+        stream.flush();
+        result = stream.status() == QTextStream::Ok;
+    } else {
+        warnKrita << "KisUpdateTimeMonitor: failed to open the trace file" << fileName;
+    }
+
+    m_d->traceEvents.clear();
+    m_d->traceEvents.squeeze();
+
+    return result;
+}
+
+bool KisUpdateTimeMonitor::isTracing() const
+{
+    return m_d->tracingActive.loadAcquire();
+}
+
+void KisUpdateTimeMonitor::flushTrace()
+{
+    if (m_d->traceFileName.isEmpty()) return;
+
+    stopTracing(m_d->traceFileName);
+}
+
+qint64 KisUpdateTimeMonitor::traceTimestamp() const
+{
+    return m_d->traceTimer.nsecsElapsed();
+}
+
+void KisUpdateTimeMonitor::reportTraceEvent(const char *category, const char *name,
+                                            qint64 startTime, qint64 endTime,
+                                            const QRect &rect, const QString &detail)
+{
+    if (!isTracing()) return;
+
+    QMutexLocker locker(&m_d->traceMutex);
+
+    // the tracing might have been restarted meanwhile
+    if (!m_d->tracingActive.loadAcquire() || startTime > endTime) return;
+
+    if (m_d->traceEvents.size() >= maxTraceEvents) {
+        m_d->numDroppedTraceEvents++;
+        return;
+    }
+
+    TraceEvent event;
+    event.category = category;
+    event.name = name;
+    event.startTime = startTime;
+    event.endTime = endTime;
+    event.threadId = m_d->traceThreadId(QThread::currentThread());
+    event.rect = rect;
+    event.detail = detail;
+
+    m_d->traceEvents.append(event);
+}
+
+int KisUpdateTimeMonitor::Private::traceThreadId(QThread *thread)
+{
+    auto it = traceThreadIds.constFind(thread);
+    if (it != traceThreadIds.constEnd()) {
+        return *it;
+    }
+
+    const int id = traceThreadNames.size() + 1;
+
+    QString name = thread->objectName();
+    if (name.isEmpty()) {
+        name = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread() ?
+            QString("Main Thread") : QString("Thread %1").arg(id);
+    }
+
+    traceThreadIds.insert(thread, id);
+    traceThreadNames.append(name);
+
+    return id;
+}
+
+namespace {
+
+QString escapedJsonString(const QString &str)
+{
+    QString result;
+    result.reserve(str.size() + 2);
+    result += '"';
+
+    Q_FOREACH (const QChar &c, str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (c.unicode() < 0x20) {
+            result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+        } else {
+            result += c;
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
+}
+
+void KisUpdateTimeMonitor::Private::writeTrace(QTextStream &stream)
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+
+    for (int i = 0; i < traceThreadNames.size(); i++) {
+        if (!first) stream << ",\n";
+        first = false;
+
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+               << ",\"tid\":" << i + 1
+               << ",\"args\":{\"name\":" << escapedJsonString(traceThreadNames[i]) << "}}";
+    }
+
+    Q_FOREACH (const TraceEvent &event, traceEvents) {
+        if (!first) stream << ",\n";
+        first = false;
+
+        // the format measures time in microseconds
+        stream << "{\"name\":\"" << event.name << "\""
+               << ",\"cat\":\"" << event.category << "\""
+               << ",\"ph\":\"X\""
+               << ",\"ts\":" << QString::number(event.startTime / 1000.0, 'f', 3)
+               << ",\"dur\":" << QString::number((event.endTime - event.startTime) / 1000.0, 'f', 3)
+               << ",\"pid\":" << pid
+               << ",\"tid\":" << event.threadId
+               << ",\"args\":{";
+
+        bool firstArg = true;
+
+        if (!event.rect.isNull()) {
+            stream << "\"rect\":[" << event.rect.x() << "," << event.rect.y() << ","
+                   << event.rect.width() << "," << event.rect.height() << "]";
+            firstArg = false;
+        }
+
+        if (!event.detail.isEmpty()) {
+            if (!firstArg) stream << ",";
+            stream << "\"detail\":" << escapedJsonString(event.detail);
+        }
+
+        stream << "}}";
+    }
+
+    stream << "\n]}\n";
+}
+
+KisUpdateTraceScope::KisUpdateTraceScope(const char *category, const char *name,
+                                         const QRect &rect, const QString &detail)
+    : m_category(category),
+      m_name(name),
+      m_startTime(-1)
+{
+    if (start(rect)) {
+        m_detail = detail;
+    }
+}
+
+KisUpdateTraceScope::KisUpdateTraceScope(const char *category, const char *name,
+                                         const QRect &rect, const KisNodeSP &node)
+    : m_category(category),
+      m_name(name),
+      m_startTime(-1)
+{
+    if (start(rect) && node) {
+        m_detail = node->name();
+    }
+}
+
+KisUpdateTraceScope::KisUpdateTraceScope(const char *category, const char *name,
+                                         const QRect &rect, const KisProjectionLeafSP &leaf)
+    : m_category(category),
+      m_name(name),
+      m_startTime(-1)
+{
+    if (start(rect) && leaf) {
+        m_detail = leaf->node()->name();
+    }
+}
+
+bool KisUpdateTraceScope::start(const QRect &rect)
+{
+    KisUpdateTimeMonitor *monitor = KisUpdateTimeMonitor::instance();
+    if (!monitor || !monitor->isTracing()) return false;
+
+    m_rect = rect;
+    m_startTime = monitor->traceTimestamp();
+    return true;
+}
+
+KisUpdateTraceScope::~KisUpdateTraceScope()
+{
+    if (m_startTime < 0) return;
+
+    KisUpdateTimeMonitor *monitor = KisUpdateTimeMonitor::instance();
+    if (!monitor) return;
+
+    monitor->reportTraceEvent(m_category, m_name,
+                              m_startTime, monitor->traceTimestamp(),
+                              m_rect, m_detail);
+}
@@ -24,8 +24,9 @@
 
 
 #include <QVector>
+#include <QRect>
+#include <QString>
 class QPointF;
-class QRect;
 
 
 class KRITAIMAGE_EXPORT KisUpdateTimeMonitor
@@ -46,10 +47,76 @@ public:
     void reportJobFinished(void *key, const QVector<QRect> &rects);
     void reportUpdateFinished(const QRect &rect);
 
+    /**
+     * Tracing of the update pipeline
+     *
+     * While the tracing is active, every KisUpdateTraceScope records
+     * an event with its start time, duration, thread and the rect it
+     * processed. stopTracing() writes the collected events into a
+     * JSON file in the Trace Event Format, which can be opened in
+     * any trace viewer understanding it (e.g. chrome://tracing).
+     *
+     * If "updateTraceFile" is set in the config, the tracing is
+     * started on the first access to the monitor and the trace is
+     * written into that file by flushTrace().
+     */
+    void startTracing();
+    bool stopTracing(const QString &fileName);
+    bool isTracing() const;
+
+    /**
+     * Stops the tracing started by the "updateTraceFile" config option
+     * and writes the trace into that file. The application calls it on
+     * exit, while everything the writing depends on is still alive.
+     */
+    void flushTrace();
+
+    /**
+     * The timestamp (in nanoseconds) the trace events are measured in
+     */
+    qint64 traceTimestamp() const;
+
+    void reportTraceEvent(const char *category, const char *name,
+                          qint64 startTime, qint64 endTime,
+                          const QRect &rect, const QString &detail);
+
 
 private:
     struct Private;
     Private * const m_d;
 };
 
+/**
+ * Records the lifetime of the scope as a trace event of
+ * KisUpdateTimeMonitor. Does nothing when the tracing is not active.
+ *
+ * \p category and \p name must be string literals, the rect and the
+ * detail string are shown in the arguments of the event. When a node
+ * or a leaf is passed instead of the detail, its name is shown, but it
+ * is fetched only while the tracing is active.
+ */
+class KRITAIMAGE_EXPORT KisUpdateTraceScope
+{
+public:
+    KisUpdateTraceScope(const char *category, const char *name,
+                        const QRect &rect = QRect(),
+                        const QString &detail = QString());
+    KisUpdateTraceScope(const char *category, const char *name,
+                        const QRect &rect, const KisNodeSP &node);
+    KisUpdateTraceScope(const char *category, const char *name,
+                        const QRect &rect, const KisProjectionLeafSP &leaf);
+    ~KisUpdateTraceScope();
+
+private:
+    Q_DISABLE_COPY(KisUpdateTraceScope)
+
+    bool start(const QRect &rect);
+
+    const char *m_category;
+    const char *m_name;
+    QRect m_rect;
+    QString m_detail;
+    qint64 m_startTime;
+};
+
 #endif /* __KIS_UPDATE_TIME_MONITOR_H */
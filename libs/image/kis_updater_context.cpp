@@ -27,16 +27,23 @@
 const int KisUpdaterContext::useIdealThreadCountTag = -1;
 
 KisUpdaterContext::KisUpdaterContext(qint32 threadCount, QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_taskPool(&m_threadPool)
 {
     if(threadCount <= 0) {
         threadCount = QThread::idealThreadCount();
         threadCount = threadCount > 0 ? threadCount : 1;
     }
 
+    /**
+     * The helpers of the task pool may occupy only the threads
+     * that are not used by the jobs
+     */
+    m_threadPool.setMaxThreadCount(threadCount);
+
     m_jobs.resize(threadCount);
     for(qint32 i = 0; i < m_jobs.size(); i++) {
-        m_jobs[i] = new KisUpdateJobItem(&m_exclusiveJobLock);
+        m_jobs[i] = new KisUpdateJobItem(&m_exclusiveJobLock, &m_taskPool);
         connect(m_jobs[i], SIGNAL(sigContinueUpdate(const QRect&)),
                 SIGNAL(sigContinueUpdate(const QRect&)),
                 Qt::DirectConnection);
@@ -123,6 +130,7 @@ void KisUpdaterContext::addMergeJob(KisBaseRectsWalkerSP walker)
     Q_ASSERT(jobIndex >= 0);
 
     m_jobs[jobIndex]->setWalker(walker);
+    m_taskPool.reserveThread();
     m_threadPool.start(m_jobs[jobIndex]);
 }
 
@@ -146,6 +154,7 @@ void KisUpdaterContext::addStrokeJob(KisStrokeJob *strokeJob)
     Q_ASSERT(jobIndex >= 0);
 
     m_jobs[jobIndex]->setStrokeJob(strokeJob);
+    m_taskPool.reserveThread();
     m_threadPool.start(m_jobs[jobIndex]);
 }
 
@@ -169,6 +178,7 @@ void KisUpdaterContext::addSpontaneousJob(KisSpontaneousJob *spontaneousJob)
     Q_ASSERT(jobIndex >= 0);
 
     m_jobs[jobIndex]->setSpontaneousJob(spontaneousJob);
+    m_taskPool.reserveThread();
     m_threadPool.start(m_jobs[jobIndex]);
 }
 
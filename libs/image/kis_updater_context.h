@@ -27,6 +27,7 @@
 #include "kis_base_rects_walker.h"
 #include "kis_async_merger.h"
 #include "kis_lock_free_lod_counter.h"
+#include "kis_work_stealing_task_pool.h"
 
 
 class KisUpdateJobItem;
@@ -144,6 +145,13 @@ protected:
     QMutex m_lock;
     QVector<KisUpdateJobItem*> m_jobs;
     QThreadPool m_threadPool;
+
+    /**
+     * Lets the running jobs split their work into smaller tasks,
+     * which are stolen by the threads not occupied by any job
+     */
+    KisWorkStealingTaskPool m_taskPool;
+
     KisLockFreeLodCounter m_lodCounter;
 };
 
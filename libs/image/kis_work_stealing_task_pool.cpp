@@ -0,0 +1,389 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_work_stealing_task_pool.h"
+
+#include <deque>
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+
+typedef KisWorkStealingTaskPool::Task Task;
+
+namespace {
+
+/**
+ * The chunks are aligned to blocks of 4x4 tiles. It is big enough to
+ * amortize the cost of stealing and small enough to balance the load
+ * between the threads.
+ */
+const int CHUNK_SIZE = 256;
+
+struct TaskBatch
+{
+    TaskBatch(const QVector<Task> &_tasks)
+        : tasks(_tasks.begin(), _tasks.end()),
+          numUnfinished(_tasks.size())
+    {
+    }
+
+    bool popBack(Task *task, int *numLeft) {
+        QMutexLocker l(&mutex);
+        if (tasks.empty()) return false;
+
+        *task = std::move(tasks.back());
+        tasks.pop_back();
+        *numLeft = int(tasks.size());
+        return true;
+    }
+
+    bool popFront(Task *task) {
+        QMutexLocker l(&mutex);
+        if (tasks.empty()) return false;
+
+        *task = std::move(tasks.front());
+        tasks.pop_front();
+        return true;
+    }
+
+    void finishTask() {
+        QMutexLocker l(&mutex);
+        if (!--numUnfinished) {
+            finished.wakeAll();
+        }
+    }
+
+    void waitForDone() {
+        QMutexLocker l(&mutex);
+        while (numUnfinished) {
+            finished.wait(&mutex);
+        }
+    }
+
+    QMutex mutex;
+    QWaitCondition finished;
+    std::deque<Task> tasks;
+    int numUnfinished;
+};
+
+struct CurrentPoolHolder
+{
+    CurrentPoolHolder() : pool(0) {}
+    KisWorkStealingTaskPool *pool;
+};
+
+inline int alignDown(int value, int step) {
+    return value >= 0 ? value - value % step : -((-value + step - 1) / step) * step;
+}
+
+}
+
+Q_GLOBAL_STATIC(QThreadStorage<CurrentPoolHolder>, s_currentPool)
+Q_GLOBAL_STATIC_WITH_ARGS(KisWorkStealingTaskPool, s_globalPool, (QThreadPool::globalInstance()))
+
+struct KisWorkStealingTaskPool::Private
+{
+    Private(KisWorkStealingTaskPool *_q, QThreadPool *_threadPool)
+        : q(_q),
+          threadPool(_threadPool),
+          stealIndex(0)
+    {
+    }
+
+    KisWorkStealingTaskPool *q;
+    QThreadPool *threadPool;
+
+    /**
+     * Protects the list of batches. Every thief takes this lock
+     * before stealing, so the owner of a batch may be sure nobody
+     * touches its queue after removing it from the list.
+     */
+    QMutex batchesLock;
+    QList<TaskBatch*> batches;
+    int stealIndex;
+
+    QAtomicInt numHelpers;
+    QAtomicInt numReservations;
+    QAtomicInt numStolenTasks;
+
+    class StealingHelper;
+    class TaskRunner;
+
+    bool stealTask(Task *task, TaskBatch **batch);
+    void spawnHelpers(int numPendingTasks);
+};
+
+class KisWorkStealingTaskPool::Private::StealingHelper : public QRunnable
+{
+public:
+    StealingHelper(KisWorkStealingTaskPool::Private *d)
+        : m_d(d)
+    {
+    }
+
+    void run() override {
+        KisWorkStealingTaskPool::setCurrentPool(m_d->q);
+
+        Task task;
+        TaskBatch *batch = 0;
+
+        while (!m_d->numReservations.load() &&
+               m_d->stealTask(&task, &batch)) {
+
+            task();
+            task = Task();
+
+            m_d->numStolenTasks.ref();
+            batch->finishTask();
+        }
+
+        KisWorkStealingTaskPool::setCurrentPool(0);
+        m_d->numHelpers.deref();
+    }
+
+private:
+    KisWorkStealingTaskPool::Private *m_d;
+};
+
+class KisWorkStealingTaskPool::Private::TaskRunner : public QRunnable
+{
+public:
+    TaskRunner(KisWorkStealingTaskPool::Private *d, const Task &task)
+        : m_d(d),
+          m_task(task)
+    {
+    }
+
+    void run() override {
+        KisWorkStealingTaskPool::setCurrentPool(m_d->q);
+
+        m_task();
+        m_task = Task();
+
+        KisWorkStealingTaskPool::setCurrentPool(0);
+        m_d->numHelpers.deref();
+    }
+
+private:
+    KisWorkStealingTaskPool::Private *m_d;
+    Task m_task;
+};
+
+bool KisWorkStealingTaskPool::Private::stealTask(Task *task, TaskBatch **batch)
+{
+    QMutexLocker l(&batchesLock);
+
+    const int numBatches = batches.size();
+
+    for (int i = 0; i < numBatches; i++) {
+        const int index = (stealIndex + i) % numBatches;
+        TaskBatch *candidate = batches[index];
+
+        if (candidate->popFront(task)) {
+            *batch = candidate;
+            stealIndex = index + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void KisWorkStealingTaskPool::Private::spawnHelpers(int numPendingTasks)
+{
+    while (!numReservations.load() &&
+           numHelpers.load() < numPendingTasks) {
+
+        numHelpers.ref();
+
+        StealingHelper *helper = new StealingHelper(this);
+        if (!threadPool->tryStart(helper)) {
+            delete helper;
+            numHelpers.deref();
+            break;
+        }
+    }
+}
+
+KisWorkStealingTaskPool::KisWorkStealingTaskPool(QThreadPool *threadPool)
+    : m_d(new Private(this, threadPool))
+{
+}
+
+KisWorkStealingTaskPool::~KisWorkStealingTaskPool()
+{
+    /**
+     * The owner of the thread pool should wait for all the
+     * runnables to finish before destroying the pool
+     */
+    KIS_SAFE_ASSERT_RECOVER_NOOP(!m_d->numHelpers.load());
+}
+
+void KisWorkStealingTaskPool::runTasks(const QVector<Task> &tasks)
+{
+    if (tasks.isEmpty()) return;
+
+    if (tasks.size() == 1) {
+        tasks.first()();
+        return;
+    }
+
+    TaskBatch batch(tasks);
+
+    {
+        QMutexLocker l(&m_d->batchesLock);
+        m_d->batches.append(&batch);
+    }
+
+    Task task;
+    int numLeft = 0;
+
+    while (batch.popBack(&task, &numLeft)) {
+        m_d->spawnHelpers(numLeft);
+
+        task();
+        task = Task();
+
+        batch.finishTask();
+    }
+
+    {
+        QMutexLocker l(&m_d->batchesLock);
+        m_d->batches.removeOne(&batch);
+    }
+
+    // wait for the tasks that have been stolen by the helpers
+    batch.waitForDone();
+}
+
+bool KisWorkStealingTaskPool::tryStartTask(const Task &task)
+{
+    if (m_d->numReservations.load()) return false;
+
+    m_d->numHelpers.ref();
+
+    Private::TaskRunner *runner = new Private::TaskRunner(m_d.data(), task);
+    if (!m_d->threadPool->tryStart(runner)) {
+        delete runner;
+        m_d->numHelpers.deref();
+        return false;
+    }
+
+    return true;
+}
+
+void KisWorkStealingTaskPool::runTiled(const QRect &rc, const RectTask &func)
+{
+    QVector<Task> tasks;
+
+    Q_FOREACH (const QRect &chunk, splitRect(rc, CHUNK_SIZE)) {
+        tasks.append([&func, chunk] () { func(chunk); });
+    }
+
+    runTasks(tasks);
+}
+
+void KisWorkStealingTaskPool::runInCurrentPool(const QVector<Task> &tasks)
+{
+    KisWorkStealingTaskPool *pool = currentPool();
+
+    if (pool) {
+        pool->runTasks(tasks);
+    } else {
+        Q_FOREACH (const Task &task, tasks) {
+            task();
+        }
+    }
+}
+
+void KisWorkStealingTaskPool::runInCurrentOrGlobalPool(const QVector<Task> &tasks)
+{
+    KisWorkStealingTaskPool *pool = currentPool();
+
+    /**
+     * The global pool cannot be a temporary object: its helpers
+     * may still be finishing their stealing loop after runTasks()
+     * has returned.
+     */
+    if (!pool) {
+        pool = s_globalPool;
+    }
+
+    pool->runTasks(tasks);
+}
+
+void KisWorkStealingTaskPool::runTiledInCurrentPool(const QRect &rc, const RectTask &func)
+{
+    KisWorkStealingTaskPool *pool = currentPool();
+
+    if (pool) {
+        pool->runTiled(rc, func);
+    } else if (!rc.isEmpty()) {
+        func(rc);
+    }
+}
+
+KisWorkStealingTaskPool* KisWorkStealingTaskPool::currentPool()
+{
+    return s_currentPool->localData().pool;
+}
+
+void KisWorkStealingTaskPool::setCurrentPool(KisWorkStealingTaskPool *pool)
+{
+    s_currentPool->localData().pool = pool;
+}
+
+QVector<QRect> KisWorkStealingTaskPool::splitRect(const QRect &rc, int chunkSize)
+{
+    QVector<QRect> chunks;
+    if (rc.isEmpty()) return chunks;
+
+    for (int y = alignDown(rc.top(), chunkSize); y <= rc.bottom(); y += chunkSize) {
+        for (int x = alignDown(rc.left(), chunkSize); x <= rc.right(); x += chunkSize) {
+            chunks.append(QRect(x, y, chunkSize, chunkSize) & rc);
+        }
+    }
+
+    return chunks;
+}
+
+void KisWorkStealingTaskPool::reserveThread()
+{
+    m_d->numReservations.ref();
+}
+
+void KisWorkStealingTaskPool::releaseThreadReservation()
+{
+    m_d->numReservations.deref();
+}
+
+bool KisWorkStealingTaskPool::hasThreadReservations() const
+{
+    return m_d->numReservations.load();
+}
+
+int KisWorkStealingTaskPool::numStolenTasks() const
+{
+    return m_d->numStolenTasks.load();
+}
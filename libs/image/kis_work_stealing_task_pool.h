@@ -0,0 +1,153 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_WORK_STEALING_TASK_POOL_H
+#define __KIS_WORK_STEALING_TASK_POOL_H
+
+#include <functional>
+
+#include <QRect>
+#include <QScopedPointer>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+class QThreadPool;
+
+
+/**
+ * A small work-stealing executor living under KisUpdaterContext.
+ *
+ * The context hands the jobs to its threads one at a time, so a huge
+ * merge or stroke job would normally occupy a single core, while the
+ * other threads of the context are idle. The pool lets such a job split
+ * its work into small (usually tile-aligned) tasks. The tasks are put
+ * into a per-job queue: the owner thread executes them from the back of
+ * the queue, and the idle threads of the context steal them from the
+ * front. runTasks() returns only when all the tasks of the batch are
+ * finished, so from the point of view of the scheduler the job is still
+ * a single unit of work: exclusive, sequential and barrier jobs keep
+ * their semantics.
+ *
+ * The helpers never occupy a thread that is needed by the context:
+ * they are started with QThreadPool::tryStart() only, and stop stealing
+ * as soon as the context asks for a thread with reserveThread().
+ */
+class KRITAIMAGE_EXPORT KisWorkStealingTaskPool
+{
+public:
+    typedef std::function<void()> Task;
+    typedef std::function<void(const QRect&)> RectTask;
+
+public:
+    KisWorkStealingTaskPool(QThreadPool *threadPool);
+    ~KisWorkStealingTaskPool();
+
+    /**
+     * Runs all the \p tasks and blocks until they are finished. The
+     * calling thread takes part in the execution.
+     */
+    void runTasks(const QVector<Task> &tasks);
+
+    /**
+     * Splits \p rc into tile-aligned chunks and calls \p func for
+     * every chunk. The chunks may be processed concurrently, so
+     * \p func must only touch the pixels inside the passed rect.
+     */
+    void runTiled(const QRect &rc, const RectTask &func);
+
+    /**
+     * Starts \p task asynchronously on a free thread of the context
+     * and returns true. The task runs under the same rules as the
+     * stealing helpers: if there is no free thread or the context has
+     * reserved one, the task is not started and false is returned.
+     * The task may use runInCurrentPool() itself.
+     */
+    bool tryStartTask(const Task &task);
+
+    /**
+     * The same as runTasks(), but uses the pool of the update job
+     * executed by the current thread. When called outside the
+     * updater context, the tasks are executed sequentially.
+     */
+    static void runInCurrentPool(const QVector<Task> &tasks);
+
+    /**
+     * \see runTiled()
+     * \see runInCurrentPool()
+     */
+    static void runTiledInCurrentPool(const QRect &rc, const RectTask &func);
+
+    /**
+     * The same as runInCurrentPool(), but when called outside the
+     * updater context, the tasks are spread over the threads of
+     * QThreadPool::globalInstance(). Used by the heavy operations
+     * that are not executed as update jobs, e.g. the conversion
+     * of the color space of a paint device.
+     */
+    static void runInCurrentOrGlobalPool(const QVector<Task> &tasks);
+
+    /**
+     * Returns the pool of the update job executed by the current
+     * thread or null if the thread doesn't belong to any context.
+     */
+    static KisWorkStealingTaskPool* currentPool();
+
+    /**
+     * Attaches the current thread to \p pool. Used by the update job
+     * items when they start executing a job.
+     */
+    static void setCurrentPool(KisWorkStealingTaskPool *pool);
+
+    /**
+     * Splits \p rc into tile-aligned chunks of at most \p chunkSize
+     * pixels in each dimension
+     */
+    static QVector<QRect> splitRect(const QRect &rc, int chunkSize);
+
+    /**
+     * Called by the context right before it puts a new job into the
+     * thread pool. Until the reservation is released, the helpers
+     * stop stealing new tasks and give their threads back.
+     */
+    void reserveThread();
+
+    /**
+     * Called by the job item when the job has got its thread
+     *
+     * \see reserveThread()
+     */
+    void releaseThreadReservation();
+
+    /**
+     * Returns true if the context is waiting for a thread for one
+     * of its jobs. The long-running tasks should give their threads
+     * back as soon as possible when it happens.
+     */
+    bool hasThreadReservations() const;
+
+    /**
+     * The number of tasks executed by the helper threads. Used
+     * for the testing purposes only.
+     */
+    int numStolenTasks() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_WORK_STEALING_TASK_POOL_H */
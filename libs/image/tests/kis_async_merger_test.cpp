@@ -21,8 +21,10 @@
 #include "kis_merge_walker.h"
 #include "kis_full_refresh_walker.h"
 #include "kis_async_merger.h"
+#include "kis_work_stealing_task_pool.h"
 
 #include <QTest>
+#include <QThreadPool>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
 #include "kis_image.h"
@@ -123,6 +125,60 @@ void KisAsyncMergerTest::testMerger()
 }
 
 
+void KisAsyncMergerTest::testParallelMerge()
+{
+    const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 640, 441, colorSpace, "merger test");
+
+    QImage sourceImage1(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    QImage sourceImage2(QString(FILES_DATA_DIR) + QDir::separator() + "inverted_hakonepa.png");
+    QImage referenceProjection(QString(FILES_DATA_DIR) + QDir::separator() + "merged_hakonepa.png");
+
+    KisPaintDeviceSP device1 = new KisPaintDevice(colorSpace);
+    KisPaintDeviceSP device2 = new KisPaintDevice(colorSpace);
+    device1->convertFromQImage(sourceImage1, 0, 0, 0);
+    device2->convertFromQImage(sourceImage2, 0, 0, 0);
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value("blur");
+    Q_ASSERT(filter);
+    KisFilterConfigurationSP configuration = filter->defaultConfiguration(0);
+    Q_ASSERT(configuration);
+
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8, device1);
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", OPACITY_OPAQUE_U8, device2);
+    KisLayerSP groupLayer = new KisGroupLayer(image, "group", 200/*OPACITY_OPAQUE*/);
+    KisLayerSP blur1 = new KisAdjustmentLayer(image, "blur1", configuration, 0);
+
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(groupLayer, image->rootLayer());
+
+    image->addNode(paintLayer2, groupLayer);
+    image->addNode(blur1, groupLayer);
+
+    /**
+     * Pretend we are an update job: the merger will share
+     * the chunks of every leaf with the threads of the pool
+     */
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    KisWorkStealingTaskPool taskPool(&threadPool);
+    KisWorkStealingTaskPool::setCurrentPool(&taskPool);
+
+    KisFullRefreshWalker walker(image->bounds());
+    KisAsyncMerger merger;
+
+    walker.collectRects(image->rootLayer(), image->bounds());
+    merger.startMerge(walker);
+
+    KisWorkStealingTaskPool::setCurrentPool(0);
+    threadPool.waitForDone();
+
+    QImage resultProjection = image->rootLayer()->projection()->convertToQImage(0);
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt, resultProjection, referenceProjection, 5, 0, 0));
+}
+
+
 /**
  * This in not fully automated test for child obliging in KisAsyncMerger.
  * It just checks whether devices are shared. To check if the merger
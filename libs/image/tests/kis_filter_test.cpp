@@ -24,11 +24,14 @@
 #include "kis_selection.h"
 #include "kis_processing_information.h"
 #include "filter/kis_filter.h"
+#include "filter/kis_filter_update_cache.h"
 #include "testutil.h"
 #include "kis_pixel_selection.h"
+#include "kis_painter.h"
 
 #include <KoProgressUpdater.h>
 #include <KoUpdater.h>
+#include <KoColor.h>
 
 class TestFilter : public KisFilter
 {
@@ -50,6 +53,35 @@ public:
 
 };
 
+/**
+ * Copies the source and counts the pixels it has been asked to process
+ */
+class CountingFilter : public KisFilter
+{
+public:
+
+    CountingFilter()
+            : KisFilter(KoID("counting", "counting"), KoID("test", "test"), "CountingFilter") {
+    }
+
+    void processImpl(KisPaintDeviceSP src,
+                     const QRect& size,
+                     const KisFilterConfigurationSP config,
+                     KoUpdater* progressUpdater) const override {
+        Q_UNUSED(src);
+        Q_UNUSED(config);
+        Q_UNUSED(progressUpdater);
+        processedPixels.fetchAndAddOrdered(size.width() * size.height());
+    }
+
+    int takeProcessedPixels() const {
+        return processedPixels.fetchAndStoreOrdered(0);
+    }
+
+private:
+    mutable QAtomicInt processedPixels;
+};
+
 void KisFilterTest::testCreation()
 {
     TestFilter test;
@@ -236,5 +268,119 @@ void KisFilterTest::testBlurFilterApplicationRect()
     QVERIFY(TestUtil::compareQImages(pt, refImage, dst2Image));
 }
 
+void KisFilterTest::testFilterUpdateCache()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    const QRect imageRect(QPoint(0,0), qimage.size());
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->convertFromQImage(qimage, 0, 0, 0);
+
+    Q_FOREACH (const QString &filterId, QStringList() << "gaussian blur" << "invert") {
+        KisFilterSP f = KisFilterRegistry::instance()->value(filterId);
+        QVERIFY(f);
+        KisFilterConfigurationSP kfc = f->defaultConfiguration();
+        QVERIFY(kfc);
+
+        KisFilterUpdateCache cache;
+        KisPaintDeviceSP dst = new KisPaintDevice(cs);
+        cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+
+        // a small change of the source and a rewrite with the same pixels
+        src->fill(QRect(50, 50, 10, 10), KoColor(Qt::red, cs));
+        const QRect rewriteRect(192, 192, 64, 64);
+        KisPaintDeviceSP copy = new KisPaintDevice(cs);
+        KisPainter::copyAreaOptimized(rewriteRect.topLeft(), src, copy, rewriteRect);
+        KisPainter::copyAreaOptimized(rewriteRect.topLeft(), copy, src, rewriteRect);
+
+        cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+
+        KisPaintDeviceSP reference = new KisPaintDevice(cs);
+        f->process(src, reference, 0, imageRect, kfc);
+
+        QPoint pt;
+        QVERIFY(TestUtil::compareQImages(pt,
+                                         reference->convertToQImage(0, imageRect),
+                                         dst->convertToQImage(0, imageRect), 1));
+
+        // someone else has written into the destination
+        dst->fill(QRect(100, 100, 10, 10), KoColor(Qt::green, cs));
+        cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+
+        QVERIFY(TestUtil::compareQImages(pt,
+                                         reference->convertToQImage(0, imageRect),
+                                         dst->convertToQImage(0, imageRect), 1));
+    }
+}
+
+void KisFilterTest::testFilterUpdateCacheSkipsWork()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QRect imageRect(0, 0, 256, 256);
+    const int tileArea = 64 * 64;
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->fill(imageRect, KoColor(Qt::blue, cs));
+
+    CountingFilter *counting = new CountingFilter();
+    KisFilterSP f = counting;
+    KisFilterConfigurationSP kfc = f->defaultConfiguration();
+
+    KisFilterUpdateCache cache;
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), imageRect.width() * imageRect.height());
+
+    // nothing has changed
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), 0);
+
+    // the same pixels written again
+    const QRect rewriteRect(128, 128, 64, 64);
+    KisPaintDeviceSP copy = new KisPaintDevice(cs);
+    KisPainter::copyAreaOptimized(rewriteRect.topLeft(), src, copy, rewriteRect);
+    KisPainter::copyAreaOptimized(rewriteRect.topLeft(), copy, src, rewriteRect);
+
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), 0);
+
+    // a change inside a single tile of the source
+    src->fill(QRect(70, 10, 10, 10), KoColor(Qt::red, cs));
+
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), tileArea);
+
+    // someone else has written into a single tile of the destination
+    dst->fill(QRect(10, 70, 10, 10), KoColor(Qt::green, cs));
+
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), tileArea);
+
+    // an update of a part of the image checks that part only
+    src->fill(QRect(200, 200, 10, 10), KoColor(Qt::red, cs));
+
+    cache.process(f, kfc, src, dst, QRect(0, 0, 128, 128), QRect(0, 0, 128, 128), true);
+    QCOMPARE(counting->takeProcessedPixels(), 0);
+
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), tileArea);
+
+    // without output reuse the whole update rect is recalculated
+    cache.process(f, kfc, src, dst, imageRect, imageRect, false);
+    QCOMPARE(counting->takeProcessedPixels(), imageRect.width() * imageRect.height());
+
+    // and a new configuration resets the cache
+    cache.process(f, kfc, src, dst, imageRect, imageRect, true);
+    counting->takeProcessedPixels();
+
+    KisFilterConfigurationSP kfc2 = f->defaultConfiguration();
+    kfc2->setProperty("testProperty", 1);
+
+    cache.process(f, kfc2, src, dst, imageRect, imageRect, true);
+    QCOMPARE(counting->takeProcessedPixels(), imageRect.width() * imageRect.height());
+}
 
 QTEST_MAIN(KisFilterTest)
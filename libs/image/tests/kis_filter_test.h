@@ -32,6 +32,8 @@ private Q_SLOTS:
     void testDifferentSrcAndDst();
     void testOldDataApiAfterCopy();
     void testBlurFilterApplicationRect();
+    void testFilterUpdateCache();
+    void testFilterUpdateCacheSkipsWork();
 };
 
 #endif
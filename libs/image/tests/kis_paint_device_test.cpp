@@ -1519,6 +1519,65 @@ void KisPaintDeviceTest::testLodDevice()
                                   "lod", "lod1-offset-6-14"));
 }
 
+void KisPaintDeviceTest::testLodPyramidIncrementalSync()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    TestingLodDefaultBounds *bounds = new TestingLodDefaultBounds(QRect(0,0,300,300));
+    dev->setDefaultBounds(bounds);
+
+    fillGradientDevice(dev, QRect(10,10,250,250));
+
+    bounds->testingSetLevelOfDetail(1);
+    syncLodCache(dev, 1);
+    QCOMPARE(dev->exactBounds(), QRect(5,5,125,125));
+
+    /**
+     * Change a small area, erase another one and sync the level
+     * again. Only the changed tiles are downsampled now, so the
+     * result must still be equal to a full regeneration of the level.
+     */
+    bounds->testingSetLevelOfDetail(0);
+    dev->fill(QRect(100,100,20,20), KoColor(Qt::blue, cs));
+    dev->clear(QRect(192,192,68,68));
+
+    bounds->testingSetLevelOfDetail(1);
+    syncLodCache(dev, 1);
+
+    KisPaintDeviceSP ref = new KisPaintDevice(cs);
+    TestingLodDefaultBounds *refBounds = new TestingLodDefaultBounds(QRect(0,0,300,300));
+    ref->setDefaultBounds(refBounds);
+
+    fillGradientDevice(ref, QRect(10,10,250,250));
+    ref->fill(QRect(100,100,20,20), KoColor(Qt::blue, cs));
+    ref->clear(QRect(192,192,68,68));
+
+    refBounds->testingSetLevelOfDetail(1);
+    syncLodCache(ref, 1);
+
+    QCOMPARE(dev->exactBounds(), ref->exactBounds());
+    QCOMPARE(dev->convertToQImage(0,0,0,150,150),
+             ref->convertToQImage(0,0,0,150,150));
+
+    /**
+     * Moving the device invalidates the resident level
+     */
+    bounds->testingSetLevelOfDetail(0);
+    refBounds->testingSetLevelOfDetail(0);
+    dev->setX(20);
+    ref->setX(20);
+
+    bounds->testingSetLevelOfDetail(1);
+    refBounds->testingSetLevelOfDetail(1);
+    syncLodCache(dev, 1);
+    syncLodCache(ref, 1);
+
+    QCOMPARE(dev->exactBounds(), ref->exactBounds());
+    QCOMPARE(dev->convertToQImage(0,0,0,150,150),
+             ref->convertToQImage(0,0,0,150,150));
+}
+
 void KisPaintDeviceTest::benchmarkLod1Generation()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
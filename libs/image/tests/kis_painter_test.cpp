@@ -39,6 +39,10 @@
 #include <kis_fixed_paint_device.h>
 #include "testutil.h"
 #include <kis_iterator_ng.h>
+#include "kis_dab_blending_pipeline.h"
+#include "kis_work_stealing_task_pool.h"
+#include <QMutex>
+#include <QThreadPool>
 
 void KisPainterTest::allCsApplicator(void (KisPainterTest::* funcPtr)(const KoColorSpace*cs))
 {
@@ -479,6 +483,128 @@ void KisPainterTest::testBitBltOldData()
     srcGc.deleteTransaction();
 }
 
+void KisPainterTest::testPipelinedBltFixed()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(4);
+    KisWorkStealingTaskPool taskPool(&threadPool);
+
+    // without a pool the producer blends the dabs itself
+    QVector<KisWorkStealingTaskPool*> pools;
+    pools << &taskPool << 0;
+
+    Q_FOREACH (KisWorkStealingTaskPool *pool, pools) {
+        KisPaintDeviceSP directDev = new KisPaintDevice(cs);
+        KisPaintDeviceSP pipelinedDev = new KisPaintDevice(cs);
+
+        QVector<QRect> reportedRects;
+        QMutex reportLock;
+
+        {
+            // a small buffer makes the producer wait for the blending job
+            KisDabBlendingPipeline pipeline(pipelinedDev,
+                                            [&] (const QVector<QRect> &rects) {
+                                                QMutexLocker l(&reportLock);
+                                                reportedRects += rects;
+                                            },
+                                            pool, 4);
+
+            KisPainter directGc(directDev);
+            KisPainter pipelinedGc(pipelinedDev);
+            pipelinedGc.setDabBlendingPipeline(&pipeline);
+
+            KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+            dab->setRect(QRect(0, 0, 100, 100));
+            dab->initialize();
+
+            for (int i = 0; i < 200; i++) {
+                const QColor color(QColor::fromHsv(i % 360, 255, 255));
+                dab->fill(QRect(0, 0, 100, 100), KoColor(color, cs));
+                dab->fill(QRect(25, 25, 50, 50), KoColor(color.darker(), cs));
+
+                // the dabs overlap each other and cross the tile borders
+                const QPoint pos(-70 + 7 * (i % 40), -50 + 13 * (i / 40));
+                const quint8 opacity = 64 + i % 128;
+                const QString compositeOp = i % 3 ? COMPOSITE_OVER : COMPOSITE_MULT;
+
+                directGc.setOpacity(opacity);
+                directGc.setCompositeOp(compositeOp);
+                directGc.bltFixed(pos, dab, QRect(10, 10, 80, 80));
+
+                pipelinedGc.setOpacity(opacity);
+                pipelinedGc.setCompositeOp(compositeOp);
+                pipelinedGc.bltFixed(pos, dab, QRect(10, 10, 80, 80));
+            }
+
+            QVERIFY(pipelinedGc.takeDirtyRegion().isEmpty());
+
+            QVector<QRect> directRects = directGc.takeDirtyRegion();
+            QCOMPARE(pipeline.takeAddedRects(), directRects);
+            QVERIFY(pipeline.takeAddedRects().isEmpty());
+
+            pipeline.waitForDone();
+
+            QMutexLocker l(&reportLock);
+            QCOMPARE(reportedRects, directRects);
+        }
+
+        QCOMPARE(pipelinedDev->exactBounds(), directDev->exactBounds());
+
+        QPoint errorPoint;
+        QVERIFY(TestUtil::comparePaintDevices(errorPoint, pipelinedDev, directDev));
+    }
+
+    threadPool.waitForDone();
+}
+
+void KisPainterTest::testPipelinedFlush()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(2);
+    KisWorkStealingTaskPool taskPool(&threadPool);
+
+    // the context is waiting for a thread, so no blending job can start
+    taskPool.reserveThread();
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    QVector<QRect> reportedRects;
+
+    KisDabBlendingPipeline pipeline(dev,
+                                    [&] (const QVector<QRect> &rects) {
+                                        reportedRects += rects;
+                                    },
+                                    &taskPool, 16);
+
+    KisPainter gc(dev);
+    gc.setDabBlendingPipeline(&pipeline);
+
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(0, 0, 10, 10));
+    dab->initialize();
+    dab->fill(QRect(0, 0, 10, 10), KoColor(Qt::red, cs));
+
+    gc.bltFixed(QPoint(5, 5), dab, QRect(0, 0, 10, 10));
+    gc.bltFixed(QPoint(100, 5), dab, QRect(0, 0, 10, 10));
+
+    // the buffer is not full, so the dabs are still pending
+    QVERIFY(dev->exactBounds().isEmpty());
+    QVERIFY(reportedRects.isEmpty());
+
+    // ...until the producer flushes them
+    pipeline.flush();
+
+    QCOMPARE(dev->exactBounds(), QRect(5, 5, 105, 10));
+    QCOMPARE(reportedRects.size(), 2);
+
+    taskPool.releaseThreadReservation();
+    threadPool.waitForDone();
+}
+
 void KisPainterTest::benchmarkBitBlt()
 {
     quint8 p = 128;
@@ -51,6 +51,8 @@ private Q_SLOTS:
     void testSelectionBitBltEraseCompositeOp();
 
     void testBitBltOldData();
+    void testPipelinedBltFixed();
+    void testPipelinedFlush();
     void benchmarkBitBlt();
     void benchmarkBitBltOldData();
 
@@ -240,6 +240,84 @@ void KisSimpleUpdateQueueTest::testMixingTypes()
     QCOMPARE(walkersList[2]->type(), KisBaseRectsWalker::UPDATE_NO_FILTHY);
 }
 
+void KisSimpleUpdateQueueTest::testSpatialIndex()
+{
+    QRect imageRect(0,0,2048,2048);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    // the rects lying in the neighbour cells of the index are joined
+    queue.addUpdateJob(paintLayer, QRect(510,510,20,20), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(512,512,20,20), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(510,510,22,22)));
+
+    // the rect contained in a pending one is just dropped
+    queue.addUpdateJob(paintLayer, QRect(515,515,10,10), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 1);
+    QVERIFY(checkWalker(walkersList[0], QRect(510,510,22,22)));
+
+    // the far rects are never joined
+    queue.addUpdateJob(paintLayer, QRect(1500,1500,20,20), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(-20,-20,20,20), imageRect, 0);
+    queue.addUpdateJob(paintLayer, QRect(-22,-22,20,20), imageRect, 0);
+
+    QCOMPARE(walkersList.size(), 3);
+    QVERIFY(checkWalker(walkersList[1], QRect(1500,1500,20,20)));
+    QVERIFY(checkWalker(walkersList[2], QRect(-22,-22,22,22)));
+}
+
+void KisSimpleUpdateQueueTest::testPriorityRect()
+{
+    QRect imageRect(0,0,1024,1024);
+
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, imageRect.width(), imageRect.height(), cs, "merge test");
+
+    KisPaintLayerSP paintLayer = new KisPaintLayer(image, "test", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer);
+    image->unlock();
+
+    KisTestableSimpleUpdateQueue queue;
+    KisWalkersList& walkersList = queue.getWalkersList();
+
+    queue.addFullRefreshJob(paintLayer, QRect(0,0,1000,1000), imageRect, 0);
+    QCOMPARE(walkersList.size(), 4);
+
+    // the visible patch goes first...
+    queue.setPriorityRect(QRect(600,600,100,100));
+
+    KisTestableUpdaterContext context(1);
+    queue.processQueue(context);
+
+    QVector<KisUpdateJobItem*> jobs = context.getJobs();
+    QVERIFY(checkWalker(jobs[0]->walker(), QRect(512,512,488,488)));
+    context.clear();
+
+    // ...and the rest is processed in the order of arrival
+    queue.processQueue(context);
+
+    jobs = context.getJobs();
+    QVERIFY(checkWalker(jobs[0]->walker(), QRect(0,0,512,512)));
+    context.clear();
+
+    QCOMPARE(walkersList.size(), 2);
+}
+
 void KisSimpleUpdateQueueTest::testSpontaneousJobsCompression()
 {
     KisTestableSimpleUpdateQueue queue;
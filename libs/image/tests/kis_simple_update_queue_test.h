@@ -35,6 +35,8 @@ private Q_SLOTS:
     void testSplitFullRefresh();
     void testChecksum();
     void testMixingTypes();
+    void testSpatialIndex();
+    void testPriorityRect();
     void testSpontaneousJobsCompression();
 };
 
@@ -18,6 +18,9 @@
 
 #include "kis_update_scheduler_test.h"
 #include <QTest>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
@@ -411,6 +414,62 @@ void KisUpdateSchedulerTest::testTimeMonitor()
     KisUpdateTimeMonitor::instance()->endStrokeMeasure();
 }
 
+void KisUpdateSchedulerTest::testUpdateTracing()
+{
+    KisImageSP image = buildTestingImage();
+    KisNodeSP rootLayer = image->rootLayer();
+    KisNodeSP paintLayer1 = rootLayer->firstChild();
+
+    KisUpdateScheduler scheduler(image.data());
+
+    KisUpdateTimeMonitor::instance()->startTracing();
+    QVERIFY(KisUpdateTimeMonitor::instance()->isTracing());
+
+    scheduler.updateProjection(paintLayer1, QRect(10,10,100,100), image->bounds());
+    scheduler.waitForDone();
+
+    const QString fileName =
+        QString(FILES_OUTPUT_DIR) + QDir::separator() + "scheduler_update_trace.json";
+
+    QVERIFY(KisUpdateTimeMonitor::instance()->stopTracing(fileName));
+    QVERIFY(!KisUpdateTimeMonitor::instance()->isTracing());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QSet<QString> events;
+    bool hasThreadNames = false;
+
+    Q_FOREACH (const QJsonValue &value, doc.object().value("traceEvents").toArray()) {
+        const QJsonObject event = value.toObject();
+
+        if (event.value("ph").toString() == "M") {
+            hasThreadNames = true;
+            continue;
+        }
+
+        QCOMPARE(event.value("ph").toString(), QString("X"));
+        QVERIFY(event.value("dur").toDouble() >= 0.0);
+        events.insert(event.value("name").toString());
+
+        if (event.value("name").toString() == "Merge job") {
+            const QJsonArray rect = event.value("args").toObject().value("rect").toArray();
+            QCOMPARE(rect.size(), 4);
+            QCOMPARE(event.value("args").toObject().value("detail").toString(), QString("paint1"));
+        }
+    }
+
+    QVERIFY(hasThreadNames);
+    QVERIFY(events.contains("Collect rects"));
+    QVERIFY(events.contains("Merge job"));
+    QVERIFY(events.contains("Merge leaf"));
+    QVERIFY(events.contains("Composite"));
+}
+
 void KisUpdateSchedulerTest::testLodSync()
 {
     KisImageSP image = buildTestingImage();
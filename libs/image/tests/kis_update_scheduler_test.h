@@ -40,6 +40,7 @@ private Q_SLOTS:
     void testBlockUpdates();
 
     void testTimeMonitor();
+    void testUpdateTracing();
 
     void testLodSync();
 };
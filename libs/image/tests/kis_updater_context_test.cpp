@@ -27,6 +27,7 @@
 
 #include "kis_merge_walker.h"
 #include "kis_updater_context.h"
+#include "kis_work_stealing_task_pool.h"
 #include "kis_image.h"
 
 #include "scheduler_utils.h"
@@ -237,5 +238,97 @@ void KisUpdaterContextTest::stressTestExclusiveJobs()
              << "/" << NUM_CHECKS * NUM_JOBS;
 }
 
+void KisUpdaterContextTest::testSplitRect()
+{
+    QVector<QRect> chunks =
+        KisWorkStealingTaskPool::splitRect(QRect(-10, 10, 300, 100), 256);
+
+    QCOMPARE(chunks.size(), 3);
+    QCOMPARE(chunks[0], QRect(-10, 10, 10, 100));
+    QCOMPARE(chunks[1], QRect(0, 10, 256, 100));
+    QCOMPARE(chunks[2], QRect(256, 10, 34, 100));
+
+    QVERIFY(KisWorkStealingTaskPool::splitRect(QRect(), 256).isEmpty());
+}
+
+#define NUM_TASKS 64
+#define TASK_DELAY 2 // ms
+
+class TaskSplittingStrategy : public KisStrokeJobStrategy
+{
+public:
+    TaskSplittingStrategy(QAtomicInt &numTasksDone,
+                          QSet<Qt::HANDLE> &threads,
+                          QMutex &threadsLock)
+        : m_numTasksDone(numTasksDone),
+          m_threads(threads),
+          m_threadsLock(threadsLock)
+    {
+    }
+
+    void run(KisStrokeJobData *data) override {
+        Q_UNUSED(data);
+
+        QVector<KisWorkStealingTaskPool::Task> tasks;
+
+        for (int i = 0; i < NUM_TASKS; i++) {
+            tasks << [this] () {
+                QTest::qSleep(TASK_DELAY);
+
+                QMutexLocker l(&m_threadsLock);
+                m_threads.insert(QThread::currentThreadId());
+                m_numTasksDone.ref();
+            };
+        }
+
+        KisWorkStealingTaskPool::runInCurrentPool(tasks);
+
+        // all the tasks must be finished when the call returns
+        Q_ASSERT(m_numTasksDone.load() == NUM_TASKS);
+    }
+
+private:
+    QAtomicInt &m_numTasksDone;
+    QSet<Qt::HANDLE> &m_threads;
+    QMutex &m_threadsLock;
+};
+
+void KisUpdaterContextTest::testWorkStealing()
+{
+    KisUpdaterContext context(4);
+
+    QAtomicInt numTasksDone;
+    QSet<Qt::HANDLE> threads;
+    QMutex threadsLock;
+
+    KisStrokeJobData *data =
+        new KisStrokeJobData(KisStrokeJobData::SEQUENTIAL,
+                             KisStrokeJobData::EXCLUSIVE);
+
+    QScopedPointer<KisStrokeJobStrategy> strategy(
+        new TaskSplittingStrategy(numTasksDone, threads, threadsLock));
+
+    context.lock();
+    context.addStrokeJob(new KisStrokeJob(strategy.data(), data, 0, true));
+    context.unlock();
+
+    context.waitForDone();
+
+    QCOMPARE(numTasksDone.load(), NUM_TASKS);
+    QVERIFY(threads.size() > 1);
+
+    // outside the context the tasks are executed sequentially
+    threads.clear();
+    QVector<KisWorkStealingTaskPool::Task> tasks;
+    tasks << [&threads, &threadsLock] () {
+        QMutexLocker l(&threadsLock);
+        threads.insert(QThread::currentThreadId());
+    };
+    KisWorkStealingTaskPool::runInCurrentPool(tasks);
+
+    QCOMPARE(threads.size(), 1);
+    QVERIFY(threads.contains(QThread::currentThreadId()));
+}
+
 QTEST_MAIN(KisUpdaterContextTest)
 
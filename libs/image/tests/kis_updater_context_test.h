@@ -29,6 +29,8 @@ private Q_SLOTS:
     void testJobInterference();
     void testSnapshot();
     void stressTestExclusiveJobs();
+    void testSplitRect();
+    void testWorkStealing();
 };
 
 #endif /* KIS_UPDATER_CONTEXT_TEST_H */
@@ -27,6 +27,7 @@
 #include <KoColorSpace.h>
 #include "kis_paint_layer.h"
 #include "kis_group_layer.h"
+#include "kis_projection_leaf.h"
 #include "kis_clone_layer.h"
 #include "kis_adjustment_layer.h"
 #include "kis_selection.h"
@@ -96,6 +97,14 @@ protected:
     QStringList m_order;
 };
 
+class KisUncachedTestWalker : public KisTestWalker
+{
+protected:
+    int tripCacheId() const override {
+        return -1;
+    }
+};
+
 /************** Debug And Verify Code *******************************/
 
 struct UpdateTestJob {
@@ -1222,5 +1231,80 @@ void KisWalkersTest::testGraphStructureChecksum()
     QCOMPARE(walker.checksumValid(), true);
 }
 
+void KisWalkersTest::testCachedTrip()
+{
+    const KoColorSpace * colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 512, 512, colorSpace, "walker test");
+
+    KisLayerSP paintLayer1 = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer2 = new KisPaintLayer(image, "paint2", OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer3 = new KisPaintLayer(image, "paint3", OPACITY_OPAQUE_U8);
+    KisLayerSP paintLayer4 = new KisPaintLayer(image, "paint4", OPACITY_OPAQUE_U8);
+    KisGroupLayerSP groupLayer = new KisGroupLayer(image, "group", OPACITY_OPAQUE_U8);
+
+    image->lock();
+    image->addNode(paintLayer1, image->rootLayer());
+    image->addNode(groupLayer, image->rootLayer());
+    image->addNode(paintLayer4, image->rootLayer());
+    image->addNode(paintLayer2, groupLayer);
+    image->addNode(paintLayer3, groupLayer);
+    image->unlock();
+
+    QRect testRect(10,10,10,10);
+
+    KisTestWalker walker;
+    KisUncachedTestWalker referenceWalker;
+
+    referenceWalker.collectRects(paintLayer2, testRect);
+    QStringList reference = referenceWalker.popResult();
+
+    // the first trip is recorded, the second one is replayed
+    walker.collectRects(paintLayer2, testRect);
+    QCOMPARE(walker.popResult(), reference);
+    walker.collectRects(paintLayer2, testRect);
+    QCOMPARE(walker.popResult(), reference);
+
+    // the cached trip should not depend on the requested rect
+    KisMergeWalker mergeWalker(QRect());
+    KisMergeWalker referenceMergeWalker(QRect());
+    mergeWalker.collectRects(paintLayer2, QRect(50,50,100,100));
+    mergeWalker.collectRects(paintLayer2, testRect);
+    referenceMergeWalker.collectRects(paintLayer2, testRect);
+    QCOMPARE(mergeWalker.accessRect(), referenceMergeWalker.accessRect());
+    QCOMPARE(mergeWalker.leafStack().size(), referenceMergeWalker.leafStack().size());
+
+    // switching the pass-through mode should invalidate the trip
+    groupLayer->setPassThroughMode(true);
+
+    referenceWalker.collectRects(paintLayer2, testRect);
+    QStringList passThroughReference = referenceWalker.popResult();
+    QVERIFY(passThroughReference != reference);
+
+    walker.collectRects(paintLayer2, testRect);
+    QCOMPARE(walker.popResult(), passThroughReference);
+
+    // so should adding of a new node
+    KisLayerSP paintLayer5 = new KisPaintLayer(image, "paint5", OPACITY_OPAQUE_U8);
+    image->lock();
+    image->addNode(paintLayer5, image->rootLayer());
+    image->unlock();
+
+    referenceWalker.collectRects(paintLayer2, testRect);
+    reference = referenceWalker.popResult();
+    QVERIFY(reference.contains("paint5"));
+
+    walker.collectRects(paintLayer2, testRect);
+    QCOMPARE(walker.popResult(), reference);
+
+    // regenerating the pass-through projection bumps the number only once
+    const int sequenceNumber = paintLayer2->graphSequenceNumber();
+    groupLayer->projectionLeaf()->explicitlyRegeneratePassThroughProjection();
+    QVERIFY(groupLayer->passThroughMode());
+    QCOMPARE(paintLayer2->graphSequenceNumber(), sequenceNumber + 1);
+
+    walker.collectRects(paintLayer2, testRect);
+    QCOMPARE(walker.popResult(), reference);
+}
+
 QTEST_MAIN(KisWalkersTest)
 
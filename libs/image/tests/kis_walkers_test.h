@@ -252,6 +252,7 @@ private Q_SLOTS:
     void testMasksOverlapping();
     void testRectsChecksum();
     void testGraphStructureChecksum();
+    void testCachedTrip();
 
 private:
     void verifyResult(KisBaseRectsWalker &walker, QStringList reference,
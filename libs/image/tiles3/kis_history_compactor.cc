@@ -0,0 +1,176 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_history_compactor.h"
+
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QWaitCondition>
+
+#include "kis_assert.h"
+#include "kis_memento_manager.h"
+
+
+struct Q_DECL_HIDDEN KisHistoryCompactor::Private
+{
+    struct Request {
+        KisMementoManager *mm;
+
+        /**
+         * Incremented on every scheduleCompaction() call. Lets the
+         * compactor notice the revisions committed while it was
+         * compacting the manager.
+         */
+        int seqNo;
+    };
+
+    QSemaphore semaphore;
+    QAtomicInt shouldExitFlag;
+
+    /**
+     * Held while a manager is being compacted, so that
+     * cancelCompaction() could wait for the compactor to
+     * leave the manager. Always locked before queueLock.
+     */
+    QMutex jobLock;
+
+    QMutex queueLock;
+    QList<Request> queue;
+    QWaitCondition queueEmpty;
+
+    int findRequest(KisMementoManager *mm) const {
+        for (int i = 0; i < queue.size(); i++) {
+            if (queue[i].mm == mm) return i;
+        }
+        return -1;
+    }
+};
+
+KisHistoryCompactor::KisHistoryCompactor()
+    : QThread(),
+      m_d(new Private())
+{
+    m_d->shouldExitFlag = 0;
+}
+
+KisHistoryCompactor::~KisHistoryCompactor()
+{
+    delete m_d;
+}
+
+void KisHistoryCompactor::scheduleCompaction(KisMementoManager *mm)
+{
+    {
+        QMutexLocker locker(&m_d->queueLock);
+
+        const int index = m_d->findRequest(mm);
+        if (index >= 0) {
+            m_d->queue[index].seqNo++;
+        } else {
+            Private::Request request = {mm, 0};
+            m_d->queue.append(request);
+        }
+    }
+
+    m_d->semaphore.release();
+}
+
+void KisHistoryCompactor::cancelCompaction(KisMementoManager *mm)
+{
+    QMutexLocker jobLocker(&m_d->jobLock);
+    QMutexLocker locker(&m_d->queueLock);
+
+    const int index = m_d->findRequest(mm);
+    if (index >= 0) {
+        m_d->queue.removeAt(index);
+    }
+
+    if (m_d->queue.isEmpty()) {
+        m_d->queueEmpty.wakeAll();
+    }
+}
+
+void KisHistoryCompactor::terminateCompactor()
+{
+    unsigned long exitTimeout = 100;
+    do {
+        m_d->shouldExitFlag = true;
+        m_d->semaphore.release();
+    } while(!wait(exitTimeout));
+
+    QMutexLocker locker(&m_d->queueLock);
+    m_d->queue.clear();
+    m_d->queueEmpty.wakeAll();
+}
+
+void KisHistoryCompactor::testingWaitForDone()
+{
+    QMutexLocker locker(&m_d->queueLock);
+
+    while (!m_d->queue.isEmpty()) {
+        m_d->queueEmpty.wait(&m_d->queueLock);
+    }
+}
+
+void KisHistoryCompactor::run()
+{
+    while (1) {
+        m_d->semaphore.acquire();
+
+        if (m_d->shouldExitFlag)
+            return;
+
+        doJob();
+    }
+}
+
+void KisHistoryCompactor::doJob()
+{
+    while (!m_d->shouldExitFlag) {
+        QMutexLocker jobLocker(&m_d->jobLock);
+
+        Private::Request request;
+
+        {
+            QMutexLocker locker(&m_d->queueLock);
+            if (m_d->queue.isEmpty()) break;
+            request = m_d->queue.first();
+        }
+
+        /**
+         * The manager cannot be cancelled while we hold the job
+         * lock, so the request stays the first one in the queue
+         */
+        const bool hasMoreWork = request.mm->compactHistory();
+
+        QMutexLocker locker(&m_d->queueLock);
+
+        Private::Request current = m_d->queue.takeFirst();
+        KIS_ASSERT_RECOVER_NOOP(current.mm == request.mm);
+
+        /**
+         * Let the other managers have their turn
+         */
+        if (hasMoreWork || current.seqNo != request.seqNo) {
+            m_d->queue.append(current);
+        }
+
+        if (m_d->queue.isEmpty()) {
+            m_d->queueEmpty.wakeAll();
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_HISTORY_COMPACTOR_H
+#define __KIS_HISTORY_COMPACTOR_H
+
+#include <QThread>
+
+#include "kritaimage_export.h"
+
+class KisMementoManager;
+
+
+/**
+ * A low priority background thread that deduplicates the tile data
+ * kept in the undo history of the paint devices
+ * (\see KisMementoManager::compactHistory()).
+ *
+ * The memento managers schedule themselves on every commit. The
+ * compactor processes them in turns, a small portion of the history
+ * at a time, so a long history of one device doesn't delay the
+ * others and the painting threads never wait for the compaction for
+ * long.
+ */
+class KRITAIMAGE_EXPORT KisHistoryCompactor : public QThread
+{
+    Q_OBJECT
+
+public:
+    KisHistoryCompactor();
+    ~KisHistoryCompactor() override;
+
+    /**
+     * Asks the compactor to process the new revisions of \p mm
+     */
+    void scheduleCompaction(KisMementoManager *mm);
+
+    /**
+     * Removes \p mm from the queue. If \p mm is being compacted
+     * right now, waits until the compactor leaves it. Must be
+     * called before the manager is destroyed.
+     */
+    void cancelCompaction(KisMementoManager *mm);
+
+    void terminateCompactor();
+
+    /**
+     * Blocks until all the scheduled managers are compacted
+     */
+    void testingWaitForDone();
+
+private:
+    void run() override;
+    void doJob();
+
+private:
+    struct Private;
+    Private * const m_d;
+};
+
+#endif /* __KIS_HISTORY_COMPACTOR_H */
@@ -143,6 +143,21 @@ public:
         m_committedFlag = true;
     }
 
+    /**
+     * Makes a committed item refer to \p tileData, which must
+     * have exactly the same content as the current one. Used
+     * for deduplicating the history.
+     */
+    void replaceTileData(KisTileData *tileData) {
+        Q_ASSERT(m_committedFlag);
+
+        tileData->acquire();
+        tileData->setMementoed(true);
+
+        releaseTileData();
+        m_tileData = tileData;
+    }
+
     inline KisTileSP tile(KisMementoManager *mm) {
         Q_ASSERT(m_tileData);
         return KisTileSP(new KisTile(m_col, m_row, m_tileData, mm));
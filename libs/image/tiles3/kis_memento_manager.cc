@@ -19,6 +19,7 @@
 #include <QtGlobal>
 #include "kis_memento_manager.h"
 #include "kis_memento.h"
+#include "kis_tile_data.h"
 
 
 //#define DEBUG_MM
@@ -73,10 +74,14 @@
 
 #define namedTransactionInProgress() ((bool)m_currentMemento)
 
+const qint32 KisMementoManager::COMPACTION_BUDGET = 64;
+
 KisMementoManager::KisMementoManager()
     : m_index(0),
       m_headsHashTable(0),
-      m_registrationBlocked(false)
+      m_registrationBlocked(false),
+      m_compactionRevision(0),
+      m_compactionItem(0)
 {
     /**
      * Tile change/delete registration is enabled for all
@@ -90,7 +95,9 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
         m_cancelledRevisions(rhs.m_cancelledRevisions),
         m_headsHashTable(rhs.m_headsHashTable, 0),
         m_currentMemento(rhs.m_currentMemento),
-        m_registrationBlocked(rhs.m_registrationBlocked)
+        m_registrationBlocked(rhs.m_registrationBlocked),
+        m_compactionRevision(rhs.m_compactionRevision),
+        m_compactionItem(rhs.m_compactionItem)
 {
     Q_ASSERT_X(!m_registrationBlocked,
                "KisMementoManager", "(impossible happened) "
@@ -99,7 +106,9 @@ KisMementoManager::KisMementoManager(const KisMementoManager& rhs)
 
 KisMementoManager::~KisMementoManager()
 {
-    // Nothing to be done here. Happily...
+    KisTileDataStore::instance()->cancelHistoryCompaction(this);
+
+    // Nothing else to be done here. Happily...
     // Everything is done by QList and KisSharedPtr...
     DEBUG_LOG_SIMPLE_ACTION("died\n");
 }
@@ -182,6 +191,8 @@ void KisMementoManager::commit()
         }
     }
 
+    QMutexLocker locker(&m_historyLock);
+
     KisMementoItemList revisionList;
     KisMementoItemSP mi;
     KisMementoItemSP parentMI;
@@ -209,6 +220,10 @@ void KisMementoManager::commit()
     m_currentMemento = 0;
     Q_ASSERT(m_index.isEmpty());
 
+    locker.unlock();
+
+    scheduleCompaction();
+
     DEBUG_DUMP_MESSAGE("COMMIT_DONE");
 
     // Waking up pooler to prepare copies for us
@@ -225,6 +240,11 @@ KisTileSP KisMementoManager::getCommitedTile(qint32 col, qint32 row)
     if(!namedTransactionInProgress())
         return KisTileSP();
 
+    /**
+     * The compaction may replace the tile data of the item
+     */
+    QMutexLocker locker(&m_historyLock);
+
     KisMementoItemSP mi = m_headsHashTable.getReadOnlyTileLazy(col, row);
     Q_ASSERT(mi);
     return mi->tile(0);
@@ -238,7 +258,11 @@ KisMementoSP KisMementoManager::getMemento()
     Q_ASSERT(!namedTransactionInProgress());
 
     // Clear redo() information
-    m_cancelledRevisions.clear();
+    if (!m_cancelledRevisions.isEmpty()) {
+        QMutexLocker locker(&m_historyLock);
+        m_cancelledRevisions.clear();
+        resetCompaction();
+    }
 
     commit();
     m_currentMemento = new KisMemento(this);
@@ -260,10 +284,17 @@ void KisMementoManager::rollback(KisTileHashTable *ht)
 {
     commit();
 
+    QMutexLocker locker(&m_historyLock);
+
     if (! m_revisions.size()) return;
 
     KisHistoryItem changeList = m_revisions.takeLast();
 
+    if (m_compactionRevision >= m_revisions.size()) {
+        m_compactionRevision = m_revisions.size();
+        m_compactionItem = 0;
+    }
+
     KisMementoItemSP mi;
     KisMementoItemSP parentMI;
     KisMementoItemList::iterator iter;
@@ -303,6 +334,8 @@ void KisMementoManager::rollback(KisTileHashTable *ht)
     Q_ASSERT(!namedTransactionInProgress());
 
     m_cancelledRevisions.prepend(changeList);
+    locker.unlock();
+
     DEBUG_DUMP_MESSAGE("UNDONE");
 
     // Waking up pooler to prepare copies for us
@@ -320,13 +353,17 @@ void KisMementoManager::rollforward(KisTileHashTable *ht)
     KisMementoItemSP mi;
 
     blockRegistration();
-    Q_FOREACH (mi, changeList.itemList) {
-        if (mi->parent()->type() == KisMementoItem::CHANGED)
-            ht->deleteTile(mi->col(), mi->row());
-        if (mi->type() == KisMementoItem::CHANGED)
-            ht->addTile(mi->tile(this));
+    {
+        QMutexLocker locker(&m_historyLock);
 
-        m_index.addTile(mi);
+        Q_FOREACH (mi, changeList.itemList) {
+            if (mi->parent()->type() == KisMementoItem::CHANGED)
+                ht->deleteTile(mi->col(), mi->row());
+            if (mi->type() == KisMementoItem::CHANGED)
+                ht->addTile(mi->tile(this));
+
+            m_index.addTile(mi);
+        }
     }
     // see comment in rollback()
 
@@ -342,6 +379,8 @@ void KisMementoManager::purgeHistory(KisMementoSP oldestMemento)
         commit();
     }
 
+    QMutexLocker locker(&m_historyLock);
+
     qint32 revisionIndex = findRevisionByMemento(oldestMemento);
     if (revisionIndex < 0) return;
 
@@ -353,6 +392,11 @@ void KisMementoManager::purgeHistory(KisMementoSP oldestMemento)
     Q_ASSERT(m_revisions.first().memento == oldestMemento);
     resetRevisionHistory(m_revisions.first().itemList);
 
+    resetCompaction();
+    locker.unlock();
+
+    scheduleCompaction();
+
     DEBUG_DUMP_MESSAGE("PURGE_HISTORY");
 }
 
@@ -384,6 +428,122 @@ void KisMementoManager::resetRevisionHistory(KisMementoItemList list)
     }
 }
 
+/**
+ * Compaction of the history
+ *
+ * Every write access to a tile makes a copy of its data, even if the
+ * pixels are not changed in the end (e.g. a stroke passing through a
+ * masked area). Besides, the same content often appears in different
+ * revisions (a tile painted and then erased, tiles of a uniform color).
+ * Such copies carry no information, so the committed memento items are
+ * relinked to a single tile data having the same content, and the
+ * duplicates are freed. Reverting a revision keeps working as before,
+ * because the shared tile data is protected by the COW mechanism.
+ *
+ * The compaction is done by KisHistoryCompactor in a low priority
+ * thread, a few items at a time, with m_historyLock held. The tile data
+ * objects that are not present in memory are skipped, there is no
+ * point in loading them from swap just for compaction.
+ */
+
+/**
+ * Both tile data objects should have the swapping blocked
+ */
+inline bool tileDataEqual(KisTileData *td1, KisTileData *td2)
+{
+    return td1->pixelSize() == td2->pixelSize() &&
+        td1->contentHashSwappingBlocked() == td2->contentHashSwappingBlocked() &&
+        !memcmp(td1->data(), td2->data(),
+                td1->pixelSize() * KisTileData::WIDTH * KisTileData::HEIGHT);
+}
+
+/**
+ * Returns true if \p td2 is loaded into memory and has the same
+ * content as \p td1. The swapping of \p td1 should be blocked.
+ */
+inline bool loadedTileDataEqual(KisTileData *td1, KisTileData *td2)
+{
+    if (td1 == td2 || !td2->tryBlockSwapping()) return false;
+
+    const bool result = tileDataEqual(td1, td2);
+    td2->unblockSwapping();
+
+    return result;
+}
+
+/**
+ * Should be called with m_historyLock held
+ */
+void KisMementoManager::compactItem(KisMementoItemSP mi)
+{
+    if (mi->type() != KisMementoItem::CHANGED) return;
+
+    KisTileData *td = mi->tileData();
+    if (!td->tryBlockSwapping()) return;
+
+    KisTileData *sharedData = 0;
+
+    KisMementoItemSP parentMI = mi->parent();
+    if (parentMI &&
+        parentMI->type() == KisMementoItem::CHANGED &&
+        loadedTileDataEqual(td, parentMI->tileData())) {
+
+        sharedData = parentMI->tileData();
+    } else {
+        KisMementoItemSP &indexedMI = m_compactionIndex[td->contentHashSwappingBlocked()];
+
+        if (!indexedMI) {
+            indexedMI = mi;
+        } else if (loadedTileDataEqual(td, indexedMI->tileData())) {
+            sharedData = indexedMI->tileData();
+        }
+    }
+
+    td->unblockSwapping();
+
+    if (sharedData) {
+        mi->replaceTileData(sharedData);
+    }
+}
+
+bool KisMementoManager::compactHistory()
+{
+    QMutexLocker locker(&m_historyLock);
+
+    qint32 budget = COMPACTION_BUDGET;
+
+    while (budget > 0 && m_compactionRevision < m_revisions.size()) {
+        const KisMementoItemList &list = m_revisions.at(m_compactionRevision).itemList;
+
+        for (; budget > 0 && m_compactionItem < list.size(); m_compactionItem++, budget--) {
+            compactItem(list[m_compactionItem]);
+        }
+
+        if (m_compactionItem >= list.size()) {
+            m_compactionRevision++;
+            m_compactionItem = 0;
+        }
+    }
+
+    return m_compactionRevision < m_revisions.size();
+}
+
+void KisMementoManager::scheduleCompaction()
+{
+    KisTileDataStore::instance()->scheduleHistoryCompaction(this);
+}
+
+void KisMementoManager::resetCompaction()
+{
+    /**
+     * Some of the revisions might have gone, so start
+     * from the very beginning of the history
+     */
+    m_compactionIndex.clear();
+    m_compactionRevision = 0;
+    m_compactionItem = 0;
+}
+
 void KisMementoManager::setDefaultTileData(KisTileData *defaultTileData)
 {
     m_headsHashTable.setDefaultTileData(defaultTileData);
@@ -20,6 +20,8 @@
 #define KIS_MEMENTO_MANAGER_
 
 #include <QList>
+#include <QHash>
+#include <QMutex>
 
 #include "kis_memento_item.h"
 #include "kis_tile_hash_table.h"
@@ -115,6 +117,22 @@ protected:
     qint32 findRevisionByMemento(KisMementoSP memento) const;
     void resetRevisionHistory(KisMementoItemList list);
 
+    /**
+     * Makes committed memento items with equal content share the
+     * same tile data. Processes at most COMPACTION_BUDGET items per
+     * call, continuing from the place where the previous call has
+     * stopped. Returns true if there are items left. Called by
+     * KisHistoryCompactor in a background thread.
+     */
+    bool compactHistory();
+    void compactItem(KisMementoItemSP mi);
+    void resetCompaction();
+    void scheduleCompaction();
+
+    friend class KisHistoryCompactor;
+
+    static const qint32 COMPACTION_BUDGET;
+
 protected:
     /**
      * INDEX of tiles to be committed with next commit()
@@ -155,6 +173,28 @@ protected:
      * \see rollforward()
      */
     bool m_registrationBlocked;
+
+    /**
+     * The position of the first item in m_revisions
+     * that hasn't been compacted yet
+     */
+    qint32 m_compactionRevision;
+    qint32 m_compactionItem;
+
+    /**
+     * Committed items hashed by the content of their tile data.
+     * Holds the items, so it must be reset when the history is
+     * purged to not keep them alive.
+     */
+    QHash<quint64, KisMementoItemSP> m_compactionIndex;
+
+    /**
+     * Guards the committed revisions and the compaction state
+     * against the compaction running in the background. The
+     * rest of the manager is guarded by the lock of the data
+     * manager.
+     */
+    QMutex m_historyLock;
 };
 
 #endif /* KIS_MEMENTO_MANAGER_ */
@@ -32,6 +32,7 @@ void KisTile::init(qint32 col, qint32 row,
     m_col = col;
     m_row = row;
     m_lockCounter = 0;
+    m_isDead = 0;
 
     m_extent = QRect(m_col * KisTileData::WIDTH, m_row * KisTileData::HEIGHT,
                      KisTileData::WIDTH, KisTileData::HEIGHT);
@@ -86,6 +87,8 @@ KisTile::~KisTile()
 
 void KisTile::notifyDead()
 {
+    m_isDead = 1;
+
     if (m_mementoManager) {
         KisMementoManager *manager = m_mementoManager;
         m_mementoManager = 0;
@@ -199,6 +202,16 @@ void KisTile::lockForWrite()
         m_COWMutex.unlock();
     }
 
+    /**
+     * The data is not shared anymore and is going to be
+     * changed in-place, so it cannot be uniform and its
+     * hash and version are going to be outdated
+     */
+    if (m_tileData->uniform()) {
+        m_tileData->setUniform(false);
+    }
+    m_tileData->beginWrite();
+
     DEBUG_LOG_ACTION("lock [W]");
 }
 
@@ -208,6 +221,13 @@ void KisTile::unlock() const
     DEBUG_LOG_ACTION("unlock");
 }
 
+void KisTile::unlockForWrite()
+{
+    m_tileData->endWrite();
+    unblockSwapping();
+    DEBUG_LOG_ACTION("unlock [W]");
+}
+
 
 #include <stdio.h>
 void KisTile::debugPrintInfo()
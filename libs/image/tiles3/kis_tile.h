@@ -66,6 +66,16 @@ public:
      */
     void notifyDead();
 
+    /**
+     * Returns true if the tile has been disconnected from its hash
+     * table, i.e. it was removed from the data manager or replaced
+     * by another tile. Nobody is going to read it through the data
+     * manager anymore.
+     */
+    inline bool isDead() const {
+        return m_isDead.load();
+    }
+
 public:
 
     void debugPrintInfo();
@@ -75,6 +85,14 @@ public:
     void lockForWrite();
     void unlock() const;
 
+    /**
+     * Releases the lock taken with lockForWrite(). Must be used
+     * instead of unlock() for write locks, otherwise the content
+     * hash and the version of the tile data will not be cached
+     * anymore.
+     */
+    void unlockForWrite();
+
     /* this allows us work directly on tile's data */
     inline quint8 *data() const {
         return m_tileData->data();
@@ -140,6 +158,11 @@ private:
      */
     KisTileSP m_nextTile;
 
+    /**
+     * Set by notifyDead(). Read by the prefetcher thread.
+     */
+    QAtomicInt m_isDead;
+
 #ifdef DEAD_TILES_SANITY_CHECK
     QAtomicPointer<KisMementoManager> m_mementoManager;
 #else
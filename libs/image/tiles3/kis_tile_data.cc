@@ -22,23 +22,24 @@
 
 #include <kis_debug.h>
 
-#include <boost/pool/singleton_pool.hpp>
 #include "kis_tile_data_store_iterators.h"
 
-// BPP == bytes per pixel
-#define TILE_SIZE_4BPP (4 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-#define TILE_SIZE_8BPP (8 * __TILE_DATA_WIDTH * __TILE_DATA_HEIGHT)
-
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_4BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 256, 4096> BoostPool4BPP;
-typedef boost::singleton_pool<KisTileData, TILE_SIZE_8BPP, boost::default_user_allocator_new_delete, boost::details::pool::default_mutex, 128, 2048> BoostPool8BPP;
-
 const qint32 KisTileData::WIDTH = __TILE_DATA_WIDTH;
 const qint32 KisTileData::HEIGHT = __TILE_DATA_HEIGHT;
 
+QAtomicInteger<quint64> KisTileData::s_lastVersion(0);
+
 
 KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataStore *store)
     : m_state(NORMAL),
       m_mementoFlag(0),
+      m_uniformFlag(false),
+      m_contentHashValid(0),
+      m_contentHash(0),
+      m_versionValid(0),
+      m_version(0),
+      m_writersCount(0),
+      m_writesStarted(0),
       m_age(0),
       m_usersCount(0),
       m_refCount(0),
@@ -66,6 +67,13 @@ KisTileData::KisTileData(qint32 pixelSize, const quint8 *defPixel, KisTileDataSt
 KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     : m_state(NORMAL),
       m_mementoFlag(0),
+      m_uniformFlag(false),
+      m_contentHashValid(0),
+      m_contentHash(0),
+      m_versionValid(0),
+      m_version(0),
+      m_writersCount(0),
+      m_writesStarted(0),
       m_age(0),
       m_usersCount(0),
       m_refCount(0),
@@ -78,6 +86,17 @@ KisTileData::KisTileData(const KisTileData& rhs, bool checkFreeMemory)
     m_data = allocateData(m_pixelSize);
 
     memcpy(m_data, rhs.data(), m_pixelSize * WIDTH * HEIGHT);
+
+    // the content is the same, so is the hash
+    if (rhs.m_contentHashValid.loadAcquire()) {
+        m_contentHash = rhs.m_contentHash;
+        m_contentHashValid.storeRelease(1);
+    }
+
+    if (rhs.m_versionValid.loadAcquire()) {
+        m_version = rhs.m_version;
+        m_versionValid.storeRelease(1);
+    }
 }
 
 
@@ -118,34 +137,12 @@ void KisTileData::allocateMemory()
 
 quint8* KisTileData::allocateData(const qint32 pixelSize)
 {
-    quint8 *ptr = 0;
-
-    switch(pixelSize) {
-    case 4:
-        ptr = (quint8*)BoostPool4BPP::malloc();
-        break;
-    case 8:
-        ptr = (quint8*)BoostPool8BPP::malloc();
-        break;
-    default:
-        ptr = (quint8*) malloc(pixelSize * WIDTH * HEIGHT);
-    }
-
-    return ptr;
+    return m_store->allocator()->allocate(pixelSize);
 }
 
 void KisTileData::freeData(quint8* ptr, const qint32 pixelSize)
 {
-    switch(pixelSize) {
-    case 4:
-        BoostPool4BPP::free(ptr);
-        break;
-    case 8:
-        BoostPool8BPP::free(ptr);
-        break;
-    default:
-        free(ptr);
-    }
+    m_store->allocator()->free(ptr, pixelSize);
 }
 
 //#define DEBUG_POOL_RELEASE
@@ -176,9 +173,7 @@ void KisTileData::releaseInternalPools()
             }
 
             // check if the tile data has actually been pooled
-            if (item->m_pixelSize != 4 &&
-                item->m_pixelSize != 8) {
-
+            if (!KisTileDataAllocator::isPooled(item->m_pixelSize)) {
                 continue;
             }
 
@@ -198,9 +193,13 @@ void KisTileData::releaseInternalPools()
         }
 
         if (!failedToLock) {
+            Q_FOREACH (KisTileData *item, dataObjects) {
+                item->freeData(item->m_data, item->m_pixelSize);
+                item->m_data = 0;
+            }
+
             // purge the pools memory
-            BoostPool4BPP::purge_memory();
-            BoostPool8BPP::purge_memory();
+            KisTileDataStore::instance()->allocator()->releaseUnusedArenas();
 
             auto it = dataObjects.begin();
             auto chunkIt = memoryChunks.constBegin();
@@ -209,7 +208,7 @@ void KisTileData::releaseInternalPools()
                 KisTileData *item = *it;
                 const int chunkSize = item->m_pixelSize * WIDTH * HEIGHT;
 
-                item->m_data = allocateData(item->m_pixelSize);
+                item->m_data = item->allocateData(item->m_pixelSize);
                 memcpy(item->m_data, chunkIt->data(), chunkSize);
 
                 item->m_swapLock.unlock();
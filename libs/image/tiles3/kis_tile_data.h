@@ -24,6 +24,8 @@
  * declaration to a separate file, that will be included
  * by the store.
  */
+#include <cstring>
+
 #include "kis_tile_data_interface.h"
 
 
@@ -38,6 +40,7 @@ inline quint8* KisTileData::data() const {
 void KisTileData::setData(const quint8 *data) {
     Q_ASSERT(m_data);
     memcpy(m_data, data, m_pixelSize*WIDTH*HEIGHT);
+    invalidateContentHash();
 }
 
 inline quint32 KisTileData::pixelSize() const {
@@ -101,6 +104,15 @@ inline void KisTileData::unblockSwapping() {
     m_swapLock.unlock();
 }
 
+inline bool KisTileData::tryBlockSwapping() {
+    m_swapLock.lockForRead();
+    if(!m_data) {
+        m_swapLock.unlock();
+        return false;
+    }
+    return true;
+}
+
 inline KisChunk KisTileData::swapChunk() const {
     return m_swapChunk;
 }
@@ -119,6 +131,110 @@ inline bool KisTileData::historical() const {
     return mementoed() && numUsers() <= 1;
 }
 
+inline bool KisTileData::uniform() const {
+    return m_uniformFlag.loadAcquire();
+}
+inline void KisTileData::setUniform(bool value) {
+    m_uniformFlag.storeRelease(value);
+}
+
+/**
+ * A word-wise mixing hash (the body and the finalizer of MurmurHash3).
+ * The size of the tile data is always a multiple of 8 bytes.
+ */
+inline quint64 KisTileData::calculateContentHash(const quint8 *data, qint32 size) {
+    quint64 hash = 0x9e3779b97f4a7c15ULL ^ quint64(size);
+
+    for (const quint8 *end = data + size; data < end; data += sizeof(quint64)) {
+        quint64 word;
+        memcpy(&word, data, sizeof(quint64));
+
+        word *= 0x87c37b91114253d5ULL;
+        word = (word << 31) | (word >> 33);
+        word *= 0x4cf5ad432745937fULL;
+
+        hash ^= word;
+        hash = (hash << 27) | (hash >> 37);
+        hash = hash * 5 + 0x52dce729;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+inline quint64 KisTileData::contentHash() {
+    if (m_contentHashValid.loadAcquire()) {
+        return m_contentHash;
+    }
+
+    blockSwapping();
+    const quint64 hash = contentHashSwappingBlocked();
+    unblockSwapping();
+
+    return hash;
+}
+
+inline quint64 KisTileData::contentHashSwappingBlocked() {
+    if (m_contentHashValid.loadAcquire()) {
+        return m_contentHash;
+    }
+
+    const int writesStarted = m_writesStarted.loadAcquire();
+    const quint64 hash = calculateContentHash(m_data, m_pixelSize * WIDTH * HEIGHT);
+
+    /**
+     * Don't cache the hash if the data could have changed while we
+     * were reading it. A write that starts after this check will
+     * invalidate the value in endWrite().
+     */
+    if (!m_writersCount.loadAcquire() &&
+        m_writesStarted.loadAcquire() == writesStarted) {
+
+        m_contentHash = hash;
+        m_contentHashValid.storeRelease(1);
+    }
+
+    return hash;
+}
+inline void KisTileData::invalidateContentHash() {
+    m_contentHashValid.storeRelease(0);
+}
+
+inline quint64 KisTileData::version() {
+    if (m_versionValid.loadAcquire()) {
+        return m_version;
+    }
+
+    const quint64 version = s_lastVersion.fetchAndAddOrdered(1) + 1;
+
+    if (!m_writersCount.loadAcquire()) {
+        m_version = version;
+        m_versionValid.storeRelease(1);
+    }
+
+    return version;
+}
+inline void KisTileData::invalidateVersion() {
+    m_versionValid.storeRelease(0);
+}
+
+inline void KisTileData::beginWrite() {
+    m_writersCount.ref();
+    m_writesStarted.ref();
+    invalidateContentHash();
+    invalidateVersion();
+}
+inline void KisTileData::endWrite() {
+    invalidateContentHash();
+    invalidateVersion();
+    m_writersCount.deref();
+}
+
 inline int KisTileData::age() const {
     return m_age;
 }
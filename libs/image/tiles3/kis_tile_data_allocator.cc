@@ -0,0 +1,371 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_data_allocator.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QVector>
+#include <QMap>
+#include <QThreadStorage>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "kis_assert.h"
+#include "kis_tile_data_interface.h"
+
+
+const qint32 KisTileDataAllocator::MAX_POOLED_PIXEL_SIZE = 16;
+
+/**
+ * Must stay equal to the number of bits in Arena::freeMask
+ */
+const qint32 KisTileDataAllocator::BLOCKS_PER_ARENA = 64;
+
+namespace {
+const qint32 NUM_SHARDS = 8;
+const qint32 NUM_SIZE_CLASSES = 16;
+const quint64 FREE_ARENA_MASK = ~quint64(0);
+
+inline qint32 blockSize(qint32 pixelSize) {
+    return pixelSize * KisTileData::WIDTH * KisTileData::HEIGHT;
+}
+
+inline qint32 lowestBitIndex(quint64 mask) {
+    qint32 index = 0;
+    while (!(mask & 0x1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+}
+
+struct ThreadShardHolder
+{
+    ThreadShardHolder() : shard(-1) {}
+    qint32 shard;
+};
+
+QAtomicInt s_nextShard;
+}
+
+Q_GLOBAL_STATIC(QThreadStorage<ThreadShardHolder>, s_threadShard)
+
+/**
+ * The shards are handed out to the threads in round-robin order on
+ * their first allocation, so up to NUM_SHARDS threads never share
+ * a shard.
+ */
+static inline qint32 currentShard()
+{
+    ThreadShardHolder &holder = s_threadShard->localData();
+
+    if (holder.shard < 0) {
+        holder.shard = s_nextShard.fetchAndAddOrdered(1) % NUM_SHARDS;
+    }
+
+    return holder.shard;
+}
+
+struct Q_DECL_HIDDEN KisTileDataAllocator::Private
+{
+    struct Arena {
+        quint8 *data;
+        qint32 shard;
+
+        /**
+         * A set bit means the block is free. Guarded by
+         * the lock of the owning shard.
+         */
+        quint64 freeMask;
+    };
+
+    struct Shard {
+        Shard() {
+            for (qint32 i = 0; i < NUM_SIZE_CLASSES; i++) {
+                spareArenas[i] = 0;
+            }
+        }
+
+        QMutex lock;
+
+        /**
+         * The arenas of the shard having at least one free block
+         */
+        QVector<Arena*> availableArenas[NUM_SIZE_CLASSES];
+
+        /**
+         * A completely free arena is kept in the shard, so that
+         * a thread allocating and freeing a single tile doesn't
+         * malloc() and free() a whole arena every time. Any other
+         * arena is released as soon as it becomes free.
+         */
+        Arena *spareArenas[NUM_SIZE_CLASSES];
+    };
+
+    struct SizeClass {
+        /**
+         * All the arenas of the class indexed by their addresses,
+         * used to find the arena of a block being freed
+         */
+        QReadWriteLock arenasLock;
+        QMap<quint8*, Arena*> arenas;
+
+        QAtomicInt usedBlocks;
+        QAtomicInt numArenas;
+    };
+
+    Shard shards[NUM_SHARDS];
+    SizeClass sizeClasses[NUM_SIZE_CLASSES];
+
+    QAtomicInt firstTouch;
+
+    /**
+     * The size of the unpooled allocations in
+     * (KisTileData::WIDTH * KisTileData::HEIGHT) units
+     */
+    QAtomicInt unpooledMetric;
+
+    quint8* takeFreeBlock(qint32 shardIndex, qint32 sizeClass);
+    quint8* allocateArena(qint32 shardIndex, qint32 sizeClass);
+    void releaseArena(Arena *arena, qint32 sizeClass);
+};
+
+quint8* KisTileDataAllocator::Private::takeFreeBlock(qint32 shardIndex, qint32 sizeClass)
+{
+    Shard &shard = shards[shardIndex];
+    QMutexLocker l(&shard.lock);
+
+    QVector<Arena*> &arenas = shard.availableArenas[sizeClass];
+    if (arenas.isEmpty()) return 0;
+
+    Arena *arena = arenas.last();
+    const qint32 index = lowestBitIndex(arena->freeMask);
+
+    arena->freeMask &= ~(quint64(1) << index);
+
+    if (!arena->freeMask) {
+        arenas.removeLast();
+    }
+
+    if (shard.spareArenas[sizeClass] == arena) {
+        shard.spareArenas[sizeClass] = 0;
+    }
+
+    return arena->data + index * blockSize(sizeClass + 1);
+}
+
+quint8* KisTileDataAllocator::Private::allocateArena(qint32 shardIndex, qint32 sizeClass)
+{
+    const qint32 size = blockSize(sizeClass + 1);
+    quint8 *data = (quint8*) malloc(size * BLOCKS_PER_ARENA);
+    if (!data) return 0;
+
+    if (firstTouch.load()) {
+        memset(data, 0, size * BLOCKS_PER_ARENA);
+    }
+
+    Arena *arena = new Arena;
+    arena->data = data;
+    arena->shard = shardIndex;
+    arena->freeMask = FREE_ARENA_MASK & ~quint64(1);
+
+    {
+        SizeClass &sc = sizeClasses[sizeClass];
+        QWriteLocker l(&sc.arenasLock);
+        sc.arenas.insert(data, arena);
+        sc.numArenas.ref();
+    }
+
+    {
+        Shard &shard = shards[shardIndex];
+        QMutexLocker l(&shard.lock);
+        shard.availableArenas[sizeClass].append(arena);
+    }
+
+    return data;
+}
+
+void KisTileDataAllocator::Private::releaseArena(Arena *arena, qint32 sizeClass)
+{
+    {
+        SizeClass &sc = sizeClasses[sizeClass];
+        QWriteLocker l(&sc.arenasLock);
+        sc.arenas.remove(arena->data);
+        sc.numArenas.deref();
+    }
+
+    ::free(arena->data);
+    delete arena;
+}
+
+KisTileDataAllocator::KisTileDataAllocator()
+    : m_d(new Private)
+{
+}
+
+KisTileDataAllocator::~KisTileDataAllocator()
+{
+    for (qint32 i = 0; i < NUM_SIZE_CLASSES; i++) {
+        Q_FOREACH (Private::Arena *arena, m_d->sizeClasses[i].arenas) {
+            ::free(arena->data);
+            delete arena;
+        }
+    }
+}
+
+bool KisTileDataAllocator::isPooled(qint32 pixelSize)
+{
+    return pixelSize > 0 && pixelSize <= MAX_POOLED_PIXEL_SIZE;
+}
+
+quint8* KisTileDataAllocator::allocate(qint32 pixelSize)
+{
+    if (!isPooled(pixelSize)) {
+        m_d->unpooledMetric.fetchAndAddOrdered(pixelSize);
+        return (quint8*) malloc(blockSize(pixelSize));
+    }
+
+    const qint32 sizeClass = pixelSize - 1;
+    m_d->sizeClasses[sizeClass].usedBlocks.ref();
+
+    const qint32 ownShard = currentShard();
+    quint8 *ptr = m_d->takeFreeBlock(ownShard, sizeClass);
+
+    for (qint32 i = 1; !ptr && i < NUM_SHARDS; i++) {
+        ptr = m_d->takeFreeBlock((ownShard + i) % NUM_SHARDS, sizeClass);
+    }
+
+    if (!ptr) {
+        ptr = m_d->allocateArena(ownShard, sizeClass);
+    }
+
+    if (!ptr) {
+        m_d->sizeClasses[sizeClass].usedBlocks.deref();
+    }
+
+    return ptr;
+}
+
+void KisTileDataAllocator::free(quint8 *ptr, qint32 pixelSize)
+{
+    if (!isPooled(pixelSize)) {
+        m_d->unpooledMetric.fetchAndAddOrdered(-pixelSize);
+        ::free(ptr);
+        return;
+    }
+
+    const qint32 sizeClass = pixelSize - 1;
+    Private::SizeClass &sc = m_d->sizeClasses[sizeClass];
+
+    /**
+     * The arena cannot be released while our block is in use,
+     * so the pointer stays valid after unlocking
+     */
+    Private::Arena *arena = 0;
+    {
+        QReadLocker l(&sc.arenasLock);
+        QMap<quint8*, Private::Arena*>::const_iterator it = sc.arenas.upperBound(ptr);
+        KIS_ASSERT_RECOVER_RETURN(it != sc.arenas.constBegin());
+        arena = *(--it);
+    }
+
+    const qint32 index = (ptr - arena->data) / blockSize(pixelSize);
+    Private::Arena *releasedArena = 0;
+
+    {
+        Private::Shard &shard = m_d->shards[arena->shard];
+        QMutexLocker l(&shard.lock);
+
+        if (!arena->freeMask) {
+            shard.availableArenas[sizeClass].append(arena);
+        }
+
+        arena->freeMask |= quint64(1) << index;
+
+        if (arena->freeMask == FREE_ARENA_MASK) {
+            if (!shard.spareArenas[sizeClass]) {
+                shard.spareArenas[sizeClass] = arena;
+            } else {
+                shard.availableArenas[sizeClass].removeOne(arena);
+                releasedArena = arena;
+            }
+        }
+    }
+
+    sc.usedBlocks.deref();
+
+    if (releasedArena) {
+        m_d->releaseArena(releasedArena, sizeClass);
+    }
+}
+
+void KisTileDataAllocator::setFirstTouchEnabled(bool value)
+{
+    m_d->firstTouch.store(value);
+}
+
+bool KisTileDataAllocator::firstTouchEnabled() const
+{
+    return m_d->firstTouch.load();
+}
+
+void KisTileDataAllocator::releaseUnusedArenas()
+{
+    for (qint32 i = 0; i < NUM_SHARDS; i++) {
+        Private::Shard &shard = m_d->shards[i];
+
+        for (qint32 j = 0; j < NUM_SIZE_CLASSES; j++) {
+            Private::Arena *arena = 0;
+
+            {
+                QMutexLocker l(&shard.lock);
+                arena = shard.spareArenas[j];
+                if (!arena) continue;
+
+                shard.spareArenas[j] = 0;
+                shard.availableArenas[j].removeOne(arena);
+            }
+
+            m_d->releaseArena(arena, j);
+        }
+    }
+}
+
+KisTileDataAllocator::Statistics KisTileDataAllocator::statistics() const
+{
+    Statistics stats;
+    stats.reservedSize = 0;
+    stats.usedSize = 0;
+    stats.numArenas = 0;
+
+    for (qint32 i = 0; i < NUM_SIZE_CLASSES; i++) {
+        const Private::SizeClass &sc = m_d->sizeClasses[i];
+        const qint64 size = blockSize(i + 1);
+
+        const qint32 numArenas = sc.numArenas.load();
+        stats.numArenas += numArenas;
+        stats.reservedSize += size * BLOCKS_PER_ARENA * numArenas;
+        stats.usedSize += size * sc.usedBlocks.load();
+    }
+
+    stats.unpooledSize = qint64(m_d->unpooledMetric.load()) * KisTileData::WIDTH * KisTileData::HEIGHT;
+
+    return stats;
+}
@@ -0,0 +1,109 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_DATA_ALLOCATOR_H
+#define __KIS_TILE_DATA_ALLOCATOR_H
+
+#include <QtGlobal>
+#include <QScopedPointer>
+
+#include "kritaimage_export.h"
+
+/**
+ * Allocates the pixel buffers for KisTileData objects.
+ *
+ * Every pixel size up to MAX_POOLED_PIXEL_SIZE (128-bit RGBA) has its
+ * own size class. The buffers of a size class are cut from big arenas,
+ * so the heap is not fragmented by thousands of small allocations.
+ *
+ * The arenas are owned by a set of shards. Every thread is assigned
+ * its own shard on the first allocation, so the threads don't fight
+ * for a single lock and the buffers a thread allocates come from the
+ * arenas it created, which keeps them in the thread's cache and on its
+ * NUMA node. Other shards are accessed only when the own shard has
+ * nothing to offer. A freed buffer returns to the arena it was cut
+ * from, whatever thread frees it.
+ *
+ * An arena is returned to the system as soon as all its buffers are
+ * free. Only one such arena per shard and size class is kept as a
+ * spare, to avoid reallocating an arena on every allocation.
+ *
+ * With first-touch enabled, the arenas are faulted in by the thread
+ * that allocated them, so that the kernel places their pages on the
+ * node of that thread.
+ *
+ * Bigger pixel sizes are allocated with malloc() directly.
+ */
+class KRITAIMAGE_EXPORT KisTileDataAllocator
+{
+public:
+    static const qint32 MAX_POOLED_PIXEL_SIZE;
+    static const qint32 BLOCKS_PER_ARENA;
+
+    struct Statistics {
+        /**
+         * The memory occupied by the arenas
+         */
+        qint64 reservedSize;
+
+        /**
+         * The memory of the arenas given away to the tiles
+         */
+        qint64 usedSize;
+
+        /**
+         * The memory allocated for the pixel sizes
+         * not handled by the arenas
+         */
+        qint64 unpooledSize;
+
+        qint32 numArenas;
+
+        /**
+         * The part of the arenas which is not used by
+         * the tiles, [0...1]
+         */
+        qreal fragmentation() const {
+            return reservedSize > 0 ? qreal(reservedSize - usedSize) / reservedSize : 0.0;
+        }
+    };
+
+public:
+    KisTileDataAllocator();
+    ~KisTileDataAllocator();
+
+    static bool isPooled(qint32 pixelSize);
+
+    quint8* allocate(qint32 pixelSize);
+    void free(quint8 *ptr, qint32 pixelSize);
+
+    void setFirstTouchEnabled(bool value);
+    bool firstTouchEnabled() const;
+
+    /**
+     * Returns the spare arenas kept by the shards, which have
+     * no buffers in use, back to the system
+     */
+    void releaseUnusedArenas();
+
+    Statistics statistics() const;
+
+private:
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_TILE_DATA_ALLOCATOR_H */
@@ -20,6 +20,7 @@
 
 #include <QReadWriteLock>
 #include <QAtomicInt>
+#include <QAtomicInteger>
 
 #include "kis_lockless_stack.h"
 #include "swap/kis_chunk_allocator.h"
@@ -106,6 +107,14 @@ public:
     inline void blockSwapping();
     inline void unblockSwapping();
 
+    /**
+     * Blocks swapping only if the data is present in memory. Never
+     * loads the data from swap and doesn't count as an access to the
+     * tile data. Returns false if the data is swapped out, in this
+     * case the swapping is not blocked.
+     */
+    inline bool tryBlockSwapping();
+
     /**
      * The position of the tile data in a swap file
      */
@@ -139,6 +148,66 @@ public:
      */
      inline bool historical() const;
 
+    /**
+     * Show whether the tile data has been created filled with a
+     * single pixel value and is supposed to be shared between all
+     * the tiles having this value. The flag is dropped as soon as
+     * the data is modified in-place.
+     */
+    inline bool uniform() const;
+    inline void setUniform(bool value);
+
+    /**
+     * A 64-bit hash of the pixels of the tile data. It is
+     * calculated on the first request after the data has been
+     * written to, so unchanged tiles are never read again.
+     *
+     * Equal hashes don't guarantee equal content. The users that
+     * replace one tile data with another should compare the
+     * pixels when the hashes are equal.
+     *
+     * NOTE: the value is not cached while someone is writing
+     *       into the tile data, and the value returned during
+     *       the write is undefined
+     */
+    inline quint64 contentHash();
+    inline void invalidateContentHash();
+
+    /**
+     * The same as contentHash(), but should be called with the
+     * swapping blocked
+     */
+    inline quint64 contentHashSwappingBlocked();
+
+    /**
+     * The hash function used by contentHash(). \p size should
+     * be a multiple of 8 bytes.
+     */
+    static inline quint64 calculateContentHash(const quint8 *data, qint32 size);
+
+    /**
+     * A number identifying the current state of the pixels of the
+     * tile data. The numbers are never reused, so if the version of
+     * a tile has not changed, neither have its pixels. A new number
+     * is assigned on the first request after the data has been
+     * written to.
+     *
+     * NOTE: the value is not cached while someone is writing
+     *       into the tile data
+     */
+    inline quint64 version();
+    inline void invalidateVersion();
+
+    /**
+     * Called by KisTile when the data is locked/unlocked for
+     * writing. While there is at least one writer, neither the
+     * content hash nor the version are cached, and both are
+     * invalidated when the writer leaves, so the values calculated
+     * by concurrent readers can never outlive the write.
+     */
+    inline void beginWrite();
+    inline void endWrite();
+
     /**
      * Used for swapping purposes only.
      * Frees the memory occupied by the tile data.
@@ -160,7 +229,7 @@ public:
     /**
      * Releases internal pools, which keep blobs where the tiles are
      * stored.  The point is that we don't allocate the tiles from
-     * glibc directly, but use pools (implemented via boost) to
+     * glibc directly, but use arenas (see KisTileDataAllocator) to
      * allocate bigger chunks. This method should be called when one
      * knows that we have just free'd quite a lot of memory and we
      * won't need it anymore. E.g. when a document has been closed.
@@ -170,8 +239,8 @@ public:
 private:
     void fillWithPixel(const quint8 *defPixel);
 
-    static quint8* allocateData(const qint32 pixelSize);
-    static void freeData(quint8 *ptr, const qint32 pixelSize);
+    quint8* allocateData(const qint32 pixelSize);
+    void freeData(quint8 *ptr, const qint32 pixelSize);
 private:
     friend class KisTileDataPooler;
     friend class KisTileDataPoolerTest;
@@ -221,6 +290,38 @@ private:
      */
     qint32 m_mementoFlag;
 
+    /**
+     * The flag is set by KisTileDataStore::createUniformTileData()
+     * and reset by KisTile on the first in-place write. It is
+     * read by the pooler and the data managers concurrently
+     * with the writers, hence atomic.
+     */
+    QAtomicInt m_uniformFlag;
+
+    /**
+     * Cached value of contentHash(), valid
+     * only if m_contentHashValid is set
+     */
+    QAtomicInt m_contentHashValid;
+    quint64 m_contentHash;
+
+    /**
+     * Cached value of version(), valid only if
+     * m_versionValid is set
+     */
+    QAtomicInt m_versionValid;
+    quint64 m_version;
+    static QAtomicInteger<quint64> s_lastVersion;
+
+    /**
+     * The number of threads currently writing into the tile data
+     * and the number of writes ever started. The latter lets
+     * contentHash() notice a write that has started and finished
+     * while the hash was being calculated.
+     */
+    QAtomicInt m_writersCount;
+    QAtomicInt m_writesStarted;
+
     /**
      * Counts up time after last access to the tile data.
      * 0 - recently accessed
@@ -30,6 +30,7 @@ const qint32 KisTileDataPooler::MAX_NUM_CLONES = 16;
 const qint32 KisTileDataPooler::MAX_TIMEOUT = 60000; // 01m00s
 const qint32 KisTileDataPooler::MIN_TIMEOUT = 100; // 00m00.100s
 const qint32 KisTileDataPooler::TIMEOUT_FACTOR = 2;
+const qint32 KisTileDataPooler::MIN_ADAPTATION_SAMPLES = 64;
 
 //#define DEBUG_POOLER
 
@@ -94,6 +95,12 @@ KisTileDataPooler::KisTileDataPooler(KisTileDataStore *store, qint32 memoryLimit
     m_lastPoolMemoryMetric = 0;
     m_lastRealMemoryMetric = 0;
     m_lastHistoricalMemoryMetric = 0;
+    m_lastUniformSavedMemoryMetric = 0;
+
+    m_clonesCreated = 0;
+    m_lastCloneHits = 0;
+    m_lastCloneMisses = 0;
+    m_lastClonesCreated = 0;
 
     if(memoryLimit >= 0) {
         m_memoryLimit = memoryLimit;
@@ -102,6 +109,9 @@ KisTileDataPooler::KisTileDataPooler(KisTileDataStore *store, qint32 memoryLimit
         KisImageConfig config;
         m_memoryLimit = MiB_TO_METRIC(config.poolLimit());
     }
+
+    m_maxClonesPerTile.store(MAX_NUM_CLONES);
+    m_memoryBudget.store(m_memoryLimit);
 }
 
 KisTileDataPooler::~KisTileDataPooler()
@@ -127,12 +137,12 @@ qint32 KisTileDataPooler::numClonesNeeded(KisTileData *td) const
     RUNTIME_SANITY_CHECK(td);
     qint32 numUsers = td->m_usersCount;
     qint32 numPresentClones = td->m_clonesStack.size();
-    qint32 totalClones = qMin(numUsers - 1, MAX_NUM_CLONES);
+    qint32 totalClones = qMin(numUsers - 1, m_maxClonesPerTile.load());
 
     return totalClones - numPresentClones;
 }
 
-void KisTileDataPooler::cloneTileData(KisTileData *td, qint32 numClones) const
+void KisTileDataPooler::cloneTileData(KisTileData *td, qint32 numClones)
 {
     if (numClones > 0) {
         td->blockSwapping();
@@ -140,6 +150,7 @@ void KisTileDataPooler::cloneTileData(KisTileData *td, qint32 numClones) const
             td->m_clonesStack.push(new KisTileData(*td, false));
         }
         td->unblockSwapping();
+        m_clonesCreated += numClones;
     } else {
         qint32 numUnnededClones = qAbs(numClones);
         for (qint32 i = 0; i < numUnnededClones; i++) {
@@ -149,6 +160,7 @@ void KisTileDataPooler::cloneTileData(KisTileData *td, qint32 numClones) const
             if(!result) break;
 
             delete clone;
+            m_clonesWasted.ref();
         }
     }
 
@@ -200,19 +212,33 @@ void KisTileDataPooler::run()
 
         qint32 statRealMemory;
         qint32 statHistoricalMemory;
+        qint32 statUniformSavedMemory;
 
 
         getLists(iter, beggers, donors,
                  memoryOccupied,
                  statRealMemory,
-                 statHistoricalMemory);
+                 statHistoricalMemory,
+                 statUniformSavedMemory);
+
+        adaptBudget();
 
         m_lastCycleHadWork =
             processLists(beggers, donors, memoryOccupied);
 
+        /**
+         * The budget might have been decreased, so return
+         * the memory of the clones nobody needs
+         */
+        const qint32 budget = m_memoryBudget.load();
+        if (memoryOccupied > budget) {
+            memoryOccupied -= tryGetMemory(donors, memoryOccupied - budget);
+        }
+
         m_lastPoolMemoryMetric = memoryOccupied;
         m_lastRealMemoryMetric = statRealMemory;
         m_lastHistoricalMemoryMetric = statHistoricalMemory;
+        m_lastUniformSavedMemoryMetric = statUniformSavedMemory;
 
         m_store->endIteration(iter);
 
@@ -236,6 +262,78 @@ qint64 KisTileDataPooler::lastHistoricalMemoryMetric() const
     return m_lastHistoricalMemoryMetric;
 }
 
+qint64 KisTileDataPooler::lastUniformSavedMemoryMetric() const
+{
+    return m_lastUniformSavedMemoryMetric;
+}
+
+qint64 KisTileDataPooler::cloneHits() const
+{
+    return m_cloneHits.load();
+}
+
+qint64 KisTileDataPooler::cloneMisses() const
+{
+    return m_cloneMisses.load();
+}
+
+qint64 KisTileDataPooler::clonesWasted() const
+{
+    return m_clonesWasted.load();
+}
+
+qint32 KisTileDataPooler::maxClonesPerTile() const
+{
+    return m_maxClonesPerTile.load();
+}
+
+qint64 KisTileDataPooler::memoryBudgetMetric() const
+{
+    return m_memoryBudget.load();
+}
+
+qint64 KisTileDataPooler::spareMemoryMetric() const
+{
+    return m_memoryLimit - m_memoryBudget.load();
+}
+
+/**
+ * Adjusts the number of clones per tile and the memory budget of
+ * the pooler to the efficiency of the clones made since the previous
+ * adaptation. If most of the clones are thrown away unused, the
+ * memory is better given to the real tiles. If the painting threads
+ * have to copy the tiles themselves, the pooler should do more.
+ */
+void KisTileDataPooler::adaptBudget()
+{
+    const qint32 hits = m_cloneHits.load();
+    const qint32 misses = m_cloneMisses.load();
+
+    const qint32 hitsDelta = hits - m_lastCloneHits;
+    const qint32 missesDelta = misses - m_lastCloneMisses;
+    const qint32 createdDelta = m_clonesCreated - m_lastClonesCreated;
+
+    if (createdDelta + missesDelta < MIN_ADAPTATION_SAMPLES) return;
+
+    qint32 maxClones = m_maxClonesPerTile.load();
+    qint32 budget = m_memoryBudget.load();
+
+    if (createdDelta >= MIN_ADAPTATION_SAMPLES && hitsDelta < createdDelta / 4) {
+        maxClones = qMax(1, maxClones / 2);
+        budget = qMax(m_memoryLimit / 8, budget / 2);
+    } else if (missesDelta > hitsDelta) {
+        maxClones = qMin(MAX_NUM_CLONES, 2 * maxClones);
+        budget = qMin(m_memoryLimit, 2 * budget);
+    }
+
+    m_maxClonesPerTile.store(maxClones);
+    m_memoryBudget.store(budget);
+
+    m_lastCloneHits = hits;
+    m_lastCloneMisses = misses;
+    m_lastClonesCreated = m_clonesCreated;
+}
+
 inline int KisTileDataPooler::clonesMetric(KisTileData *td, int numClones) {
     return numClones * td->pixelSize();
 }
@@ -270,11 +368,13 @@ void KisTileDataPooler::getLists(Iter *iter,
                                  QList<KisTileData*> &donors,
                                  qint32 &memoryOccupied,
                                  qint32 &statRealMemory,
-                                 qint32 &statHistoricalMemory)
+                                 qint32 &statHistoricalMemory,
+                                 qint32 &statUniformSavedMemory)
 {
     memoryOccupied = 0;
     statRealMemory = 0;
     statHistoricalMemory = 0;
+    statUniformSavedMemory = 0;
 
     qint32 needMemoryTotal = 0;
     qint32 canDonorMemoryTotal = 0;
@@ -306,6 +406,10 @@ void KisTileDataPooler::getLists(Iter *iter,
         } else {
             statRealMemory += item->pixelSize();
         }
+
+        if (item->uniform() && item->numUsers() > 1) {
+            statUniformSavedMemory += (item->numUsers() - 1) * item->pixelSize();
+        }
     }
 
     DEBUG_LISTS(memoryOccupied,
@@ -345,8 +449,9 @@ bool KisTileDataPooler::processLists(QList<KisTileData*> &beggers,
         qint32 clonesNeeded = numClonesNeeded(item);
         qint32 clonesMemory = clonesMetric(item, clonesNeeded);
 
+        const qint32 budget = m_memoryBudget.load();
         qint32 memoryLeft =
-            m_memoryLimit - (memoryOccupied + clonesMemory);
+            budget - (memoryOccupied + clonesMemory);
 
         if(memoryLeft < 0) {
             qint32 freedMemory = tryGetMemory(donors, -memoryLeft);
@@ -354,7 +459,7 @@ bool KisTileDataPooler::processLists(QList<KisTileData*> &beggers,
 
             DEBUG_FREE_CLONE(freedMemory, memoryLeft);
 
-            if(m_memoryLimit < memoryOccupied + clonesMemory)
+            if(budget < memoryOccupied + clonesMemory)
                 break;
         }
 
@@ -394,4 +499,5 @@ void KisTileDataPooler::testingRereadConfig()
 {
     KisImageConfig config;
     m_memoryLimit = MiB_TO_METRIC(config.poolLimit());
+    m_memoryBudget.store(m_memoryLimit);
 }
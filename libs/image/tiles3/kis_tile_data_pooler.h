@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QThread>
 #include <QSemaphore>
+#include <QAtomicInt>
 
 class KisTileDataStore;
 class KisTileData;
@@ -43,6 +44,39 @@ public:
     qint64 lastPoolMemoryMetric() const;
     qint64 lastRealMemoryMetric() const;
     qint64 lastHistoricalMemoryMetric() const;
+    qint64 lastUniformSavedMemoryMetric() const;
+
+    /**
+     * Called by the store when a tile data is duplicated. A hit
+     * means a pre-made clone has been used, a miss means the copy
+     * had to be done synchronously.
+     */
+    inline void registerCloneHit() {
+        m_cloneHits.ref();
+    }
+
+    inline void registerCloneMiss() {
+        m_cloneMisses.ref();
+    }
+
+    qint64 cloneHits() const;
+    qint64 cloneMisses() const;
+    qint64 clonesWasted() const;
+
+    /**
+     * The maximum number of clones made for a single tile data
+     * and the memory the pooler allows itself to use at the
+     * moment. Both are adjusted to the hit rate of the clones.
+     */
+    qint32 maxClonesPerTile() const;
+    qint64 memoryBudgetMetric() const;
+
+    /**
+     * The part of the pool limit the pooler doesn't use
+     * because the clones are not efficient. The swapper lets
+     * the tiles occupy this memory.
+     */
+    qint64 spareMemoryMetric() const;
 
 protected:
     static const qint32 MAX_NUM_CLONES;
@@ -50,9 +84,12 @@ protected:
     static const qint32 MIN_TIMEOUT;
     static const qint32 TIMEOUT_FACTOR;
 
+    static const qint32 MIN_ADAPTATION_SAMPLES;
+
     void waitForWork();
+    void adaptBudget();
     qint32 numClonesNeeded(KisTileData *td) const;
-    void cloneTileData(KisTileData *td, qint32 numClones) const;
+    void cloneTileData(KisTileData *td, qint32 numClones);
     void run() override;
 
     inline int clonesMetric(KisTileData *td, int numClones);
@@ -68,7 +105,8 @@ protected:
                       QList<KisTileData*> &donors,
                       qint32 &memoryOccupied,
                       qint32 &statRealMemory,
-                      qint32 &statHistoricalMemory);
+                      qint32 &statHistoricalMemory,
+                      qint32 &statUniformSavedMemory);
 
     bool processLists(QList<KisTileData*> &beggers,
                       QList<KisTileData*> &donors,
@@ -86,6 +124,19 @@ protected:
     qint32 m_lastPoolMemoryMetric;
     qint32 m_lastRealMemoryMetric;
     qint32 m_lastHistoricalMemoryMetric;
+    qint32 m_lastUniformSavedMemoryMetric;
+
+    QAtomicInt m_cloneHits;
+    QAtomicInt m_cloneMisses;
+    QAtomicInt m_clonesWasted;
+    qint32 m_clonesCreated;
+
+    qint32 m_lastCloneHits;
+    qint32 m_lastCloneMisses;
+    qint32 m_lastClonesCreated;
+
+    QAtomicInt m_maxClonesPerTile;
+    QAtomicInt m_memoryBudget;
 };
 
 
@@ -24,6 +24,8 @@
 #include "kis_tile_data_store.h"
 #include "kis_tile_data.h"
 #include "kis_debug.h"
+#include "kis_image_config.h"
+#include "kis_update_time_monitor.h"
 
 #include "kis_tile_data_store_iterators.h"
 
@@ -69,16 +71,25 @@ qint64 __preclone_miss_age = 0;
 KisTileDataStore::KisTileDataStore()
     : m_pooler(this),
       m_swapper(this),
+      m_prefetcher(this),
+      m_compactor(),
       m_numTiles(0),
       m_memoryMetric(0)
 {
+    KisImageConfig config(true);
+    m_allocator.setFirstTouchEnabled(config.tileDataFirstTouch());
+
     m_clockIterator = m_tileDataList.end();
     m_pooler.start();
     m_swapper.start();
+    m_prefetcher.start();
+    m_compactor.start(QThread::LowestPriority);
 }
 
 KisTileDataStore::~KisTileDataStore()
 {
+    m_compactor.terminateCompactor();
+    m_prefetcher.terminatePrefetcher();
     m_pooler.terminatePooler();
     m_swapper.terminateSwapper();
 
@@ -110,6 +121,17 @@ KisTileDataStore::MemoryStatistics KisTileDataStore::memoryStatistics()
 
     stats.swapSize = m_swappedStore.totalMemoryMetric() * metricCoeff;
 
+    stats.uniformSavedSize = m_pooler.lastUniformSavedMemoryMetric() * metricCoeff;
+
+    stats.poolBudget = m_pooler.memoryBudgetMetric() * metricCoeff;
+    stats.poolCloneHits = m_pooler.cloneHits();
+    stats.poolCloneMisses = m_pooler.cloneMisses();
+    stats.poolClonesWasted = m_pooler.clonesWasted();
+
+    KisTileDataAllocator::Statistics allocatorStats = m_allocator.statistics();
+    stats.arenasReservedSize = allocatorStats.reservedSize;
+    stats.arenasUsedSize = allocatorStats.usedSize;
+
     return stats;
 }
 
@@ -160,12 +182,14 @@ KisTileData *KisTileDataStore::duplicateTileData(KisTileData *rhs)
     if (rhs->m_clonesStack.pop(td)) {
         DEBUG_PRECLONE_ACTION("+ Pre-clone HIT", rhs, td);
         DEBUG_COUNT_PRECLONE_HIT(rhs);
+        m_pooler.registerCloneHit();
     } else {
         rhs->blockSwapping();
         td = new KisTileData(*rhs);
         rhs->unblockSwapping();
         DEBUG_PRECLONE_ACTION("- Pre-clone #MISS#", rhs, td);
         DEBUG_COUNT_PRECLONE_MISS(rhs);
+        m_pooler.registerCloneMiss();
     }
 
     registerTileData(td);
@@ -226,6 +250,7 @@ void KisTileDataStore::ensureTileDataLoaded(KisTileData *td)
         if(!td->data()) {
             td->m_swapLock.lockForWrite();
 
+            KisUpdateTraceScope trace("swapper", "Swap in");
             m_swappedStore.swapInTileData(td);
             registerTileDataImp(td);
 
@@ -337,8 +362,12 @@ void KisTileDataStore::debugClear()
 }
 
 void KisTileDataStore::testingRereadConfig() {
+    KisImageConfig config(true);
+    m_allocator.setFirstTouchEnabled(config.tileDataFirstTouch());
+
     m_pooler.testingRereadConfig();
     m_swapper.testingRereadConfig();
+    m_prefetcher.testingRereadConfig();
     kickPooler();
 }
 
@@ -351,3 +380,8 @@ void KisTileDataStore::testingResumePooler()
 {
     m_pooler.start();
 }
+
+void KisTileDataStore::testingWaitForHistoryCompaction()
+{
+    m_compactor.testingWaitForDone();
+}
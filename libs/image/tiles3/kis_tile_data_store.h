@@ -22,10 +22,13 @@
 
 #include <QReadWriteLock>
 #include "kis_tile_data_interface.h"
+#include "kis_tile_data_allocator.h"
 
 #include "kis_tile_data_pooler.h"
+#include "kis_history_compactor.h"
 #include "swap/kis_tile_data_swapper.h"
 #include "swap/kis_swapped_data_store.h"
+#include "swap/kis_tile_prefetcher.h"
 
 class KisTileDataStoreIterator;
 class KisTileDataStoreReverseIterator;
@@ -50,7 +53,33 @@ public:
 
         qint64 poolSize;
 
+        /**
+         * Telemetry of the pooler: the memory it allows itself to
+         * use at the moment (adapted to the efficiency of the
+         * clones), the number of the duplications served by a
+         * pre-made clone or done synchronously, and the number of
+         * the clones freed without being used
+         */
+        qint64 poolBudget;
+        qint64 poolCloneHits;
+        qint64 poolCloneMisses;
+        qint64 poolClonesWasted;
+
         qint64 swapSize;
+
+        /**
+         * The amount of memory that would have been used if
+         * the tiles filled with a single color didn't share
+         * their data
+         */
+        qint64 uniformSavedSize;
+
+        /**
+         * Fragmentation of the tiles memory: the size of the arenas
+         * and the part of them actually used by the tiles
+         */
+        qint64 arenasReservedSize;
+        qint64 arenasUsedSize;
     };
 
     MemoryStatistics memoryStatistics();
@@ -70,10 +99,45 @@ public:
         return m_numTiles;
     }
 
+    /**
+     * The allocator for the pixel buffers of the tile data objects
+     * belonging to this store
+     */
+    inline KisTileDataAllocator* allocator() {
+        return &m_allocator;
+    }
+
     inline void checkFreeMemory() {
         m_swapper.checkFreeMemory();
     }
 
+    /**
+     * Returns true if at least one tile data is swapped out
+     */
+    inline bool hasSwappedTiles() const {
+        return m_swappedStore.numTiles() > 0;
+    }
+
+    /**
+     * Asks the store to load the data of the \p tiles from
+     * swap in a background thread
+     */
+    inline void prefetchTiles(const QVector<KisTileSP> &tiles) {
+        m_prefetcher.prefetch(tiles);
+    }
+
+    /**
+     * Asks the store to compact the history of \p mm in a
+     * background thread
+     */
+    inline void scheduleHistoryCompaction(KisMementoManager *mm) {
+        m_compactor.scheduleCompaction(mm);
+    }
+
+    inline void cancelHistoryCompaction(KisMementoManager *mm) {
+        m_compactor.cancelCompaction(mm);
+    }
+
     /**
      * \see m_memoryMetric
      */
@@ -81,6 +145,14 @@ public:
         return m_memoryMetric;
     }
 
+    /**
+     * The part of the pool memory that the pooler doesn't use,
+     * because the clones are inefficient. The tiles may occupy it.
+     */
+    inline qint64 poolSpareMemoryMetric() const {
+        return m_pooler.spareMemoryMetric();
+    }
+
     KisTileDataStoreIterator* beginIteration();
     void endIteration(KisTileDataStoreIterator* iterator);
 
@@ -94,6 +166,17 @@ public:
         return allocTileData(pixelSize, defPixel);
     }
 
+    /**
+     * Creates a tile data filled with \p pixel, which is supposed to
+     * be shared by all the tiles of the same uniform color. The
+     * memory saved by sharing is reported in memoryStatistics().
+     */
+    inline KisTileData* createUniformTileData(qint32 pixelSize, const quint8 *pixel) {
+        KisTileData *td = allocTileData(pixelSize, pixel);
+        td->setUniform(true);
+        return td;
+    }
+
     // Called by The Memento Manager after every commit
     inline void kickPooler() {
         m_pooler.kick();
@@ -148,12 +231,21 @@ private:
     friend class KisTiledDataManagerTest;
     void testingSuspendPooler();
     void testingResumePooler();
+    void testingWaitForHistoryCompaction();
 
     friend class KisLowMemoryBenchmark;
     void testingRereadConfig();
 private:
+    /**
+     * Should be destroyed after all the tile data objects are gone,
+     * so keep it the first member
+     */
+    KisTileDataAllocator m_allocator;
+
     KisTileDataPooler m_pooler;
     KisTileDataSwapper m_swapper;
+    KisTilePrefetcher m_prefetcher;
+    KisHistoryCompactor m_compactor;
 
     friend class KisTileDataStoreTest;
     friend class KisTileDataPoolerTest;
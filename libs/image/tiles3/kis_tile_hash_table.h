@@ -20,8 +20,21 @@
 #ifndef KIS_TILEHASHTABLE_H_
 #define KIS_TILEHASHTABLE_H_
 
+#include <QVector>
+
 #include "kis_tile.h"
 
+/**
+ * The number of independent locks guarding the buckets of the table.
+ * The buckets are spread over the stripes evenly, so the threads
+ * accessing different tiles of the same data manager (e.g. several
+ * KisUpdateJobItem's iterating the same layer) do not serialize on
+ * a single lock. Must be a power of two. Define it to 1 to get the
+ * old behavior with a single table-wide lock.
+ */
+#ifndef KIS_TILE_HASH_TABLE_LOCK_STRIPES
+#define KIS_TILE_HASH_TABLE_LOCK_STRIPES 16
+#endif
 
 
 /**
@@ -30,6 +43,12 @@
  * col()/row() methods and be able to answer setNext()/next() requests to
  * be   stored   here.    It   is   used   in   KisTiledDataManager   and
  * KisMementoManager.
+ *
+ * Every bucket of the table belongs to one of LOCK_STRIPES locks, so
+ * per-tile operations take only the lock of their own stripe. The
+ * operations touching the whole table (clear(), copying, iteration and
+ * changing the default tile data) take all the stripes in ascending
+ * order.
  */
 
 template<class T>
@@ -48,7 +67,7 @@ public:
     ~KisTileHashTableTraits();
 
     bool isEmpty() {
-        return !m_numTiles;
+        return !m_numTiles.load();
     }
 
     bool tileExists(qint32 col, qint32 row);
@@ -86,11 +105,19 @@ public:
 
     void clear();
 
+    /**
+     * Returns all the tiles of the table. Unlike the iterator, locks
+     * the table only for reading and only while the tiles are being
+     * collected, so the tiles can be processed without blocking the
+     * other users of the table.
+     */
+    QVector<TileTypeSP> tiles() const;
+
     void setDefaultTileData(KisTileData *defaultTileData);
     KisTileData* defaultTileData() const;
 
     qint32 numTiles() {
-        return m_numTiles;
+        return m_numTiles.load();
     }
 
     void debugPrintInfo();
@@ -106,6 +133,11 @@ private:
 
     static inline quint32 calculateHash(qint32 col, qint32 row);
 
+    inline QReadWriteLock* stripeLock(quint32 idx) const;
+    inline void lockAllForRead() const;
+    inline void lockAllForWrite() const;
+    inline void unlockAll() const;
+
     inline qint32 debugChainLen(qint32 idx);
     void debugListLengthDistibution();
     void sanityChecksumCheck();
@@ -113,13 +145,15 @@ private:
     template<class U> friend class KisTileHashTableIteratorTraits;
 
     static const qint32 TABLE_SIZE = 1024;
+    static const qint32 LOCK_STRIPES = KIS_TILE_HASH_TABLE_LOCK_STRIPES;
+
     TileTypeSP *m_hashTable;
-    qint32 m_numTiles;
+    QAtomicInt m_numTiles;
 
     KisTileData *m_defaultTileData;
     KisMementoManager *m_mementoManager;
 
-    mutable QReadWriteLock m_lock;
+    mutable QReadWriteLock m_locks[LOCK_STRIPES];
 };
 
 #include "kis_tile_hash_table_p.h"
@@ -141,16 +175,16 @@ public:
 
     KisTileHashTableIteratorTraits(KisTileHashTableTraits<T> *ht) {
         m_hashTable = ht;
+        m_hashTable->lockAllForWrite();
+
         m_index = nextNonEmptyList(0);
         if (m_index < KisTileHashTableTraits<T>::TABLE_SIZE)
             m_tile = m_hashTable->m_hashTable[m_index];
-
-        m_hashTable->m_lock.lockForWrite();
     }
 
     ~KisTileHashTableIteratorTraits<T>() {
         if (m_index != -1)
-            m_hashTable->m_lock.unlock();
+            m_hashTable->unlockAll();
     }
 
     KisTileHashTableIteratorTraits<T>& operator++() {
@@ -197,7 +231,7 @@ public:
 
     void destroy() {
         m_index = -1;
-        m_hashTable->m_lock.unlock();
+        m_hashTable->unlockAll();
     }
 protected:
     TileTypeSP m_tile;
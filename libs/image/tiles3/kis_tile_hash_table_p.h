@@ -26,12 +26,11 @@
 
 template<class T>
 KisTileHashTableTraits<T>::KisTileHashTableTraits(KisMementoManager *mm)
-        : m_lock(QReadWriteLock::NonRecursive)
 {
     m_hashTable = new TileTypeSP [TABLE_SIZE];
     Q_CHECK_PTR(m_hashTable);
 
-    m_numTiles = 0;
+    m_numTiles.store(0);
     m_defaultTileData = 0;
     m_mementoManager = mm;
 }
@@ -39,9 +38,8 @@ KisTileHashTableTraits<T>::KisTileHashTableTraits(KisMementoManager *mm)
 template<class T>
 KisTileHashTableTraits<T>::KisTileHashTableTraits(const KisTileHashTableTraits<T> &ht,
         KisMementoManager *mm)
-        : m_lock(QReadWriteLock::NonRecursive)
 {
-    QReadLocker locker(&ht.m_lock);
+    ht.lockAllForRead();
 
     m_mementoManager = mm;
     m_defaultTileData = 0;
@@ -68,7 +66,9 @@ KisTileHashTableTraits<T>::KisTileHashTableTraits(const KisTileHashTableTraits<T
 
         m_hashTable[i] = nativeTileHead;
     }
-    m_numTiles = ht.m_numTiles;
+    m_numTiles.store(ht.m_numTiles.load());
+
+    ht.unlockAll();
 }
 
 template<class T>
@@ -85,6 +85,36 @@ quint32 KisTileHashTableTraits<T>::calculateHash(qint32 col, qint32 row)
     return ((row << 5) + (col & 0x1F)) & 0x3FF;
 }
 
+template<class T>
+inline QReadWriteLock* KisTileHashTableTraits<T>::stripeLock(quint32 idx) const
+{
+    return &m_locks[idx & (LOCK_STRIPES - 1)];
+}
+
+template<class T>
+inline void KisTileHashTableTraits<T>::lockAllForRead() const
+{
+    for (qint32 i = 0; i < LOCK_STRIPES; i++) {
+        m_locks[i].lockForRead();
+    }
+}
+
+template<class T>
+inline void KisTileHashTableTraits<T>::lockAllForWrite() const
+{
+    for (qint32 i = 0; i < LOCK_STRIPES; i++) {
+        m_locks[i].lockForWrite();
+    }
+}
+
+template<class T>
+inline void KisTileHashTableTraits<T>::unlockAll() const
+{
+    for (qint32 i = LOCK_STRIPES - 1; i >= 0; i--) {
+        m_locks[i].unlock();
+    }
+}
+
 template<class T>
 typename KisTileHashTableTraits<T>::TileTypeSP
 KisTileHashTableTraits<T>::getTile(qint32 col, qint32 row)
@@ -116,7 +146,7 @@ void KisTileHashTableTraits<T>::linkTile(TileTypeSP tile)
 
     tile->setNext(firstTile);
     m_hashTable[idx] = tile;
-    m_numTiles++;
+    m_numTiles.ref();
 }
 
 template<class T>
@@ -146,7 +176,7 @@ KisTileHashTableTraits<T>::unlinkTile(qint32 col, qint32 row)
             tile->notifyDead();
             tile = TileTypeSP();
 
-            m_numTiles--;
+            m_numTiles.deref();
             return tile;
         }
         prevTile = tile;
@@ -179,7 +209,7 @@ inline KisTileData* KisTileHashTableTraits<T>::defaultTileDataImp() const
 template<class T>
 bool KisTileHashTableTraits<T>::tileExists(qint32 col, qint32 row)
 {
-    QReadLocker locker(&m_lock);
+    QReadLocker locker(stripeLock(calculateHash(col, row)));
     return getTile(col, row);
 }
 
@@ -187,7 +217,7 @@ template<class T>
 typename KisTileHashTableTraits<T>::TileTypeSP
 KisTileHashTableTraits<T>::getExistedTile(qint32 col, qint32 row)
 {
-    QReadLocker locker(&m_lock);
+    QReadLocker locker(stripeLock(calculateHash(col, row)));
     return getTile(col, row);
 }
 
@@ -196,12 +226,22 @@ typename KisTileHashTableTraits<T>::TileTypeSP
 KisTileHashTableTraits<T>::getTileLazy(qint32 col, qint32 row,
                                        bool& newTile)
 {
+    QReadWriteLock *lock = stripeLock(calculateHash(col, row));
+    newTile = false;
+
     /**
-     * FIXME: Read access is better
+     * Most of the requests are for already existing tiles, so try
+     * to find the tile with read access first and upgrade the lock
+     * only when a new tile should actually be linked in
      */
-    QWriteLocker locker(&m_lock);
+    {
+        QReadLocker locker(lock);
+        TileTypeSP tile = getTile(col, row);
+        if (tile) return tile;
+    }
+
+    QWriteLocker locker(lock);
 
-    newTile = false;
     TileTypeSP tile = getTile(col, row);
     if (!tile) {
         tile = new TileType(col, row, m_defaultTileData, m_mementoManager);
@@ -216,7 +256,7 @@ template<class T>
 typename KisTileHashTableTraits<T>::TileTypeSP
 KisTileHashTableTraits<T>::getReadOnlyTileLazy(qint32 col, qint32 row)
 {
-    QReadLocker locker(&m_lock);
+    QReadLocker locker(stripeLock(calculateHash(col, row)));
 
     TileTypeSP tile = getTile(col, row);
     if (!tile)
@@ -228,14 +268,14 @@ KisTileHashTableTraits<T>::getReadOnlyTileLazy(qint32 col, qint32 row)
 template<class T>
 void KisTileHashTableTraits<T>::addTile(TileTypeSP tile)
 {
-    QWriteLocker locker(&m_lock);
+    QWriteLocker locker(stripeLock(calculateHash(tile->col(), tile->row())));
     linkTile(tile);
 }
 
 template<class T>
 void KisTileHashTableTraits<T>::deleteTile(qint32 col, qint32 row)
 {
-    QWriteLocker locker(&m_lock);
+    QWriteLocker locker(stripeLock(calculateHash(col, row)));
 
     TileTypeSP tile = unlinkTile(col, row);
 
@@ -251,10 +291,31 @@ void KisTileHashTableTraits<T>::deleteTile(TileTypeSP tile)
     deleteTile(tile->col(), tile->row());
 }
 
+template<class T>
+QVector<typename KisTileHashTableTraits<T>::TileTypeSP>
+KisTileHashTableTraits<T>::tiles() const
+{
+    QVector<TileTypeSP> result;
+
+    lockAllForRead();
+
+    result.reserve(m_numTiles.load());
+
+    for (qint32 i = 0; i < TABLE_SIZE; i++) {
+        for (TileTypeSP tile = m_hashTable[i]; tile; tile = tile->next()) {
+            result.append(tile);
+        }
+    }
+
+    unlockAll();
+
+    return result;
+}
+
 template<class T>
 void KisTileHashTableTraits<T>::clear()
 {
-    QWriteLocker locker(&m_lock);
+    lockAllForWrite();
     TileTypeSP tile = TileTypeSP();
     qint32 i;
 
@@ -273,26 +334,33 @@ void KisTileHashTableTraits<T>::clear()
             tmp->notifyDead();
             tmp = 0;
 
-            m_numTiles--;
+            m_numTiles.deref();
         }
 
         m_hashTable[i] = 0;
     }
 
-    Q_ASSERT(!m_numTiles);
+    Q_ASSERT(!m_numTiles.load());
+
+    unlockAll();
 }
 
 template<class T>
 void KisTileHashTableTraits<T>::setDefaultTileData(KisTileData *defaultTileData)
 {
-    QWriteLocker locker(&m_lock);
+    lockAllForWrite();
     setDefaultTileDataImp(defaultTileData);
+    unlockAll();
 }
 
 template<class T>
 KisTileData* KisTileHashTableTraits<T>::defaultTileData() const
 {
-    QWriteLocker locker(&m_lock);
+    /**
+     * The default tile data is changed with all the stripes locked,
+     * so holding any of them is enough for reading it
+     */
+    QReadLocker locker(stripeLock(0));
     return defaultTileDataImp();
 }
 
@@ -305,7 +373,7 @@ void KisTileHashTableTraits<T>::debugPrintInfo()
     dbgTiles << "==========================\n"
              << "TileHashTable:"
              << "\n   def. data:\t\t" << m_defaultTileData
-             << "\n   numTiles:\t\t" << m_numTiles;
+             << "\n   numTiles:\t\t" << m_numTiles.load();
     debugListLengthDistibution();
     dbgTiles << "==========================\n";
 }
@@ -323,7 +391,7 @@ void KisTileHashTableTraits<T>::debugMaxListLength(qint32 &min, qint32 &max)
 {
     TileTypeSP tile;
     qint32 maxLen = 0;
-    qint32 minLen = m_numTiles;
+    qint32 minLen = m_numTiles.load();
     qint32 tmp = 0;
 
     for (qint32 i = 0; i < TABLE_SIZE; i++) {
@@ -373,7 +441,7 @@ void KisTileHashTableTraits<T>::sanityChecksumCheck()
      * We assume that the lock should have already been taken
      * by the code that was going to change the table
      */
-    Q_ASSERT(!m_lock.tryLockForWrite());
+    Q_ASSERT(!m_locks[0].tryLockForWrite());
 
     TileTypeSP tile = 0;
     qint32 exactNumTiles = 0;
@@ -386,10 +454,10 @@ void KisTileHashTableTraits<T>::sanityChecksumCheck()
         }
     }
 
-    if (exactNumTiles != m_numTiles) {
+    if (exactNumTiles != m_numTiles.load()) {
         dbgKrita << "Sanity check failed!";
         dbgKrita << ppVar(exactNumTiles);
-        dbgKrita << ppVar(m_numTiles);
+        dbgKrita << ppVar(m_numTiles.load());
         dbgKrita << "Wrong tiles checksum!";
         Q_ASSERT(0); // not fatalKrita for a backtrace support
     }
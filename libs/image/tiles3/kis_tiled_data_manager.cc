@@ -20,6 +20,9 @@
 
 #include <QRect>
 #include <QVector>
+#include <QHash>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "kis_tile.h"
 #include "kis_tiled_data_manager.h"
@@ -32,8 +35,74 @@
 #include "kis_paint_device_writer.h"
 
 #include "kis_global.h"
+#include "kis_image_config.h"
 
 
+namespace {
+
+/**
+ * The number of tiles compressed by one thread in one go when
+ * saving the data manager
+ */
+const int TILES_PER_COMPRESSION_CHUNK = 64;
+
+class KisByteArrayPaintDeviceWriter : public KisPaintDeviceWriter
+{
+public:
+    KisByteArrayPaintDeviceWriter(QByteArray *array) : m_array(array) {}
+
+    bool write(const QByteArray &data) override {
+        m_array->append(data);
+        return true;
+    }
+
+    bool write(const char* data, qint64 length) override {
+        m_array->append(data, length);
+        return true;
+    }
+
+private:
+    QByteArray *m_array;
+};
+
+struct KisTileCompressionJob {
+    KisTileCompressionJob() : result(false) {}
+    KisTileCompressionJob(const QVector<KisTileSP> &_tiles) : tiles(_tiles), result(false) {}
+
+    QVector<KisTileSP> tiles;
+    QByteArray data;
+    bool result;
+};
+
+struct KisTileCompressionFunctor {
+    KisTileCompressionFunctor(qint32 version, const QString &compressionName)
+        : m_version(version), m_compressionName(compressionName) {}
+
+    void operator() (KisTileCompressionJob &job) {
+        /**
+         * Compressors keep internal work buffers, so every
+         * chunk needs its own one
+         */
+        KisAbstractTileCompressorSP compressor =
+            KisTileCompressorFactory::create(m_version, m_compressionName);
+
+        KisByteArrayPaintDeviceWriter writer(&job.data);
+
+        job.result = true;
+        Q_FOREACH (KisTileSP tile, job.tiles) {
+            if (!compressor->writeTile(tile, writer)) {
+                job.result = false;
+                break;
+            }
+        }
+    }
+
+    qint32 m_version;
+    QString m_compressionName;
+};
+
+}
+
 /* The data area is divided into tiles each say 64x64 pixels (defined at compiletime)
  * The tiles are laid out in a matrix that can have negative indexes.
  * The matrix grows automatically if needed (a call for writeacces to a tile
@@ -57,6 +126,7 @@ KisTiledDataManager::KisTiledDataManager(quint32 pixelSize,
     m_extentMinY = qint32_MAX;
     m_extentMaxX = qint32_MIN;
     m_extentMaxY = qint32_MIN;
+    m_needsRecalculateExtent = false;
 }
 
 KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
@@ -81,6 +151,7 @@ KisTiledDataManager::KisTiledDataManager(const KisTiledDataManager &dm)
     m_extentMinY = dm.m_extentMinY;
     m_extentMaxX = dm.m_extentMaxX;
     m_extentMaxY = dm.m_extentMaxY;
+    m_needsRecalculateExtent = dm.m_needsRecalculateExtent.load();
 }
 
 KisTiledDataManager::~KisTiledDataManager()
@@ -130,19 +201,54 @@ bool KisTiledDataManager::write(KisPaintDeviceWriter &store)
     }
 
 
-    KisTileHashTableIterator iter(m_hashTable);
-    KisTileSP tile;
+    QVector<KisTileSP> tiles;
+    tiles.reserve(m_hashTable->numTiles());
 
-    KisAbstractTileCompressorSP compressor =
-        KisTileCompressorFactory::create(CURRENT_VERSION);
+    {
+        KisTileHashTableIterator iter(m_hashTable);
+        KisTileSP tile;
 
-    while ((tile = iter.tile())) {
-        retval = compressor->writeTile(tile, store);
-        if (!retval) {
-            warnFile << "Failed to write tile";
-            break;
+        while ((tile = iter.tile())) {
+            tiles.append(tile);
+            ++iter;
+        }
+    }
+
+    KisImageConfig cfg(true);
+    const QString compressionName = cfg.saveCompression();
+
+    /**
+     * The tiles are compressed in parallel in batches of limited
+     * size, so that we don't keep the whole compressed layer in
+     * memory. Inside a batch every thread gets a contiguous chunk
+     * of tiles, and the results are written in the original order,
+     * so the stream is byte-identical to the sequential one.
+     */
+    const int numThreads = qMax(1, QThread::idealThreadCount());
+    const int chunkSize = TILES_PER_COMPRESSION_CHUNK;
+    const int batchSize = numThreads * chunkSize;
+
+    for (int batchStart = 0; batchStart < tiles.size() && retval; batchStart += batchSize) {
+        const int batchEnd = qMin(batchStart + batchSize, tiles.size());
+
+        QVector<KisTileCompressionJob> jobs;
+        for (int i = batchStart; i < batchEnd; i += chunkSize) {
+            jobs.append(KisTileCompressionJob(tiles.mid(i, qMin(chunkSize, batchEnd - i))));
+        }
+
+        if (jobs.size() > 1) {
+            QtConcurrent::blockingMap(jobs, KisTileCompressionFunctor(CURRENT_VERSION, compressionName));
+        } else {
+            KisTileCompressionFunctor(CURRENT_VERSION, compressionName)(jobs.first());
+        }
+
+        Q_FOREACH (const KisTileCompressionJob &job, jobs) {
+            retval = job.result && store.write(job.data);
+            if (!retval) {
+                warnFile << "Failed to write tile";
+                break;
+            }
         }
-        ++iter;
     }
 
     return retval;
@@ -278,13 +384,52 @@ wrongString:
     return false;
 }
 
+void KisTiledDataManager::prefetchTiles(const QRect &rect)
+{
+    KisTileDataStore *store = KisTileDataStore::instance();
+    if (rect.isEmpty() || !store->hasSwappedTiles()) return;
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    QVector<KisTileSP> tiles;
+
+    for (qint32 row = firstRow; row <= lastRow; ++row) {
+        for (qint32 column = firstColumn; column <= lastColumn; ++column) {
+            KisTileSP tile = m_hashTable->getExistedTile(column, row);
+            if (tile) {
+                tiles.append(tile);
+            }
+        }
+    }
+
+    if (!tiles.isEmpty()) {
+        store->prefetchTiles(tiles);
+    }
+}
+
+/**
+ * Returns true if all the pixels of the tile are equal to the
+ * first one. A buffer equal to itself shifted by one pixel is
+ * periodic with the pixel period, that is, uniform.
+ */
+inline bool isUniformTileData(const quint8 *data, const qint32 tileDataSize, const qint32 pixelSize)
+{
+    return memcmp(data, data + pixelSize, tileDataSize - pixelSize) == 0;
+}
+
 void KisTiledDataManager::purge(const QRect& area)
 {
     QWriteLocker locker(&m_lock);
 
+    const qint32 pixelSize = this->pixelSize();
+
     QList<KisTileSP> tilesToDelete;
+    QList<KisTileSP> uniformTiles;
     {
-        const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize();
+        const qint32 tileDataSize = KisTileData::HEIGHT * KisTileData::WIDTH * pixelSize;
         KisTileData *tileData = m_hashTable->defaultTileData();
         tileData->blockSwapping();
         const quint8 *defaultData = tileData->data();
@@ -297,6 +442,8 @@ void KisTiledDataManager::purge(const QRect& area)
                 tile->lockForRead();
                 if(memcmp(defaultData, tile->data(), tileDataSize) == 0) {
                     tilesToDelete.push_back(tile);
+                } else if (isUniformTileData(tile->data(), tileDataSize, pixelSize)) {
+                    uniformTiles.push_back(tile);
                 }
                 tile->unlock();
             }
@@ -309,6 +456,47 @@ void KisTiledDataManager::purge(const QRect& area)
         m_hashTable->deleteTile(tile);
     }
 
+    /**
+     * Tiles filled with the same non-default color are made to
+     * share a single tile data. It is copied-on-write as soon as
+     * someone starts painting on any of them.
+     */
+    if (uniformTiles.size() > 1) {
+        QHash<QByteArray, KisTileData*> sharedData;
+
+        Q_FOREACH (KisTileSP tile, uniformTiles) {
+            tile->lockForRead();
+            KisTileData *td = tile->tileData();
+            const QByteArray pixel((const char*)tile->data(), pixelSize);
+            const bool isShared = td->uniform();
+            tile->unlock();
+
+            KisTileData *&shared = sharedData[pixel];
+
+            if (!shared) {
+                if (isShared) {
+                    shared = td;
+                    shared->acquire();
+                    continue;
+                }
+
+                shared = KisTileDataStore::instance()->
+                    createUniformTileData(pixelSize, (const quint8*)pixel.constData());
+                shared->acquire();
+            }
+
+            if (td == shared) continue;
+
+            m_hashTable->deleteTile(tile);
+            KisTileSP sharedTile(new KisTile(tile->col(), tile->row(), shared, m_mementoManager));
+            m_hashTable->addTile(sharedTile);
+        }
+
+        Q_FOREACH (KisTileData *td, sharedData) {
+            td->release();
+        }
+    }
+
     recalculateExtent();
 }
 
@@ -325,6 +513,163 @@ quint8* KisTiledDataManager::duplicatePixel(qint32 num, const quint8 *pixel)
     return dstBuf;
 }
 
+quint64 KisTiledDataManager::contentHash() const
+{
+    QReadLocker locker(&m_lock);
+
+    quint64 result = qHashBits(m_defaultPixel, pixelSize());
+
+    /**
+     * The tiles are hashed after the table has been unlocked, so the
+     * painters creating new tiles are not blocked while we read the
+     * changed ones. The order of the tiles depends on the history of
+     * the hash table, so their hashes are combined in an
+     * order-independent way.
+     */
+    Q_FOREACH (const KisTileSP &tile, m_hashTable->tiles()) {
+        quint64 value = tile->tileData()->contentHash();
+        value ^= quint64(quint32(tile->col())) * 0x9e3779b97f4a7c15ULL;
+        value ^= quint64(quint32(tile->row())) * 0xc2b2ae3d27d4eb4fULL;
+        value *= 0xff51afd7ed558ccdULL;
+        result += value ^ (value >> 33);
+    }
+
+    return result;
+}
+
+namespace {
+inline quint64 tileKey(qint32 col, qint32 row) {
+    return (quint64(quint32(col)) << 32) | quint32(row);
+}
+}
+
+QRegion KisTiledDataManager::changedRegion(const TileVersions &oldVersions, TileVersions *newVersions) const
+{
+    QReadLocker locker(&m_lock);
+
+    QRegion region;
+    newVersions->clear();
+    newVersions->reserve(oldVersions.size());
+
+    Q_FOREACH (const KisTileSP &tile, m_hashTable->tiles()) {
+        const quint64 key = tileKey(tile->col(), tile->row());
+        const quint64 version = tile->tileData()->version();
+
+        newVersions->insert(key, version);
+
+        if (oldVersions.value(key, 0) != version) {
+            region += tile->extent();
+        }
+    }
+
+    // the removed tiles are reset to the default pixel
+    for (auto it = oldVersions.constBegin(); it != oldVersions.constEnd(); ++it) {
+        if (!newVersions->contains(it.key())) {
+            const qint32 col = qint32(it.key() >> 32);
+            const qint32 row = qint32(quint32(it.key()));
+
+            region += QRect(col * KisTileData::WIDTH, row * KisTileData::HEIGHT,
+                            KisTileData::WIDTH, KisTileData::HEIGHT);
+        }
+    }
+
+    return region;
+}
+
+QRegion KisTiledDataManager::changedRegion(const QRect &rect, TileVersions *versions) const
+{
+    QReadLocker locker(&m_lock);
+
+    QRegion region;
+    if (rect.isEmpty()) return region;
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    for (qint32 row = firstRow; row <= lastRow; row++) {
+        for (qint32 column = firstColumn; column <= lastColumn; column++) {
+            const quint64 key = tileKey(column, row);
+            KisTileSP tile = m_hashTable->getExistedTile(column, row);
+
+            auto it = versions->find(key);
+
+            if (tile) {
+                const quint64 version = tile->tileData()->version();
+
+                if (it == versions->end() || *it != version) {
+                    versions->insert(key, version);
+                    region += tile->extent();
+                }
+            } else if (it != versions->end()) {
+                versions->erase(it);
+                region += QRect(column * KisTileData::WIDTH, row * KisTileData::HEIGHT,
+                                KisTileData::WIDTH, KisTileData::HEIGHT);
+            }
+        }
+    }
+
+    return region;
+}
+
+QRegion KisTiledDataManager::changedContentRegion(const QRect &rect, TileContents *contents) const
+{
+    QReadLocker locker(&m_lock);
+
+    QRegion region;
+    if (rect.isEmpty()) return region;
+
+    const qint32 firstColumn = xToCol(rect.left());
+    const qint32 lastColumn = xToCol(rect.right());
+    const qint32 firstRow = yToRow(rect.top());
+    const qint32 lastRow = yToRow(rect.bottom());
+
+    for (qint32 row = firstRow; row <= lastRow; row++) {
+        for (qint32 column = firstColumn; column <= lastColumn; column++) {
+            const quint64 key = tileKey(column, row);
+            KisTileSP tile = m_hashTable->getExistedTile(column, row);
+
+            auto it = contents->find(key);
+
+            if (tile) {
+                KisTileData *td = tile->tileData();
+
+                /**
+                 * The version must be fetched before the hash. If the
+                 * tile is written in between, we store the old version
+                 * with the new hash and just read the tile once more
+                 * next time. In the reverse order we would store the
+                 * new version with the old hash and miss the change.
+                 */
+                const quint64 version = td->version();
+
+                if (it != contents->end() && it->version == version) continue;
+
+                const quint64 hash = td->contentHash();
+
+                if (it == contents->end()) {
+                    TileContent content = {version, hash};
+                    contents->insert(key, content);
+                    region += tile->extent();
+                } else {
+                    if (it->hash != hash) {
+                        region += tile->extent();
+                    }
+                    it->version = version;
+                    it->hash = hash;
+                }
+            } else if (it != contents->end()) {
+                contents->erase(it);
+                region += QRect(column * KisTileData::WIDTH, row * KisTileData::HEIGHT,
+                                KisTileData::WIDTH, KisTileData::HEIGHT);
+            }
+        }
+    }
+
+    return region;
+}
+
 void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
 {
     QWriteLocker locker(&m_lock);
@@ -348,6 +693,7 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
     }
 
     if (pixelBytesAreDefault) {
+        recalculateExtentIfNeeded();
         clearRect &= extentImpl();
     }
 
@@ -369,12 +715,10 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
         clearRect.width() >= KisTileData::WIDTH &&
         clearRect.height() >= KisTileData::HEIGHT) {
 
-        td = KisTileDataStore::instance()->createDefaultTileData(pixelSize, clearPixel);
+        td = KisTileDataStore::instance()->createUniformTileData(pixelSize, clearPixel);
         td->acquire();
     }
 
-    bool needsRecalculateExtent = false;
-
     for (qint32 row = firstRow; row <= lastRow; ++row) {
         for (qint32 column = firstColumn; column <= lastColumn; ++column) {
 
@@ -385,7 +729,7 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
             if (clearTileRect == tileRect) {
                  // Clear whole tile
                  m_hashTable->deleteTile(column, row);
-                 needsRecalculateExtent = true;
+                 m_needsRecalculateExtent = true;
 
                  if (!pixelBytesAreDefault) {
                      KisTileSP clearedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
@@ -419,10 +763,6 @@ void KisTiledDataManager::clear(QRect clearRect, const quint8 *clearPixel)
         }
     }
 
-    if (needsRecalculateExtent) {
-        recalculateExtent();
-    }
-
     if (td) td->release();
     delete[] clearPixelData;
 }
@@ -450,10 +790,12 @@ void KisTiledDataManager::clear()
 
     m_hashTable->clear();
 
+    QMutexLocker extentLocker(&m_extentMutex);
     m_extentMinX = qint32_MAX;
     m_extentMinY = qint32_MAX;
     m_extentMaxX = qint32_MIN;
     m_extentMaxY = qint32_MIN;
+    m_needsRecalculateExtent = false;
 }
 
 
@@ -473,6 +815,8 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
     qint32 firstRow = yToRow(rect.top());
     qint32 lastRow = yToRow(rect.bottom());
 
+    const bool defaultPixelsMatch = !memcmp(srcDM->m_defaultPixel, m_defaultPixel, pixelSize);
+
     for (qint32 row = firstRow; row <= lastRow; ++row) {
         for (qint32 column = firstColumn; column <= lastColumn; ++column) {
 
@@ -489,6 +833,11 @@ void KisTiledDataManager::bitBltImpl(KisTiledDataManager *srcDM, const QRect &re
                  // Clone whole tile
                  m_hashTable->deleteTile(column, row);
 
+                 if (srcDM->isDefaultTile(srcTile, defaultPixelsMatch)) {
+                     m_needsRecalculateExtent = true;
+                     continue;
+                 }
+
                  srcTile->lockForRead();
                  KisTileData *td = srcTile->tileData();
                  KisTileSP clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
@@ -535,6 +884,8 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
     qint32 firstRow = yToRow(rect.top());
     qint32 lastRow = yToRow(rect.bottom());
 
+    const bool defaultPixelsMatch = !memcmp(srcDM->m_defaultPixel, m_defaultPixel, pixelSize());
+
     for (qint32 row = firstRow; row <= lastRow; ++row) {
         for (qint32 column = firstColumn; column <= lastColumn; ++column) {
 
@@ -550,6 +901,11 @@ void KisTiledDataManager::bitBltRoughImpl(KisTiledDataManager *srcDM, const QRec
 
             m_hashTable->deleteTile(column, row);
 
+            if (srcDM->isDefaultTile(srcTile, defaultPixelsMatch)) {
+                m_needsRecalculateExtent = true;
+                continue;
+            }
+
             srcTile->lockForRead();
             KisTileData *td = srcTile->tileData();
             KisTileSP clonedTile = KisTileSP(new KisTile(column, row, td, m_mementoManager));
@@ -628,7 +984,7 @@ void KisTiledDataManager::setExtent(QRect newRect)
                         }
                     }
                 }
-                tile->unlock();
+                tile->unlockForWrite();
                 ++iter;
             } else {
                 iter.deleteCurrent();
@@ -641,20 +997,52 @@ void KisTiledDataManager::setExtent(QRect newRect)
 
 void KisTiledDataManager::recalculateExtent()
 {
-    m_extentMinX = qint32_MAX;
-    m_extentMinY = qint32_MAX;
-    m_extentMaxX = qint32_MIN;
-    m_extentMaxY = qint32_MIN;
+    QMutexLocker locker(&m_extentMutex);
+    recalculateExtentImpl();
+}
 
-    KisTileHashTableIterator iter(m_hashTable);
-    KisTileSP tile;
+void KisTiledDataManager::recalculateExtentIfNeeded()
+{
+    if (!m_needsRecalculateExtent.loadAcquire()) return;
 
-    while ((tile = iter.tile())) {
-        updateExtent(tile->col(), tile->row());
-        ++iter;
+    QMutexLocker locker(&m_extentMutex);
+    if (m_needsRecalculateExtent.loadAcquire()) {
+        recalculateExtentImpl();
     }
 }
 
+void KisTiledDataManager::recalculateExtentImpl()
+{
+    /**
+     * Can be called by several readers concurrently, so the tiles are
+     * taken from a snapshot of the hash table. m_extentMutex is held
+     * by the caller for the whole pass, so a tile created by an
+     * iterator after the snapshot will extend the recalculated extent
+     * in updateExtent() rather than be overwritten by it.
+     */
+    qint32 minX = qint32_MAX;
+    qint32 minY = qint32_MAX;
+    qint32 maxX = qint32_MIN;
+    qint32 maxY = qint32_MIN;
+
+    Q_FOREACH (KisTileSP tile, m_hashTable->tiles()) {
+        const qint32 tileMinX = tile->col() * KisTileData::WIDTH;
+        const qint32 tileMinY = tile->row() * KisTileData::HEIGHT;
+
+        minX = qMin(minX, tileMinX);
+        maxX = qMax(maxX, tileMinX + KisTileData::WIDTH - 1);
+        minY = qMin(minY, tileMinY);
+        maxY = qMax(maxY, tileMinY + KisTileData::HEIGHT - 1);
+    }
+
+    m_extentMinX = minX;
+    m_extentMinY = minY;
+    m_extentMaxX = maxX;
+    m_extentMaxY = maxY;
+
+    m_needsRecalculateExtent.storeRelease(false);
+}
+
 void KisTiledDataManager::updateExtent(qint32 col, qint32 row)
 {
     const qint32 tileMinX = col * KisTileData::WIDTH;
@@ -662,6 +1050,7 @@ void KisTiledDataManager::updateExtent(qint32 col, qint32 row)
     const qint32 tileMaxX = tileMinX + KisTileData::WIDTH - 1;
     const qint32 tileMaxY = tileMinY + KisTileData::HEIGHT - 1;
 
+    QMutexLocker locker(&m_extentMutex);
     m_extentMinX = qMin(m_extentMinX, tileMinX);
     m_extentMaxX = qMax(m_extentMaxX, tileMaxX);
     m_extentMinY = qMin(m_extentMinY, tileMinY);
@@ -670,6 +1059,8 @@ void KisTiledDataManager::updateExtent(qint32 col, qint32 row)
 
 QRect KisTiledDataManager::extentImpl() const
 {
+    QMutexLocker locker(&m_extentMutex);
+
     qint32 x = m_extentMinX;
     qint32 y = m_extentMinY;
     qint32 w = (m_extentMaxX >= m_extentMinX) ? m_extentMaxX - m_extentMinX + 1 : 0;
@@ -687,6 +1078,13 @@ void KisTiledDataManager::extent(qint32 &x, qint32 &y, qint32 &w, qint32 &h) con
 QRect KisTiledDataManager::extent() const
 {
     QReadLocker locker(&m_lock);
+
+    /**
+     * The recalculation only touches the extent fields, which are
+     * guarded by m_extentMutex, so it is safe under the read lock
+     * and doesn't serialize the other readers.
+     */
+    const_cast<KisTiledDataManager*>(this)->recalculateExtentIfNeeded();
     return extentImpl();
 }
 
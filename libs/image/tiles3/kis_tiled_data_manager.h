@@ -20,8 +20,10 @@
 #define KIS_TILEDDATAMANAGER_H_
 
 #include <QtGlobal>
+#include <QHash>
 #include <QVector>
 #include <QRegion>
+#include <QMutex>
 
 #include <kis_shared.h>
 #include <kis_shared_ptr.h>
@@ -81,6 +83,7 @@ protected:
     friend class KisTiledRandomAccessor;
     friend class KisRandomAccessor2;
     friend class KisStressJob;
+    friend class KisTiledDataManagerTest;
 
 public:
     void setDefaultPixel(const quint8 *defPixel);
@@ -177,6 +180,14 @@ protected:
 
     void purge(const QRect& area);
 
+    /**
+     * Asks the tile data store to load the tiles covering \p rect
+     * from swap in a background thread. Does nothing if no tiles are
+     * swapped out. Used as a hint only, the tiles are still loaded
+     * synchronously if they are accessed before the prefetch finishes.
+     */
+    void prefetchTiles(const QRect &rect);
+
     inline quint32 pixelSize() const {
         return m_pixelSize;
     }
@@ -192,6 +203,70 @@ public:
 
     QRegion region() const;
 
+    /**
+     * Returns a 64-bit hash of the content of the data manager. It is
+     * combined from the cached hashes of the tiles, so only the
+     * tiles changed since the previous call are actually read.
+     * Equal hashes do not guarantee equal content, but different
+     * hashes guarantee the content has changed.
+     */
+    quint64 contentHash() const;
+
+    /**
+     * The versions of the tiles of the data manager, keyed by
+     * the position of the tile (\see KisTileData::version())
+     */
+    typedef QHash<quint64, quint64> TileVersions;
+
+    /**
+     * Compares the versions of the tiles with \p oldVersions and
+     * returns the region covered by the tiles that have been changed,
+     * added or removed since \p oldVersions were fetched. The current
+     * versions are stored in \p newVersions.
+     *
+     * Only the tiles changed since the previous call are actually
+     * read, so the method is cheap enough to be called on every
+     * synchronization of a cache built from the data manager.
+     */
+    QRegion changedRegion(const TileVersions &oldVersions, TileVersions *newVersions) const;
+
+    /**
+     * Compares the versions of the tiles intersecting \p rect with
+     * \p versions and returns the region covered by the tiles that
+     * have been changed, added or removed. The versions of these
+     * tiles are updated in \p versions, the versions of the tiles
+     * outside \p rect are left untouched.
+     */
+    QRegion changedRegion(const QRect &rect, TileVersions *versions) const;
+
+    /**
+     * The version and the content hash of a tile
+     * (\see KisTileData::version(), KisTileData::contentHash())
+     */
+    struct TileContent {
+        quint64 version;
+        quint64 hash;
+    };
+
+    /**
+     * The contents of the tiles of the data manager, keyed by
+     * the position of the tile
+     */
+    typedef QHash<quint64, TileContent> TileContents;
+
+    /**
+     * Compares the tiles intersecting \p rect with \p contents and
+     * returns the region covered by the tiles whose content has
+     * changed, or which have been added or removed. The contents of
+     * these tiles are updated in \p contents.
+     *
+     * A tile with the same version is unchanged, its pixels are not
+     * read at all. Only if the version has changed, the content
+     * hashes are compared, so unlike changedRegion(), the tiles
+     * rewritten with the same content are not reported.
+     */
+    QRegion changedContentRegion(const QRect &rect, TileContents *contents) const;
+
     void clear(QRect clearRect, quint8 clearValue);
     void clear(QRect clearRect, const quint8 *clearPixel);
     void clear(qint32 x, qint32 y, qint32 w, qint32 h, quint8 clearValue);
@@ -304,12 +379,24 @@ private:
     qint32 m_pixelSize;
 
     /**
-     * Extents stuff
+     * Extents stuff. Guarded by m_extentMutex, because the tiles are
+     * created (and the extent is updated) by the iterators without
+     * taking m_lock and the extent is recalculated by the readers.
      */
     qint32 m_extentMinX;
     qint32 m_extentMaxX;
     qint32 m_extentMinY;
     qint32 m_extentMaxY;
+    mutable QMutex m_extentMutex;
+
+    /**
+     * Set when tiles have been removed, so the extent may have
+     * shrunk. Walking through all the tiles is too expensive to be
+     * done on every clear() or bitBlt(), so the extent is
+     * recalculated lazily, when it is requested next time. It is
+     * set under the write lock of m_lock and reset by the readers.
+     */
+    QAtomicInt m_needsRecalculateExtent;
 
     mutable QReadWriteLock m_lock;
 
@@ -333,9 +420,22 @@ private:
 
     void updateExtent(qint32 col, qint32 row);
     void recalculateExtent();
+    void recalculateExtentIfNeeded();
+    void recalculateExtentImpl();
 
     quint8* duplicatePixel(qint32 num, const quint8 *pixel);
 
+    /**
+     * Returns true if \p tile has no data of its own, but
+     * just refers to the default tile data of this manager.
+     * Such tiles need not be copied when bitBlt'ing into a
+     * manager with the same default pixel (\p defaultPixelsMatch)
+     */
+    inline bool isDefaultTile(KisTileSP tile, bool defaultPixelsMatch) const {
+        return defaultPixelsMatch &&
+            tile->tileData() == m_hashTable->defaultTileData();
+    }
+
     template<bool useOldSrcData>
         void bitBltImpl(KisTiledDataManager *srcDM, const QRect &rect);
     template<bool useOldSrcData>
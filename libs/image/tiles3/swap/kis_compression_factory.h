@@ -0,0 +1,67 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_COMPRESSION_FACTORY_H
+#define __KIS_COMPRESSION_FACTORY_H
+
+#include <QString>
+#include <QStringList>
+
+#include "tiles3/swap/kis_lzf_compression.h"
+#include "tiles3/swap/kis_zlib_compression.h"
+
+/**
+ * Creates compression codecs by their names. The name of the codec is
+ * written into the header of every tile of a .kra layer, so the names
+ * must never change, otherwise the old files will become unreadable.
+ *
+ * To add a new codec just implement KisAbstractCompression and add
+ * its name here.
+ */
+class KRITAIMAGE_EXPORT KisCompressionFactory
+{
+public:
+    static QString defaultCompression() {
+        return "LZF";
+    }
+
+    static QStringList availableCompressions() {
+        return QStringList() << "LZF" << "ZLIB";
+    }
+
+    static bool isSupported(const QString &name) {
+        return availableCompressions().contains(name);
+    }
+
+    /**
+     * \return a new codec object owned by the caller, or null if the
+     * \p name is unknown
+     */
+    static KisAbstractCompression* create(const QString &name) {
+        if (name == "LZF") {
+            return new KisLzfCompression();
+        } else if (name == "ZLIB") {
+            return new KisZlibCompression();
+        }
+
+        return 0;
+    }
+
+private:
+    KisCompressionFactory();
+};
+
+#endif /* __KIS_COMPRESSION_FACTORY_H */
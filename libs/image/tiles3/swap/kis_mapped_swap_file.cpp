@@ -0,0 +1,188 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_debug.h"
+#include "kis_mapped_swap_file.h"
+
+#include <QDir>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define SWP_PREFIX "KRITA_SWAP_FILE_XXXXXX"
+
+/**
+ * Every segment is mapped with this extra tail, so that the chunks
+ * crossing the border of the segment could be accessed directly.
+ * It is bigger than any compressed tile can be.
+ */
+#define SEGMENT_OVERLAP (1*MiB)
+
+
+KisMappedSwapFile::KisMappedSwapFile(const QString &swapDir,
+                                     quint64 segmentSize,
+                                     quint64 maxMappedSize,
+                                     quint64 readaheadSize)
+    : m_segmentSize(segmentSize),
+      m_maxMappedSize(maxMappedSize),
+      m_readaheadSize(readaheadSize),
+      m_mappedSize(0)
+{
+    QString swapFileTemplate = (swapDir.isEmpty() ? QDir::tempPath() : swapDir) + QDir::separator() + SWP_PREFIX;
+    QDir d(swapDir.isEmpty() ? QDir::tempPath() : swapDir);
+    if (!d.exists()) {
+        d.mkpath(swapDir.isEmpty() ? QDir::tempPath() : swapDir);
+    }
+    m_file.setFileTemplate(swapFileTemplate);
+    bool res = m_file.open();
+    Q_ASSERT(res);
+    Q_ASSERT(!m_file.fileName().isEmpty());
+    if (!res || m_file.fileName().isEmpty()) {
+        qWarning() << "Could not create or open swapfile";
+    }
+}
+
+KisMappedSwapFile::~KisMappedSwapFile()
+{
+    unmapAll();
+}
+
+quint8* KisMappedSwapFile::getReadChunkPtr(const KisChunkData &readChunk)
+{
+    Segment *segment = 0;
+    quint8 *ptr = getChunkPtr(readChunk, &segment);
+
+    if (ptr) {
+        readahead(*segment, ptr, readChunk.size() + m_readaheadSize);
+    }
+
+    return ptr;
+}
+
+quint8* KisMappedSwapFile::getWriteChunkPtr(const KisChunkData &writeChunk)
+{
+    Segment *segment = 0;
+    return getChunkPtr(writeChunk, &segment);
+}
+
+quint64 KisMappedSwapFile::mappedSize() const
+{
+    return m_mappedSize;
+}
+
+quint8* KisMappedSwapFile::getChunkPtr(const KisChunkData &chunk, Segment **segment)
+{
+    const int index = chunk.m_begin / m_segmentSize;
+    const quint64 segmentBegin = quint64(index) * m_segmentSize;
+    const quint64 requiredSize = chunk.m_end + 1 - segmentBegin;
+
+    if (index >= m_segments.size()) {
+        m_segments.resize(index + 1);
+    }
+
+    if (!m_segments[index].data || m_segments[index].size < requiredSize) {
+        if (m_segments[index].data) {
+            warnKrita <<
+                "KisMappedSwapFile: the requested chunk is too "
+                "big to fit into the segment! "
+                "Remapping the segment to avoid SIGSEGV...";
+
+            m_file.unmap(m_segments[index].data);
+            m_mappedSize -= m_segments[index].size;
+            m_segments[index] = Segment();
+        }
+
+        const quint64 mappingSize = qMax(m_segmentSize + SEGMENT_OVERLAP, requiredSize);
+
+        if (m_maxMappedSize && m_mappedSize + mappingSize > m_maxMappedSize) {
+            unmapAll();
+        }
+
+        ensureFileSize(segmentBegin + mappingSize);
+
+#ifdef Q_OS_UNIX
+        // A workaround for https://bugreports.qt-project.org/browse/QTBUG-6330
+        m_file.exists();
+#endif
+
+        quint8 *data = m_file.map(segmentBegin, mappingSize);
+        if (!data) {
+            warnKrita << "KisMappedSwapFile: failed to map the swap file segment"
+                      << ppVar(segmentBegin) << ppVar(mappingSize) << m_file.errorString();
+            return 0;
+        }
+
+        m_segments[index].data = data;
+        m_segments[index].size = mappingSize;
+        m_mappedSize += mappingSize;
+    }
+
+    *segment = &m_segments[index];
+    return m_segments[index].data + chunk.m_begin - segmentBegin;
+}
+
+void KisMappedSwapFile::ensureFileSize(quint64 size)
+{
+    if (size <= (quint64)m_file.size()) return;
+
+#ifdef Q_OS_WIN32
+    /**
+     * Workaround for Qt's "feature"
+     *
+     * On windows QFSEnginePrivate caches the value of
+     * mapHandle which is limited to the size of the file at
+     * the moment of its (handle's) creation. That is we will
+     * not be able to use it after resizing the file.  The
+     * only way to free the handle is to release all the
+     * mappings we have. They will be recreated on demand.
+     */
+    unmapAll();
+#endif
+
+    m_file.resize(size);
+}
+
+void KisMappedSwapFile::unmapAll()
+{
+    for (int i = 0; i < m_segments.size(); i++) {
+        if (m_segments[i].data) {
+            m_file.unmap(m_segments[i].data);
+            m_segments[i] = Segment();
+        }
+    }
+
+    m_mappedSize = 0;
+}
+
+void KisMappedSwapFile::readahead(const Segment &segment, quint8 *ptr, quint64 size)
+{
+#ifdef Q_OS_UNIX
+    static const quintptr pageSize = sysconf(_SC_PAGESIZE);
+
+    quint8 *start = (quint8*)((quintptr)ptr & ~(pageSize - 1));
+    quint8 *end = qMin(ptr + size, segment.data + segment.size);
+
+    if (end > start) {
+        posix_madvise(start, end - start, POSIX_MADV_WILLNEED);
+    }
+#else
+    Q_UNUSED(segment);
+    Q_UNUSED(ptr);
+    Q_UNUSED(size);
+#endif
+}
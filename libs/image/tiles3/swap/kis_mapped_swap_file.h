@@ -0,0 +1,106 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_MAPPED_SWAP_FILE_H
+#define __KIS_MAPPED_SWAP_FILE_H
+
+#include <QTemporaryFile>
+#include <QVector>
+
+#include "kis_chunk_allocator.h"
+
+
+#define DEFAULT_SEGMENT_SIZE (64*MiB)
+#define DEFAULT_READAHEAD_SIZE (256*1024ULL)
+
+/**
+ * Swap file backend for KisSwappedDataStore. In contrast to
+ * KisMemoryWindow, which moves a single mapping window over the file
+ * and remaps it on every miss, this class splits the file into
+ * fixed-size segments, maps every segment on the first access and
+ * keeps the mapping. The file itself grows lazily, so on the file
+ * systems supporting sparse files the unused segments do not occupy
+ * any disk space.
+ *
+ * Every segment is mapped slightly bigger than the segment size, so
+ * the chunks that start inside the segment and cross its border are
+ * still accessible through a single pointer.
+ *
+ * When reading a chunk, the class asks the OS to prefetch the
+ * following part of the file. KisChunkAllocator places the tiles
+ * swapped out together next to each other, so neighbouring tiles
+ * usually come back without an extra page fault.
+ */
+class KisMappedSwapFile
+{
+public:
+    /**
+     * @param swapDir the directory for the swap file. If the dir doesn't
+     *        exist, it'll be created, if it's empty QDir::tempPath will be used.
+     * @param segmentSize the size of a single mapping
+     * @param maxMappedSize the limit for the total size of the mappings,
+     *         0 means "no limit". When the limit is reached, all the
+     *        mappings are dropped and recreated on demand.
+     * @param readaheadSize the number of bytes after a chunk being read
+     *        that should be prefetched from disk.
+     */
+    KisMappedSwapFile(const QString &swapDir,
+                      quint64 segmentSize = DEFAULT_SEGMENT_SIZE,
+                      quint64 maxMappedSize = 0,
+                      quint64 readaheadSize = DEFAULT_READAHEAD_SIZE);
+    ~KisMappedSwapFile();
+
+    inline quint8* getReadChunkPtr(KisChunk readChunk) {
+        return getReadChunkPtr(readChunk.data());
+    }
+
+    inline quint8* getWriteChunkPtr(KisChunk writeChunk) {
+        return getWriteChunkPtr(writeChunk.data());
+    }
+
+    quint8* getReadChunkPtr(const KisChunkData &readChunk);
+    quint8* getWriteChunkPtr(const KisChunkData &writeChunk);
+
+    /**
+     * The total size of all the currently existing mappings
+     */
+    quint64 mappedSize() const;
+
+private:
+    struct Segment {
+        Segment() : data(0), size(0) {}
+
+        quint8 *data;
+        quint64 size;
+    };
+
+private:
+    quint8* getChunkPtr(const KisChunkData &chunk, Segment **segment);
+    void ensureFileSize(quint64 size);
+    void unmapAll();
+    void readahead(const Segment &segment, quint8 *ptr, quint64 size);
+
+private:
+    QTemporaryFile m_file;
+
+    QVector<Segment> m_segments;
+    const quint64 m_segmentSize;
+    const quint64 m_maxMappedSize;
+    const quint64 m_readaheadSize;
+    quint64 m_mappedSize;
+};
+
+#endif /* __KIS_MAPPED_SWAP_FILE_H */
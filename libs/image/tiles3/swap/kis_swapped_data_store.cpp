@@ -18,26 +18,30 @@
 
 //#include "kis_debug.h"
 #include "kis_swapped_data_store.h"
-#include "kis_memory_window.h"
+#include "kis_mapped_swap_file.h"
 #include "kis_image_config.h"
 
 #include "kis_tile_compressor_2.h"
 
-//#define COMPRESSOR_VERSION 2
-
 KisSwappedDataStore::KisSwappedDataStore()
     : m_memoryMetric(0)
 {
     KisImageConfig config;
     const quint64 maxSwapSize = config.maxSwapSize() * MiB;
     const quint64 swapSlabSize = config.swapSlabSize() * MiB;
-    const quint64 swapWindowSize = config.swapWindowSize() * MiB;
+
+    /**
+     * On 32-bit systems the address space is too small for mapping
+     * the whole swap file, so the mappings are limited to a few
+     * segments there
+     */
+    const quint64 maxMappedSize = sizeof(void*) > 4 ? 0 :
+        qMax(quint64(config.swapWindowSize()) * MiB, 4 * DEFAULT_SEGMENT_SIZE);
 
     m_allocator = new KisChunkAllocator(swapSlabSize, maxSwapSize);
-    m_swapSpace = new KisMemoryWindow(config.swapDir(), swapWindowSize);
+    m_swapSpace = new KisMappedSwapFile(config.swapDir(), DEFAULT_SEGMENT_SIZE, maxMappedSize);
 
-    // FIXME: use a factory after the patch is committed
-    m_compressor = new KisTileCompressor2();
+    m_compressor = new KisTileCompressor2(config.swapCompression());
 }
 
 KisSwappedDataStore::~KisSwappedDataStore()
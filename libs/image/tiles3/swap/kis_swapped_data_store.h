@@ -29,7 +29,7 @@ class QMutex;
 class KisTileData;
 class KisAbstractTileCompressor;
 class KisChunkAllocator;
-class KisMemoryWindow;
+class KisMappedSwapFile;
 
 class KRITAIMAGE_EXPORT KisSwappedDataStore
 {
@@ -81,7 +81,7 @@ private:
     KisAbstractTileCompressor *m_compressor;
 
     KisChunkAllocator *m_allocator;
-    KisMemoryWindow *m_swapSpace;
+    KisMappedSwapFile *m_swapSpace;
 
     QMutex m_lock;
 
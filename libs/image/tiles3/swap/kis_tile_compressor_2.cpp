@@ -17,22 +17,54 @@
  */
 
 #include "kis_tile_compressor_2.h"
-#include "kis_lzf_compression.h"
+#include "kis_compression_factory.h"
 #include <QIODevice>
 #include "kis_paint_device_writer.h"
 #define TILE_DATA_SIZE(pixelSize) ((pixelSize) * KisTileData::WIDTH * KisTileData::HEIGHT)
 
-const QString KisTileCompressor2::m_compressionName = "LZF";
 
-
-KisTileCompressor2::KisTileCompressor2()
+KisTileCompressor2::KisTileCompressor2(const QString &compressionName)
+    : m_compressionName(compressionName)
 {
-    m_compression = new KisLzfCompression();
+    m_compression = KisCompressionFactory::create(m_compressionName);
+
+    if (!m_compression) {
+        warnKrita << "Unknown tile compression" << m_compressionName
+                  << "falling back to" << KisCompressionFactory::defaultCompression();
+
+        m_compressionName = KisCompressionFactory::defaultCompression();
+        m_compression = KisCompressionFactory::create(m_compressionName);
+    }
 }
 
 KisTileCompressor2::~KisTileCompressor2()
 {
     delete m_compression;
+    qDeleteAll(m_foreignCompressions);
+}
+
+QString KisTileCompressor2::compressionName() const
+{
+    return m_compressionName;
+}
+
+KisAbstractCompression* KisTileCompressor2::compressionForName(const QString &name)
+{
+    if (name == m_compressionName) {
+        return m_compression;
+    }
+
+    KisAbstractCompression *compression = m_foreignCompressions.value(name, 0);
+
+    if (!compression) {
+        compression = KisCompressionFactory::create(name);
+
+        if (compression) {
+            m_foreignCompressions.insert(name, compression);
+        }
+    }
+
+    return compression;
 }
 
 bool KisTileCompressor2::writeTile(KisTileSP tile, KisPaintDeviceWriter &store)
@@ -75,18 +107,28 @@ bool KisTileCompressor2::readTile(QIODevice *stream, KisTiledDataManager *dm)
         qint32 dataSize = headerItems.takeFirst().toInt();
 
         Q_ASSERT(headerItems.isEmpty());
-        Q_ASSERT(compressionName == m_compressionName);
+
+        if (dataSize > m_streamingBuffer.size()) {
+            warnFile << "Corrupted tile header: the data size is too big" << dataSize;
+            return false;
+        }
 
         qint32 row = yToRow(dm, y);
         qint32 col = xToCol(dm, x);
 
-        KisTileSP tile = dm->getTile(col, row, true);
-
         stream->read(m_streamingBuffer.data(), dataSize);
 
+        KisAbstractCompression *compression = compressionForName(compressionName);
+        if (!compression) {
+            warnFile << "Unsupported tile compression" << compressionName;
+            return false;
+        }
+
+        KisTileSP tile = dm->getTile(col, row, true);
+
         tile->lockForWrite();
-        bool res = decompressTileData((quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
-        tile->unlock();
+        bool res = decompressTileData(compression, (quint8*)m_streamingBuffer.data(), dataSize, tile->tileData());
+        tile->unlockForWrite();
         return res;
     }
     return false;
@@ -129,7 +171,7 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
     compressedBytes = m_compression->compress((quint8*)m_linearizationBuffer.data(), tileDataSize,
                                               (quint8*)m_compressionBuffer.data(), m_compressionBuffer.size());
 
-    if(compressedBytes < tileDataSize) {
+    if(compressedBytes > 0 && compressedBytes < tileDataSize) {
         buffer[0] = COMPRESSED_DATA_FLAG;
         memcpy(buffer + 1, m_compressionBuffer.data(), compressedBytes);
         bytesWritten = compressedBytes + 1;
@@ -144,6 +186,14 @@ void KisTileCompressor2::compressTileData(KisTileData *tileData,
 bool KisTileCompressor2::decompressTileData(quint8 *buffer,
                                             qint32 bufferSize,
                                             KisTileData *tileData)
+{
+    return decompressTileData(m_compression, buffer, bufferSize, tileData);
+}
+
+bool KisTileCompressor2::decompressTileData(KisAbstractCompression *compression,
+                                            quint8 *buffer,
+                                            qint32 bufferSize,
+                                            KisTileData *tileData)
 {
     const qint32 pixelSize = tileData->pixelSize();
     const qint32 tileDataSize = TILE_DATA_SIZE(pixelSize);
@@ -152,7 +202,7 @@ bool KisTileCompressor2::decompressTileData(quint8 *buffer,
         prepareWorkBuffers(tileDataSize);
 
         qint32 bytesWritten;
-        bytesWritten = m_compression->decompress(buffer + 1, bufferSize - 1,
+        bytesWritten = compression->decompress(buffer + 1, bufferSize - 1,
                                                  (quint8*)m_linearizationBuffer.data(), tileDataSize);
         if (bytesWritten == tileDataSize) {
             KisAbstractCompression::delinearizeColors((quint8*)m_linearizationBuffer.data(),
@@ -178,7 +228,7 @@ qint32 KisTileCompressor2::tileDataBufferSize(KisTileData *tileData)
 inline qint32 KisTileCompressor2::maxHeaderLength()
 {
     static const qint32 QINT32_LENGTH = 11;
-    static const qint32 COMPRESSION_NAME_LENGTH = 5;
+    static const qint32 COMPRESSION_NAME_LENGTH = 8;
     static const qint32 SEPARATORS_LENGTH = 4;
 
     return 3 * QINT32_LENGTH + COMPRESSION_NAME_LENGTH + SEPARATORS_LENGTH;
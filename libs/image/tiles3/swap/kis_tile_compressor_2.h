@@ -21,14 +21,23 @@
 
 #include "kis_abstract_tile_compressor.h"
 
+#include <QHash>
+
 class KisAbstractCompression;
 
 class KRITAIMAGE_EXPORT KisTileCompressor2 : public KisAbstractTileCompressor
 {
 public:
-    KisTileCompressor2();
+    /**
+     * \p compressionName is the name of the codec used for compressing
+     * the tiles (see KisCompressionFactory). When reading, the codec
+     * is chosen according to the header of every tile.
+     */
+    KisTileCompressor2(const QString &compressionName = "LZF");
     ~KisTileCompressor2() override;
 
+    QString compressionName() const;
+
     bool writeTile(KisTileSP tile, KisPaintDeviceWriter &store) override;
     bool readTile(QIODevice *io, KisTiledDataManager *dm) override;
 
@@ -46,6 +55,11 @@ private:
 
     QString getHeader(KisTileSP tile, qint32 compressedSize);
 
+    KisAbstractCompression* compressionForName(const QString &name);
+    bool decompressTileData(KisAbstractCompression *compression,
+                            quint8 *buffer, qint32 bufferSize,
+                            KisTileData *tileData);
+
     void prepareWorkBuffers(qint32 tileDataSize);
     void prepareStreamingBuffer(qint32 tileDataSize);
 
@@ -58,7 +72,13 @@ private:
     QByteArray m_compressionBuffer;
     QByteArray m_streamingBuffer;
     KisAbstractCompression *m_compression;
-    static const QString m_compressionName;
+    QString m_compressionName;
+
+    /**
+     * Codecs of the tiles that were written with a compression
+     * different from m_compressionName
+     */
+    QHash<QString, KisAbstractCompression*> m_foreignCompressions;
 };
 
 #endif /* __KIS_TILE_COMPRESSOR_2_H */
@@ -21,17 +21,27 @@
 
 #include "tiles3/swap/kis_legacy_tile_compressor.h"
 #include "tiles3/swap/kis_tile_compressor_2.h"
+#include "tiles3/swap/kis_compression_factory.h"
 
 class KRITAIMAGE_EXPORT KisTileCompressorFactory
 {
 public:
-    static KisAbstractTileCompressorSP create(qint32 version) {
+    /**
+     * Creates a tile compressor for the tiles format \p version.
+     *
+     * \p compressionName is the codec used for writing the tiles (see
+     * KisCompressionFactory). It is ignored by the legacy compressor.
+     * The readers always decode the codec stored in the tile header,
+     * so the files written with any supported codec stay readable.
+     */
+    static KisAbstractTileCompressorSP create(qint32 version,
+                                              const QString &compressionName = KisCompressionFactory::defaultCompression()) {
         switch(version) {
         case 1:
             return KisAbstractTileCompressorSP(new KisLegacyTileCompressor());
             break;
         case 2:
-            return KisAbstractTileCompressorSP(new KisTileCompressor2());
+            return KisAbstractTileCompressorSP(new KisTileCompressor2(compressionName));
             break;
         default:
             qFatal("Unknown version of the tiles");
@@ -24,6 +24,7 @@
 #include "tiles3/kis_tile_data_store.h"
 #include "tiles3/kis_tile_data_store_iterators.h"
 #include "kis_debug.h"
+#include "kis_update_time_monitor.h"
 
 #define SEC 1000
 
@@ -103,7 +104,8 @@ void KisTileDataSwapper::run()
 void KisTileDataSwapper::checkFreeMemory()
 {
 //    dbgKrita <<"check memory: high limit -" << m_d->limits.emergencyThreshold() <<"in mem -" << m_d->store->numTilesInMemory();
-    if(m_d->store->memoryMetric() > m_d->limits.emergencyThreshold())
+    if(m_d->store->memoryMetric() - m_d->store->poolSpareMemoryMetric() >
+       m_d->limits.emergencyThreshold())
         doJob();
 }
 
@@ -114,8 +116,13 @@ void KisTileDataSwapper::doJob()
      * to this function as well
      */
     QMutexLocker locker(&m_d->cycleLock);
+    KisUpdateTraceScope trace("swapper", "Swap cycle");
 
-    qint32 memoryMetric = m_d->store->memoryMetric();
+    /**
+     * The memory the pooler doesn't need is given to the tiles
+     */
+    qint32 memoryMetric =
+        m_d->store->memoryMetric() - m_d->store->poolSpareMemoryMetric();
 
     DEBUG_ACTION("Started swap cycle");
     DEBUG_VALUE(m_d->store->numTiles());
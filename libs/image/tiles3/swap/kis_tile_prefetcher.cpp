@@ -0,0 +1,146 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_prefetcher.h"
+
+#include <algorithm>
+
+#include <QSemaphore>
+#include <QMutex>
+
+#include "tiles3/kis_tile.h"
+#include "tiles3/kis_tile_data_store.h"
+#include "tiles3/swap/kis_tile_data_swapper_p.h"
+#include "kis_debug.h"
+
+/**
+ * 4096 tiles is 64 MiB of RGBA8 data, which is more than enough
+ * for a few update patches and the viewport of a 4K screen
+ */
+const int KisTilePrefetcher::MAX_QUEUE_SIZE = 4096;
+
+
+struct Q_DECL_HIDDEN KisTilePrefetcher::Private
+{
+    QSemaphore semaphore;
+    QAtomicInt shouldExitFlag;
+    KisTileDataStore *store;
+    KisStoreLimits limits;
+
+    QMutex queueLock;
+    QVector<KisTileSP> queue;
+};
+
+KisTilePrefetcher::KisTilePrefetcher(KisTileDataStore *store)
+    : QThread(),
+      m_d(new Private())
+{
+    m_d->shouldExitFlag = 0;
+    m_d->store = store;
+}
+
+KisTilePrefetcher::~KisTilePrefetcher()
+{
+    delete m_d;
+}
+
+void KisTilePrefetcher::prefetch(const QVector<KisTileSP> &tiles)
+{
+    {
+        QMutexLocker locker(&m_d->queueLock);
+
+        /**
+         * Drop the tiles that have been removed from their data
+         * managers since they were queued, they are not needed
+         * anymore and we shouldn't keep them alive
+         */
+        auto it = std::remove_if(m_d->queue.begin(), m_d->queue.end(),
+                                 [] (const KisTileSP &tile) { return tile->isDead(); });
+        m_d->queue.erase(it, m_d->queue.end());
+
+        m_d->queue += tiles;
+
+        const int excess = m_d->queue.size() - MAX_QUEUE_SIZE;
+        if (excess > 0) {
+            m_d->queue.remove(0, excess);
+        }
+    }
+
+    m_d->semaphore.release();
+}
+
+void KisTilePrefetcher::terminatePrefetcher()
+{
+    unsigned long exitTimeout = 100;
+    do {
+        m_d->shouldExitFlag = true;
+        m_d->semaphore.release();
+    } while(!wait(exitTimeout));
+
+    QMutexLocker locker(&m_d->queueLock);
+    m_d->queue.clear();
+}
+
+void KisTilePrefetcher::run()
+{
+    while (1) {
+        m_d->semaphore.acquire();
+
+        if (m_d->shouldExitFlag)
+            return;
+
+        doJob();
+    }
+}
+
+void KisTilePrefetcher::doJob()
+{
+    QVector<KisTileSP> tiles;
+
+    {
+        QMutexLocker locker(&m_d->queueLock);
+        tiles.swap(m_d->queue);
+    }
+
+    /**
+     * The newest requests are the most urgent ones, so
+     * process the batch from the end
+     */
+    for (int i = tiles.size() - 1; i >= 0; i--) {
+        if (m_d->shouldExitFlag) break;
+        if (m_d->store->memoryMetric() - m_d->store->poolSpareMemoryMetric() >
+            m_d->limits.hardLimitThreshold()) break;
+
+        /**
+         * The tile might have been removed or replaced while
+         * waiting in the queue. Its data is kept only by the
+         * undo history now, so there is no reason to load it.
+         */
+        if (tiles[i]->isDead()) continue;
+
+        /**
+         * Locking the tile ensures its data is loaded
+         * into memory. The lock is released immediately.
+         */
+        tiles[i]->lockForRead();
+        tiles[i]->unlock();
+    }
+}
+
+void KisTilePrefetcher::testingRereadConfig()
+{
+    m_d->limits = KisStoreLimits();
+}
@@ -0,0 +1,70 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_TILE_PREFETCHER_H
+#define __KIS_TILE_PREFETCHER_H
+
+#include <QThread>
+#include <QVector>
+
+#include "kritaimage_export.h"
+#include "kis_shared_ptr.h"
+
+class KisTileDataStore;
+class KisTile;
+typedef KisSharedPtr<KisTile> KisTileSP;
+
+
+/**
+ * A background thread that loads swapped out tiles back into memory
+ * before somebody actually accesses them. Without it, the tiles come
+ * back from swap one by one, synchronously, when an iterator touches
+ * them.
+ *
+ * The tiles are passed by the update queue (the areas that are going
+ * to be merged soon) and by the canvas (the area around the viewport).
+ * The newest requests are considered the most important ones, so when
+ * the queue overflows, the oldest requests are dropped.
+ *
+ * The prefetcher never loads the tiles when the store is above the
+ * hard limit, because the tiles would be swapped out again at once.
+ */
+class KRITAIMAGE_EXPORT KisTilePrefetcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    KisTilePrefetcher(KisTileDataStore *store);
+    ~KisTilePrefetcher() override;
+
+    void prefetch(const QVector<KisTileSP> &tiles);
+    void terminatePrefetcher();
+
+    void testingRereadConfig();
+
+private:
+    void run() override;
+    void doJob();
+
+private:
+    static const int MAX_QUEUE_SIZE;
+
+private:
+    struct Private;
+    Private * const m_d;
+};
+
+#endif /* __KIS_TILE_PREFETCHER_H */
@@ -0,0 +1,65 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_zlib_compression.h"
+
+#include <QByteArray>
+
+
+KisZlibCompression::KisZlibCompression(int level)
+    : m_level(level)
+{
+}
+
+KisZlibCompression::~KisZlibCompression()
+{
+}
+
+qint32 KisZlibCompression::compress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength)
+{
+    const QByteArray compressed = qCompress(input, inputLength, m_level);
+
+    /**
+     * qCompress() returns an empty array on failure. The caller
+     * stores the data uncompressed if we return 0.
+     */
+    if (compressed.isEmpty() || compressed.size() > outputLength) {
+        return 0;
+    }
+
+    memcpy(output, compressed.constData(), compressed.size());
+    return compressed.size();
+}
+
+qint32 KisZlibCompression::decompress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength)
+{
+    const QByteArray uncompressed = qUncompress(input, inputLength);
+    if (uncompressed.isEmpty() || uncompressed.size() > outputLength) {
+        return 0;
+    }
+
+    memcpy(output, uncompressed.constData(), uncompressed.size());
+    return uncompressed.size();
+}
+
+qint32 KisZlibCompression::outputBufferSize(qint32 dataSize)
+{
+    /**
+     * zlib's compressBound() plus the 4-byte size prefix
+     * prepended by qCompress()
+     */
+    return dataSize + (dataSize >> 12) + (dataSize >> 14) + 13 + 4;
+}
@@ -0,0 +1,47 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_ZLIB_COMPRESSION_H
+#define __KIS_ZLIB_COMPRESSION_H
+
+#include "kis_abstract_compression.h"
+
+/**
+ * Deflate compression provided by zlib (via qCompress()). It is
+ * noticeably slower than LZF, but gives much smaller streams, so it
+ * is a good choice when the data is going to be stored on disk for
+ * a long time, e.g. in a .kra file.
+ */
+class KRITAIMAGE_EXPORT KisZlibCompression : public KisAbstractCompression
+{
+public:
+    /**
+     * \p level is the zlib compression level, from 0 (no compression)
+     * to 9 (best compression). -1 means zlib's default.
+     */
+    KisZlibCompression(int level = -1);
+    ~KisZlibCompression() override;
+
+    qint32 compress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength) override;
+    qint32 decompress(const quint8* input, qint32 inputLength, quint8* output, qint32 outputLength) override;
+
+    qint32 outputBufferSize(qint32 dataSize) override;
+
+private:
+    int m_level;
+};
+
+#endif /* __KIS_ZLIB_COMPRESSION_H */
@@ -23,6 +23,7 @@
 
 #include "../../../sdk/tests/testutil.h"
 #include "tiles3/swap/kis_lzf_compression.h"
+#include "tiles3/swap/kis_zlib_compression.h"
 #include <kis_debug.h>
 
 #define TEST_FILE "tile.png"
@@ -221,6 +222,34 @@ void KisCompressionTests::testLzfOverflow()
     delete compression;
 }
 
+void KisCompressionTests::testZlibRoundTrip()
+{
+    KisAbstractCompression *compression = new KisZlibCompression();
+
+    roundTrip(compression);
+    roundTripTwoPass(compression);
+
+    delete compression;
+}
+
+void KisCompressionTests::testZlibOverflow()
+{
+    KisAbstractCompression *compression = new KisZlibCompression();
+    testOverflow(compression);
+
+    // the compressed data doesn't fit into the buffer
+    QByteArray input(1024, 0);
+    for (int i = 0; i < input.size(); i++) {
+        input[i] = quint8(i * 37 + (i >> 3) * 101);
+    }
+
+    quint8 output[16];
+    QCOMPARE(compression->compress((quint8*)input.data(), input.size(),
+                                   output, sizeof(output)), 0);
+
+    delete compression;
+}
+
 void KisCompressionTests::benchmarkMemCpy()
 {
     QImage image(QString(FILES_DATA_DIR) + QDir::separator() + TEST_FILE);
@@ -261,6 +290,19 @@ void KisCompressionTests::benchmarkDecompressionLzfTwoPass()
     benchmarkDecompressionTwoPass(compression);
     delete compression;
 }
+void KisCompressionTests::benchmarkCompressionZlib()
+{
+    KisAbstractCompression *compression = new KisZlibCompression();
+    benchmarkCompression(compression);
+    delete compression;
+}
+
+void KisCompressionTests::benchmarkDecompressionZlib()
+{
+    KisAbstractCompression *compression = new KisZlibCompression();
+    benchmarkDecompression(compression);
+    delete compression;
+}
 
 QTEST_MAIN(KisCompressionTests)
 
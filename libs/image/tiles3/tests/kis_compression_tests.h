@@ -41,6 +41,8 @@ private:
 private Q_SLOTS:
     void testLzfRoundTrip();
     void testLzfOverflow();
+    void testZlibRoundTrip();
+    void testZlibOverflow();
 
     void benchmarkMemCpy();
 
@@ -48,6 +50,9 @@ private Q_SLOTS:
     void benchmarkCompressionLzfTwoPass();
     void benchmarkDecompressionLzf();
     void benchmarkDecompressionLzfTwoPass();
+
+    void benchmarkCompressionZlib();
+    void benchmarkDecompressionZlib();
 };
 
 #endif /* KIS_COMPRESSION_TESTS_H */
@@ -0,0 +1,101 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_mapped_swap_file_test.h"
+#include <QTest>
+
+#include "kis_debug.h"
+
+#include "../swap/kis_mapped_swap_file.h"
+
+void KisMappedSwapFileTest::testReadWrite()
+{
+    KisMappedSwapFile memory(QString(), 1024);
+
+    quint8 oddValue = 0xee;
+    const quint8 chunkLength = 10;
+
+    quint8 oddBuf[chunkLength];
+    memset(oddBuf, oddValue, chunkLength);
+
+
+    KisChunkData chunk1(0, chunkLength);
+    KisChunkData chunk2(4097, chunkLength);
+
+    quint8 *ptr;
+
+    ptr = memory.getWriteChunkPtr(chunk1);
+    memcpy(ptr, oddBuf, chunkLength);
+
+    ptr = memory.getWriteChunkPtr(chunk2);
+    memcpy(ptr, oddBuf, chunkLength);
+
+    ptr = memory.getReadChunkPtr(chunk2);
+    QVERIFY(!memcmp(ptr, oddBuf, chunkLength));
+
+    ptr = memory.getReadChunkPtr(chunk1);
+    QVERIFY(!memcmp(ptr, oddBuf, chunkLength));
+}
+
+void KisMappedSwapFileTest::testCrossSegmentChunk()
+{
+    const quint64 segmentSize = 4096;
+    KisMappedSwapFile memory(QString(), segmentSize);
+
+    const quint64 chunkLength = 2 * segmentSize;
+
+    QScopedArrayPointer<quint8> buffer(new quint8[chunkLength]);
+    for (quint64 i = 0; i < chunkLength; i++) {
+        buffer[i] = i % 251;
+    }
+
+    // starts in the first segment and ends far beyond it
+    KisChunkData chunk(segmentSize - 16, chunkLength);
+
+    quint8 *ptr;
+
+    ptr = memory.getWriteChunkPtr(chunk);
+    memcpy(ptr, buffer.data(), chunkLength);
+
+    ptr = memory.getReadChunkPtr(chunk);
+    QVERIFY(!memcmp(ptr, buffer.data(), chunkLength));
+}
+
+void KisMappedSwapFileTest::testMappingLimit()
+{
+    const quint64 segmentSize = 4096;
+    KisMappedSwapFile memory(QString(), segmentSize, 3 * MiB);
+
+    quint8 oddValue = 0xee;
+    const quint8 chunkLength = 10;
+
+    quint8 oddBuf[chunkLength];
+    memset(oddBuf, oddValue, chunkLength);
+
+    for (int i = 0; i < 16; i++) {
+        quint8 *ptr = memory.getWriteChunkPtr(KisChunkData(i * segmentSize, chunkLength));
+        memcpy(ptr, oddBuf, chunkLength);
+
+        QVERIFY(memory.mappedSize() <= 3 * MiB);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        quint8 *ptr = memory.getReadChunkPtr(KisChunkData(i * segmentSize, chunkLength));
+        QVERIFY(!memcmp(ptr, oddBuf, chunkLength));
+    }
+}
+
+QTEST_MAIN(KisMappedSwapFileTest)
@@ -25,8 +25,13 @@
 
 #include "tiles_test_utils.h"
 
-void KisTileCompressorsTest::doRoundTrip(KisAbstractTileCompressor *compressor)
+void KisTileCompressorsTest::doRoundTrip(KisAbstractTileCompressor *compressor,
+                                         KisAbstractTileCompressor *readCompressor)
 {
+    if (!readCompressor) {
+        readCompressor = compressor;
+    }
+
     quint8 defaultPixel = 0;
     KisTiledDataManager dm(1, &defaultPixel);
 
@@ -53,7 +58,7 @@ void KisTileCompressorsTest::doRoundTrip(KisAbstractTileCompressor *compressor)
     QVERIFY(memoryIsFilled(defaultPixel, tile11->data(), TILESIZE));
     tile11 = 0;
 
-    bool res = compressor->readTile(fakeStore.device(), &dm);
+    bool res = readCompressor->readTile(fakeStore.device(), &dm);
     Q_ASSERT(res);
     Q_UNUSED(res);
     tile11 = dm.getTile(1, 1, false);
@@ -95,7 +100,7 @@ void KisTileCompressorsTest::doLowLevelRoundTrip(KisAbstractTileCompressor *comp
     QVERIFY(memoryIsFilled(oddPixel1, td->data(), TILESIZE));
 
     delete[] buffer;
-    tile->unlock();
+    tile->unlockForWrite();
 }
 
 void KisTileCompressorsTest::doLowLevelRoundTripIncompressible(KisAbstractTileCompressor *compressor)
@@ -141,7 +146,7 @@ void KisTileCompressorsTest::doLowLevelRoundTripIncompressible(KisAbstractTileCo
     QVERIFY(!memcmp(td->data(), incompressibleArray.data(), TILESIZE));
 
     delete[] buffer;
-    tile->unlock();
+    tile->unlockForWrite();
 }
 
 void KisTileCompressorsTest::testRoundTripLegacy()
@@ -179,6 +184,29 @@ void KisTileCompressorsTest::testLowLevelRoundTripIncompressible2()
     delete compressor;
 }
 
+void KisTileCompressorsTest::testRoundTripZlib()
+{
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2("ZLIB");
+    doRoundTrip(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testLowLevelRoundTripZlib()
+{
+    KisAbstractTileCompressor *compressor = new KisTileCompressor2("ZLIB");
+    doLowLevelRoundTrip(compressor);
+    doLowLevelRoundTripIncompressible(compressor);
+    delete compressor;
+}
+
+void KisTileCompressorsTest::testReadZlibWithDefaultCompressor()
+{
+    KisAbstractTileCompressor *writeCompressor = new KisTileCompressor2("ZLIB");
+    KisAbstractTileCompressor *readCompressor = new KisTileCompressor2();
+    doRoundTrip(writeCompressor, readCompressor);
+    delete readCompressor;
+    delete writeCompressor;
+}
 
 QTEST_MAIN(KisTileCompressorsTest)
 
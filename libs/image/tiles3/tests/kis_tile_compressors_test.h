@@ -26,7 +26,8 @@ class KisTileCompressorsTest : public QObject
 {
     Q_OBJECT
 private:
-    void doRoundTrip(KisAbstractTileCompressor *compressor);
+    void doRoundTrip(KisAbstractTileCompressor *compressor,
+                     KisAbstractTileCompressor *readCompressor = 0);
     void doLowLevelRoundTrip(KisAbstractTileCompressor *compressor);
     void doLowLevelRoundTripIncompressible(KisAbstractTileCompressor *compressor);
 
@@ -38,6 +39,10 @@ private Q_SLOTS:
     void testRoundTrip2();
     void testLowLevelRoundTrip2();
     void testLowLevelRoundTripIncompressible2();
+
+    void testRoundTripZlib();
+    void testLowLevelRoundTripZlib();
+    void testReadZlibWithDefaultCompressor();
 };
 
 #endif /* KIS_TILE_COMPRESSORS_TEST_H */
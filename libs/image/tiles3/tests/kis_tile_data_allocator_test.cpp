@@ -0,0 +1,183 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_tile_data_allocator_test.h"
+
+#include <QTest>
+
+#include "kis_debug.h"
+
+#include "tiles3/kis_tile_data_allocator.h"
+
+#define TILE_AREA (64 * 64)
+#define NUM_THREADS 4
+#define NUM_CYCLES 1000
+#define NUM_OBJECTS 100
+
+void KisTileDataAllocatorTest::testAllocateFree()
+{
+    KisTileDataAllocator allocator;
+
+    quint8 *ptr1 = allocator.allocate(4);
+    quint8 *ptr2 = allocator.allocate(4);
+    quint8 *ptr3 = allocator.allocate(20);
+
+    QVERIFY(ptr1);
+    QVERIFY(ptr2);
+    QVERIFY(ptr3);
+    QVERIFY(ptr1 != ptr2);
+
+    memset(ptr1, 0x1, 4 * TILE_AREA);
+    memset(ptr2, 0x2, 4 * TILE_AREA);
+    memset(ptr3, 0x3, 20 * TILE_AREA);
+
+    KisTileDataAllocator::Statistics stats = allocator.statistics();
+    QCOMPARE(stats.numArenas, 1);
+    QCOMPARE(stats.usedSize, qint64(2 * 4 * TILE_AREA));
+    QCOMPARE(stats.reservedSize, qint64(KisTileDataAllocator::BLOCKS_PER_ARENA * 4 * TILE_AREA));
+    QCOMPARE(stats.unpooledSize, qint64(20 * TILE_AREA));
+
+    allocator.free(ptr2, 4);
+
+    // the block freed last is reused first
+    quint8 *ptr4 = allocator.allocate(4);
+    QCOMPARE(ptr4, ptr2);
+
+    allocator.free(ptr1, 4);
+    allocator.free(ptr3, 20);
+    allocator.free(ptr4, 4);
+
+    stats = allocator.statistics();
+    QCOMPARE(stats.usedSize, qint64(0));
+    QCOMPARE(stats.unpooledSize, qint64(0));
+    QCOMPARE(stats.fragmentation(), 1.0);
+}
+
+void KisTileDataAllocatorTest::testReleaseUnusedArenas()
+{
+    KisTileDataAllocator allocator;
+
+    quint8 *ptr1 = allocator.allocate(4);
+    quint8 *ptr2 = allocator.allocate(8);
+
+    QCOMPARE(allocator.statistics().numArenas, 2);
+
+    allocator.free(ptr1, 4);
+    allocator.releaseUnusedArenas();
+
+    // the arena of 8-byte pixels is still in use
+    QCOMPARE(allocator.statistics().numArenas, 1);
+
+    allocator.free(ptr2, 8);
+    allocator.releaseUnusedArenas();
+
+    KisTileDataAllocator::Statistics stats = allocator.statistics();
+    QCOMPARE(stats.numArenas, 0);
+    QCOMPARE(stats.reservedSize, qint64(0));
+
+    // the allocator is still usable
+    ptr1 = allocator.allocate(4);
+    QVERIFY(ptr1);
+    allocator.free(ptr1, 4);
+}
+
+void KisTileDataAllocatorTest::testReleaseEmptyArenas()
+{
+    KisTileDataAllocator allocator;
+
+    const qint32 numBlocks = 3 * KisTileDataAllocator::BLOCKS_PER_ARENA;
+    QVector<quint8*> blocks;
+
+    for (qint32 i = 0; i < numBlocks; i++) {
+        blocks.append(allocator.allocate(4));
+    }
+
+    QCOMPARE(allocator.statistics().numArenas, 3);
+
+    // the last block keeps the last arena alive
+    for (qint32 i = 0; i < numBlocks - 1; i++) {
+        allocator.free(blocks[i], 4);
+    }
+
+    // one of the empty arenas is kept as a spare, the other is released
+    KisTileDataAllocator::Statistics stats = allocator.statistics();
+    QCOMPARE(stats.numArenas, 2);
+    QCOMPARE(stats.usedSize, qint64(4 * TILE_AREA));
+
+    allocator.free(blocks.last(), 4);
+    QCOMPARE(allocator.statistics().numArenas, 1);
+
+    allocator.releaseUnusedArenas();
+    QCOMPARE(allocator.statistics().numArenas, 0);
+}
+
+class KisAllocatorStressJob : public QRunnable
+{
+public:
+    KisAllocatorStressJob(KisTileDataAllocator &allocator, quint8 seed)
+        : m_allocator(allocator),
+          m_seed(seed)
+    {
+    }
+
+    void run() override {
+        for (qint32 i = 0; i < NUM_CYCLES; i++) {
+            const qint32 pixelSize = 1 + (i % KisTileDataAllocator::MAX_POOLED_PIXEL_SIZE);
+            const quint8 value = m_seed + i;
+
+            for (qint32 j = 0; j < NUM_OBJECTS; j++) {
+                m_pointer[j] = m_allocator.allocate(pixelSize);
+                Q_ASSERT(m_pointer[j]);
+                memset(m_pointer[j], value, pixelSize * TILE_AREA);
+            }
+
+            for (qint32 j = 0; j < NUM_OBJECTS; j++) {
+                // are we the only writers here?
+                Q_ASSERT(m_pointer[j][0] == value);
+                Q_ASSERT(m_pointer[j][pixelSize * TILE_AREA - 1] == value);
+                m_allocator.free(m_pointer[j], pixelSize);
+            }
+        }
+    }
+
+private:
+    KisTileDataAllocator &m_allocator;
+    quint8 m_seed;
+    quint8 *m_pointer[NUM_OBJECTS];
+};
+
+void KisTileDataAllocatorTest::testThreadedAllocation()
+{
+    KisTileDataAllocator allocator;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(NUM_THREADS);
+
+    for (qint32 i = 0; i < NUM_THREADS; i++) {
+        pool.start(new KisAllocatorStressJob(allocator, i * 64));
+    }
+
+    pool.waitForDone();
+
+    KisTileDataAllocator::Statistics stats = allocator.statistics();
+    QCOMPARE(stats.usedSize, qint64(0));
+    QVERIFY(stats.numArenas > 0);
+
+    allocator.releaseUnusedArenas();
+    QCOMPARE(allocator.statistics().numArenas, 0);
+}
+
+QTEST_MAIN(KisTileDataAllocatorTest)
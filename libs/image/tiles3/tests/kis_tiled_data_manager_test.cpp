@@ -20,6 +20,8 @@
 #include <QTest>
 
 #include "tiles3/kis_tiled_data_manager.h"
+#include "tiles3/swap/kis_tile_compressor_factory.h"
+#include "kis_image_config.h"
 
 #include "tiles_test_utils.h"
 
@@ -541,6 +543,393 @@ void KisTiledDataManagerTest::testUndoSetDefaultPixel()
 
 //#include <valgrind/callgrind.h>
 
+void KisTiledDataManagerTest::testPurgeUniformTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    QRect fillRect(0,0,128,64);
+
+    quint8 *buffer = new quint8[fillRect.width()*fillRect.height()];
+    memset(buffer, oddPixel1, fillRect.width()*fillRect.height());
+    dm.writeBytes(buffer, fillRect.x(), fillRect.y(), fillRect.width(), fillRect.height());
+
+    KisTileSP tile00;
+    KisTileSP tile10;
+
+    tile00 = dm.getTile(0, 0, false);
+    tile10 = dm.getTile(1, 0, false);
+    QVERIFY(tile00->tileData() != tile10->tileData());
+
+    dm.purge(fillRect);
+
+    tile00 = dm.getTile(0, 0, false);
+    tile10 = dm.getTile(1, 0, false);
+    QCOMPARE(tile00->tileData(), tile10->tileData());
+    QVERIFY(tile00->tileData()->uniform());
+    QCOMPARE(dm.extent(), fillRect);
+
+    // writing into the shared data should copy it
+    dm.clear(QRect(0,0,1,1), &oddPixel2);
+
+    tile00 = dm.getTile(0, 0, false);
+    tile10 = dm.getTile(1, 0, false);
+    QVERIFY(tile00->tileData() != tile10->tileData());
+    QVERIFY(!tile00->tileData()->uniform());
+    QVERIFY(memoryIsFilled(oddPixel1, tile10->data(), TILESIZE));
+
+    dm.readBytes(buffer, fillRect.x(), fillRect.y(), fillRect.width(), fillRect.height());
+    QCOMPARE(buffer[0], oddPixel2);
+    QCOMPARE(buffer[1], oddPixel1);
+
+    delete[] buffer;
+}
+
+void KisTiledDataManagerTest::testBitBltDefaultTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager srcDM(1, &defaultPixel);
+    KisTiledDataManager dstDM(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+
+    QRect rect(0,0,128,128);
+
+    dstDM.clear(rect, &oddPixel1);
+    QCOMPARE(dstDM.extent(), rect);
+
+    // nothing is painted on the source, so no tiles should be created
+    dstDM.bitBlt(&srcDM, rect);
+    QVERIFY(dstDM.extent().isEmpty());
+
+    dstDM.clear(rect, &oddPixel1);
+    dstDM.bitBltRough(&srcDM, rect);
+    QVERIFY(dstDM.extent().isEmpty());
+
+    // the extent shrinks lazily, the tiles added meanwhile are kept
+    dstDM.clear(rect, &oddPixel1);
+    dstDM.bitBlt(&srcDM, QRect(64,0,64,128));
+    dstDM.clear(QRect(0,128,64,64), &oddPixel1);
+    QCOMPARE(dstDM.extent(), QRect(0,0,64,192));
+}
+
+void KisTiledDataManagerTest::testHistoryCompaction()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    KisMementoSP memento1 = dm.getMemento();
+    dm.clear(0, 0, 64, 64, &oddPixel1);
+    dm.commit();
+
+    KisTileSP tile00 = dm.getTile(0, 0, false);
+    KisTileData *committedData = tile00->tileData();
+
+    // write access without actual changes
+    KisMementoSP memento2 = dm.getMemento();
+    tile00 = dm.getTile(0, 0, true);
+    tile00->lockForWrite();
+    tile00->unlockForWrite();
+    QVERIFY(tile00->tileData() != committedData);
+    dm.commit();
+
+    // the history is compacted in the background
+    KisTileDataStore::instance()->testingWaitForHistoryCompaction();
+
+    // the new revision should refer to the old data...
+    KisMementoSP memento3 = dm.getMemento();
+    KisTileSP oldTile00 = dm.getOldTile(0, 0);
+    QCOMPARE(oldTile00->tileData(), committedData);
+
+    // ...so the tile can be written without copying
+    QCOMPARE(tile00->tileData()->numUsers(), 1);
+
+    dm.clear(0, 0, 64, 64, &oddPixel2);
+    dm.commit();
+    tile00 = oldTile00 = 0;
+
+    dm.rollback(memento3);
+    tile00 = dm.getTile(0, 0, false);
+    QVERIFY(memoryIsFilled(oddPixel1, tile00->data(), TILESIZE));
+
+    dm.rollback(memento2);
+    tile00 = dm.getTile(0, 0, false);
+    QVERIFY(memoryIsFilled(oddPixel1, tile00->data(), TILESIZE));
+
+    dm.rollback(memento1);
+    tile00 = dm.getTile(0, 0, false);
+    QVERIFY(memoryIsFilled(defaultPixel, tile00->data(), TILESIZE));
+
+    dm.rollforward(memento1);
+    dm.rollforward(memento2);
+    dm.rollforward(memento3);
+    tile00 = dm.getTile(0, 0, false);
+    QVERIFY(memoryIsFilled(oddPixel2, tile00->data(), TILESIZE));
+}
+
+void KisTiledDataManagerTest::testContentHash()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm1(1, &defaultPixel);
+    KisTiledDataManager dm2(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    QCOMPARE(dm1.contentHash(), dm2.contentHash());
+
+    // the same content created in different ways
+    dm1.clear(0, 0, 128, 64, &oddPixel1);
+    dm2.clear(64, 0, 64, 64, &oddPixel1);
+    dm2.clear(0, 0, 64, 64, &oddPixel1);
+
+    QCOMPARE(dm1.contentHash(), dm2.contentHash());
+
+    KisTileSP tile00 = dm1.getTile(0, 0, false);
+    const quint64 tileHash = tile00->tileData()->contentHash();
+
+    dm1.setPixel(10, 10, &oddPixel2);
+    tile00 = dm1.getTile(0, 0, false);
+    QVERIFY(tile00->tileData()->contentHash() != tileHash);
+    QVERIFY(dm1.contentHash() != dm2.contentHash());
+
+    dm1.setPixel(10, 10, &oddPixel1);
+    QCOMPARE(tile00->tileData()->contentHash(), tileHash);
+    QCOMPARE(dm1.contentHash(), dm2.contentHash());
+
+    // the same content at a different place
+    KisTiledDataManager dm3(1, &defaultPixel);
+    dm3.clear(0, 64, 128, 64, &oddPixel1);
+    QVERIFY(dm1.contentHash() != dm3.contentHash());
+}
+
+class KisContentHashWriter : public QRunnable
+{
+public:
+    KisContentHashWriter(KisTileSP tile, int numCycles)
+        : m_tile(tile), m_numCycles(numCycles)
+    {
+    }
+
+    void run() override {
+        for (int i = 0; i < m_numCycles; i++) {
+            m_tile->lockForWrite();
+
+            // write pixel by pixel to make the write long enough
+            quint8 *data = m_tile->data();
+            for (int j = 0; j < TILESIZE; j++) {
+                data[j] = quint8(i + j);
+            }
+
+            m_tile->unlockForWrite();
+        }
+    }
+
+private:
+    KisTileSP m_tile;
+    int m_numCycles;
+};
+
+class KisContentHashReader : public QRunnable
+{
+public:
+    KisContentHashReader(KisTileSP tile, QAtomicInt &stop)
+        : m_tile(tile), m_stop(stop)
+    {
+    }
+
+    void run() override {
+        while (!m_stop.loadAcquire()) {
+            m_tile->tileData()->contentHash();
+            m_tile->tileData()->version();
+        }
+    }
+
+private:
+    KisTileSP m_tile;
+    QAtomicInt &m_stop;
+};
+
+void KisTiledDataManagerTest::testContentHashConcurrentWrite()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    quint8 oddPixel1 = 128;
+    quint8 oddPixel2 = 129;
+
+    dm.clear(0, 0, 64, 64, &oddPixel1);
+
+    KisTileSP tile00 = dm.getTile(0, 0, true);
+
+    // the hash requested in the middle of the write is not cached...
+    tile00->lockForWrite();
+    KisTileData *td = tile00->tileData();
+    memset(tile00->data(), oddPixel2, TILESIZE / 2);
+    const quint64 partialHash = td->contentHash();
+    const quint64 partialVersion = td->version();
+    memset(tile00->data() + TILESIZE / 2, oddPixel2, TILESIZE / 2);
+
+    QCOMPARE(td->contentHash(), KisTileData::calculateContentHash(tile00->data(), TILESIZE));
+    QVERIFY(td->contentHash() != partialHash);
+    QVERIFY(td->version() != partialVersion);
+
+    // ...neither is the one requested right before unlocking
+    const quint64 hashBeforeUnlock = td->contentHash();
+    tile00->data()[0] = oddPixel1;
+    tile00->unlockForWrite();
+
+    QVERIFY(td->contentHash() != hashBeforeUnlock);
+    QCOMPARE(td->contentHash(), KisTileData::calculateContentHash(tile00->data(), TILESIZE));
+
+    // once nobody writes, the values are stable
+    const quint64 version = td->version();
+    QCOMPARE(td->version(), version);
+
+    // hash and version requested while another thread writes
+    QAtomicInt stop(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(3);
+
+    KisContentHashReader *reader1 = new KisContentHashReader(tile00, stop);
+    KisContentHashReader *reader2 = new KisContentHashReader(tile00, stop);
+    KisContentHashWriter *writer = new KisContentHashWriter(tile00, 1000);
+
+    pool.start(reader1);
+    pool.start(reader2);
+    pool.start(writer);
+
+    while (!pool.waitForDone(10)) {
+        if (pool.activeThreadCount() < 3) {
+            stop.storeRelease(1);
+        }
+    }
+
+    QCOMPARE(td->contentHash(), KisTileData::calculateContentHash(tile00->data(), TILESIZE));
+    QVERIFY(td->version() != version);
+}
+
+void KisTiledDataManagerTest::testParallelWrite()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    /**
+     * Enough tiles for several compression batches even on
+     * a machine with many cores. The tiles are uniform, smooth
+     * and noisy, so that they are compressed differently.
+     */
+    const int numTilesX = 48;
+    const int numTilesY = 48;
+    const QRect rect(0, 0, numTilesX * 64, numTilesY * 64);
+
+    QByteArray pixels(rect.width() * rect.height(), 0);
+
+    qsrand(1);
+    for (int y = 0; y < rect.height(); y++) {
+        for (int x = 0; x < rect.width(); x++) {
+            const int col = x / 64;
+            const int row = y / 64;
+
+            quint8 value;
+            switch ((col + row) % 3) {
+            case 0:
+                value = 0x80 | ((col * row) & 0x7F);
+                break;
+            case 1:
+                value = (x + y) & 0xFF;
+                break;
+            default:
+                value = qrand() & 0xFF;
+            }
+
+            pixels[y * rect.width() + x] = value;
+        }
+    }
+
+    dm.writeBytes((quint8*)pixels.data(), rect.x(), rect.y(), rect.width(), rect.height());
+
+    KoStoreFake parallelStore;
+    KisFakePaintDeviceWriter parallelWriter(&parallelStore);
+    QVERIFY(dm.write(parallelWriter));
+
+    parallelStore.startReading();
+    const QByteArray parallelData = parallelStore.device()->readAll();
+
+    // the stream written sequentially, the way it was done before
+    KoStoreFake sequentialStore;
+    KisFakePaintDeviceWriter sequentialWriter(&sequentialStore);
+
+    QVERIFY(sequentialWriter.write(QString("VERSION 2\n"
+                                           "TILEWIDTH 64\n"
+                                           "TILEHEIGHT 64\n"
+                                           "PIXELSIZE 1\n"
+                                           "DATA %1\n")
+                                   .arg(numTilesX * numTilesY).toLatin1()));
+
+    KisAbstractTileCompressorSP compressor =
+        KisTileCompressorFactory::create(2, KisImageConfig(true).saveCompression());
+
+    KisTileHashTableIterator iter(dm.m_hashTable);
+    KisTileSP tile;
+    int numTiles = 0;
+
+    while ((tile = iter.tile())) {
+        QVERIFY(compressor->writeTile(tile, sequentialWriter));
+        numTiles++;
+        ++iter;
+    }
+    QCOMPARE(numTiles, numTilesX * numTilesY);
+
+    sequentialStore.startReading();
+    const QByteArray sequentialData = sequentialStore.device()->readAll();
+
+    QCOMPARE(parallelData.size(), sequentialData.size());
+    QVERIFY(parallelData == sequentialData);
+
+    // round trip
+    KisTiledDataManager dstDM(1, &defaultPixel);
+    parallelStore.startReading();
+    QVERIFY(dstDM.read(parallelStore.device()));
+
+    QCOMPARE(dstDM.extent(), rect);
+
+    QByteArray dstPixels(pixels.size(), 0);
+    dstDM.readBytes((quint8*)dstPixels.data(), rect.x(), rect.y(), rect.width(), rect.height());
+    QVERIFY(dstPixels == pixels);
+}
+
+void KisTiledDataManagerTest::testDeadTiles()
+{
+    quint8 defaultPixel = 0;
+    KisTiledDataManager dm(1, &defaultPixel);
+
+    KisMementoSP memento0 = dm.getMemento();
+    KisTileSP createdTile = dm.getTile(0, 0, true);
+    KisTileSP otherTile = dm.getTile(1, 0, true);
+    dm.commit();
+
+    QVERIFY(!createdTile->isDead());
+    QVERIFY(!otherTile->isDead());
+
+    // undoing the transaction removes the created tiles
+    dm.rollback(memento0);
+    QVERIFY(createdTile->isDead());
+    QVERIFY(otherTile->isDead());
+
+    KisTileSP tile = dm.getTile(0, 0, true);
+    QVERIFY(!tile->isDead());
+
+    dm.clear();
+    QVERIFY(tile->isDead());
+}
+
 void KisTiledDataManagerTest::benchmarkReadOnlyTileLazy()
 {
     quint8 defaultPixel = 0;
@@ -604,7 +993,7 @@ void KisTiledDataManagerTest::benchmarkCOWImpl()
         for (int j = 0; j < 64; j++) {
             KisTileSP tile = dm.getTile(j, i, true);
             tile->lockForWrite();
-            tile->unlock();
+            tile->unlockForWrite();
         }
     }
 
@@ -620,7 +1009,7 @@ void KisTiledDataManagerTest::benchmarkCOWImpl()
             for (int j = 0; j < 64; j++) {
                 KisTileSP tile = dm.getTile(j, i, true);
                 tile->lockForWrite();
-                tile->unlock();
+                tile->unlockForWrite();
             }
         }
 
@@ -707,7 +1096,7 @@ public:
                     tile = dm.getTile(m_accessRect.x() / TILE_DIMENSION,
                                       m_accessRect.y() / TILE_DIMENSION, true);
                     tile->lockForWrite();
-                    tile->unlock();
+                    tile->unlockForWrite();
 
                     tile = dm.getOldTile(m_accessRect.x() / TILE_DIMENSION,
                                          m_accessRect.y() / TILE_DIMENSION);
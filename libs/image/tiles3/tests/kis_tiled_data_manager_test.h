@@ -52,6 +52,13 @@ private Q_SLOTS:
     void testTransactions();
     void testPurgeHistory();
     void testUndoSetDefaultPixel();
+    void testPurgeUniformTiles();
+    void testBitBltDefaultTiles();
+    void testHistoryCompaction();
+    void testContentHash();
+    void testContentHashConcurrentWrite();
+    void testParallelWrite();
+    void testDeadTiles();
 
     void benchmarkReadOnlyTileLazy();
     void benchmarkSharedPointers();
@@ -23,8 +23,10 @@
 #include <QList>
 #include <QMutex>
 #include <QThreadStorage>
+#include <QWaitCondition>
 
 #include <KoColorSpace.h>
+#include <KoLut3DColorConversionTransformation.h>
 
 struct KoColorConversionCacheKey {
 
@@ -58,8 +60,8 @@ uint qHash(const KoColorConversionCacheKey& key)
 
 struct KoColorConversionCache::CachedTransformation {
 
-    CachedTransformation(KoColorConversionTransformation* _transfo)
-        : transfo(_transfo), use(0)
+    CachedTransformation(KoColorConversionTransformation* _transfo, bool _shared = false)
+        : transfo(_transfo), use(0), shared(_shared)
     {}
 
     ~CachedTransformation() {
@@ -67,19 +69,56 @@ struct KoColorConversionCache::CachedTransformation {
     }
 
     bool available() {
-        return use == 0;
+        return shared || use.load() == 0;
+    }
+
+    bool unused() {
+        return use.load() == 0;
     }
 
     KoColorConversionTransformation* transfo;
-    int use;
+    QAtomicInt use;
+
+    /**
+     * A shared transformation is used by all the threads at the same
+     * time. It is possible only for the transformations that don't
+     * change their state while converting, like the 3D lookup tables.
+     */
+    bool shared;
 };
 
 typedef QPair<KoColorConversionCacheKey, KoCachedColorConversionTransformation> FastPathCacheItem;
 
+namespace {
+
+KoColorConversionTransformation* createLut3DTransformation(const KoColorSpace* src,
+                                                           const KoColorSpace* dst,
+                                                           KoColorConversionTransformation::Intent renderingIntent,
+                                                           KoColorConversionTransformation::ConversionFlags conversionFlags)
+{
+    conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
+    KoColorConversionTransformation *exactTransfo = src->createColorConverter(dst, renderingIntent, conversionFlags);
+
+    KoColorConversionTransformation *lutTransfo = new KoLut3DColorConversionTransformation(exactTransfo);
+    delete exactTransfo;
+
+    return lutTransfo;
+}
+
+}
+
 struct KoColorConversionCache::Private {
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*> cache;
     QMutex cacheMutex;
 
+    /**
+     * The keys of the lookup tables being sampled right now. The
+     * sampling is done with cacheMutex unlocked, the other threads
+     * asking for the same table wait for lutReady.
+     */
+    QList<KoColorConversionCacheKey> lutsInProgress;
+    QWaitCondition lutReady;
+
     QThreadStorage<FastPathCacheItem*> fastStorage;
 };
 
@@ -114,22 +153,58 @@ KoCachedColorConversionTransformation KoColorConversionCache::cachedConverter(co
 
     cacheItem = 0;
 
+    const bool useLut3D =
+        _conversionFlags.testFlag(KoColorConversionTransformation::UseLut3D) &&
+        KoLut3DColorConversionTransformation::isSupported(src, dst);
+
     QMutexLocker lock(&d->cacheMutex);
-    QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
-    if (cachedTransfos.size() != 0) {
+
+    forever {
+        QList< CachedTransformation* > cachedTransfos = d->cache.values(key);
         Q_FOREACH (CachedTransformation* ct, cachedTransfos) {
             if (ct->available()) {
-                ct->transfo->setSrcColorSpace(src);
-                ct->transfo->setDstColorSpace(dst);
+                // the shared transformation may be in use by other threads
+                if (!ct->shared) {
+                    ct->transfo->setSrcColorSpace(src);
+                    ct->transfo->setDstColorSpace(dst);
+                }
 
                 cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
                 break;
             }
         }
+
+        if (cacheItem || !useLut3D || !d->lutsInProgress.contains(key)) break;
+
+        d->lutReady.wait(&d->cacheMutex);
     }
+
     if (!cacheItem) {
-        KoColorConversionTransformation* transfo = src->createColorConverter(dst, _renderingIntent, _conversionFlags);
-        CachedTransformation* ct = new CachedTransformation(transfo);
+        CachedTransformation* ct = 0;
+
+        if (useLut3D) {
+            /**
+             * Sampling the table is expensive, so it is done only once
+             * per key and without blocking the other conversions
+             */
+            d->lutsInProgress.append(key);
+            lock.unlock();
+
+            KoColorConversionTransformation* transfo =
+                createLut3DTransformation(src, dst, _renderingIntent, _conversionFlags);
+
+            lock.relock();
+            d->lutsInProgress.removeOne(key);
+            d->lutReady.wakeAll();
+
+            ct = new CachedTransformation(transfo, true);
+        } else {
+            const KoColorConversionTransformation::ConversionFlags conversionFlags =
+                _conversionFlags & ~KoColorConversionTransformation::UseLut3D;
+
+            ct = new CachedTransformation(src->createColorConverter(dst, _renderingIntent, conversionFlags));
+        }
+
         d->cache.insert(key, ct);
         cacheItem = new FastPathCacheItem(key, KoCachedColorConversionTransformation(this, ct));
     }
@@ -146,7 +221,7 @@ void KoColorConversionCache::colorSpaceIsDestroyed(const KoColorSpace* cs)
     QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator endIt = d->cache.end();
     for (QMultiHash< KoColorConversionCacheKey, CachedTransformation*>::iterator it = d->cache.begin(); it != endIt;) {
         if (it.key().src == cs || it.key().dst == cs) {
-            Q_ASSERT(it.value()->available()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
+            Q_ASSERT(it.value()->unused()); // That's terribely evil, if that assert fails, that means that someone is using a color transformation with a color space which is currently being deleted
             delete it.value();
             it = d->cache.erase(it);
         } else {
@@ -168,18 +243,18 @@ KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(KoC
     Q_ASSERT(transfo->available());
     d->cache = cache;
     d->transfo = transfo;
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::KoCachedColorConversionTransformation(const KoCachedColorConversionTransformation& rhs) : d(new Private(*rhs.d))
 {
-    d->transfo->use++;
+    d->transfo->use.ref();
 }
 
 KoCachedColorConversionTransformation::~KoCachedColorConversionTransformation()
 {
-    d->transfo->use--;
-    Q_ASSERT(d->transfo->use >= 0);
+    d->transfo->use.deref();
+    Q_ASSERT(d->transfo->use.load() >= 0);
     delete d;
 }
 
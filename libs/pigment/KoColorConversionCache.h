@@ -24,13 +24,15 @@ class KoCachedColorConversionTransformation;
 class KoColorSpace;
 
 #include "KoColorConversionTransformation.h"
+#include "kritapigment_export.h"
 
 /**
  * This class holds a cache of KoColorConversionTransformations.
  *
  * This class is not part of public API, and can be changed without notice.
+ * It is exported for the unittests only.
  */
-class KoColorConversionCache
+class KRITAPIGMENT_EXPORT KoColorConversionCache
 {
 public:
     struct CachedTransformation;
@@ -43,6 +45,13 @@ public:
      * or create one.
      * @param src source color space
      * @param dst destination color space
+     *
+     * If \p conversionFlags contain KoColorConversionTransformation::UseLut3D
+     * and the pair of color spaces is supported by
+     * KoLut3DColorConversionTransformation, the exact transformation is
+     * sampled into a 3D lookup table once, and the table is cached instead.
+     * Unlike the other transformations, the table is shared by all the
+     * threads asking for it.
      */
     KoCachedColorConversionTransformation cachedConverter(const KoColorSpace* src,
                                                           const KoColorSpace* dst,
@@ -67,8 +76,9 @@ private:
  * the pool of available color convertion transformation.
  *
  * This class is not part of public API, and can be changed without notice.
+ * It is exported for the unittests only.
  */
-class KoCachedColorConversionTransformation
+class KRITAPIGMENT_EXPORT KoCachedColorConversionTransformation
 {
     friend class KoColorConversionCache;
 private:
@@ -20,6 +20,7 @@
 #include "KoColorConversionSystem.h"
 #include "KoColorConversionSystem_p.h"
 
+#include <QDataStream>
 #include <QHash>
 #include <QString>
 
@@ -62,6 +63,7 @@ KoColorConversionSystem::Node* KoColorConversionSystem::insertEngine(const KoCol
     n->profileName = engine->id();
     n->referenceDepth = 64; // engine don't have reference depth,
     d->graph.insert(key, n);
+    d->addProvider(engine->id());
     n->init(engine);
     return n;
 }
@@ -70,6 +72,8 @@ KoColorConversionSystem::Node* KoColorConversionSystem::insertEngine(const KoCol
 void KoColorConversionSystem::insertColorSpace(const KoColorSpaceFactory* csf)
 {
     dbgPigment << "Inserting color space " << csf->name() << " (" << csf->id() << ") Model: " << csf->colorModelId() << " Depth: " << csf->colorDepthId() << " into the CCS";
+    d->invalidatePaths();
+    d->addProvider(csf->id());
     const QList<const KoColorProfile*> profiles = d->registryInterface->profilesFor(csf);
     QString modelId = csf->colorModelId().id();
     QString depthId = csf->colorDepthId().id();
@@ -127,6 +131,7 @@ void KoColorConversionSystem::insertColorSpace(const KoColorSpaceFactory* csf)
 void KoColorConversionSystem::insertColorProfile(const KoColorProfile* _profile)
 {
     dbgPigmentCCS << _profile->name();
+    d->invalidatePaths();
     const QList< const KoColorSpaceFactory* >& factories = d->registryInterface->colorSpacesFor(_profile);
     Q_FOREACH (const KoColorSpaceFactory* factory, factories) {
         QString modelId = factory->colorModelId().id();
@@ -496,6 +501,31 @@ KoColorConversionSystem::Path KoColorConversionSystem::findBestPath(const KoColo
 {
     Q_ASSERT(srcNode);
     Q_ASSERT(dstNode);
+
+    QMutexLocker l(&d->pathsMutex);
+
+    const QPair<const Node*, const Node*> key(srcNode, dstNode);
+
+    QHash<QPair<const Node*, const Node*>, Path>::const_iterator it = d->bestPaths.constFind(key);
+    if (it != d->bestPaths.constEnd()) {
+        return it.value();
+    }
+
+    Path path = warmPath(srcNode, dstNode);
+
+    if (path.isEmpty()) {
+        path = searchBestPath(srcNode, dstNode);
+    }
+
+    if (!path.isEmpty()) {
+        d->bestPaths.insert(key, path);
+    }
+
+    return path;
+}
+
+KoColorConversionSystem::Path KoColorConversionSystem::searchBestPath(const KoColorConversionSystem::Node* srcNode, const KoColorConversionSystem::Node* dstNode) const
+{
     dbgPigmentCCS << "Find best path between " << srcNode->id() << " and  " << dstNode->id();
     if (srcNode->isHdr &&  dstNode->isHdr) {
         return findBestPathImpl(srcNode, dstNode, false);
@@ -503,3 +533,124 @@ KoColorConversionSystem::Path KoColorConversionSystem::findBestPath(const KoColo
         return findBestPathImpl(srcNode, dstNode, true);
     }
 }
+
+// -- Memoization of the paths --
+
+KoColorConversionSystem::Path KoColorConversionSystem::warmPath(const KoColorConversionSystem::Node* srcNode, const KoColorConversionSystem::Node* dstNode) const
+{
+    if (d->warmPaths.isEmpty()) return Path();
+
+    if (d->warmPathsState == Private::WarmPathsUnchecked) {
+        d->warmPathsState = d->sortedProviders() == d->warmPathsProviders ?
+            Private::WarmPathsValid : Private::WarmPathsInvalid;
+    }
+
+    if (d->warmPathsState != Private::WarmPathsValid) return Path();
+
+    /**
+     * Every node and vertex of the loaded path is resolved in the
+     * current graph, so the path is valid only if the graph still
+     * has all of them. The rest of the graph doesn't matter.
+     */
+    const QList<QStringList> keys = d->warmPaths.value(qMakePair(srcNode->id(), dstNode->id()));
+    if (keys.size() < 2) return Path();
+
+    Path path;
+    const Node *prevNode = 0;
+
+    Q_FOREACH (const QStringList &key, keys) {
+        if (key.size() != 3) return Path();
+
+        const Node *node = nodeFor(NodeKey(key[0], key[1], key[2]));
+        if (!node || !node->isInitialized) return Path();
+
+        if (prevNode) {
+            Vertex *vertex = 0;
+
+            Q_FOREACH (Vertex *v, prevNode->outputVertexes) {
+                if (v->dstNode == node) {
+                    vertex = v;
+                    break;
+                }
+            }
+
+            if (!vertex) return Path();
+            path.appendVertex(vertex);
+        }
+
+        prevNode = node;
+    }
+
+    if (path.startNode() != srcNode || path.endNode() != dstNode) return Path();
+
+    // the same criteria as used by findBestPathImpl()
+    const bool ignoreHdr = !(srcNode->isHdr && dstNode->isHdr);
+    const bool ignoreColorCorrectness = srcNode->isGray || dstNode->isGray;
+    PathQualityChecker pQC(qMin(srcNode->referenceDepth, dstNode->referenceDepth), ignoreHdr, ignoreColorCorrectness);
+    path.isGood = pQC.isGoodPath(path);
+
+    return path;
+}
+
+QByteArray KoColorConversionSystem::saveCachedPaths() const
+{
+    QMutexLocker l(&d->pathsMutex);
+
+    /**
+     * Only the paths requested in this session are saved: either
+     * found by the search or the loaded ones which were confirmed to
+     * be valid in the current graph
+     */
+    QHash<QPair<QString, QString>, QList<QStringList> > paths;
+
+    for (auto it = d->bestPaths.constBegin(); it != d->bestPaths.constEnd(); ++it) {
+        const Path &path = it.value();
+
+        QList<QStringList> keys;
+        keys << (QStringList() << path.startNode()->modelId << path.startNode()->depthId << path.startNode()->profileName);
+
+        Q_FOREACH (const Vertex *v, path.vertexes) {
+            keys << (QStringList() << v->dstNode->modelId << v->dstNode->depthId << v->dstNode->profileName);
+        }
+
+        paths.insert(qMakePair(it.key().first->id(), it.key().second->id()), keys);
+    }
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << quint32(3); // version of the format
+    stream << d->sortedProviders();
+    stream << paths;
+
+    return data;
+}
+
+void KoColorConversionSystem::loadCachedPaths(const QByteArray &data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 version = 0;
+    QStringList providers;
+    QHash<QPair<QString, QString>, QList<QStringList> > paths;
+
+    stream >> version;
+    if (version != 3) return;
+
+    stream >> providers;
+    stream >> paths;
+
+    if (stream.status() != QDataStream::Ok) {
+        warnPigment << "Failed to load the cached color conversion paths";
+        return;
+    }
+
+    QMutexLocker l(&d->pathsMutex);
+
+    d->bestPaths.clear();
+    d->warmPaths = paths;
+    d->warmPathsProviders = providers;
+    d->warmPathsState = Private::WarmPathsUnchecked;
+}
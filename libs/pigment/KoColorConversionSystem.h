@@ -28,6 +28,7 @@ class KoID;
 
 #include "KoColorConversionTransformation.h"
 
+#include <QByteArray>
 #include <QList>
 #include <QPair>
 
@@ -119,6 +120,29 @@ public:
      * @return true if there is a good path between two color spaces
      */
     bool existsGoodPath(const QString& srcModelId, const QString& srcDepthId, const QString& srcProfileName, const QString& dstModelId, const QString& dstDepthId, const QString& dstProfileName) const;
+public:
+    /**
+     * The best paths are memoized: the graph is searched only once for
+     * every pair of nodes, until a new color space or profile is
+     * inserted into the graph.
+     *
+     * This function serializes the memoized paths as lists of node
+     * keys, so that they could be loaded on the next start with
+     * loadCachedPaths(). Only the paths requested in this session are
+     * saved, together with the ids of the registered engines and
+     * color space factories.
+     */
+    QByteArray saveCachedPaths() const;
+    /**
+     * Loads the paths saved by saveCachedPaths(). The loaded paths are
+     * used only if the same engines and color space factories are
+     * registered now, and a path is used instead of searching the
+     * graph only if all its nodes and vertexes exist in the current
+     * graph. Everything is checked lazily, when a path is requested,
+     * so the function can be called before all the color spaces and
+     * profiles are registered.
+     */
+    void loadCachedPaths(const QByteArray &data);
 private:
     QString vertexToDot(Vertex* v, const QString &options) const;
 private:
@@ -167,6 +191,17 @@ private:
      * looks for the best path between two nodes
      */
     Path findBestPath(const Node* srcNode, const Node* dstNode) const;
+    /**
+     * Don't call that function, but rather findBestPath, which memoizes
+     * the result
+     * @internal
+     */
+    Path searchBestPath(const Node* srcNode, const Node* dstNode) const;
+    /**
+     * @return the path loaded by loadCachedPaths() or an empty path
+     *         if there is no valid one
+     */
+    Path warmPath(const Node* srcNode, const Node* dstNode) const;
     /**
      * Delete all the paths of the list given in argument.
      */
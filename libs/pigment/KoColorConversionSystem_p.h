@@ -27,6 +27,10 @@
 #include "KoColorSpaceEngine.h"
 
 #include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
 
 struct KoColorConversionSystem::Node {
 
@@ -268,11 +272,70 @@ uint qHash(const KoColorConversionSystem::NodeKey &key)
 
 struct Q_DECL_HIDDEN KoColorConversionSystem::Private {
 
-    Private(RegistryInterface *_registryInterface) : registryInterface(_registryInterface) {}
+    Private(RegistryInterface *_registryInterface)
+        : registryInterface(_registryInterface),
+          warmPathsState(WarmPathsUnchecked)
+    {}
 
     QHash<NodeKey, Node*> graph;
     QList<Vertex*> vertexes;
     RegistryInterface *registryInterface;
+
+    /**
+     * The best paths found so far. The nodes and vertexes are never
+     * deleted, so the pointers stay valid until the graph changes.
+     */
+    QHash<QPair<const Node*, const Node*>, Path> bestPaths;
+
+    /**
+     * The paths loaded by loadCachedPaths(). They are stored as lists
+     * of node keys ({model, depth, profile}) and are resolved into the
+     * real nodes on request. A path is used only if all its nodes
+     * and vertexes still exist in the graph.
+     */
+    QHash<QPair<QString, QString>, QList<QStringList> > warmPaths;
+
+    /**
+     * The ids of the engines and color space factories the warm paths
+     * were found with. The loaded paths are used only if exactly the
+     * same ones are registered now: a new engine or factory brings new
+     * kinds of vertexes, which may give a better path. The profiles
+     * are not included, a new profile adds only the nodes of the same
+     * kind as the already existing ones.
+     */
+    QStringList warmPathsProviders;
+
+    /**
+     * The ids of the engines and color space factories inserted into
+     * the graph
+     */
+    QSet<QString> providers;
+
+    enum WarmPathsState {
+        WarmPathsUnchecked,
+        WarmPathsValid,
+        WarmPathsInvalid
+    };
+    WarmPathsState warmPathsState;
+
+    QMutex pathsMutex;
+
+    void invalidatePaths() {
+        QMutexLocker l(&pathsMutex);
+        bestPaths.clear();
+    }
+
+    void addProvider(const QString &id) {
+        QMutexLocker l(&pathsMutex);
+        providers.insert(id);
+        warmPathsState = WarmPathsUnchecked;
+    }
+
+    QStringList sortedProviders() const {
+        QStringList result = providers.toList();
+        result.sort();
+        return result;
+    }
 };
 
 #define CHECK_ONE_AND_NOT_THE_OTHER(name) \
@@ -58,7 +58,8 @@ public:
         BlackpointCompensation  = 0x2000,
         NoWhiteOnWhiteFixup     = 0x0004,    // Don't fix scum dot
         HighQuality             = 0x0400,    // Use more memory to give better accurancy
-        LowQuality              = 0x0800    // Use less memory to minimize resouces
+        LowQuality              = 0x0800,    // Use less memory to minimize resouces
+        UseLut3D                = 0x10000000 // Not an lcms flag: convert through a precomputed 3D lookup table, see KoLut3DColorConversionTransformation
     };
     Q_DECLARE_FLAGS(ConversionFlags, ConversionFlag)
 
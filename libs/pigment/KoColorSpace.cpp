@@ -32,6 +32,7 @@
 #include "KoColorProfile.h"
 #include "KoCopyColorConversionTransformation.h"
 #include "KoFallBackColorTransformation.h"
+#include "KoLut3DColorConversionTransformation.h"
 #include "KoUniqueNumberForIdServer.h"
 #include "KoMixColorsOp.h"
 #include "KoConvolutionOp.h"
@@ -442,7 +443,27 @@ KoColorConversionTransformation * KoColorSpace::createProofingTransform(const Ko
     }
     if (!d->iccEngine) return 0;
 
-    return d->iccEngine->createColorProofingTransformation(this, dstColorSpace, proofingSpace, renderingIntent, proofingIntent, conversionFlags, gamutWarning, adaptationState);
+    /**
+     * The gamut alarm is a discontinuity in the transformation, so
+     * it cannot be interpolated by a lookup table
+     */
+    const bool useLut3D =
+        conversionFlags.testFlag(KoColorConversionTransformation::UseLut3D) &&
+        !conversionFlags.testFlag(KoColorConversionTransformation::GamutCheck) &&
+        KoLut3DColorConversionTransformation::isSupported(this, dstColorSpace);
+
+    conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
+
+    KoColorConversionTransformation *transform =
+        d->iccEngine->createColorProofingTransformation(this, dstColorSpace, proofingSpace, renderingIntent, proofingIntent, conversionFlags, gamutWarning, adaptationState);
+
+    if (useLut3D && transform) {
+        KoColorConversionTransformation *lutTransform = new KoLut3DColorConversionTransformation(transform);
+        delete transform;
+        transform = lutTransform;
+    }
+
+    return transform;
 }
 
 bool KoColorSpace::proofPixelsTo(const quint8 *src,
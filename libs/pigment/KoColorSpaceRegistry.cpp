@@ -25,6 +25,8 @@
 #include <QReadWriteLock>
 #include <QStringList>
 #include <QDir>
+#include <QFile>
+#include <QSaveFile>
 #include <QGlobalStatic>
 
 #include "KoPluginLoader.h"
@@ -721,6 +723,39 @@ const KoColorConversionSystem* KoColorSpaceRegistry::colorConversionSystem() con
     return d->colorConversionSystem;
 }
 
+bool KoColorSpaceRegistry::saveColorConversionPaths(const QString &fileName) const
+{
+    QByteArray data;
+
+    {
+        QReadLocker l(&d->registrylock);
+        data = d->colorConversionSystem->saveCachedPaths();
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnPigment << "Failed to save the color conversion paths to" << fileName;
+        return false;
+    }
+
+    file.write(data);
+    return file.commit();
+}
+
+bool KoColorSpaceRegistry::loadColorConversionPaths(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+
+    QWriteLocker l(&d->registrylock);
+    d->colorConversionSystem->loadCachedPaths(data);
+    return true;
+}
+
 KoColorConversionCache* KoColorSpaceRegistry::colorConversionCache() const
 {
     return d->colorConversionCache;
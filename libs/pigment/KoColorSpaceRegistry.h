@@ -310,6 +310,26 @@ public:
      */
     KoColorConversionCache* colorConversionCache() const;
 
+    /**
+     * Saves the best color conversion paths found by the conversion
+     * system into \p fileName, so that the next session could skip the
+     * search with loadColorConversionPaths().
+     *
+     * @return false if the file cannot be written
+     */
+    bool saveColorConversionPaths(const QString &fileName) const;
+
+    /**
+     * Warm start of the color conversion system: loads the paths
+     * saved by saveColorConversionPaths(). The paths are ignored if
+     * the registered color space engines and factories differ from
+     * the ones they were saved with. A single path is ignored if any
+     * of its color spaces or profiles is missing.
+     *
+     * @return false if the file cannot be read
+     */
+    bool loadColorConversionPaths(const QString &fileName);
+
     /**
      * @return a permanent colorspace owned by the registry, of the same type and profile
      *         as the one given in argument
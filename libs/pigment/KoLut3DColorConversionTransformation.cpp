@@ -0,0 +1,245 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoLut3DColorConversionTransformation.h"
+
+#include <QVector>
+
+#include <KoChannelInfo.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+#include <KoColorModelStandardIds.h>
+
+namespace {
+
+/**
+ * The number of grid nodes along every axis. It is the same size LCMS
+ * uses for its own high resolution precalculated tables of RGB data.
+ */
+const int GRID_SIZE = 33;
+
+bool isSupportedColorSpace(const KoColorSpace *cs)
+{
+    if (cs->colorDepthId() != Integer8BitsColorDepthID &&
+        cs->colorDepthId() != Integer16BitsColorDepthID) {
+
+        return false;
+    }
+
+    const QList<KoChannelInfo*> channels = cs->channels();
+    if (channels.size() != 4) return false;
+
+    for (int i = 0; i < channels.size(); i++) {
+        const KoChannelInfo *channel = channels[i];
+        const KoChannelInfo::enumChannelType expectedType =
+            i < 3 ? KoChannelInfo::COLOR : KoChannelInfo::ALPHA;
+
+        if (channel->channelType() != expectedType ||
+            channel->pos() != i * channel->size()) {
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+struct Q_DECL_HIDDEN KoLut3DColorConversionTransformation::Private
+{
+    virtual ~Private() {}
+    virtual void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const = 0;
+};
+
+template <typename src_channel_type, typename dst_channel_type>
+struct Q_DECL_HIDDEN KoLut3DColorConversionTransformation::LutImpl : public KoLut3DColorConversionTransformation::Private
+{
+    typedef KoColorSpaceMathsTraits<src_channel_type> SrcTraits;
+    typedef KoColorSpaceMathsTraits<dst_channel_type> DstTraits;
+
+    /**
+     * The nodes are stored as three floats (in the units of the
+     * destination channels) with the first channel of the source
+     * changing the fastest
+     */
+    static const int STRIDE_X = 3;
+    static const int STRIDE_Y = GRID_SIZE * STRIDE_X;
+    static const int STRIDE_Z = GRID_SIZE * STRIDE_Y;
+
+    LutImpl(const KoColorConversionTransformation *exactTransformation)
+    {
+        const int numNodes = GRID_SIZE * GRID_SIZE * GRID_SIZE;
+
+        QVector<src_channel_type> srcPixels(numNodes * 4);
+        QVector<dst_channel_type> dstPixels(numNodes * 4);
+
+        src_channel_type *srcIt = srcPixels.data();
+
+        for (int z = 0; z < GRID_SIZE; z++) {
+            for (int y = 0; y < GRID_SIZE; y++) {
+                for (int x = 0; x < GRID_SIZE; x++) {
+                    srcIt[0] = nodeValue(x);
+                    srcIt[1] = nodeValue(y);
+                    srcIt[2] = nodeValue(z);
+                    srcIt[3] = SrcTraits::unitValue;
+                    srcIt += 4;
+                }
+            }
+        }
+
+        exactTransformation->transform(reinterpret_cast<const quint8*>(srcPixels.constData()),
+                                       reinterpret_cast<quint8*>(dstPixels.data()),
+                                       numNodes);
+
+        nodes.resize(numNodes * 3);
+
+        const dst_channel_type *dstIt = dstPixels.constData();
+        float *nodeIt = nodes.data();
+
+        for (int i = 0; i < numNodes; i++) {
+            nodeIt[0] = dstIt[0];
+            nodeIt[1] = dstIt[1];
+            nodeIt[2] = dstIt[2];
+
+            dstIt += 4;
+            nodeIt += 3;
+        }
+    }
+
+    static src_channel_type nodeValue(int index) {
+        return src_channel_type(qRound(qreal(index) * SrcTraits::unitValue / (GRID_SIZE - 1)));
+    }
+
+    static inline void locate(src_channel_type value, int *index, float *fraction) {
+        const float pos = float(value) * (float(GRID_SIZE - 1) / SrcTraits::unitValue);
+        *index = qMin(int(pos), GRID_SIZE - 2);
+        *fraction = pos - *index;
+    }
+
+    void transform(const quint8 *src8, quint8 *dst8, qint32 nPixels) const override {
+        const src_channel_type *src = reinterpret_cast<const src_channel_type*>(src8);
+        dst_channel_type *dst = reinterpret_cast<dst_channel_type*>(dst8);
+
+        const float maxValue = DstTraits::unitValue;
+
+        for (qint32 i = 0; i < nPixels; i++) {
+            int ix, iy, iz;
+            float fx, fy, fz;
+
+            locate(src[0], &ix, &fx);
+            locate(src[1], &iy, &fy);
+            locate(src[2], &iz, &fz);
+
+            const float *c000 = nodes.constData() + iz * STRIDE_Z + iy * STRIDE_Y + ix * STRIDE_X;
+            const float *c111 = c000 + STRIDE_X + STRIDE_Y + STRIDE_Z;
+            const float *c1;
+            const float *c2;
+            float w0, w1, w2, w3;
+
+            /**
+             * Tetrahedral interpolation: the cube is split into six
+             * tetrahedra along its main diagonal, the one containing
+             * the point is selected by the order of the fractions.
+             */
+            if (fx >= fy) {
+                if (fy >= fz) {
+                    c1 = c000 + STRIDE_X;
+                    c2 = c000 + STRIDE_X + STRIDE_Y;
+                    w0 = 1.0f - fx; w1 = fx - fy; w2 = fy - fz; w3 = fz;
+                } else if (fx >= fz) {
+                    c1 = c000 + STRIDE_X;
+                    c2 = c000 + STRIDE_X + STRIDE_Z;
+                    w0 = 1.0f - fx; w1 = fx - fz; w2 = fz - fy; w3 = fy;
+                } else {
+                    c1 = c000 + STRIDE_Z;
+                    c2 = c000 + STRIDE_X + STRIDE_Z;
+                    w0 = 1.0f - fz; w1 = fz - fx; w2 = fx - fy; w3 = fy;
+                }
+            } else {
+                if (fz >= fy) {
+                    c1 = c000 + STRIDE_Z;
+                    c2 = c000 + STRIDE_Y + STRIDE_Z;
+                    w0 = 1.0f - fz; w1 = fz - fy; w2 = fy - fx; w3 = fx;
+                } else if (fz >= fx) {
+                    c1 = c000 + STRIDE_Y;
+                    c2 = c000 + STRIDE_Y + STRIDE_Z;
+                    w0 = 1.0f - fy; w1 = fy - fz; w2 = fz - fx; w3 = fx;
+                } else {
+                    c1 = c000 + STRIDE_Y;
+                    c2 = c000 + STRIDE_X + STRIDE_Y;
+                    w0 = 1.0f - fy; w1 = fy - fx; w2 = fx - fz; w3 = fz;
+                }
+            }
+
+            for (int ch = 0; ch < 3; ch++) {
+                const float value = w0 * c000[ch] + w1 * c1[ch] + w2 * c2[ch] + w3 * c111[ch];
+                dst[ch] = dst_channel_type(qBound(0.0f, value + 0.5f, maxValue));
+            }
+
+            dst[3] = KoColorSpaceMaths<src_channel_type, dst_channel_type>::scaleToA(src[3]);
+
+            src += 4;
+            dst += 4;
+        }
+    }
+
+    QVector<float> nodes;
+};
+
+KoLut3DColorConversionTransformation::KoLut3DColorConversionTransformation(const KoColorConversionTransformation *exactTransformation)
+    : KoColorConversionTransformation(exactTransformation->srcColorSpace(),
+                                      exactTransformation->dstColorSpace(),
+                                      exactTransformation->renderingIntent(),
+                                      exactTransformation->conversionFlags())
+    , d(createLut(exactTransformation))
+{
+}
+
+KoLut3DColorConversionTransformation::~KoLut3DColorConversionTransformation()
+{
+    delete d;
+}
+
+bool KoLut3DColorConversionTransformation::isSupported(const KoColorSpace *srcCs, const KoColorSpace *dstCs)
+{
+    return isSupportedColorSpace(srcCs) && isSupportedColorSpace(dstCs);
+}
+
+void KoLut3DColorConversionTransformation::transform(const quint8 *src, quint8 *dst, qint32 nPixels) const
+{
+    d->transform(src, dst, nPixels);
+}
+
+KoLut3DColorConversionTransformation::Private*
+KoLut3DColorConversionTransformation::createLut(const KoColorConversionTransformation *exactTransformation)
+{
+    Q_ASSERT(isSupported(exactTransformation->srcColorSpace(), exactTransformation->dstColorSpace()));
+
+    const bool src8 = exactTransformation->srcColorSpace()->colorDepthId() == Integer8BitsColorDepthID;
+    const bool dst8 = exactTransformation->dstColorSpace()->colorDepthId() == Integer8BitsColorDepthID;
+
+    if (src8) {
+        return dst8 ?
+            static_cast<Private*>(new LutImpl<quint8, quint8>(exactTransformation)) :
+            static_cast<Private*>(new LutImpl<quint8, quint16>(exactTransformation));
+    } else {
+        return dst8 ?
+            static_cast<Private*>(new LutImpl<quint16, quint8>(exactTransformation)) :
+            static_cast<Private*>(new LutImpl<quint16, quint16>(exactTransformation));
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _KO_LUT3D_COLOR_CONVERSION_TRANSFORMATION_H_
+#define _KO_LUT3D_COLOR_CONVERSION_TRANSFORMATION_H_
+
+#include <KoColorConversionTransformation.h>
+
+#include "kritapigment_export.h"
+
+/**
+ * This color conversion transformation replaces an exact (usually
+ * LCMS-based) transformation with a precomputed 3D lookup table.
+ *
+ * On creation the exact transformation is sampled on a regular grid
+ * of the source color space. After that every pixel is converted with
+ * a tetrahedral interpolation between the four nearest grid nodes, so
+ * the cost of the conversion doesn't depend on the complexity of the
+ * profiles anymore. The result is not bit-exact: the error is bounded
+ * by the curvature of the exact transformation inside a single grid
+ * cell and is usually below one level of an 8-bit destination.
+ *
+ * Only integer (8- and 16-bit) color spaces with three color channels
+ * followed by an alpha channel are supported, both for the source and
+ * for the destination. That covers RGB and Lab data going to the
+ * display or being soft-proofed. Check it with isSupported() before
+ * creating the transformation.
+ *
+ * The transformation has no mutable state, so a single instance can
+ * be used from several threads at the same time.
+ */
+class KRITAPIGMENT_EXPORT KoLut3DColorConversionTransformation : public KoColorConversionTransformation
+{
+public:
+    /**
+     * Create a lookup table by sampling \p exactTransformation. The
+     * exact transformation is not used after the constructor returns,
+     * so the caller may delete it right away.
+     */
+    KoLut3DColorConversionTransformation(const KoColorConversionTransformation *exactTransformation);
+    ~KoLut3DColorConversionTransformation() override;
+
+    /**
+     * @return true if the conversion between \p srcCs and \p dstCs
+     *         can be done with a lookup table
+     */
+    static bool isSupported(const KoColorSpace *srcCs, const KoColorSpace *dstCs);
+
+    void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const override;
+
+private:
+    struct Private;
+    template <typename src_channel_type, typename dst_channel_type>
+    struct LutImpl;
+
+    static Private* createLut(const KoColorConversionTransformation *exactTransformation);
+
+    Private* const d;
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "KoColorConversionBenchmark.h"
+
+#include <QTest>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <KoColorSpaceRegistry.h>
+#include <KoColorSpace.h>
+#include <KoColorModelStandardIds.h>
+
+/**
+ * The pixels are converted in the same portions as KisPaintDevice
+ * does: a scanline is 64 pixels (the width of a tile), a tile is
+ * 64x64 pixels.
+ */
+#define TILE_SIZE 64
+#define NB_TILES 256
+#define NB_PIXELS (NB_TILES * TILE_SIZE * TILE_SIZE)
+
+void KoColorConversionBenchmark::createRowsColumns()
+{
+    QTest::addColumn<QString>("srcModelID");
+    QTest::addColumn<QString>("srcDepthID");
+    QTest::addColumn<QString>("dstModelID");
+    QTest::addColumn<QString>("dstDepthID");
+
+    QTest::newRow("RGBA16 -> CMYKA16")
+        << RGBAColorModelID.id() << Integer16BitsColorDepthID.id()
+        << CMYKAColorModelID.id() << Integer16BitsColorDepthID.id();
+
+    QTest::newRow("CMYKA16 -> RGBA16")
+        << CMYKAColorModelID.id() << Integer16BitsColorDepthID.id()
+        << RGBAColorModelID.id() << Integer16BitsColorDepthID.id();
+
+    QTest::newRow("RGBA8 -> LABA16")
+        << RGBAColorModelID.id() << Integer8BitsColorDepthID.id()
+        << LABAColorModelID.id() << Integer16BitsColorDepthID.id();
+
+    QTest::newRow("RGBAF32 -> RGBA8")
+        << RGBAColorModelID.id() << Float32BitsColorDepthID.id()
+        << RGBAColorModelID.id() << Integer8BitsColorDepthID.id();
+}
+
+#define START_BENCHMARK \
+    QFETCH(QString, srcModelID); \
+    QFETCH(QString, srcDepthID); \
+    QFETCH(QString, dstModelID); \
+    QFETCH(QString, dstDepthID); \
+    \
+    const KoColorSpace* srcColorSpace = KoColorSpaceRegistry::instance()->colorSpace(srcModelID, srcDepthID, 0); \
+    const KoColorSpace* dstColorSpace = KoColorSpaceRegistry::instance()->colorSpace(dstModelID, dstDepthID, 0); \
+    QVERIFY(srcColorSpace); \
+    QVERIFY(dstColorSpace); \
+    const int srcPixelSize = srcColorSpace->pixelSize(); \
+    const int dstPixelSize = dstColorSpace->pixelSize(); \
+    quint8* srcData = new quint8[NB_PIXELS * srcPixelSize]; \
+    quint8* dstData = new quint8[NB_PIXELS * dstPixelSize]; \
+    for (int i = 0; i < NB_PIXELS * srcPixelSize; i++) { \
+        srcData[i] = qrand() & 0xff; \
+    } \
+    /* float color spaces don't like random garbage */ \
+    if (srcDepthID == Float32BitsColorDepthID.id()) { \
+        srcColorSpace->fromNormalisedChannelsValue(srcData, QVector<float>(srcColorSpace->channelCount(), 0.5)); \
+        for (int i = 1; i < NB_PIXELS; i++) { \
+            memcpy(srcData + i * srcPixelSize, srcData, srcPixelSize); \
+        } \
+    } \
+    /* warm up the conversion cache */ \
+    srcColorSpace->convertPixelsTo(srcData, dstData, dstColorSpace, 1, \
+                                   KoColorConversionTransformation::internalRenderingIntent(), \
+                                   KoColorConversionTransformation::internalConversionFlags());
+
+#define END_BENCHMARK \
+    delete[] srcData; \
+    delete[] dstData;
+
+namespace {
+
+class ConvertTilesRunnable : public QRunnable
+{
+public:
+    ConvertTilesRunnable(const KoColorSpace *srcColorSpace, const KoColorSpace *dstColorSpace,
+                         const quint8 *srcData, quint8 *dstData,
+                         int firstTile, int numTiles)
+        : m_srcColorSpace(srcColorSpace),
+          m_dstColorSpace(dstColorSpace),
+          m_srcData(srcData),
+          m_dstData(dstData),
+          m_firstTile(firstTile),
+          m_numTiles(numTiles)
+    {
+    }
+
+    void run() override {
+        const int tileArea = TILE_SIZE * TILE_SIZE;
+        const int srcPixelSize = m_srcColorSpace->pixelSize();
+        const int dstPixelSize = m_dstColorSpace->pixelSize();
+
+        for (int i = m_firstTile; i < m_firstTile + m_numTiles; i++) {
+            m_srcColorSpace->convertPixelsTo(m_srcData + i * tileArea * srcPixelSize,
+                                             m_dstData + i * tileArea * dstPixelSize,
+                                             m_dstColorSpace, tileArea,
+                                             KoColorConversionTransformation::internalRenderingIntent(),
+                                             KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+
+private:
+    const KoColorSpace *m_srcColorSpace;
+    const KoColorSpace *m_dstColorSpace;
+    const quint8 *m_srcData;
+    quint8 *m_dstData;
+    int m_firstTile;
+    int m_numTiles;
+};
+
+}
+
+void KoColorConversionBenchmark::benchmarkScanlines_data()
+{
+    createRowsColumns();
+}
+
+void KoColorConversionBenchmark::benchmarkScanlines()
+{
+    START_BENCHMARK
+    QBENCHMARK {
+        for (int i = 0; i < NB_PIXELS; i += TILE_SIZE) {
+            srcColorSpace->convertPixelsTo(srcData + i * srcPixelSize,
+                                           dstData + i * dstPixelSize,
+                                           dstColorSpace, TILE_SIZE,
+                                           KoColorConversionTransformation::internalRenderingIntent(),
+                                           KoColorConversionTransformation::internalConversionFlags());
+        }
+    }
+    END_BENCHMARK
+}
+
+void KoColorConversionBenchmark::benchmarkTiles_data()
+{
+    createRowsColumns();
+}
+
+void KoColorConversionBenchmark::benchmarkTiles()
+{
+    START_BENCHMARK
+    QBENCHMARK {
+        ConvertTilesRunnable runnable(srcColorSpace, dstColorSpace,
+                                      srcData, dstData,
+                                      0, NB_TILES);
+        runnable.run();
+    }
+    END_BENCHMARK
+}
+
+void KoColorConversionBenchmark::benchmarkTilesMultithreaded_data()
+{
+    createRowsColumns();
+}
+
+void KoColorConversionBenchmark::benchmarkTilesMultithreaded()
+{
+    START_BENCHMARK
+
+    QThreadPool pool;
+    const int numThreads = qMax(1, QThread::idealThreadCount());
+    const int tilesPerThread = (NB_TILES + numThreads - 1) / numThreads;
+
+    QBENCHMARK {
+        for (int i = 0; i < NB_TILES; i += tilesPerThread) {
+            pool.start(new ConvertTilesRunnable(srcColorSpace, dstColorSpace,
+                                                srcData, dstData,
+                                                i, qMin(tilesPerThread, NB_TILES - i)));
+        }
+        pool.waitForDone();
+    }
+    END_BENCHMARK
+}
+
+QTEST_GUILESS_MAIN(KoColorConversionBenchmark)
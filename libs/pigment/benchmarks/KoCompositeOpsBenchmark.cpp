@@ -24,6 +24,8 @@
 
 #include <KoColorSpaceTraits.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoCompositeOpRegistry.h>
+#include <KoColorModelStandardIds.h>
 
 #include <QTest>
 
@@ -38,6 +40,9 @@ const quint8 OPACITY_HALF = 128;
 const int TILES_IN_WIDTH = IMG_WIDTH / TILE_WIDTH;
 const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
 
+// big enough for RGBA F32
+const int MAX_PIXEL_SIZE = 16;
+
 
 #define COMPOSITE_BENCHMARK \
         for (int y = 0; y < TILES_IN_HEIGHT; y++){                                              \
@@ -52,15 +57,15 @@ const int TILES_IN_HEIGHT = IMG_HEIGHT / TILE_HEIGHT;
 
 void KoCompositeOpsBenchmark::initTestCase()
 {
-    m_dstBuffer = new quint8[ TILE_WIDTH * TILE_HEIGHT * KoBgrU16Traits::pixelSize ];
-    m_srcBuffer = new quint8[ TILE_WIDTH * TILE_HEIGHT * KoBgrU16Traits::pixelSize ];
+    m_dstBuffer = new quint8[ TILE_WIDTH * TILE_HEIGHT * MAX_PIXEL_SIZE ];
+    m_srcBuffer = new quint8[ TILE_WIDTH * TILE_HEIGHT * MAX_PIXEL_SIZE ];
 }
 
 // this is called before every benchmark
 void KoCompositeOpsBenchmark::init()
 {
-    memset(m_dstBuffer, 42 , TILE_WIDTH * TILE_HEIGHT * KoBgrU16Traits::pixelSize);
-    memset(m_srcBuffer, 42 , TILE_WIDTH * TILE_HEIGHT * KoBgrU16Traits::pixelSize);
+    memset(m_dstBuffer, 42 , TILE_WIDTH * TILE_HEIGHT * MAX_PIXEL_SIZE);
+    memset(m_srcBuffer, 42 , TILE_WIDTH * TILE_HEIGHT * MAX_PIXEL_SIZE);
 }
 
 
@@ -87,5 +92,58 @@ void KoCompositeOpsBenchmark::benchmarkCompositeAlphaDarken()
     }
 }
 
+void KoCompositeOpsBenchmark::benchmarkGenericBlendModes_data()
+{
+    QTest::addColumn<QString>("depthId");
+    QTest::addColumn<QString>("compositeOpId");
+
+    const QStringList depthIds = QStringList()
+        << Integer8BitsColorDepthID.id()
+        << Integer16BitsColorDepthID.id()
+        << Float32BitsColorDepthID.id();
+
+    const QStringList compositeOpIds = QStringList()
+        << COMPOSITE_MULT << COMPOSITE_SCREEN << COMPOSITE_OVERLAY
+        << COMPOSITE_DARKEN << COMPOSITE_LIGHTEN << COMPOSITE_DODGE
+        << COMPOSITE_BURN << COMPOSITE_HARD_LIGHT << COMPOSITE_SOFT_LIGHT_SVG
+        << COMPOSITE_DIFF << COMPOSITE_ADD << COMPOSITE_HARD_MIX
+        << COMPOSITE_HUE << COMPOSITE_SATURATION << COMPOSITE_COLOR
+        << COMPOSITE_LUMINIZE << COMPOSITE_COLOR_HSL << COMPOSITE_LIGHTNESS;
+
+    Q_FOREACH (const QString &depthId, depthIds) {
+        Q_FOREACH (const QString &compositeOpId, compositeOpIds) {
+            QTest::newRow(QString("%1 %2").arg(depthId).arg(compositeOpId).toLatin1())
+                << depthId << compositeOpId;
+        }
+    }
+}
+
+void KoCompositeOpsBenchmark::benchmarkGenericBlendModes()
+{
+    QFETCH(QString, depthId);
+    QFETCH(QString, compositeOpId);
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depthId, "");
+    QVERIFY(cs);
+
+    const KoCompositeOp *compositeOp = cs->compositeOp(compositeOpId);
+    QVERIFY(compositeOp);
+    QCOMPARE(compositeOp->id(), compositeOpId);
+
+    const int rowStride = TILE_WIDTH * cs->pixelSize();
+
+    QBENCHMARK{
+        for (int y = 0; y < TILES_IN_HEIGHT; y++){
+            for (int x = 0; x < TILES_IN_WIDTH; x++){
+                compositeOp->composite(m_dstBuffer, rowStride,
+                                       m_srcBuffer, rowStride,
+                                       0, 0,
+                                       TILE_WIDTH, TILE_HEIGHT,
+                                       OPACITY_HALF);
+            }
+        }
+    }
+}
+
 
 QTEST_GUILESS_MAIN(KoCompositeOpsBenchmark)
@@ -32,6 +32,8 @@ private Q_SLOTS:
     
     void benchmarkCompositeOver();
     void benchmarkCompositeAlphaDarken();
+    void benchmarkGenericBlendModes_data();
+    void benchmarkGenericBlendModes();
 
 private:
     quint8 * m_dstBuffer;
@@ -58,6 +58,13 @@ struct OptimizedOpsSelector
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return new KoCompositeOpOver<Traits>(cs);
     }
+    static KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        Q_UNUSED(cs);
+        Q_UNUSED(id);
+        Q_UNUSED(description);
+        Q_UNUSED(category);
+        return 0;
+    }
 };
 
 template<>
@@ -69,6 +76,23 @@ struct OptimizedOpsSelector<KoBgrU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericOp32(cs, id, description, category);
+    }
+};
+
+template<>
+struct OptimizedOpsSelector<KoBgrU16Traits>
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return new KoCompositeOpAlphaDarken<KoBgrU16Traits>(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return new KoCompositeOpOver<KoBgrU16Traits>(cs);
+    }
+    static KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericOp64(cs, id, description, category);
+    }
 };
 
 template<>
@@ -80,6 +104,13 @@ struct OptimizedOpsSelector<KoLabU8Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp32(cs);
     }
+    static KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        Q_UNUSED(cs);
+        Q_UNUSED(id);
+        Q_UNUSED(description);
+        Q_UNUSED(category);
+        return 0;
+    }
 };
 
 template<>
@@ -91,6 +122,9 @@ struct OptimizedOpsSelector<KoRgbF32Traits>
     static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
         return KoOptimizedCompositeOpFactory::createOverOp128(cs);
     }
+    static KoCompositeOp* createGenericOp(const KoColorSpace *cs, const QString& id, const QString& description, const QString& category) {
+        return KoOptimizedCompositeOpFactory::createGenericOp128(cs, id, description, category);
+    }
 };
 
 template<class Traits>
@@ -102,7 +136,13 @@ struct AddGeneralOps<Traits, true>
 
      template<CompositeFunc func>
      static void add(KoColorSpace* cs, const QString& id, const QString& description, const QString& category) {
-         cs->addCompositeOp(new KoCompositeOpGenericSC<Traits, func>(cs, id, description, category));
+         KoCompositeOp *op = OptimizedOpsSelector<Traits>::createGenericOp(cs, id, description, category);
+
+         if (!op) {
+             op = new KoCompositeOpGenericSC<Traits, func>(cs, id, description, category);
+         }
+
+         cs->addCompositeOp(op);
      }
 
      static void add(KoColorSpace* cs) {
@@ -175,7 +215,13 @@ struct AddRGBOps<Traits, true>
     template<void compositeFunc(Arg, Arg, Arg, Arg&, Arg&, Arg&)>
 
     static void add(KoColorSpace* cs, const QString& id, const QString& description, const QString& category) {
-        cs->addCompositeOp(new KoCompositeOpGenericHSL<Traits, compositeFunc>(cs, id, description, category));
+        KoCompositeOp *op = OptimizedOpsSelector<Traits>::createGenericOp(cs, id, description, category);
+
+        if (!op) {
+            op = new KoCompositeOpGenericHSL<Traits, compositeFunc>(cs, id, description, category);
+        }
+
+        cs->addCompositeOp(op);
     }
     
     static void add(KoColorSpace* cs) {
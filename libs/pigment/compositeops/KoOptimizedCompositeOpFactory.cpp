@@ -44,3 +44,18 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    return createOptimizedClass<KoOptimizedGenericOpFactoryPerArch<KoBgrU8Traits> >(KoOptimizedGenericOpParams(cs, id, description, category));
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp64(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    return createOptimizedClass<KoOptimizedGenericOpFactoryPerArch<KoBgrU16Traits> >(KoOptimizedGenericOpParams(cs, id, description, category));
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category)
+{
+    return createOptimizedClass<KoOptimizedGenericOpFactoryPerArch<KoRgbF32Traits> >(KoOptimizedGenericOpParams(cs, id, description, category));
+}
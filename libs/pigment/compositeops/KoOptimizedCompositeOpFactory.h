@@ -24,6 +24,7 @@
 
 class KoCompositeOp;
 class KoColorSpace;
+class QString;
 
 /**
  * The creation of the optimized composite ops is moved into a separate
@@ -44,6 +45,17 @@ public:
     static KoCompositeOp* createOverOp32(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOp128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+    /**
+     * Create the vectorized versions of the generic blending modes
+     * (KoCompositeOpGenericSC and KoCompositeOpGenericHSL) for RGBA
+     * U8, U16 and F32 respectively.
+     * Return null if \p id has no vectorized version or the CPU has no
+     * SIMD support.
+     */
+    static KoCompositeOp* createGenericOp32(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericOp64(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
+    static KoCompositeOp* createGenericOp128(const KoColorSpace *cs, const QString &id, const QString &description, const QString &category);
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
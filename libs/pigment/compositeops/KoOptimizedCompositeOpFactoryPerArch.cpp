@@ -26,6 +26,8 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpGeneric.h"
+#include "KoColorSpaceTraits.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -67,3 +69,27 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoBgrU8Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoBgrU8Traits>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createOptimizedGenericOp<Vc::CurrentImplementation::current(), KoBgrU8Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoBgrU16Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoBgrU16Traits>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createOptimizedGenericOp<Vc::CurrentImplementation::current(), KoBgrU16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoRgbF32Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoRgbF32Traits>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return createOptimizedGenericOp<Vc::CurrentImplementation::current(), KoRgbF32Traits>(param);
+}
@@ -23,10 +23,16 @@
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
 
+#include <QString>
+
 
 class KoCompositeOp;
 class KoColorSpace;
 
+struct KoBgrU8Traits;
+struct KoBgrU16Traits;
+struct KoRgbF32Traits;
+
 
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpAlphaDarken32;
@@ -50,5 +56,38 @@ struct KoOptimizedCompositeOpFactoryPerArch
     static ReturnType create(ParamType param);
 };
 
+struct KoOptimizedGenericOpParams
+{
+    KoOptimizedGenericOpParams(const KoColorSpace *_colorSpace,
+                                 const QString &_id,
+                                 const QString &_description,
+                                 const QString &_category)
+        : colorSpace(_colorSpace),
+          id(_id),
+          description(_description),
+          category(_category)
+    {
+    }
+
+    const KoColorSpace *colorSpace;
+    QString id;
+    QString description;
+    QString category;
+};
+
+/**
+ * Creates the vectorized generic blending modes, both separable and
+ * HSX ones. The returned value is null if the mode has no vectorized
+ * version.
+ */
+template<class Traits>
+struct KoOptimizedGenericOpFactoryPerArch
+{
+    typedef const KoOptimizedGenericOpParams& ParamType;
+    typedef KoCompositeOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType param);
+};
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORYPERARCH_H */
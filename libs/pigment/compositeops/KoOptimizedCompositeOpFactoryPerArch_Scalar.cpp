@@ -55,3 +55,36 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+/**
+ * There is no point in creating the scalar versions of the generic
+ * blending modes: the caller falls back to KoCompositeOpGenericSC or
+ * KoCompositeOpGenericHSL.
+ */
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoBgrU8Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoBgrU8Traits>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return 0;
+}
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoBgrU16Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoBgrU16Traits>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return 0;
+}
+
+template<>
+template<>
+KoOptimizedGenericOpFactoryPerArch<KoRgbF32Traits>::ReturnType
+KoOptimizedGenericOpFactoryPerArch<KoRgbF32Traits>::create<Vc::ScalarImpl>(ParamType param)
+{
+    Q_UNUSED(param);
+    return 0;
+}
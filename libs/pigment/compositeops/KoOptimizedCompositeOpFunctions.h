@@ -0,0 +1,568 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPFUNCTIONS_H_
+#define KOOPTIMIZEDCOMPOSITEOPFUNCTIONS_H_
+
+#include <limits>
+
+#include <KoCompositeOp.h>
+#include "KoColorSpaceMaths.h"
+#include "KoStreamedMath.h"
+
+/**
+ * Vectorized versions of the separable blending functions from
+ * KoCompositeOpFunctions.h. They are used by
+ * KoOptimizedCompositeOpGeneric.
+ *
+ * All the values are normalized into the [0, 1] range, whatever the
+ * channel type is. The functions follow the scalar versions formula
+ * by formula, including the order of the special cases, so the result
+ * differs from the scalar one only by the rounding of the integer
+ * arithmetic.
+ *
+ * The scalar functions clamp the result with Arithmetic::clamp(),
+ * which does nothing for floating point channels, so the vectorized
+ * versions clamp the result for the integer channels only.
+ */
+template<typename channels_type>
+struct KoVcBlendingTraits
+{
+    static ALWAYS_INLINE Vc::float_v clamp(Vc::float_v::AsArg x) {
+        return std::numeric_limits<channels_type>::is_integer ?
+            Vc::min(Vc::max(x, Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One)) : x;
+    }
+
+    /**
+     * The value is normalized exactly the same way as the pixels are
+     * (\see KoStreamedPixelIO), so the comparisons against the half
+     * value give the same result as the scalar integer ones.
+     */
+    static ALWAYS_INLINE Vc::float_v halfValue() {
+        return Vc::float_v(float(KoColorSpaceMathsTraits<channels_type>::halfValue) *
+                           (1.0f / float(KoColorSpaceMathsTraits<channels_type>::unitValue)));
+    }
+};
+
+namespace KoVcBlendFunctions {
+
+using Vc::float_v;
+using Vc::float_m;
+
+struct Multiply {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return src * dst;
+    }
+};
+
+struct Screen {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return src + dst - src * dst;
+    }
+};
+
+struct DarkenOnly {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return Vc::min(src, dst);
+    }
+};
+
+struct LightenOnly {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return Vc::max(src, dst);
+    }
+};
+
+struct Difference {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return Vc::abs(src - dst);
+    }
+};
+
+struct Equivalence {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return Vc::abs(dst - src);
+    }
+};
+
+struct Addition {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(src + dst);
+    }
+};
+
+struct Subtract {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(dst - src);
+    }
+};
+
+struct InverseSubtract {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(dst - (float_v(Vc::One) - src));
+    }
+};
+
+struct LinearBurn {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(src + dst - float_v(Vc::One));
+    }
+};
+
+struct LinearLight {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(src + src + dst - float_v(Vc::One));
+    }
+};
+
+struct Exclusion {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v x = src * dst;
+        return KoVcBlendingTraits<channels_type>::clamp(dst + src - (x + x));
+    }
+};
+
+struct GrainMerge {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(dst + src - KoVcBlendingTraits<channels_type>::halfValue());
+    }
+};
+
+struct GrainExtract {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(dst - src + KoVcBlendingTraits<channels_type>::halfValue());
+    }
+};
+
+struct Allanon {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return (src + dst) * KoVcBlendingTraits<channels_type>::halfValue();
+    }
+};
+
+struct PinLight {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v src2 = src + src;
+        return Vc::max(src2 - float_v(Vc::One), Vc::min(dst, src2));
+    }
+};
+
+struct HardLight {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v src2 = src + src;
+
+        // screen(src*2.0 - 1.0, dst)
+        const float_v src2s = src2 - float_v(Vc::One);
+        const float_v screen = (src2s + dst) - src2s * dst;
+
+        // multiply(src*2.0, dst)
+        const float_v multiply = KoVcBlendingTraits<channels_type>::clamp(src2 * dst);
+
+        return Vc::iif(src > KoVcBlendingTraits<channels_type>::halfValue(), screen, multiply);
+    }
+};
+
+struct Overlay {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return HardLight::blend<channels_type>(dst, src);
+    }
+};
+
+struct SoftLightSvg {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v one(Vc::One);
+        const float_v half(0.5f);
+        const float_v src2 = src + src;
+
+        const float_v D = Vc::iif(dst > float_v(0.25f),
+                                  Vc::sqrt(dst),
+                                  ((float_v(16.0f) * dst - float_v(12.0f)) * dst + float_v(4.0f)) * dst);
+
+        const float_v result =
+            Vc::iif(src > half,
+                    dst + (src2 - one) * (D - dst),
+                    dst - (one - src2) * dst * (one - dst));
+
+        return KoVcBlendingTraits<channels_type>::clamp(result);
+    }
+};
+
+struct SoftLight {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v one(Vc::One);
+        const float_v half(0.5f);
+        const float_v src2 = src + src;
+
+        const float_v result =
+            Vc::iif(src > half,
+                    dst + (src2 - one) * (Vc::sqrt(dst) - dst),
+                    dst - (one - src2) * dst * (one - dst));
+
+        return KoVcBlendingTraits<channels_type>::clamp(result);
+    }
+};
+
+struct ColorDodge {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v zero(Vc::Zero);
+        const float_v one(Vc::One);
+
+        const float_v invSrc = one - src;
+        float_v result = KoVcBlendingTraits<channels_type>::clamp(dst / invSrc);
+        result = Vc::iif(invSrc < dst, one, result);
+        result = Vc::iif(dst == zero, zero, result);
+
+        return result;
+    }
+};
+
+struct ColorBurn {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v zero(Vc::Zero);
+        const float_v one(Vc::One);
+
+        const float_v invDst = one - dst;
+        float_v result = one - KoVcBlendingTraits<channels_type>::clamp(invDst / src);
+        result = Vc::iif(src < invDst, zero, result);
+        result = Vc::iif(dst == one, one, result);
+
+        return result;
+    }
+};
+
+struct HardMix {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return Vc::iif(dst > KoVcBlendingTraits<channels_type>::halfValue(),
+                       ColorDodge::blend<channels_type>(src, dst),
+                       ColorBurn::blend<channels_type>(src, dst));
+    }
+};
+
+struct Divide {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v zero(Vc::Zero);
+        const float_v one(Vc::One);
+
+        const float_v result = KoVcBlendingTraits<channels_type>::clamp(dst / src);
+        return Vc::iif(src == zero, Vc::iif(dst == zero, zero, one), result);
+    }
+};
+
+struct Parallel {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        const float_v zero(Vc::Zero);
+        const float_v one(Vc::One);
+
+        const float_v s = Vc::iif(src != zero, one / src, one);
+        const float_v d = Vc::iif(dst != zero, one / dst, one);
+
+        return KoVcBlendingTraits<channels_type>::clamp((one + one) / (d + s));
+    }
+};
+
+struct GeometricMean {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(Vc::sqrt(dst * src));
+    }
+};
+
+struct AdditiveSubtractive {
+    template<typename channels_type>
+    static ALWAYS_INLINE float_v blend(float_v::AsArg src, float_v::AsArg dst) {
+        return KoVcBlendingTraits<channels_type>::clamp(Vc::abs(Vc::sqrt(dst) - Vc::sqrt(src)));
+    }
+};
+
+}
+
+/**
+ * Vectorized versions of the non-separable (HSX) blending functions
+ * from KoCompositeOpFunctions.h and of the helpers they use from
+ * KoColorSpaceMaths.h. The functions work on normalized float
+ * channels, exactly like their scalar counterparts.
+ */
+namespace KoVcHSXFunctions {
+
+using Vc::float_v;
+using Vc::float_m;
+
+ALWAYS_INLINE float_v min3(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+    return Vc::min(r, Vc::min(g, b));
+}
+
+ALWAYS_INLINE float_v max3(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+    return Vc::max(r, Vc::max(g, b));
+}
+
+ALWAYS_INLINE float_v epsilon() {
+    return float_v(std::numeric_limits<float>::epsilon());
+}
+
+/**
+ * The vectorized counterparts of HSYType, HSIType, HSLType and HSVType
+ */
+template<class HSXType>
+struct HSX;
+
+template<>
+struct HSX<HSYType>
+{
+    static ALWAYS_INLINE float_v getLightness(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        return float_v(0.299f) * r + float_v(0.587f) * g + float_v(0.114f) * b;
+    }
+
+    static ALWAYS_INLINE float_v getSaturation(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        return max3(r, g, b) - min3(r, g, b);
+    }
+};
+
+template<>
+struct HSX<HSIType>
+{
+    static ALWAYS_INLINE float_v getLightness(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        return (r + g + b) * float_v(0.33333333333333333333f);
+    }
+
+    static ALWAYS_INLINE float_v getSaturation(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        const float_v min = min3(r, g, b);
+        const float_v chroma = max3(r, g, b) - min;
+
+        return Vc::iif(chroma > epsilon(),
+                       float_v(Vc::One) - min / getLightness(r, g, b),
+                       float_v(Vc::Zero));
+    }
+};
+
+template<>
+struct HSX<HSLType>
+{
+    static ALWAYS_INLINE float_v getLightness(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        return (max3(r, g, b) + min3(r, g, b)) * float_v(0.5f);
+    }
+
+    static ALWAYS_INLINE float_v getSaturation(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        const float_v max = max3(r, g, b);
+        const float_v min = min3(r, g, b);
+        const float_v chroma = max - min;
+        const float_v light = (max + min) * float_v(0.5f);
+        const float_v div = float_v(Vc::One) - Vc::abs(float_v(2.0f) * light - float_v(Vc::One));
+
+        return Vc::iif(div > epsilon(), chroma / div, float_v(Vc::One));
+    }
+};
+
+template<>
+struct HSX<HSVType>
+{
+    static ALWAYS_INLINE float_v getLightness(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        return max3(r, g, b);
+    }
+
+    static ALWAYS_INLINE float_v getSaturation(float_v::AsArg r, float_v::AsArg g, float_v::AsArg b) {
+        const float_v max = max3(r, g, b);
+        const float_v min = min3(r, g, b);
+
+        return Vc::iif(max == float_v(Vc::Zero), float_v(Vc::Zero), (max - min) / max);
+    }
+};
+
+template<class HSXType>
+ALWAYS_INLINE void addLightness(float_v &r, float_v &g, float_v &b, float_v::AsArg light)
+{
+    const float_v zero(Vc::Zero);
+    const float_v one(Vc::One);
+
+    r += light;
+    g += light;
+    b += light;
+
+    const float_v l = HSX<HSXType>::getLightness(r, g, b);
+    const float_v n = min3(r, g, b);
+    const float_v x = max3(r, g, b);
+
+    const float_m belowZero = n < zero;
+
+    if (!belowZero.isEmpty()) {
+        const float_v iln = one / (l - n);
+        r = Vc::iif(belowZero, l + ((r - l) * l) * iln, r);
+        g = Vc::iif(belowZero, l + ((g - l) * l) * iln, g);
+        b = Vc::iif(belowZero, l + ((b - l) * l) * iln, b);
+    }
+
+    const float_m aboveUnit = x > one && (x - l) > epsilon();
+
+    if (!aboveUnit.isEmpty()) {
+        const float_v il = one - l;
+        const float_v ixl = one / (x - l);
+        r = Vc::iif(aboveUnit, l + ((r - l) * il) * ixl, r);
+        g = Vc::iif(aboveUnit, l + ((g - l) * il) * ixl, g);
+        b = Vc::iif(aboveUnit, l + ((b - l) * il) * ixl, b);
+    }
+}
+
+template<class HSXType>
+ALWAYS_INLINE void setLightness(float_v &r, float_v &g, float_v &b, float_v::AsArg light)
+{
+    addLightness<HSXType>(r, g, b, light - HSX<HSXType>::getLightness(r, g, b));
+}
+
+/**
+ * The scalar version sorts the channels to find the mid one. Here the
+ * same result is achieved without sorting: the max channel becomes
+ * \p sat, the min one becomes zero and the mid one is scaled
+ * proportionally.
+ */
+ALWAYS_INLINE void setSaturation(float_v &r, float_v &g, float_v &b, float_v::AsArg sat)
+{
+    const float_v zero(Vc::Zero);
+    const float_v min = min3(r, g, b);
+    const float_v chroma = max3(r, g, b) - min;
+    const float_m hasChroma = chroma > zero;
+    const float_v scale = sat / chroma;
+
+    r = Vc::iif(hasChroma, (r - min) * scale, zero);
+    g = Vc::iif(hasChroma, (g - min) * scale, zero);
+    b = Vc::iif(hasChroma, (b - min) * scale, zero);
+}
+
+template<class HSXType>
+struct Color {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        const float_v lum = HSX<HSXType>::getLightness(dr, dg, db);
+        dr = sr;
+        dg = sg;
+        db = sb;
+        setLightness<HSXType>(dr, dg, db, lum);
+    }
+};
+
+template<class HSXType>
+struct Lightness {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        setLightness<HSXType>(dr, dg, db, HSX<HSXType>::getLightness(sr, sg, sb));
+    }
+};
+
+template<class HSXType>
+struct IncreaseLightness {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        addLightness<HSXType>(dr, dg, db, HSX<HSXType>::getLightness(sr, sg, sb));
+    }
+};
+
+template<class HSXType>
+struct DecreaseLightness {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        addLightness<HSXType>(dr, dg, db, HSX<HSXType>::getLightness(sr, sg, sb) - float_v(Vc::One));
+    }
+};
+
+template<class HSXType>
+struct Saturation {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        const float_v sat = HSX<HSXType>::getSaturation(sr, sg, sb);
+        const float_v light = HSX<HSXType>::getLightness(dr, dg, db);
+        setSaturation(dr, dg, db, sat);
+        setLightness<HSXType>(dr, dg, db, light);
+    }
+};
+
+template<class HSXType>
+struct IncreaseSaturation {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        // lerp(dstSat, unitValue, srcSat)
+        const float_v dstSat = HSX<HSXType>::getSaturation(dr, dg, db);
+        const float_v sat = dstSat + HSX<HSXType>::getSaturation(sr, sg, sb) * (float_v(Vc::One) - dstSat);
+        const float_v light = HSX<HSXType>::getLightness(dr, dg, db);
+        setSaturation(dr, dg, db, sat);
+        setLightness<HSXType>(dr, dg, db, light);
+    }
+};
+
+template<class HSXType>
+struct DecreaseSaturation {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        // lerp(zeroValue, dstSat, srcSat)
+        const float_v sat = HSX<HSXType>::getSaturation(sr, sg, sb) * HSX<HSXType>::getSaturation(dr, dg, db);
+        const float_v light = HSX<HSXType>::getLightness(dr, dg, db);
+        setSaturation(dr, dg, db, sat);
+        setLightness<HSXType>(dr, dg, db, light);
+    }
+};
+
+template<class HSXType>
+struct Hue {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        const float_v sat = HSX<HSXType>::getSaturation(dr, dg, db);
+        const float_v lum = HSX<HSXType>::getLightness(dr, dg, db);
+        dr = sr;
+        dg = sg;
+        db = sb;
+        setSaturation(dr, dg, db, sat);
+        setLightness<HSXType>(dr, dg, db, lum);
+    }
+};
+
+template<class HSXType>
+struct DarkerColor {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        const float_m keepDst = HSX<HSXType>::getLightness(dr, dg, db) < HSX<HSXType>::getLightness(sr, sg, sb);
+        dr = Vc::iif(keepDst, dr, sr);
+        dg = Vc::iif(keepDst, dg, sg);
+        db = Vc::iif(keepDst, db, sb);
+    }
+};
+
+template<class HSXType>
+struct LighterColor {
+    static ALWAYS_INLINE void compose(float_v::AsArg sr, float_v::AsArg sg, float_v::AsArg sb, float_v &dr, float_v &dg, float_v &db) {
+        const float_m keepDst = HSX<HSXType>::getLightness(dr, dg, db) > HSX<HSXType>::getLightness(sr, sg, sb);
+        dr = Vc::iif(keepDst, dr, sr);
+        dg = Vc::iif(keepDst, dg, sg);
+        db = Vc::iif(keepDst, db, sb);
+    }
+};
+
+}
+
+#endif /* KOOPTIMIZEDCOMPOSITEOPFUNCTIONS_H_ */
@@ -0,0 +1,469 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPGENERIC_H_
+#define KOOPTIMIZEDCOMPOSITEOPGENERIC_H_
+
+#include "KoCompositeOpGeneric.h"
+#include "KoCompositeOpFunctions.h"
+#include "KoCompositeOpRegistry.h"
+#include "KoStreamedMath.h"
+#include "KoOptimizedCompositeOpFunctions.h"
+#include "KoOptimizedCompositeOpFactoryPerArch.h"
+
+
+/**
+ * Loads and stores Vc::float_v::size() pixels of a 4-channel color
+ * space with alpha in the last channel. The channels are normalized
+ * into the [0, 1] range. The color channels are stored into \p colors
+ * in the order they have in the pixel, so they can be addressed with
+ * Traits::red_pos and friends.
+ */
+template<typename channels_type>
+struct KoStreamedPixelIO;
+
+template<>
+struct KoStreamedPixelIO<quint8>
+{
+    static const int pixelSize = 4;
+
+    template<bool aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *colors, Vc::float_v &alpha) {
+        KoStreamedMath<_impl>::template fetch_colors_32<aligned>(data, colors[2], colors[1], colors[0]);
+        alpha = KoStreamedMath<_impl>::template fetch_alpha_32<aligned>(data);
+
+        const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+        colors[0] *= uint8MaxRec1;
+        colors[1] *= uint8MaxRec1;
+        colors[2] *= uint8MaxRec1;
+        alpha *= uint8MaxRec1;
+    }
+
+    // NOTE: \p data must be aligned
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE void write(quint8 *data, const Vc::float_v *colors, Vc::float_v::AsArg alpha) {
+        const Vc::float_v uint8Max(255.0f);
+        KoStreamedMath<_impl>::write_channels_32(data,
+                                                 clampUnit(alpha) * uint8Max,
+                                                 clampUnit(colors[2]) * uint8Max,
+                                                 clampUnit(colors[1]) * uint8Max,
+                                                 clampUnit(colors[0]) * uint8Max);
+    }
+
+    static ALWAYS_INLINE Vc::float_v clampUnit(Vc::float_v::AsArg x) {
+        return Vc::min(Vc::max(x, Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+    }
+};
+
+template<>
+struct KoStreamedPixelIO<quint16>
+{
+    static const int pixelSize = 8;
+
+    static ALWAYS_INLINE Vc::float_v::IndexType indexes() {
+        return Vc::float_v::IndexType(Vc::IndexesFromZero) * 4;
+    }
+
+    template<bool aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *colors, Vc::float_v &alpha) {
+        const quint16 *p = reinterpret_cast<const quint16*>(data);
+        const Vc::float_v::IndexType idx = indexes();
+        const Vc::float_v uint16MaxRec1(1.0f / 65535.0f);
+
+        for (int i = 0; i < 3; i++) {
+            colors[i].gather(p + i, idx);
+            colors[i] *= uint16MaxRec1;
+        }
+
+        alpha.gather(p + 3, idx);
+        alpha *= uint16MaxRec1;
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE void write(quint8 *data, const Vc::float_v *colors, Vc::float_v::AsArg alpha) {
+        quint16 *p = reinterpret_cast<quint16*>(data);
+        const Vc::float_v::IndexType idx = indexes();
+
+        for (int i = 0; i < 3; i++) {
+            toUint16(colors[i]).scatter(p + i, idx);
+        }
+
+        toUint16(alpha).scatter(p + 3, idx);
+    }
+
+    static ALWAYS_INLINE Vc::float_v toUint16(Vc::float_v::AsArg x) {
+        const Vc::float_v clamped = Vc::min(Vc::max(x, Vc::float_v(Vc::Zero)), Vc::float_v(Vc::One));
+        return Vc::round(clamped * Vc::float_v(65535.0f));
+    }
+};
+
+template<>
+struct KoStreamedPixelIO<float>
+{
+    static const int pixelSize = 16;
+
+    struct Pixel {
+        float c0;
+        float c1;
+        float c2;
+        float alpha;
+    };
+
+    template<bool aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void fetch(const quint8 *data, Vc::float_v *colors, Vc::float_v &alpha) {
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> wrapper(reinterpret_cast<Pixel*>(const_cast<quint8*>(data)));
+        tie(colors[0], colors[1], colors[2], alpha) = wrapper[indexes];
+    }
+
+    template<Vc::Implementation _impl>
+    static ALWAYS_INLINE void write(quint8 *data, const Vc::float_v *colors, Vc::float_v::AsArg alpha) {
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+        Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> wrapper(reinterpret_cast<Pixel*>(data));
+        wrapper[indexes] = tie(colors[0], colors[1], colors[2], alpha);
+    }
+};
+
+/**
+ * Adapts a separable blending function from
+ * KoOptimizedCompositeOpFunctions.h to the interface of
+ * GenericCompositor: the function is applied to every color channel
+ * independently.
+ */
+template<class BlendFunc>
+struct KoVcSeparableColorFunc
+{
+    template<class Traits>
+    static ALWAYS_INLINE void compose(const Vc::float_v *src, const Vc::float_v *dst, Vc::float_v *result) {
+        typedef typename Traits::channels_type channels_type;
+
+        for (int i = 0; i < 3; i++) {
+            result[i] = BlendFunc::template blend<channels_type>(src[i], dst[i]);
+        }
+    }
+};
+
+/**
+ * Adapts a non-separable (HSX) blending function from
+ * KoOptimizedCompositeOpFunctions.h to the interface of
+ * GenericCompositor. The result is converted into the channel type
+ * the same way as KoCompositeOpGenericHSL does with scale().
+ */
+template<class HSXFunc>
+struct KoVcHSXColorFunc
+{
+    template<class Traits>
+    static ALWAYS_INLINE void compose(const Vc::float_v *src, const Vc::float_v *dst, Vc::float_v *result) {
+        typedef typename Traits::channels_type channels_type;
+
+        Vc::float_v r = dst[Traits::red_pos];
+        Vc::float_v g = dst[Traits::green_pos];
+        Vc::float_v b = dst[Traits::blue_pos];
+
+        HSXFunc::compose(src[Traits::red_pos], src[Traits::green_pos], src[Traits::blue_pos], r, g, b);
+
+        result[Traits::red_pos] = KoVcBlendingTraits<channels_type>::clamp(r);
+        result[Traits::green_pos] = KoVcBlendingTraits<channels_type>::clamp(g);
+        result[Traits::blue_pos] = KoVcBlendingTraits<channels_type>::clamp(b);
+    }
+};
+
+/**
+ * The compositor for KoStreamedMath, which implements the same
+ * formula as KoCompositeOpGenericSC and KoCompositeOpGenericHSL with
+ * all the color channels enabled. \p ColorFunc calculates the blended
+ * color (\see KoVcSeparableColorFunc and KoVcHSXColorFunc). The edge
+ * pixels of the rows are processed with \p ScalarOp, that is the
+ * scalar generic op with the same blending function.
+ */
+template<class Traits, class ColorFunc, class ScalarOp, bool alphaLocked>
+struct GenericCompositor {
+    struct OptionalParams {
+        OptionalParams(const KoCompositeOp::ParameterInfo& params)
+            : channelFlags(params.channelFlags)
+        {
+        }
+        const QBitArray &channelFlags;
+    };
+
+    typedef typename Traits::channels_type channels_type;
+    typedef KoStreamedPixelIO<channels_type> PixelIO;
+
+    // \see docs in AlphaDarkenCompositor32
+    template<bool haveMask, bool src_aligned, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeVector(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        Q_UNUSED(oparams);
+
+        Vc::float_v src_c[3];
+        Vc::float_v src_alpha;
+
+        PixelIO::template fetch<src_aligned, _impl>(src, src_c, src_alpha);
+
+        src_alpha *= Vc::float_v(opacity);
+
+        if (haveMask) {
+            const Vc::float_v uint8MaxRec1(1.0f / 255.0f);
+            src_alpha *= KoStreamedMath<_impl>::fetch_mask_8(mask) * uint8MaxRec1;
+        }
+
+        const Vc::float_v zeroValue(Vc::Zero);
+        const Vc::float_v oneValue(Vc::One);
+
+        /**
+         * The source cannot change the destination, since it is fully
+         * transparent. With the alpha channel locked we still have to
+         * clear the transparent pixels of the destination.
+         */
+        if (!alphaLocked && (src_alpha == zeroValue).isFull()) {
+            return;
+        }
+
+        Vc::float_v dst_c[3];
+        Vc::float_v dst_alpha;
+
+        PixelIO::template fetch<true, _impl>(dst, dst_c, dst_alpha);
+
+        Vc::float_v result[3];
+        ColorFunc::template compose<Traits>(src_c, dst_c, result);
+
+        if (alphaLocked) {
+            /**
+             * KoCompositeOpBase clears the fully transparent pixels
+             * when the alpha channel is locked
+             */
+            const Vc::float_m dstVisible = dst_alpha != zeroValue;
+
+            for (int i = 0; i < 3; i++) {
+                dst_c[i] = Vc::iif(dstVisible, dst_c[i] + (result[i] - dst_c[i]) * src_alpha, zeroValue);
+            }
+        } else {
+            const Vc::float_v new_alpha = src_alpha + dst_alpha - src_alpha * dst_alpha;
+
+            const Vc::float_v srcOnly = (oneValue - dst_alpha) * src_alpha;
+            const Vc::float_v dstOnly = (oneValue - src_alpha) * dst_alpha;
+            const Vc::float_v both = src_alpha * dst_alpha;
+
+            /**
+             * The value of new_alpha can have *some* zero values,
+             * which will result in NaN values while division. The
+             * scalar version doesn't touch the color of such pixels.
+             */
+            const Vc::float_m empty = new_alpha == zeroValue;
+            const Vc::float_v new_alpha_rec = oneValue / new_alpha;
+
+            for (int i = 0; i < 3; i++) {
+                const Vc::float_v blended = dstOnly * dst_c[i] + srcOnly * src_c[i] + both * result[i];
+                dst_c[i] = Vc::iif(empty, dst_c[i], blended * new_alpha_rec);
+            }
+
+            dst_alpha = new_alpha;
+        }
+
+        PixelIO::template write<_impl>(dst, dst_c, dst_alpha);
+    }
+
+    template <bool haveMask, Vc::Implementation _impl>
+    static ALWAYS_INLINE void compositeOnePixelScalar(const quint8 *src, quint8 *dst, const quint8 *mask, float opacity, const OptionalParams &oparams)
+    {
+        using namespace Arithmetic;
+        const qint32 alpha_pos = Traits::alpha_pos;
+
+        const channels_type *s = reinterpret_cast<const channels_type*>(src);
+        channels_type *d = reinterpret_cast<channels_type*>(dst);
+
+        const channels_type srcAlpha = s[alpha_pos];
+        const channels_type dstAlpha = d[alpha_pos];
+        const channels_type maskAlpha = haveMask ? scale<channels_type>(*mask) : unitValue<channels_type>();
+
+        if (alphaLocked && dstAlpha == zeroValue<channels_type>()) {
+            memset(dst, 0, PixelIO::pixelSize);
+        }
+
+        const channels_type newDstAlpha =
+            ScalarOp::template composeColorChannels<alphaLocked, true>(
+                s, srcAlpha, d, dstAlpha, maskAlpha,
+                scale<channels_type>(opacity), oparams.channelFlags);
+
+        d[alpha_pos] = alphaLocked ? dstAlpha : newDstAlpha;
+    }
+};
+
+/**
+ * A vectorized version of KoCompositeOpGenericSC and
+ * KoCompositeOpGenericHSL for the 4-channel color spaces with alpha
+ * in the last channel: RGBA U8, U16 and F32. \p ScalarOp is the
+ * scalar op being replaced, \p ColorFunc is the vectorized version of
+ * its blending function.
+ *
+ * Only the case, when all the color channels are enabled, is
+ * vectorized. The alpha channel may be locked. Everything else is
+ * passed to the scalar implementation.
+ */
+template<Vc::Implementation _impl, class Traits, class ScalarOp, class ColorFunc>
+class KoOptimizedCompositeOpGeneric : public ScalarOp
+{
+    typedef ScalarOp base_class;
+
+public:
+    KoOptimizedCompositeOpGeneric(const KoColorSpace* cs, const QString& id, const QString& description, const QString& category)
+        : base_class(cs, id, description, category) { }
+
+    using KoCompositeOp::composite;
+
+    void composite(const KoCompositeOp::ParameterInfo& params) const override
+    {
+        const QBitArray &flags = params.channelFlags;
+
+        const bool allColorChannels =
+            flags.isEmpty() ||
+            (flags.at(0) && flags.at(1) && flags.at(2));
+
+        if (!allColorChannels) {
+            base_class::composite(params);
+            return;
+        }
+
+        const bool alphaLocked = !flags.isEmpty() && !flags.at(Traits::alpha_pos);
+
+        if (params.maskRowStart) {
+            if (alphaLocked) {
+                composite<true, true>(params);
+            } else {
+                composite<true, false>(params);
+            }
+        } else {
+            if (alphaLocked) {
+                composite<false, true>(params);
+            } else {
+                composite<false, false>(params);
+            }
+        }
+    }
+
+private:
+    template <bool haveMask, bool alphaLocked>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        typedef GenericCompositor<Traits, ColorFunc, base_class, alphaLocked> Compositor;
+
+        KoStreamedMath<_impl>::template genericComposite<haveMask, false, Compositor, Compositor::PixelIO::pixelSize>(params);
+    }
+};
+
+/**
+ * Creates the vectorized version of the generic (separable or HSX)
+ * blending mode \p param.id, or returns null if there is no such
+ * version. The mapping of the ids to the blending functions must be
+ * kept in sync with KoCompositeOps.h.
+ *
+ * Gamma Dark/Light, Arcus Tangent, Vivid Light and Hard Overlay are
+ * not vectorized: they either need pow/atan or have too many special
+ * cases to gain anything. Neither are the normal map ops.
+ */
+template<Vc::Implementation _impl, class Traits>
+KoCompositeOp* createOptimizedGenericOp(const KoOptimizedGenericOpParams &param)
+{
+    typedef typename Traits::channels_type T;
+    namespace F = KoVcBlendFunctions;
+    namespace H = KoVcHSXFunctions;
+
+#define CREATE_SC_OP(scalarFunc, vectorFunc) \
+    new KoOptimizedCompositeOpGeneric<_impl, Traits, KoCompositeOpGenericSC<Traits, &scalarFunc<T> >, KoVcSeparableColorFunc<F::vectorFunc> >(param.colorSpace, param.id, param.description, param.category)
+
+#define CREATE_HSX_OP(scalarFunc, vectorFunc, HSXType) \
+    new KoOptimizedCompositeOpGeneric<_impl, Traits, KoCompositeOpGenericHSL<Traits, &scalarFunc<HSXType, float> >, KoVcHSXColorFunc<H::vectorFunc<HSXType> > >(param.colorSpace, param.id, param.description, param.category)
+
+    const QString &id = param.id;
+
+    if (id == COMPOSITE_OVERLAY)                 return CREATE_SC_OP(cfOverlay, Overlay);
+    if (id == COMPOSITE_GRAIN_MERGE)             return CREATE_SC_OP(cfGrainMerge, GrainMerge);
+    if (id == COMPOSITE_GRAIN_EXTRACT)           return CREATE_SC_OP(cfGrainExtract, GrainExtract);
+    if (id == COMPOSITE_HARD_MIX)                return CREATE_SC_OP(cfHardMix, HardMix);
+    if (id == COMPOSITE_GEOMETRIC_MEAN)          return CREATE_SC_OP(cfGeometricMean, GeometricMean);
+    if (id == COMPOSITE_PARALLEL)                return CREATE_SC_OP(cfParallel, Parallel);
+    if (id == COMPOSITE_ALLANON)                 return CREATE_SC_OP(cfAllanon, Allanon);
+
+    if (id == COMPOSITE_SCREEN)                  return CREATE_SC_OP(cfScreen, Screen);
+    if (id == COMPOSITE_DODGE)                   return CREATE_SC_OP(cfColorDodge, ColorDodge);
+    if (id == COMPOSITE_LINEAR_DODGE)            return CREATE_SC_OP(cfAddition, Addition);
+    if (id == COMPOSITE_LIGHTEN)                 return CREATE_SC_OP(cfLightenOnly, LightenOnly);
+    if (id == COMPOSITE_HARD_LIGHT)              return CREATE_SC_OP(cfHardLight, HardLight);
+    if (id == COMPOSITE_SOFT_LIGHT_SVG)          return CREATE_SC_OP(cfSoftLightSvg, SoftLightSvg);
+    if (id == COMPOSITE_SOFT_LIGHT_PHOTOSHOP)    return CREATE_SC_OP(cfSoftLight, SoftLight);
+    if (id == COMPOSITE_PIN_LIGHT)               return CREATE_SC_OP(cfPinLight, PinLight);
+    if (id == COMPOSITE_LINEAR_LIGHT)            return CREATE_SC_OP(cfLinearLight, LinearLight);
+
+    if (id == COMPOSITE_BURN)                    return CREATE_SC_OP(cfColorBurn, ColorBurn);
+    if (id == COMPOSITE_LINEAR_BURN)             return CREATE_SC_OP(cfLinearBurn, LinearBurn);
+    if (id == COMPOSITE_DARKEN)                  return CREATE_SC_OP(cfDarkenOnly, DarkenOnly);
+
+    if (id == COMPOSITE_ADD)                     return CREATE_SC_OP(cfAddition, Addition);
+    if (id == COMPOSITE_SUBTRACT)                return CREATE_SC_OP(cfSubtract, Subtract);
+    if (id == COMPOSITE_INVERSE_SUBTRACT)        return CREATE_SC_OP(cfInverseSubtract, InverseSubtract);
+    if (id == COMPOSITE_MULT)                    return CREATE_SC_OP(cfMultiply, Multiply);
+    if (id == COMPOSITE_DIVIDE)                  return CREATE_SC_OP(cfDivide, Divide);
+
+    if (id == COMPOSITE_DIFF)                    return CREATE_SC_OP(cfDifference, Difference);
+    if (id == COMPOSITE_EXCLUSION)               return CREATE_SC_OP(cfExclusion, Exclusion);
+    if (id == COMPOSITE_EQUIVALENCE)             return CREATE_SC_OP(cfEquivalence, Equivalence);
+    if (id == COMPOSITE_ADDITIVE_SUBTRACTIVE)    return CREATE_SC_OP(cfAdditiveSubtractive, AdditiveSubtractive);
+
+    if (id == COMPOSITE_COLOR)                   return CREATE_HSX_OP(cfColor, Color, HSYType);
+    if (id == COMPOSITE_HUE)                     return CREATE_HSX_OP(cfHue, Hue, HSYType);
+    if (id == COMPOSITE_SATURATION)              return CREATE_HSX_OP(cfSaturation, Saturation, HSYType);
+    if (id == COMPOSITE_INC_SATURATION)          return CREATE_HSX_OP(cfIncreaseSaturation, IncreaseSaturation, HSYType);
+    if (id == COMPOSITE_DEC_SATURATION)          return CREATE_HSX_OP(cfDecreaseSaturation, DecreaseSaturation, HSYType);
+    if (id == COMPOSITE_LUMINIZE)                return CREATE_HSX_OP(cfLightness, Lightness, HSYType);
+    if (id == COMPOSITE_INC_LUMINOSITY)          return CREATE_HSX_OP(cfIncreaseLightness, IncreaseLightness, HSYType);
+    if (id == COMPOSITE_DEC_LUMINOSITY)          return CREATE_HSX_OP(cfDecreaseLightness, DecreaseLightness, HSYType);
+    if (id == COMPOSITE_DARKER_COLOR)            return CREATE_HSX_OP(cfDarkerColor, DarkerColor, HSYType);
+    if (id == COMPOSITE_LIGHTER_COLOR)           return CREATE_HSX_OP(cfLighterColor, LighterColor, HSYType);
+
+    if (id == COMPOSITE_COLOR_HSI)               return CREATE_HSX_OP(cfColor, Color, HSIType);
+    if (id == COMPOSITE_HUE_HSI)                 return CREATE_HSX_OP(cfHue, Hue, HSIType);
+    if (id == COMPOSITE_SATURATION_HSI)          return CREATE_HSX_OP(cfSaturation, Saturation, HSIType);
+    if (id == COMPOSITE_INC_SATURATION_HSI)      return CREATE_HSX_OP(cfIncreaseSaturation, IncreaseSaturation, HSIType);
+    if (id == COMPOSITE_DEC_SATURATION_HSI)      return CREATE_HSX_OP(cfDecreaseSaturation, DecreaseSaturation, HSIType);
+    if (id == COMPOSITE_INTENSITY)               return CREATE_HSX_OP(cfLightness, Lightness, HSIType);
+    if (id == COMPOSITE_INC_INTENSITY)           return CREATE_HSX_OP(cfIncreaseLightness, IncreaseLightness, HSIType);
+    if (id == COMPOSITE_DEC_INTENSITY)           return CREATE_HSX_OP(cfDecreaseLightness, DecreaseLightness, HSIType);
+
+    if (id == COMPOSITE_COLOR_HSL)               return CREATE_HSX_OP(cfColor, Color, HSLType);
+    if (id == COMPOSITE_HUE_HSL)                 return CREATE_HSX_OP(cfHue, Hue, HSLType);
+    if (id == COMPOSITE_SATURATION_HSL)          return CREATE_HSX_OP(cfSaturation, Saturation, HSLType);
+    if (id == COMPOSITE_INC_SATURATION_HSL)      return CREATE_HSX_OP(cfIncreaseSaturation, IncreaseSaturation, HSLType);
+    if (id == COMPOSITE_DEC_SATURATION_HSL)      return CREATE_HSX_OP(cfDecreaseSaturation, DecreaseSaturation, HSLType);
+    if (id == COMPOSITE_LIGHTNESS)               return CREATE_HSX_OP(cfLightness, Lightness, HSLType);
+    if (id == COMPOSITE_INC_LIGHTNESS)           return CREATE_HSX_OP(cfIncreaseLightness, IncreaseLightness, HSLType);
+    if (id == COMPOSITE_DEC_LIGHTNESS)           return CREATE_HSX_OP(cfDecreaseLightness, DecreaseLightness, HSLType);
+
+    if (id == COMPOSITE_COLOR_HSV)               return CREATE_HSX_OP(cfColor, Color, HSVType);
+    if (id == COMPOSITE_HUE_HSV)                 return CREATE_HSX_OP(cfHue, Hue, HSVType);
+    if (id == COMPOSITE_SATURATION_HSV)          return CREATE_HSX_OP(cfSaturation, Saturation, HSVType);
+    if (id == COMPOSITE_INC_SATURATION_HSV)      return CREATE_HSX_OP(cfIncreaseSaturation, IncreaseSaturation, HSVType);
+    if (id == COMPOSITE_DEC_SATURATION_HSV)      return CREATE_HSX_OP(cfDecreaseSaturation, DecreaseSaturation, HSVType);
+    if (id == COMPOSITE_VALUE)                   return CREATE_HSX_OP(cfLightness, Lightness, HSVType);
+    if (id == COMPOSITE_INC_VALUE)               return CREATE_HSX_OP(cfIncreaseLightness, IncreaseLightness, HSVType);
+    if (id == COMPOSITE_DEC_VALUE)               return CREATE_HSX_OP(cfDecreaseLightness, DecreaseLightness, HSVType);
+
+#undef CREATE_HSX_OP
+#undef CREATE_SC_OP
+
+    return 0;
+}
+
+#endif /* KOOPTIMIZEDCOMPOSITEOPGENERIC_H_ */
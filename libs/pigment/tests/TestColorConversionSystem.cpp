@@ -20,12 +20,19 @@
 #include "TestColorConversionSystem.h"
 
 #include <QTest>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
 
 #include <DebugPigment.h>
+#include <KoChannelInfo.h>
+#include <KoColorConversionCache.h>
 #include <KoColorProfile.h>
+#include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorConversionSystem.h>
 #include <KoColorModelStandardIds.h>
+#include <KoLut3DColorConversionTransformation.h>
 
 TestColorConversionSystem::TestColorConversionSystem()
 {
@@ -186,6 +193,241 @@ void TestColorConversionSystem::testAlphaU16Conversions()
     }
 }
 
+namespace {
+
+qreal normalizedChannelValue(const quint8 *pixel, int channel, int channelSize)
+{
+    return channelSize == 1 ?
+        qreal(pixel[channel]) / 255.0 :
+        qreal(reinterpret_cast<const quint16*>(pixel)[channel]) / 65535.0;
+}
+
+void checkLut3DConversion(const KoColorSpace *srcCs, const KoColorSpace *dstCs, qreal maxError)
+{
+    const int numPixels = 10000;
+
+    QVERIFY(KoLut3DColorConversionTransformation::isSupported(srcCs, dstCs));
+
+    QVector<quint8> src(numPixels * srcCs->pixelSize());
+    QVector<quint8> exactDst(numPixels * dstCs->pixelSize());
+    QVector<quint8> lutDst(numPixels * dstCs->pixelSize());
+
+    for (int i = 0; i < src.size(); i++) {
+        src[i] = qrand() & 0xff;
+    }
+
+    QScopedPointer<KoColorConversionTransformation> exactTransfo(
+        srcCs->createColorConverter(dstCs,
+                                    KoColorConversionTransformation::internalRenderingIntent(),
+                                    KoColorConversionTransformation::internalConversionFlags()));
+
+    KoLut3DColorConversionTransformation lutTransfo(exactTransfo.data());
+
+    exactTransfo->transform(src.constData(), exactDst.data(), numPixels);
+    lutTransfo.transform(src.constData(), lutDst.data(), numPixels);
+
+    const int channelSize = dstCs->channels().first()->size();
+    qreal error = 0.0;
+
+    for (int i = 0; i < numPixels; i++) {
+        const quint8 *exactPixel = exactDst.constData() + i * dstCs->pixelSize();
+        const quint8 *lutPixel = lutDst.constData() + i * dstCs->pixelSize();
+
+        for (int ch = 0; ch < 4; ch++) {
+            error = qMax(error,
+                         qAbs(normalizedChannelValue(exactPixel, ch, channelSize) -
+                              normalizedChannelValue(lutPixel, ch, channelSize)));
+        }
+    }
+
+    QVERIFY2(error <= maxError,
+             QString("%1 -> %2: error %3 is bigger than %4")
+                 .arg(srcCs->id()).arg(dstCs->id()).arg(error).arg(maxError).toLatin1());
+}
+
+}
+
+void TestColorConversionSystem::testLut3DConversions()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    QVERIFY(!KoLut3DColorConversionTransformation::isSupported(registry->rgb8(), registry->alpha8()));
+    QVERIFY(!KoLut3DColorConversionTransformation::isSupported(registry->alpha8(), registry->rgb8()));
+
+    checkLut3DConversion(registry->rgb16(), registry->rgb8(), 1.5 / 255.0);
+    checkLut3DConversion(registry->rgb8(), registry->rgb16(), 1.5 / 255.0);
+    checkLut3DConversion(registry->rgb8(), registry->lab16(), 0.01);
+    checkLut3DConversion(registry->lab16(), registry->rgb8(), 0.01);
+}
+
+void TestColorConversionSystem::testSharedLut3DConversions()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+    KoColorConversionCache *cache = registry->colorConversionCache();
+
+    const KoColorConversionTransformation::Intent intent =
+        KoColorConversionTransformation::internalRenderingIntent();
+    const KoColorConversionTransformation::ConversionFlags flags =
+        KoColorConversionTransformation::internalConversionFlags();
+    const KoColorConversionTransformation::ConversionFlags lutFlags =
+        flags | KoColorConversionTransformation::UseLut3D;
+
+    {
+        KoCachedColorConversionTransformation t1 =
+            cache->cachedConverter(registry->rgb16(), registry->rgb8(), intent, lutFlags);
+
+        // resets the fast path of the current thread
+        cache->cachedConverter(registry->rgb8(), registry->rgb16(), intent, lutFlags);
+
+        KoCachedColorConversionTransformation t2 =
+            cache->cachedConverter(registry->rgb16(), registry->rgb8(), intent, lutFlags);
+
+        QVERIFY(dynamic_cast<const KoLut3DColorConversionTransformation*>(t1.transformation()));
+        QCOMPARE(t1.transformation(), t2.transformation());
+    }
+
+    // the exact transformations are still used exclusively
+    {
+        KoCachedColorConversionTransformation t1 =
+            cache->cachedConverter(registry->rgb16(), registry->rgb8(), intent, flags);
+
+        cache->cachedConverter(registry->rgb8(), registry->rgb16(), intent, flags);
+
+        KoCachedColorConversionTransformation t2 =
+            cache->cachedConverter(registry->rgb16(), registry->rgb8(), intent, flags);
+
+        QVERIFY(t1.transformation() != t2.transformation());
+    }
+}
+
+void TestColorConversionSystem::testCachedPaths()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+    const KoColorConversionSystem *ccs = registry->colorConversionSystem();
+
+    const KoColorSpace *srcCs = registry->rgb8();
+    const KoColorSpace *dstCs = registry->lab16();
+
+    const QString srcKey = srcCs->colorModelId().id() + " " + srcCs->colorDepthId().id() + " " + srcCs->profile()->name();
+    const QString dstKey = dstCs->colorModelId().id() + " " + dstCs->colorDepthId().id() + " " + dstCs->profile()->name();
+
+    const QString referenceDot = ccs->bestPathToDot(srcKey, dstKey);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.path() + "/paths.cache";
+
+    QVERIFY(registry->saveColorConversionPaths(fileName));
+
+    // the memoized paths are dropped, so the path is restored from the loaded data
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+    QCOMPARE(ccs->bestPathToDot(srcKey, dstKey), referenceDot);
+    QVERIFY(ccs->existsGoodPath(srcCs->colorModelId().id(), srcCs->colorDepthId().id(), srcCs->profile()->name(),
+                                dstCs->colorModelId().id(), dstCs->colorDepthId().id(), dstCs->profile()->name()));
+
+    typedef QHash<QPair<QString, QString>, QList<QStringList> > CachedPaths;
+
+    auto readCachedPaths = [&fileName] (QStringList *providers, CachedPaths *paths) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        quint32 version = 0;
+        stream >> version;
+        stream >> *providers;
+        stream >> *paths;
+
+        return version == 3 && stream.status() == QDataStream::Ok;
+    };
+
+    auto writeCachedPaths = [&fileName] (const QStringList &providers, const CachedPaths &paths) {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) return false;
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream << quint32(3);
+        stream << providers;
+        stream << paths;
+
+        return stream.status() == QDataStream::Ok;
+    };
+
+    QStringList providers;
+    CachedPaths savedPaths;
+    QVERIFY(readCachedPaths(&providers, &savedPaths));
+    QVERIFY(providers.contains("icc"));
+    QVERIFY(savedPaths.contains(qMakePair(srcKey, dstKey)));
+
+    /**
+     * A valid path which is worse than the best one: rgb8 -> rgb16 -> lab16
+     * through the ICC engine. If it was loaded, it must be used instead of
+     * searching the graph.
+     */
+    const KoColorSpace *midCs = registry->rgb16();
+    const QString midKey = midCs->colorModelId().id() + " " + midCs->colorDepthId().id() + " " + midCs->profile()->name();
+
+    const QStringList srcNode = QStringList() << srcCs->colorModelId().id() << srcCs->colorDepthId().id() << srcCs->profile()->name();
+    const QStringList midNode = QStringList() << midCs->colorModelId().id() << midCs->colorDepthId().id() << midCs->profile()->name();
+    const QStringList dstNode = QStringList() << dstCs->colorModelId().id() << dstCs->colorDepthId().id() << dstCs->profile()->name();
+    const QStringList engineNode = QStringList() << "icc" << "icc" << "icc";
+
+    CachedPaths paths;
+    paths.insert(qMakePair(srcKey, dstKey),
+                 QList<QStringList>() << srcNode << engineNode << midNode << engineNode << dstNode);
+
+    // the path that is never requested in this session
+    paths.insert(qMakePair(dstKey, srcKey),
+                 QList<QStringList>() << dstNode << engineNode << midNode << engineNode << srcNode);
+
+    // the paths found with a different set of engines are ignored
+    QVERIFY(writeCachedPaths(QStringList(providers) << "unknown engine", paths));
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+    QCOMPARE(ccs->bestPathToDot(srcKey, dstKey), referenceDot);
+
+    QVERIFY(writeCachedPaths(providers, paths));
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+
+    const QString warmDot = ccs->bestPathToDot(srcKey, dstKey);
+    QVERIFY(warmDot != referenceDot);
+    QVERIFY(warmDot.contains(QString("\"icc icc icc\" -> \"%1\" [color=red]").arg(midKey)));
+    QVERIFY(warmDot.contains(QString("\"%1\" -> \"icc icc icc\" [color=red]").arg(midKey)));
+
+    // only the used path is saved again
+    QVERIFY(registry->saveColorConversionPaths(fileName));
+    QVERIFY(readCachedPaths(&providers, &savedPaths));
+    QCOMPARE(savedPaths.value(qMakePair(srcKey, dstKey)), paths.value(qMakePair(srcKey, dstKey)));
+    QVERIFY(!savedPaths.contains(qMakePair(dstKey, srcKey)));
+
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+    QCOMPARE(ccs->bestPathToDot(srcKey, dstKey), warmDot);
+
+    // a path through a node which doesn't exist in the graph is ignored
+    paths.clear();
+    paths.insert(qMakePair(srcKey, dstKey),
+                 QList<QStringList>() << srcNode << engineNode
+                 << (QStringList() << midNode[0] << midNode[1] << "nonexistent profile")
+                 << engineNode << dstNode);
+
+    QVERIFY(writeCachedPaths(providers, paths));
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+    QCOMPARE(ccs->bestPathToDot(srcKey, dstKey), referenceDot);
+
+    // broken data is ignored
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("garbage");
+    }
+
+    QVERIFY(registry->loadColorConversionPaths(fileName));
+    QCOMPARE(ccs->bestPathToDot(srcKey, dstKey), referenceDot);
+
+    QVERIFY(!registry->loadColorConversionPaths(dir.path() + "/nonexistent.cache"));
+}
+
 void TestColorConversionSystem::benchmarkAlphaToRgbConversion()
 {
     const KoColorSpace *alpha8 = KoColorSpaceRegistry::instance()->alpha8();
@@ -43,6 +43,9 @@ private Q_SLOTS:
     void testGoodConnections();
     void testAlphaConversions();
     void testAlphaU16Conversions();
+    void testLut3DConversions();
+    void testSharedLut3DConversions();
+    void testCachedPaths();
     void benchmarkAlphaToRgbConversion();
     void benchmarkRgbToAlphaConversion();
 private:
@@ -87,10 +87,21 @@
 #include "opengl/kis_opengl.h"
 #include "kis_spin_box_unit_manager.h"
 #include "kis_document_aware_spin_box_unit_manager.h"
+#include "kis_update_time_monitor.h"
 
 #include <KritaVersionWrapper.h>
 namespace {
 const QTime appStartTime(QTime::currentTime());
+
+QString colorConversionPathsLocation()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+}
+
+QString colorConversionPathsFileName()
+{
+    return colorConversionPathsLocation() + "/colorconversionpaths.cache";
+}
 }
 
 class KisApplicationPrivate
@@ -320,6 +331,18 @@ void KisApplication::loadPlugins()
     KisPaintOpRegistry::instance();
     KoColorSpaceRegistry::instance();
 
+    // warm start of the color conversion system, the paths are saved on exit
+    KoColorSpaceRegistry::instance()->loadColorConversionPaths(colorConversionPathsFileName());
+    connect(this, &KisApplication::aboutToQuit, [] () {
+        QDir().mkpath(colorConversionPathsLocation());
+        KoColorSpaceRegistry::instance()->saveColorConversionPaths(colorConversionPathsFileName());
+    });
+
+    // the trace requested by the "updateTraceFile" option is written on exit
+    connect(this, &KisApplication::aboutToQuit, [] () {
+        KisUpdateTimeMonitor::instance()->flushTrace();
+    });
+
     // Load the krita-specific tools
     setSplashScreenLoadingText(i18n("Loading Plugins for Krita/Tool..."));
     processEvents();
@@ -46,6 +46,8 @@
 #include "kis_prescaled_projection.h"
 #include "kis_image.h"
 #include "kis_image_barrier_locker.h"
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
 #include "kis_undo_adapter.h"
 #include "KisDocument.h"
 #include "flake/kis_shape_layer.h"
@@ -749,6 +751,7 @@ void KisCanvas2::notifyZoomChanged()
     }
 
     notifyLevelOfDetailChange();
+    notifyUpdatesPriorityChange();
     updateCanvas(); // update the canvas, because that isn't done when zooming using KoZoomAction
 }
 
@@ -782,6 +785,22 @@ void KisCanvas2::notifyLevelOfDetailChange()
     image->setDesiredLevelOfDetail(lod);
 }
 
+void KisCanvas2::notifyUpdatesPriorityChange()
+{
+    KisImageSP image = this->image();
+    if (!image) return;
+
+    /**
+     * Let the scheduler process the updates of the visible
+     * area first. The last view that has been moved or zoomed
+     * is the one the user is looking at.
+     */
+    const QRect visibleRect =
+        m_d->coordinatesConverter->widgetToImage(QRectF(canvasWidget()->rect())).toAlignedRect();
+
+    image->setUpdatesPriorityRect(visibleRect & image->bounds());
+}
+
 const KoColorProfile *  KisCanvas2::monitorProfile()
 {
     return m_d->displayColorConverter.monitorProfile();
@@ -819,8 +838,23 @@ void KisCanvas2::documentOffsetMoved(const QPoint &documentOffset)
 
     QPointF moveOffset = offsetAfter - offsetBefore;
 
-    if (!m_d->currentCanvasIsOpenGL)
+    if (!m_d->currentCanvasIsOpenGL) {
+        /**
+         * The QPainter canvas reads the image projection when
+         * panning, so load the area around the viewport from swap
+         * in advance. The OpenGL canvas keeps the whole image in
+         * textures, so it doesn't need that.
+         */
+        KisImageSP image = this->image();
+        QRect visibleRect = m_d->coordinatesConverter->widgetToImage(QRectF(canvasWidget()->rect())).toAlignedRect();
+        visibleRect.adjust(-visibleRect.width() / 2, -visibleRect.height() / 2,
+                           visibleRect.width() / 2, visibleRect.height() / 2);
+        image->projection()->dataManager()->prefetchTiles(visibleRect & image->bounds());
+
         m_d->prescaledProjection->viewportMoved(moveOffset);
+    }
+
+    notifyUpdatesPriorityChange();
 
     emit documentOffsetUpdateFinished();
 
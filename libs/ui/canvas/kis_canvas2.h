@@ -287,6 +287,7 @@ private:
     void resetCanvas(bool useOpenGL);
 
     void notifyLevelOfDetailChange();
+    void notifyUpdatesPriorityChange();
 
     // Completes construction of canvas.
     // To be called by KisView in its constructor, once it has been setup enough
@@ -357,6 +357,7 @@ KisDisplayColorConverter::conversionFlags()
 
     if (cfg.useBlackPointCompensation()) conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.useDisplayLut3D()) conversionFlags |= KoColorConversionTransformation::UseLut3D;
 
     return conversionFlags;
 }
@@ -298,6 +298,13 @@ void KisStatusBar::updateMemoryStatus()
               formatSize(stats.historicalMemorySize),
               formatSize(stats.swapSize));
 
+    if (stats.uniformSavedSize > 0) {
+        longStats +=
+            i18nc("tooltip on statusbar memory reporting button",
+                  "\nSaved by sharing uniform tiles:\t %1",
+                  formatSize(stats.uniformSavedSize));
+    }
+
     QString shortStats = formatSize(stats.imageSize);
     QIcon icon;
     qint64 warnLevel = stats.tilesHardLimit - stats.tilesHardLimit / 8;
@@ -31,6 +31,7 @@
 
 #include "kis_image.h"
 #include "kis_config.h"
+#include "kis_update_time_monitor.h"
 #include "KisPart.h"
 
 #ifdef HAVE_OPENEXR
@@ -67,6 +68,7 @@ KisOpenGLImageTextures::KisOpenGLImageTextures()
     m_conversionFlags = KoColorConversionTransformation::HighQuality;
     if (cfg.useBlackPointCompensation()) m_conversionFlags |= KoColorConversionTransformation::BlackpointCompensation;
     if (!cfg.allowLCMSOptimization()) m_conversionFlags |= KoColorConversionTransformation::NoOptimization;
+    if (cfg.useDisplayLut3D()) m_conversionFlags |= KoColorConversionTransformation::UseLut3D;
     m_useOcio = cfg.useOcio();
 }
 
@@ -270,6 +272,8 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
     QRect updateRect = rect & m_image->bounds();
     if (updateRect.isEmpty() || !(m_initialized)) return info;
 
+    KisUpdateTraceScope trace("canvas", "Texture conversion", updateRect);
+
     /**
      * Why the rect is artificial? That's easy!
      * It does not represent any real piece of the image. It is
@@ -336,7 +340,12 @@ KisOpenGLUpdateInfoSP KisOpenGLImageTextures::updateCacheImpl(const QRect& rect,
                 //create transform
                 if (m_createNewProofingTransform) {
                     const KoColorSpace *proofingSpace = KoColorSpaceRegistry::instance()->colorSpace(m_proofingConfig->proofingModel,m_proofingConfig->proofingDepth,m_proofingConfig->proofingProfile);
-                    m_proofingTransform.reset(tileInfo->generateProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, m_proofingConfig->conversionFlags, m_proofingConfig->warningColor, m_proofingConfig->adaptationState));
+                    KoColorConversionTransformation::ConversionFlags proofingFlags = m_proofingConfig->conversionFlags;
+                    if (m_conversionFlags.testFlag(KoColorConversionTransformation::UseLut3D)) {
+                        proofingFlags |= KoColorConversionTransformation::UseLut3D;
+                    }
+
+                    m_proofingTransform.reset(tileInfo->generateProofingTransform(dstCS, proofingSpace, m_renderingIntent, m_proofingConfig->intent, proofingFlags, m_proofingConfig->warningColor, m_proofingConfig->adaptationState));
                     m_createNewProofingTransform = false;
                 }
 
@@ -371,6 +380,8 @@ void KisOpenGLImageTextures::recalculateCache(KisUpdateInfoSP info)
     KisOpenGLUpdateInfoSP glInfo = dynamic_cast<KisOpenGLUpdateInfo*>(info.data());
     if(!glInfo) return;
 
+    KisUpdateTraceScope trace("canvas", "Texture upload", glInfo->dirtyImageRect());
+
     KisTextureTileUpdateInfoSP tileInfo;
     Q_FOREACH (tileInfo, glInfo->tileList) {
         KisTextureTile *tile = getTextureTileCR(tileInfo->tileCol(), tileInfo->tileRow());
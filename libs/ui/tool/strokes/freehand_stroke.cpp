@@ -78,6 +78,7 @@ void FreehandStrokeStrategy::init(bool needsIndirectPainting,
     setNeedsIndirectPainting(needsIndirectPainting);
     setIndirectPaintingCompositeOp(indirectPaintingCompositeOp);
     setSupportsWrapAroundMode(true);
+    setSupportsDabPipelining(true);
     enableJob(KisSimpleStrokeStrategy::JOB_DOSTROKE);
 
     KisUpdateTimeMonitor::instance()->startStrokeMeasure();
@@ -91,6 +92,17 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
     KisUpdateTimeMonitor::instance()->reportPaintOpPreset(info->painter->preset());
     KisRandomSourceSP rnd = m_d->randomSource.source();
 
+    /**
+     * Only the paintop-based dabs go through bltFixed(), the shapes
+     * are painted directly, so they should wait for the pipeline
+     */
+    if (d->type != Data::POINT &&
+        d->type != Data::LINE &&
+        d->type != Data::CURVE) {
+
+        waitForDabBlending();
+    }
+
     switch(d->type) {
     case Data::POINT:
         d->pi1.setRandomSource(rnd);
@@ -136,7 +148,21 @@ void FreehandStrokeStrategy::doStrokeCallback(KisStrokeJobData *data)
     };
 
     QVector<QRect> dirtyRects = info->painter->takeDirtyRegion();
-    KisUpdateTimeMonitor::instance()->reportJobFinished(data, dirtyRects);
+
+    /**
+     * The blending job might have failed to start or given its thread
+     * back to the context, don't let the last dabs wait for the next
+     * stroke job
+     */
+    flushDabBlending();
+
+    /**
+     * The pipelined dabs are set dirty by the pipeline when they are
+     * blended, but the monitor should still wait for their updates
+     */
+    KisUpdateTimeMonitor::instance()->reportJobFinished(data,
+        dirtyRects + takePipelinedDabRects());
+
     d->node->setDirty(dirtyRects);
 }
 
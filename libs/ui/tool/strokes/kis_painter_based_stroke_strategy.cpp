@@ -28,6 +28,9 @@
 #include "kis_image.h"
 #include <kis_distance_information.h>
 #include "kis_undo_stores.h"
+#include "kis_dab_blending_pipeline.h"
+#include "kis_work_stealing_task_pool.h"
+#include <brushengine/kis_paintop.h>
 
 
 KisPainterBasedStrokeStrategy::PainterInfo::PainterInfo()
@@ -77,6 +80,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const QString &id,
       m_resources(resources),
       m_painterInfos(painterInfos),
       m_transaction(0),
+      m_dabBlendingPipeline(0),
+      m_supportsDabPipelining(false),
       m_useMergeID(useMergeID)
 {
     init();
@@ -90,6 +95,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const QString &id,
       m_resources(resources),
       m_painterInfos(QVector<PainterInfo*>() <<  painterInfo),
       m_transaction(0),
+      m_dabBlendingPipeline(0),
+      m_supportsDabPipelining(false),
       m_useMergeID(useMergeID)
 {
     init();
@@ -109,6 +116,8 @@ KisPainterBasedStrokeStrategy::KisPainterBasedStrokeStrategy(const KisPainterBas
     : KisSimpleStrokeStrategy(rhs),
       m_resources(rhs.m_resources),
       m_transaction(rhs.m_transaction),
+      m_dabBlendingPipeline(0),
+      m_supportsDabPipelining(rhs.m_supportsDabPipelining),
       m_useMergeID(rhs.m_useMergeID)
 {
     Q_FOREACH (PainterInfo *info, rhs.m_painterInfos) {
@@ -155,10 +164,69 @@ void KisPainterBasedStrokeStrategy::initPainters(KisPaintDeviceSP targetDevice,
             painter->setChannelFlags(QBitArray());
         }
     }
+
+    if (m_supportsDabPipelining && !m_painterInfos.isEmpty()) {
+        /**
+         * All the painters paint on the same device, so they should
+         * share a single pipeline to keep the order of their dabs.
+         * If any of them blends the dabs directly, the pipeline
+         * would make its dabs overtake the pending ones.
+         */
+        bool canPipeline = true;
+
+        Q_FOREACH (PainterInfo *info, m_painterInfos) {
+            KisPaintOp *paintOp = info->painter->paintOp();
+            canPipeline &= paintOp && paintOp->supportsDabPipelining();
+        }
+
+        if (canPipeline) {
+            KisNodeSP node = m_resources->currentNode();
+
+            m_dabBlendingPipeline =
+                new KisDabBlendingPipeline(targetDevice,
+                                           [node] (const QVector<QRect> &rects) {
+                                               node->setDirty(rects);
+                                           },
+                                           KisWorkStealingTaskPool::currentPool());
+
+            Q_FOREACH (PainterInfo *info, m_painterInfos) {
+                info->painter->setDabBlendingPipeline(m_dabBlendingPipeline);
+            }
+        }
+    }
+}
+
+void KisPainterBasedStrokeStrategy::setSupportsDabPipelining(bool value)
+{
+    m_supportsDabPipelining = value;
+}
+
+void KisPainterBasedStrokeStrategy::waitForDabBlending()
+{
+    if (m_dabBlendingPipeline) {
+        m_dabBlendingPipeline->waitForDone();
+    }
+}
+
+void KisPainterBasedStrokeStrategy::flushDabBlending()
+{
+    if (m_dabBlendingPipeline) {
+        m_dabBlendingPipeline->flush();
+    }
+}
+
+QVector<QRect> KisPainterBasedStrokeStrategy::takePipelinedDabRects()
+{
+    return m_dabBlendingPipeline ?
+        m_dabBlendingPipeline->takeAddedRects() : QVector<QRect>();
 }
 
 void KisPainterBasedStrokeStrategy::deletePainters()
 {
+    // blends all the pending dabs before the painters go away
+    delete m_dabBlendingPipeline;
+    m_dabBlendingPipeline = 0;
+
     Q_FOREACH (PainterInfo *info, m_painterInfos) {
         delete info;
     }
@@ -221,6 +289,8 @@ void KisPainterBasedStrokeStrategy::initStrokeCallback()
 
 void KisPainterBasedStrokeStrategy::finishStrokeCallback()
 {
+    waitForDabBlending();
+
     KisNodeSP node = m_resources->currentNode();
     KisIndirectPaintingSupport *indirect =
         dynamic_cast<KisIndirectPaintingSupport*>(node.data());
@@ -262,6 +332,8 @@ void KisPainterBasedStrokeStrategy::finishStrokeCallback()
 
 void KisPainterBasedStrokeStrategy::cancelStrokeCallback()
 {
+    waitForDabBlending();
+
     KisNodeSP node = m_resources->currentNode();
     KisIndirectPaintingSupport *indirect =
         dynamic_cast<KisIndirectPaintingSupport*>(node.data());
@@ -289,6 +361,8 @@ void KisPainterBasedStrokeStrategy::cancelStrokeCallback()
 
 void KisPainterBasedStrokeStrategy::suspendStrokeCallback()
 {
+    waitForDabBlending();
+
     KisNodeSP node = m_resources->currentNode();
     KisIndirectPaintingSupport *indirect =
         dynamic_cast<KisIndirectPaintingSupport*>(node.data());
@@ -26,6 +26,7 @@
 class KisPainter;
 class KisDistanceInformation;
 class KisTransaction;
+class KisDabBlendingPipeline;
 
 
 class KRITAUI_EXPORT KisPainterBasedStrokeStrategy : public KisSimpleStrokeStrategy
@@ -83,6 +84,36 @@ protected:
 
     void setUndoEnabled(bool value);
 
+    /**
+     * Lets the stroke offload the blending of the dabs to a
+     * KisDabBlendingPipeline, if the paintop supports that. The dirty
+     * rects of the pipelined dabs are reported by the pipeline itself.
+     *
+     * \see KisPaintOp::supportsDabPipelining()
+     */
+    void setSupportsDabPipelining(bool value);
+
+    /**
+     * Blocks until all the pipelined dabs are blended onto the target
+     * device. Should be called before painting anything bypassing
+     * KisPainter::bltFixed().
+     */
+    void waitForDabBlending();
+
+    /**
+     * Makes sure the pipelined dabs get blended without waiting for
+     * the next dab. Should be called at the end of every job adding
+     * dabs, doesn't block on the running blending job.
+     */
+    void flushDabBlending();
+
+    /**
+     * Returns the rects of the dabs passed to the pipeline since the
+     * previous call. They are not in the dirty region of the painters,
+     * but get dirty later, when the dabs are blended.
+     */
+    QVector<QRect> takePipelinedDabRects();
+
 protected:
     KisPainterBasedStrokeStrategy(const KisPainterBasedStrokeStrategy &rhs, int levelOfDetail);
 
@@ -101,6 +132,8 @@ private:
     KisResourcesSnapshotSP m_resources;
     QVector<PainterInfo*> m_painterInfos;
     KisTransaction *m_transaction;
+    KisDabBlendingPipeline *m_dabBlendingPipeline;
+    bool m_supportsDabPipelining;
 
     KisPaintDeviceSP m_targetDevice;
     KisSelectionSP m_activeSelection;
@@ -52,6 +52,9 @@ public:
             }
         }
 
+        // the lookup table is built on top of the exact transform by pigment itself
+        conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
+
         m_transform = cmsCreateTransform(srcProfile->lcmsProfile(),
                                          srcColorSpaceType,
                                          dstProfile->lcmsProfile(),
@@ -121,6 +124,9 @@ public:
             }
         }
 
+        // the lookup table is built on top of the exact transform by pigment itself
+        conversionFlags &= ~KoColorConversionTransformation::UseLut3D;
+
         quint16 alarm[cmsMAXCHANNELS];//this seems to be bgr???
         alarm[0] = (cmsUInt16Number)gamutWarning[2]*256;
         alarm[1] = (cmsUInt16Number)gamutWarning[1]*256;
@@ -120,3 +120,63 @@ QRect KisGaussianBlurFilter::changedRect(const QRect & rect, const KisFilterConf
 
     return rect.adjusted( -halfWidth, -halfHeight, halfWidth, halfHeight);
 }
+
+bool KisGaussianBlurFilter::supportsSeparablePasses(const KisFilterConfigurationSP config, int lod) const
+{
+    KisLodTransformScalar t(lod);
+
+    QVariant value;
+    const float horizontalRadius = config->getProperty("horizRadius", value) ? t.scale(value.toFloat()) : 5;
+    const float verticalRadius = config->getProperty("vertRadius", value) ? t.scale(value.toFloat()) : 5;
+
+    /**
+     * KisGaussianKernel::applyGaussian() uses a single pass when one
+     * of the radii is zero, so there is nothing to cache
+     */
+    return horizontalRadius > 0 && verticalRadius > 0;
+}
+
+void KisGaussianBlurFilter::processSeparablePass(SeparablePass pass,
+                                                 const KisPaintDeviceSP src,
+                                                 KisPaintDeviceSP dst,
+                                                 const QRect &rect,
+                                                 const KisFilterConfigurationSP config,
+                                                 int lod) const
+{
+    KisLodTransformScalar t(lod);
+
+    QVariant value;
+    config->getProperty(pass == HorizontalPass ? "horizRadius" : "vertRadius", value);
+    const float radius = t.scale(value.toFloat());
+
+    QBitArray channelFlags = config->channelFlags();
+    if (channelFlags.isEmpty()) {
+        channelFlags = QBitArray(dst->colorSpace()->channelCount(), true);
+    }
+
+    KisConvolutionKernelSP kernel =
+        pass == HorizontalPass ?
+        KisGaussianKernel::createHorizontalKernel(radius) :
+        KisGaussianKernel::createVerticalKernel(radius);
+
+    KisConvolutionPainter painter(dst);
+    painter.setChannelFlags(channelFlags);
+    painter.applyMatrix(kernel, src,
+                        rect.topLeft(), rect.topLeft(), rect.size(),
+                        BORDER_REPEAT);
+}
+
+QRect KisGaussianBlurFilter::separablePassNeededRect(SeparablePass pass, const QRect &rect, const KisFilterConfigurationSP config, int lod) const
+{
+    KisLodTransformScalar t(lod);
+
+    QVariant value;
+
+    if (pass == HorizontalPass) {
+        const int halfWidth = config->getProperty("horizRadius", value) ? KisGaussianKernel::kernelSizeFromRadius(t.scale(value.toFloat())) / 2 : 5;
+        return rect.adjusted(-halfWidth, 0, halfWidth, 0);
+    } else {
+        const int halfHeight = config->getProperty("vertRadius", value) ? KisGaussianKernel::kernelSizeFromRadius(t.scale(value.toFloat())) / 2 : 5;
+        return rect.adjusted(0, -halfHeight, 0, halfHeight);
+    }
+}
@@ -45,6 +45,15 @@ public:
     KisConfigWidget * createConfigurationWidget(QWidget* parent, const KisPaintDeviceSP dev) const override;
     QRect neededRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const override;
     QRect changedRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const override;
+
+    bool supportsSeparablePasses(const KisFilterConfigurationSP config, int lod) const override;
+    void processSeparablePass(SeparablePass pass,
+                              const KisPaintDeviceSP src,
+                              KisPaintDeviceSP dst,
+                              const QRect &rect,
+                              const KisFilterConfigurationSP config,
+                              int lod) const override;
+    QRect separablePassNeededRect(SeparablePass pass, const QRect &rect, const KisFilterConfigurationSP config, int lod) const override;
 };
 
 #endif
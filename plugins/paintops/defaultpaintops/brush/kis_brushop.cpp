@@ -183,6 +183,16 @@ KisTimingInformation KisBrushOp::updateTimingImpl(const KisPaintInformation &inf
     return KisPaintOpPluginUtils::effectiveTiming(&m_airbrushOption, &m_rateOption, info);
 }
 
+bool KisBrushOp::supportsDabPipelining() const
+{
+    /**
+     * The sharp one-pixel brush paints lines with bitBlt() bypassing
+     * bltFixed(), so its lines would overtake the pending dabs
+     */
+    return !(m_sharpnessOption.isChecked() && m_brush &&
+             (m_brush->width() == 1) && (m_brush->height() == 1));
+}
+
 void KisBrushOp::paintLine(const KisPaintInformation& pi1, const KisPaintInformation& pi2, KisDistanceInformation *currentDistance)
 {
     if (m_sharpnessOption.isChecked() && m_brush && (m_brush->width() == 1) && (m_brush->height() == 1)) {
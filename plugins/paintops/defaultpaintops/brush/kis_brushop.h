@@ -55,6 +55,8 @@ public:
 
     void paintLine(const KisPaintInformation &pi1, const KisPaintInformation &pi2, KisDistanceInformation *currentDistance) override;
 
+    bool supportsDabPipelining() const override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 